@@ -0,0 +1,93 @@
+# bench_compare.py
+# 主机端工具：提取并比较基准测试固件 ([env:esp32s3_n8r8_bench]) 的输出。
+#
+# 用法:
+#   python bench_compare.py run.log                         # 提取一次运行的结果，输出为JSON
+#   python bench_compare.py base.log new.log                # 比较两次运行，列出每项的变化
+#   python bench_compare.py base.log new.log --threshold 10 # 退化超过10%时以返回码1退出
+#
+# 输入可以是串口监视器的原始日志（例如 log2file 过滤器保存的文件），只解析以 "BENCH " 开头的行，
+# 行首的时间戳等前缀会被忽略。格式定义见 include/Sys_Benchmark.h。
+
+import argparse
+import json
+import sys
+
+MARKER = "BENCH "
+
+# 数值越大越好的单位；其余单位（如 us/op）越小越好，bytes 只做展示
+HIGHER_IS_BETTER = {"MB/s", "ops/s", "msgs/s"}
+NEUTRAL_UNITS = {"bytes"}
+
+
+def read_results(path):
+    """返回 (meta, {suite.name: (value, unit)})。"""
+    meta = {}
+    results = {}
+    with open(path, "r", encoding="utf-8", errors="replace") as f:
+        for line in f:
+            pos = line.find(MARKER)
+            if pos < 0:
+                continue
+            try:
+                entry = json.loads(line[pos + len(MARKER):])
+            except json.JSONDecodeError:
+                continue
+            suite = entry.get("suite")
+            if suite == "meta":
+                meta = entry
+            elif "name" in entry and "value" in entry:
+                results[f"{suite}.{entry['name']}"] = (float(entry["value"]), entry.get("unit", ""))
+    return meta, results
+
+
+def change_percent(base, new, unit):
+    """改进为正、退化为负的百分比；基准值为0或单位无方向时返回None。"""
+    if base == 0 or unit in NEUTRAL_UNITS:
+        return None
+    delta = (new - base) / base * 100.0
+    return delta if unit in HIGHER_IS_BETTER else -delta
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Extract and compare Sys_Benchmark results.")
+    parser.add_argument("base", help="log of the baseline run (or the only run)")
+    parser.add_argument("new", nargs="?", help="log of the run to compare against the baseline")
+    parser.add_argument("--threshold", type=float, default=None, help="fail when any metric regresses by more than this percent")
+    args = parser.parse_args()
+
+    base_meta, base = read_results(args.base)
+    if not base:
+        print(f"[bench_compare.py] 未找到结果: {args.base}", file=sys.stderr)
+        return 2
+
+    if args.new is None:
+        json.dump({"meta": base_meta, "results": {k: {"value": v, "unit": u} for k, (v, u) in sorted(base.items())}},
+                  sys.stdout, indent=2, ensure_ascii=False)
+        print()
+        return 0
+
+    new_meta, new = read_results(args.new)
+    print(f"base: {base_meta.get('firmware', '?')}  new: {new_meta.get('firmware', '?')}")
+    regressions = 0
+    for key in sorted(set(base) | set(new)):
+        if key not in base or key not in new:
+            print(f"  {key:<48} {'(only in ' + ('base' if key in base else 'new') + ')':>34}")
+            continue
+        (base_value, unit), (new_value, _) = base[key], new[key]
+        change = change_percent(base_value, new_value, unit)
+        flag = ""
+        if change is not None and args.threshold is not None and change < -args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        change_text = f"{change:+7.1f}%" if change is not None else "       "
+        print(f"  {key:<48} {base_value:>12.3f} -> {new_value:>12.3f} {unit:<7} {change_text}{flag}")
+
+    if regressions:
+        print(f"{regressions} metric(s) regressed by more than {args.threshold}%.", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -5,6 +5,78 @@
  * @date [2025/7]
  */
 
+/**
+ * @brief [新增] 最小化的MessagePack解码器。
+ * @details 覆盖ArduinoJson的`serializeMsgPack`会产生的全部类型：
+ *          nil/bool、正负fixint、(u)int8-64、float32/64、str8/16/32、array16/32、map16/32及其fix形式。
+ * @param {ArrayBuffer} buffer 二进制帧的内容。
+ * @returns {*} 解码后的JavaScript值。
+ */
+function decodeMsgPack(buffer) {
+    const view = new DataView(buffer);
+    const textDecoder = new TextDecoder();
+    let offset = 0;
+
+    function readString(length) {
+        const str = textDecoder.decode(new Uint8Array(buffer, offset, length));
+        offset += length;
+        return str;
+    }
+
+    function readArray(length) {
+        const arr = new Array(length);
+        for (let i = 0; i < length; i++) arr[i] = readValue();
+        return arr;
+    }
+
+    function readMap(length) {
+        const obj = {};
+        for (let i = 0; i < length; i++) {
+            const key = readValue();
+            obj[key] = readValue();
+        }
+        return obj;
+    }
+
+    function readValue() {
+        const type = view.getUint8(offset++);
+        let value;
+
+        if (type <= 0x7f) return type;                         // positive fixint
+        if (type >= 0xe0) return type - 0x100;                 // negative fixint
+        if ((type & 0xe0) === 0xa0) return readString(type & 0x1f); // fixstr
+        if ((type & 0xf0) === 0x90) return readArray(type & 0x0f);  // fixarray
+        if ((type & 0xf0) === 0x80) return readMap(type & 0x0f);    // fixmap
+
+        switch (type) {
+            case 0xc0: return null;
+            case 0xc2: return false;
+            case 0xc3: return true;
+            case 0xca: value = view.getFloat32(offset); offset += 4; return value;
+            case 0xcb: value = view.getFloat64(offset); offset += 8; return value;
+            case 0xcc: value = view.getUint8(offset); offset += 1; return value;
+            case 0xcd: value = view.getUint16(offset); offset += 2; return value;
+            case 0xce: value = view.getUint32(offset); offset += 4; return value;
+            case 0xcf: value = Number(view.getBigUint64(offset)); offset += 8; return value;
+            case 0xd0: value = view.getInt8(offset); offset += 1; return value;
+            case 0xd1: value = view.getInt16(offset); offset += 2; return value;
+            case 0xd2: value = view.getInt32(offset); offset += 4; return value;
+            case 0xd3: value = Number(view.getBigInt64(offset)); offset += 8; return value;
+            case 0xd9: value = view.getUint8(offset); offset += 1; return readString(value);
+            case 0xda: value = view.getUint16(offset); offset += 2; return readString(value);
+            case 0xdb: value = view.getUint32(offset); offset += 4; return readString(value);
+            case 0xdc: value = view.getUint16(offset); offset += 2; return readArray(value);
+            case 0xdd: value = view.getUint32(offset); offset += 4; return readArray(value);
+            case 0xde: value = view.getUint16(offset); offset += 2; return readMap(value);
+            case 0xdf: value = view.getUint32(offset); offset += 4; return readMap(value);
+            default:
+                throw new Error(`Unsupported MessagePack type 0x${type.toString(16)}`);
+        }
+    }
+
+    return readValue();
+}
+
 document.addEventListener('DOMContentLoaded', () => {
     const wsStatus = document.getElementById('ws-status');
     const uptimeValue = document.getElementById('uptime-value');
@@ -15,6 +87,12 @@ document.addEventListener('DOMContentLoaded', () => {
     let rpcId = 1;
     let socket;
 
+    // [新增] 本地状态：system.stateUpdate 只推送变化的字段，在此合并
+    let systemState = {};
+
+    // [新增] 推送通知的首选编码：'msgpack'（二进制，更省带宽）或 'json'
+    const PREFERRED_ENCODING = 'msgpack';
+
     function connect() {
         // 使用当前页面的主机名动态构建WebSocket地址
         const wsUrl = `ws://${window.location.hostname}/ws`;
@@ -22,12 +100,24 @@ document.addEventListener('DOMContentLoaded', () => {
         cardFooter.textContent = `正在尝试连接到 ${wsUrl}...`;
 
         socket = new WebSocket(wsUrl);
+        socket.binaryType = 'arraybuffer'; // 二进制帧以ArrayBuffer交付，供MessagePack解码
 
         socket.onopen = () => {
             console.log('WebSocket Connected');
+            systemState = {}; // 新连接的第一条状态更新是完整快照
             wsStatus.textContent = '已连接';
             wsStatus.className = 'text-success';
             cardFooter.textContent = '连接成功！等待服务器消息...';
+
+            // [新增] 协商推送编码
+            if (PREFERRED_ENCODING !== 'json') {
+                socket.send(JSON.stringify({
+                    jsonrpc: '2.0',
+                    method: 'server.setEncoding',
+                    params: { encoding: PREFERRED_ENCODING },
+                    id: rpcId++
+                }));
+            }
         };
 
         socket.onclose = (event) => {
@@ -46,9 +136,12 @@ document.addEventListener('DOMContentLoaded', () => {
         };
 
         socket.onmessage = (event) => {
-            console.log('Received message:', event.data);
             try {
-                const data = JSON.parse(event.data);
+                // [新增] 二进制帧为MessagePack，文本帧为JSON
+                const data = (event.data instanceof ArrayBuffer)
+                    ? decodeMsgPack(event.data)
+                    : JSON.parse(event.data);
+                console.log('Received message:', data);
 
                 // 处理服务器推送的通知 (没有 id)
                 if (data.method) {
@@ -60,7 +153,7 @@ document.addEventListener('DOMContentLoaded', () => {
                 }
 
             } catch (e) {
-                console.error('Failed to parse JSON:', e);
+                console.error('Failed to decode message:', e);
             }
         };
     }
@@ -68,8 +161,11 @@ document.addEventListener('DOMContentLoaded', () => {
     function handleNotification(notification) {
         const { method, params } = notification;
 
-        if (method === 'system.stateUpdate' && params && params.uptime) {
-            uptimeValue.textContent = params.uptime;
+        if (method === 'system.stateUpdate' && params) {
+            Object.assign(systemState, params);
+            if (systemState.uptime !== undefined) {
+                uptimeValue.textContent = systemState.uptime;
+            }
             cardFooter.textContent = `状态更新于: ${new Date().toLocaleTimeString()}`;
         } else if (method === 'server.welcome') {
             cardFooter.textContent = `来自服务器的欢迎消息: ${params.message}`;
@@ -0,0 +1,129 @@
+# decode_flashlog.py
+# 主机端工具：解码 Sys_FlashLogger 写入的二进制日志分段 (<base>.<n>.blog)。
+#
+# 用法:
+#   python decode_flashlog.py system.0.blog system.1.blog ...   # 解码指定分段（自动按分段序号排序）
+#   python decode_flashlog.py ./logs/                           # 解码目录下所有 .blog 文件
+#   python decode_flashlog.py --level W ./logs/                 # 只输出警告及以上级别
+#
+# 分段文件可通过 Web 服务器的 /media 路由下载，例如 http://<esp32-ip>/media/sys/system.0.blog
+# 格式定义见 include/Sys_FlashLogger.h 与 include/Sys_Lzss.h，两者必须保持一致。
+
+import argparse
+import os
+import struct
+import sys
+
+SEGMENT_MAGIC = 0x474F4C53  # "SLOG"
+FORMAT_VERSION = 1
+CHUNK_MAGIC = 0x4B43        # "CK"
+CHUNK_COMPRESSED = 0x01
+LEVEL_TAG_DEFINITION = 0xFF
+
+SEGMENT_HEADER = struct.Struct("<IBBHIHH")   # magic, version, header_size, sector_size, segment_seq, boot_seq, reserved
+CHUNK_HEADER = struct.Struct("<HBBHHHHI")    # magic, flags, reserved, raw_len, stored_len, record_count, boot_seq, first_ts
+RECORD_HEADER = struct.Struct("<IBBH")       # timestamp_ms, level, tag_id, length
+
+# 与 esp_log_level_t 一致
+LEVEL_NAMES = {1: "E", 2: "W", 3: "I", 4: "D", 5: "V"}
+
+
+def lzss_decompress(data, raw_len):
+    """Sys_Lzss::decompress 的Python实现。"""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        flags = data[i]
+        i += 1
+        for bit in range(8):
+            if i >= len(data):
+                break
+            if flags & (1 << bit):
+                if i + 2 > len(data):
+                    raise ValueError("truncated match")
+                offset = ((data[i] << 4) | (data[i + 1] >> 4)) + 1
+                length = (data[i + 1] & 0x0F) + 3
+                i += 2
+                if offset > len(out):
+                    raise ValueError("match offset out of range")
+                for _ in range(length):
+                    out.append(out[-offset])
+            else:
+                out.append(data[i])
+                i += 1
+    if len(out) != raw_len:
+        raise ValueError(f"decompressed {len(out)} bytes, expected {raw_len}")
+    return bytes(out)
+
+
+def read_segment(path):
+    """返回 (segment_seq, 记录生成器)；文件头无效时返回 None。"""
+    with open(path, "rb") as f:
+        blob = f.read()
+    if len(blob) < SEGMENT_HEADER.size:
+        return None
+    magic, version, header_size, _sector, segment_seq, _boot, _ = SEGMENT_HEADER.unpack_from(blob, 0)
+    if magic != SEGMENT_MAGIC or version != FORMAT_VERSION:
+        return None
+
+    def records():
+        tags = {0: "-"}
+        offset = header_size
+        while offset + CHUNK_HEADER.size <= len(blob):
+            magic, flags, _, raw_len, stored_len, count, boot_seq, _first_ts = CHUNK_HEADER.unpack_from(blob, offset)
+            if magic != CHUNK_MAGIC or offset + CHUNK_HEADER.size + stored_len > len(blob):
+                break  # 扇区填充或未写完的数据块：分段中的有效数据到此结束
+            body = blob[offset + CHUNK_HEADER.size: offset + CHUNK_HEADER.size + stored_len]
+            offset += CHUNK_HEADER.size + stored_len
+            if flags & CHUNK_COMPRESSED:
+                body = lzss_decompress(body, raw_len)
+
+            pos = 0
+            for _ in range(count):
+                ts, level, tag_id, length = RECORD_HEADER.unpack_from(body, pos)
+                pos += RECORD_HEADER.size
+                text = body[pos: pos + length].decode("utf-8", errors="replace")
+                pos += length
+                if level == LEVEL_TAG_DEFINITION:
+                    tags[tag_id] = text
+                    continue
+                yield boot_seq, ts, level, tags.get(tag_id, f"#{tag_id}"), text
+
+    return segment_seq, records()
+
+
+def collect_paths(inputs):
+    paths = []
+    for item in inputs:
+        if os.path.isdir(item):
+            paths.extend(os.path.join(item, n) for n in sorted(os.listdir(item)) if n.endswith(".blog"))
+        else:
+            paths.append(item)
+    return paths
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Sys_FlashLogger binary log segments.")
+    parser.add_argument("inputs", nargs="+", help="segment files or directories containing .blog files")
+    parser.add_argument("--level", default="V", choices=["E", "W", "I", "D", "V"], help="maximum level to print")
+    args = parser.parse_args()
+
+    max_level = {v: k for k, v in LEVEL_NAMES.items()}[args.level]
+    segments = []
+    for path in collect_paths(args.inputs):
+        segment = read_segment(path)
+        if segment is None:
+            print(f"[decode_flashlog.py] 跳过无效分段: {path}", file=sys.stderr)
+            continue
+        segments.append(segment)
+
+    # 分段按序号排序即为时间顺序
+    for _seq, records in sorted(segments, key=lambda s: s[0]):
+        for boot_seq, ts, level, tag, text in records:
+            if level > max_level:
+                continue
+            print(f"#{boot_seq:<4} {ts / 1000.0:10.3f} {LEVEL_NAMES.get(level, '?')} [{tag}] {text}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+/**
+ * @file Sys_AssetCache.h
+ * @brief 静态Web资源内存缓存的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * [优化] 资源清单在构建期由`minify_gzip.py`生成为头文件`Sys_AssetManifest.h`并编译进固件，
+ * 其中包含每个资源的请求路径、内容哈希路径、Gzip大小、ETag和MIME类型。
+ * 启动时按照清单把Web UI的Gzip资源一次性读入PSRAM，之后`/*`路由直接从内存响应：
+ * - 请求路径中不再调用`LittleFS.exists()`：清单中没有的路径直接返回404。
+ * - 每个资源带有强ETag（构建期计算的内容哈希），浏览器携带`If-None-Match`复验时返回304。
+ * - 通过内容哈希路径（如`/main.3f2a9c0d.js`，HTML中的引用在构建期已被改写）请求的资源
+ *   内容永不改变，使用长期的`Cache-Control: immutable`；通过原始路径请求的资源（如`index.html`）
+ *   使用`no-cache`，每次都通过ETag复验。
+ *
+ * 超出缓存预算的资源仍由清单描述，从LittleFS读取后响应。
+ *
+ * @note 缓存在`begin()`之后只读，查找无需加锁。
+ */
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @struct AssetManifestEntry
+ * @brief 构建期资源清单中的一项（由`minify_gzip.py`生成，见`Sys_AssetManifest.h`）。
+ */
+struct AssetManifestEntry {
+    /** @brief 请求路径，如"/main.js"；对应LittleFS中的`<path>.gz`。*/
+    const char* path;
+    /** @brief 内容哈希路径，如"/main.3f2a9c0d.js"；HTML入口页面没有哈希路径，为`nullptr`。*/
+    const char* hashed_path;
+    /** @brief Gzip内容的大小（字节）。*/
+    uint32_t gzip_size;
+    /** @brief 强ETag，含双引号。*/
+    const char* etag;
+    /** @brief MIME类型。*/
+    const char* content_type;
+};
+
+/**
+ * @struct CachedAsset
+ * @brief 一个静态资源及其缓存状态。
+ */
+struct CachedAsset {
+    /** @brief 该资源在清单中的描述。*/
+    const AssetManifestEntry* entry;
+    /** @brief PSRAM中的Gzip内容；`nullptr`表示未缓存，需从LittleFS读取。*/
+    uint8_t* data;
+    /**
+     * @brief LittleFS中的文件与清单一致。
+     * @details 文件系统镜像与固件不是同一次构建时（如只上传了固件），ETag不可信，
+     *          此时不发送ETag和长期缓存头。
+     */
+    bool matches_manifest;
+};
+
+/**
+ * @class Sys_AssetCache
+ * @brief 静态Web资源的PSRAM缓存。
+ */
+class Sys_AssetCache {
+public:
+    /**
+     * @brief 获取资源缓存的单例实例。
+     * @return Sys_AssetCache* 指向唯一实例的指针。
+     */
+    static Sys_AssetCache* getInstance();
+    // 删除拷贝构造函数和赋值操作符，确保单例模式。
+    Sys_AssetCache(const Sys_AssetCache&) = delete;
+    Sys_AssetCache& operator=(const Sys_AssetCache&) = delete;
+
+    /**
+     * @brief 按照编译期资源清单，把资源载入PSRAM。
+     * @note 必须在LittleFS挂载之后、Web服务器启动之前调用。
+     * @return size_t 成功缓存到PSRAM的资源数量。
+     */
+    size_t begin();
+
+    /**
+     * @brief 按请求路径查找资源。
+     * @param path 请求路径（以'/'结尾的目录路径会映射到其中的`index.html`）。
+     * @param[out] versioned 是否通过内容哈希路径请求（可长期缓存）。
+     * @return const CachedAsset* 资源，清单中不存在时返回`nullptr`。
+     */
+    const CachedAsset* find(const String& path, bool& versioned) const;
+
+    /** @brief 最多管理的资源数量。*/
+    static constexpr size_t MAX_ASSETS = 32;
+    /** @brief 缓存占用的PSRAM上限（字节）。*/
+    static constexpr size_t MAX_CACHE_BYTES = 2 * 1024 * 1024;
+    /** @brief 版本化资源的`Cache-Control`。*/
+    static constexpr const char* CACHE_CONTROL_VERSIONED = "public, max-age=31536000, immutable";
+    /** @brief 其他资源的`Cache-Control`：允许缓存，但每次使用前需用ETag复验。*/
+    static constexpr const char* CACHE_CONTROL_REVALIDATE = "no-cache";
+
+private:
+    // 私有构造函数，由`getInstance()`调用。
+    Sys_AssetCache() = default;
+
+    // 检查并载入清单中的一个资源
+    void loadAsset(const AssetManifestEntry& entry);
+
+    /** @brief 单例实例指针。*/
+    static Sys_AssetCache* _instance;
+    /** @brief 清单中在LittleFS上存在的资源。*/
+    CachedAsset _assets[MAX_ASSETS] = {};
+    /** @brief 资源数量。*/
+    size_t _asset_count = 0;
+    /** @brief 已占用的PSRAM字节数。*/
+    size_t _cached_bytes = 0;
+};
@@ -0,0 +1,75 @@
+/**
+ * @file Sys_Benchmark.h
+ * @brief 板载基准测试套件的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 只在基准测试固件（`platformio.ini`中的`[env:esp32s3_n8r8_bench]`，定义`SYS_BENCH_MODE=1`）中编译。
+ * 该固件只初始化NVS、设置、内存池和文件系统，不启动网络和后台任务，然后依次运行：
+ * 1. `memcpy`：SRAM/PSRAM之间四种组合的拷贝带宽。
+ * 2. `mempool`：`Sys_MemoryManager`与`heap_caps_malloc`的分配/释放吞吐量，单核以及双核同时竞争。
+ * 3. `fs`：FFat和LittleFS在不同块大小下的顺序/随机读写带宽。
+ * 4. `msg`：FreeRTOS队列与环形缓冲区的消息吞吐量，同核与跨核。
+ * 5. `json`：项目实际RPC消息的JSON/MessagePack序列化与反序列化耗时。
+ *
+ * 输出格式：每个结果一行，以`BENCH `开头，后接一个JSON对象
+ * `{"suite":"fs","name":"ffat.seq_write.4096","value":1.23,"unit":"MB/s"}`。
+ * 第一行`suite`为`meta`（固件版本、IDF版本、CPU主频），最后一行`suite`为`done`。
+ * 用`bench_compare.py`比较两次运行的结果。
+ */
+#pragma once
+
+#ifndef SYS_BENCH_MODE
+#define SYS_BENCH_MODE 0 // 默认关闭
+#endif
+
+#if SYS_BENCH_MODE
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "FS.h"
+
+/**
+ * @class Sys_Benchmark
+ * @brief 基准测试套件。
+ */
+class Sys_Benchmark {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_Benchmark() = delete;
+
+    /**
+     * @brief 依次运行所有基准测试并输出结果。
+     * @param firmware_version 写入`meta`行的固件版本号。
+     */
+    static void run(const char* firmware_version);
+
+private:
+    /** @brief 输出一行结果。*/
+    static void report(const char* suite, const char* name, double value, const char* unit);
+
+    static void benchMemcpy();
+    static void benchMemoryPool();
+    static void benchFilesystem(const char* fs_name, fs::FS& fs, size_t file_size);
+    static void benchMessaging();
+    static void benchJson();
+
+    /** @brief 由`runTasks()`在独立任务中执行的一个测试函数。*/
+    struct BenchTask {
+        void (*op)(void* arg);
+        void* arg;
+        BaseType_t core;
+    };
+
+    /**
+     * @brief 为每个`BenchTask`创建一个固定在指定核心上的任务，同时放行并等待全部完成。
+     * @return int64_t 从放行到最后一个任务完成的时间（微秒），创建任务失败时返回-1。
+     * @note 任一任务创建失败时不放行：已创建的任务（仍阻塞在放行位上）被删除，避免单独运行的一方永久阻塞。
+     */
+    static int64_t runTasks(const BenchTask* tasks, uint8_t count);
+    /** @brief `runTasks()`创建的任务的入口。*/
+    static void benchTaskEntry(void* parameter);
+};
+
+#endif // SYS_BENCH_MODE
@@ -47,18 +47,14 @@ public:
      */
     void begin();
 
-    /**
-     * @brief 由 Task_SystemMonitor 周期性调用。
-     * @details 目前为空，为未来扩展预留。
-     */
-    void update();
-
     /**
      * @brief 应用最新的系统设置。这是控制BLE行为的核心入口。
      * @details 当用户在Web界面保存配置后，由Task_Worker调用此方法。
      *          它会比较新旧设置，并执行必要的启动广播、停止广播或重命名操作。
+     *          [优化] 配置变更通过`Sys_SettingsManager`的变更回调自动触发，只处理`changed_fields`涉及的部分。
+     * @param changed_fields 发生变化的配置字段位图（`Sys_SettingsManager::Field`），默认全部重新应用。
      */
-    void applySettings();
+    void applySettings(uint32_t changed_fields = Sys_SettingsManager::BLUETOOTH_FIELDS);
 
     /**
      * @brief 获取当前BLE模块的状态。
@@ -83,6 +79,8 @@ private:
     bool stopAdvertising();
     /** @brief 设置BLE设备名称。*/
     void setDeviceName(const char* name);
+    /** @brief [新增] 配置变更回调（在修改配置的任务中调用）。*/
+    static void onSettingsChanged(uint32_t changed_fields);
 
     /** @brief 单例实例指针。*/
     static Sys_BlueToothManager* _instance;
@@ -0,0 +1,117 @@
+/**
+ * @file Sys_Boot.h
+ * @brief [新增] 按依赖关系并行执行的分阶段启动器
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * `setup()`原先把所有模块的初始化串行执行，WiFi初始化、NimBLE初始化和FFat挂载等彼此无关的耗时步骤只能逐个等待。
+ * 现在每个模块是一个启动阶段，声明它依赖的阶段；`run()`在两个核心上各运行一个执行者
+ * （调用`run()`的任务本身和一个临时的辅助任务），依赖已满足的阶段由先空闲的执行者领取，
+ * 因此互不依赖的阶段会同时进行。
+ *
+ * - 阶段的依赖只能指向表中排在它前面的阶段（这保证了图中没有环），表的顺序即串行执行时的顺序。
+ * - 阶段失败不会阻止依赖它的阶段执行（与原先的串行启动一致），只记录在结果中。
+ * - 每个阶段的开始时刻、耗时和所在核心都被记录；`publishTiming()`把它们作为状态字段发布，
+ *   从而出现在客户端收到的第一条`system.stateUpdate`中。
+ *
+ * @note 并行阶段之间的共享资源必须是线程安全的：单例应在`run()`之前于`setup()`中构造，
+ *       注册RPC方法的阶段之间必须有依赖关系（路由表的注册不加锁）。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+/**
+ * @class Sys_Boot
+ * @brief 启动阶段图的执行器与启动耗时记录。
+ */
+class Sys_Boot {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_Boot() = delete;
+
+    /** @brief 阶段的初始化函数，返回是否成功。*/
+    using StageFunction = bool (*)();
+
+    /**
+     * @struct Stage
+     * @brief 启动阶段的声明。
+     */
+    struct Stage {
+        /** @brief 阶段名称（用于日志和状态字段名），最长`MAX_NAME_LENGTH`个字符，必须是静态生命周期的字符串。*/
+        const char* name;
+        /** @brief 初始化函数。*/
+        StageFunction init;
+        /** @brief 依赖的阶段位图（第n位对应表中的第n个阶段），用`after()`组合。*/
+        uint32_t depends_on;
+    };
+
+    /** @brief 阶段表的最大长度（受事件组可用位数限制）。*/
+    static constexpr size_t MAX_STAGES = 16;
+    /** @brief 阶段名称的最大长度。*/
+    static constexpr size_t MAX_NAME_LENGTH = 12;
+
+    /** @brief 辅助执行者任务的参数：阶段函数在其中执行，栈大小与Arduino的loopTask一致。*/
+    static constexpr const char* HELPER_TASK_NAME = "Task_BootHelper";
+    static constexpr uint32_t HELPER_STACK_SIZE = 8192;
+    static constexpr UBaseType_t HELPER_PRIORITY = 1;
+    static constexpr BaseType_t HELPER_CORE = 0;
+
+    /**
+     * @brief 依赖位图的构造辅助函数：`after(A) | after(B)`表示依赖阶段A和B。
+     */
+    static constexpr uint32_t after(uint8_t stage_index) {
+        return 1u << stage_index;
+    }
+
+    /**
+     * @brief 执行阶段表，阻塞直到所有阶段完成。
+     * @param stages 阶段表，必须在`run()`返回前保持有效。
+     * @param count 阶段数，不超过`MAX_STAGES`。
+     * @return bool `true` 表示所有阶段都成功。
+     */
+    static bool run(const Stage* stages, size_t count);
+
+    /**
+     * @brief 注册并发布启动耗时的状态字段：`boot_ms`（从应用启动到调用本函数）和每个阶段的`boot_<name>_ms`。
+     * @note 在`run()`和`Sys_Tasks::begin()`之后调用，字段值此后不再变化。
+     */
+    static void publishTiming();
+
+private:
+    /** @brief 一个阶段的执行结果。*/
+    struct StageResult {
+        /** @brief 开始时刻（微秒，从应用启动起）。*/
+        uint32_t start_us;
+        uint32_t duration_us;
+        int8_t core;
+        bool ok;
+    };
+
+    /** @brief 执行者循环：领取依赖已满足的阶段并执行，所有阶段都被领取后返回。*/
+    static void workerLoop();
+    /** @brief 辅助执行者任务的入口。*/
+    static void helperTask(void* parameter);
+    /** @brief 执行一个阶段并记录结果。*/
+    static void runStage(size_t index);
+
+    static const Stage* _stages;
+    static size_t _count;
+    /** @brief 所有阶段的位图。*/
+    static uint32_t _all_mask;
+    /** @brief 已被领取的阶段位图，受`_claim_mutex`保护。*/
+    static uint32_t _claimed_mask;
+    /** @brief 已完成的阶段：第n位置位表示第n个阶段已完成。*/
+    static EventGroupHandle_t _done_group;
+    static SemaphoreHandle_t _claim_mutex;
+    /** @brief 辅助任务退出前释放，`run()`等待它后才清理资源。*/
+    static SemaphoreHandle_t _helper_exit;
+    static StageResult _results[MAX_STAGES];
+    /** @brief 状态字段名`boot_<name>_ms`的存储。*/
+    static char _field_names[MAX_STAGES][MAX_NAME_LENGTH + 9];
+};
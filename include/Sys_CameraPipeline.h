@@ -0,0 +1,229 @@
+/**
+ * @file Sys_CameraPipeline.h
+ * @brief Core 0 摄像头帧处理管线的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 按照蓝图的核心分配策略，摄像头数据流在Core 0上以三级流水线处理：
+ *   `Task_CamCapture`（采集JPEG） -> `Task_CamDecode`（解码为灰度图） -> `Task_CamAnalyze`（条码识别等分析）
+ *
+ * 帧缓冲：
+ * - 启动时通过`Sys_MemoryManager::getFrameBuffer()`取得1MB级别的块，每块切分为`FRAMES_PER_BLOCK`个帧槽位。
+ *   每个槽位同时容纳压缩的JPEG数据和解码后的灰度平面，各级之间只传递`CameraFrame*`句柄，从不拷贝图像。
+ * - 每个帧带有引用计数。流水线中的每一级、以及`acquireLatestFrame()`的调用者（如MJPEG推流）各持有一个引用，
+ *   同一帧因此可以同时被推流和分析；最后一个引用释放时槽位回到空闲位图。
+ *
+ * 级间通道：
+ * - 每两级之间是一个单生产者/单消费者、深度为1的“最新帧”通道：放入新帧时取出被顶替的旧帧，由生产者释放。
+ *   放入即转移所有权（连同一个引用），取出即接收所有权。
+ * - 槽位耗尽时，采集级从下游通道中收回最旧的、尚未被处理的帧（先分析通道，后解码通道），
+ *   而不是阻塞等待；各级正在处理或被推流持有的帧不会被收回。
+ *
+ * 摄像头驱动、JPEG解码器和分析算法尚未选型（见`platformio.ini`中的后期依赖），
+ * 因此以回调的形式注入：`setSource()` / `setDecoder()` / `setAnalyzer()`。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @struct CameraFrame
+ * @brief 帧缓冲句柄。
+ * @details 采集级写入JPEG区域后，该区域只读；灰度平面只由解码级写入、分析级读取。
+ *          推流等外部持有者只应访问JPEG区域。
+ */
+struct CameraFrame {
+    /** @brief JPEG数据（指向帧槽位起始处，容量`Sys_CameraPipeline::JPEG_CAPACITY`）。*/
+    uint8_t* jpeg = nullptr;
+    /** @brief JPEG数据长度。*/
+    size_t jpeg_len = 0;
+    /** @brief 灰度平面（紧随JPEG区域，容量`Sys_CameraPipeline::GRAY_CAPACITY`）。*/
+    uint8_t* gray = nullptr;
+    /** @brief 灰度平面的宽高，解码成功后有效。*/
+    uint16_t width = 0;
+    uint16_t height = 0;
+    /** @brief 采集序号，从1开始单调递增。*/
+    uint32_t seq = 0;
+    /** @brief 采集时间（启动后的毫秒数）。*/
+    uint32_t timestamp_ms = 0;
+    /** @brief 引用计数，由管线维护。*/
+    std::atomic<uint8_t> refs{0};
+};
+
+/**
+ * @struct CameraPipelineStats
+ * @brief 管线统计快照。
+ */
+struct CameraPipelineStats {
+    /** @brief 成功采集的帧数。*/
+    uint32_t captured = 0;
+    /** @brief 因槽位耗尽或被新帧顶替而丢弃的帧数。*/
+    uint32_t dropped = 0;
+    /** @brief 成功解码的帧数。*/
+    uint32_t decoded = 0;
+    /** @brief 完成分析的帧数。*/
+    uint32_t analyzed = 0;
+    /** @brief 帧槽位总数，以及当前在用的槽位数。*/
+    uint8_t frame_slots = 0;
+    uint8_t frames_in_use = 0;
+};
+
+/**
+ * @class Sys_CameraPipeline
+ * @brief 管理帧槽位、三个Core 0处理任务及其之间的帧句柄传递。
+ */
+class Sys_CameraPipeline {
+public:
+    /**
+     * @brief 采集回调：把下一帧JPEG写入`dst`。
+     * @param dst 目标缓冲区；为`nullptr`时表示没有空闲槽位，驱动应丢弃下一帧以保持其内部队列流动。
+     * @param capacity 目标缓冲区容量。
+     * @param timeout_ms 最长等待时间。
+     * @return size_t 写入的字节数，0表示超时或失败。
+     */
+    using CaptureFn = size_t (*)(uint8_t* dst, size_t capacity, uint32_t timeout_ms);
+    /**
+     * @brief 解码回调：把JPEG解码为8位灰度图。
+     * @return bool 是否成功；成功时写出宽高（`width * height`不得超过`capacity`）。
+     */
+    using DecodeFn = bool (*)(const uint8_t* jpeg, size_t len, uint8_t* gray, size_t capacity, uint16_t& width, uint16_t& height);
+    /** @brief 分析回调：处理一帧已解码的灰度图（在`Task_CamAnalyze`中运行）。*/
+    using AnalyzeFn = void (*)(const CameraFrame& frame);
+
+    /**
+     * @brief 获取摄像头管线的单例实例。
+     * @return Sys_CameraPipeline* 指向唯一实例的指针。
+     */
+    static Sys_CameraPipeline* getInstance();
+    // 删除拷贝构造函数和赋值操作符，确保单例模式。
+    Sys_CameraPipeline(const Sys_CameraPipeline&) = delete;
+    Sys_CameraPipeline& operator=(const Sys_CameraPipeline&) = delete;
+
+    /**
+     * @brief 取得帧缓冲并在Core 0上启动三个处理任务。
+     * @note 必须在`Sys_MemoryManager::initializePools()`之后调用。未设置采集回调时，采集任务阻塞等待`setSource()`的通知。
+     * @return bool 是否初始化成功。
+     */
+    bool begin();
+
+    /** @brief 设置采集回调（可在任意时刻调用，`nullptr`表示停止采集），非空时唤醒空闲的采集任务。*/
+    void setSource(CaptureFn fn);
+    /** @brief 设置解码回调；未设置时帧只用于推流，不进入分析级。*/
+    void setDecoder(DecodeFn fn);
+    /** @brief 设置分析回调。*/
+    void setAnalyzer(AnalyzeFn fn);
+
+    /**
+     * @brief 取得最新采集的一帧，并为调用者增加一个引用。
+     * @param after_seq 只返回序号大于该值的帧，用于等待下一帧（传0表示任意帧）。
+     * @return CameraFrame* 帧句柄，没有更新的帧时返回`nullptr`；非空时调用者必须用`releaseFrame()`释放。
+     */
+    CameraFrame* acquireLatestFrame(uint32_t after_seq = 0);
+
+    /**
+     * @brief 释放一个引用；最后一个引用释放时槽位回到空闲位图。
+     */
+    void releaseFrame(CameraFrame* frame);
+
+    /**
+     * @brief 获取统计快照。
+     */
+    void getStats(CameraPipelineStats& out_stats) const;
+
+    // --- 配置常量 ---
+    /** @brief 每个1MB帧缓冲块切分出的帧槽位数。*/
+    static constexpr size_t FRAMES_PER_BLOCK = 2;
+    /** @brief 启动时占用的1MB帧缓冲块数（内存池中该级别共4块，其余的留给其它`getFrameBuffer()`调用者）。*/
+    static constexpr size_t FRAME_BLOCKS = 2;
+    /** @brief 帧槽位总数。*/
+    static constexpr size_t MAX_FRAMES = FRAMES_PER_BLOCK * FRAME_BLOCKS;
+    /** @brief 每个帧槽位的大小。*/
+    static constexpr size_t FRAME_SLOT_SIZE = (1024 * 1024) / FRAMES_PER_BLOCK;
+    /** @brief JPEG区域的容量。*/
+    static constexpr size_t JPEG_CAPACITY = 160 * 1024;
+    /** @brief 灰度平面的容量（足够容纳640x480）。*/
+    static constexpr size_t GRAY_CAPACITY = FRAME_SLOT_SIZE - JPEG_CAPACITY;
+    /** @brief 采集回调的等待时间（毫秒）。*/
+    static constexpr uint32_t CAPTURE_TIMEOUT_MS = 200;
+
+private:
+    // 私有构造函数，由`getInstance()`调用。
+    Sys_CameraPipeline() = default;
+
+    /**
+     * @class FrameChannel
+     * @brief 深度为1的SPSC“最新帧”通道。
+     * @details `put()`转移所有权并唤醒消费者，返回被顶替的帧（由生产者释放）；`take()`取走所有权。
+     *          `reclaim()`供采集级在槽位耗尽时收回尚未被处理的帧。
+     */
+    class FrameChannel {
+    public:
+        void setConsumer(TaskHandle_t consumer) { _consumer = consumer; }
+        CameraFrame* put(CameraFrame* frame);
+        CameraFrame* take(TickType_t wait);
+        CameraFrame* reclaim() { return _slot.exchange(nullptr); }
+    private:
+        std::atomic<CameraFrame*> _slot{nullptr};
+        TaskHandle_t _consumer = NULL;
+    };
+
+    // --- 帧槽位 ---
+    CameraFrame* allocFrame();
+    void dropFrame(CameraFrame* frame);
+    void publishLatest(CameraFrame* frame);
+
+    // --- 任务循环 ---
+    static void captureTask(void* parameter);
+    static void decodeTask(void* parameter);
+    static void analyzeTask(void* parameter);
+
+    /** @brief 三个处理任务的参数（均固定在Core 0）。*/
+    static constexpr BaseType_t TASK_CORE = 0;
+    static constexpr const char* CAPTURE_TASK_NAME = "Task_CamCapture";
+    static constexpr uint32_t CAPTURE_TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t CAPTURE_TASK_PRIORITY = 3; // 高于处理级，采集从不被处理拖慢
+    static constexpr const char* DECODE_TASK_NAME = "Task_CamDecode";
+    static constexpr uint32_t DECODE_TASK_STACK_SIZE = 8192;
+    static constexpr UBaseType_t DECODE_TASK_PRIORITY = 2;
+    static constexpr const char* ANALYZE_TASK_NAME = "Task_CamAnalyze";
+    static constexpr uint32_t ANALYZE_TASK_STACK_SIZE = 8192;
+    static constexpr UBaseType_t ANALYZE_TASK_PRIORITY = 2;
+
+    /** @brief 单例实例指针。*/
+    static Sys_CameraPipeline* _instance;
+
+    /** @brief 帧槽位描述符。*/
+    CameraFrame _frames[MAX_FRAMES];
+    /** @brief 实际可用的槽位数（取决于成功取得的帧缓冲块数）。*/
+    size_t _frame_count = 0;
+    /** @brief 空闲槽位位图，bit=1表示空闲。*/
+    std::atomic<uint32_t> _free_mask{0};
+
+    /** @brief 最新采集的帧（持有一个引用），由`_latest_mux`保护“读取+增加引用”的原子性。*/
+    CameraFrame* _latest = nullptr;
+    mutable portMUX_TYPE _latest_mux = portMUX_INITIALIZER_UNLOCKED;
+
+    /** @brief 采集任务句柄，`setSource()`用它唤醒等待采集源的采集任务。*/
+    TaskHandle_t _capture_task = NULL;
+
+    /** @brief 采集 -> 解码、解码 -> 分析 的通道。*/
+    FrameChannel _decode_channel;
+    FrameChannel _analyze_channel;
+
+    /** @brief 注入的回调。*/
+    std::atomic<CaptureFn> _capture_fn{nullptr};
+    std::atomic<DecodeFn> _decode_fn{nullptr};
+    std::atomic<AnalyzeFn> _analyze_fn{nullptr};
+
+    /** @brief 统计计数器。*/
+    std::atomic<uint32_t> _captured{0};
+    std::atomic<uint32_t> _dropped{0};
+    std::atomic<uint32_t> _decoded{0};
+    std::atomic<uint32_t> _analyzed{0};
+    /** @brief 下一个采集序号（只由采集任务写入）。*/
+    uint32_t _next_seq = 1;
+};
@@ -0,0 +1,130 @@
+/**
+ * @file Sys_DeferredLog.h
+ * @brief 延迟格式化的系统日志管道的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 该模块取代了原先的`custom_log_vprintf`。原实现在每次`ESP_LOGx`调用时，都要在调用者的
+ * 栈上进行一次256字节的`vsnprintf`、同步地`Serial.write`、再拷贝进`LogEntry_t`和`xLogQueue`，
+ * 即使没有任何WebSocket客户端在线，热路径也要付出全部代价。
+ *
+ * 新的管道分为两段：
+ * 1. **捕获（热路径，调用者任务中）**：`vprintf()`只解析格式串，把格式串指针、全局序号和原始参数
+ *    编码成一条紧凑的二进制记录，写入当前CPU核心专属的环形缓冲区。不格式化、不分配内存、
+ *    不触碰串口；两个核心各写各的缓冲区，互不竞争。时间戳本身就是ESP日志宏的参数，随记录一并保存。
+ * 2. **格式化（冷路径，低优先级的Task_LogFormatter中）**：按全局序号合并两个核心的记录，
+ *    还原出文本行，写入串口；只有存在WebSocket客户端时，才把日志行交给推送任务。
+ *
+ * 安全性：
+ * - `%s`参数在捕获时即被拷贝（最长`MAX_STRING_ARG`字节），因为指向的字符串可能在调用者的栈上。
+ * - 只有位于Flash只读数据段(DROM)中的格式串才能被延迟使用；其它格式串（或包含不支持的转换符，
+ *   如`%n`）会在捕获时立即格式化成文本记录，行为与旧实现一致。
+ *
+ * @note 本模块是一个纯静态工具类。`vprintf()`可以被任意任务并发调用，但不可在ISR中调用。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <cstdarg>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+
+/**
+ * @class Sys_DeferredLog
+ * @brief 一个按核心分区、延迟格式化的日志记录管道。
+ */
+class Sys_DeferredLog {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_DeferredLog() = delete;
+
+    /** @brief 一条日志格式化后的最大长度（与`LogEntry_t::message`一致）。*/
+    static constexpr size_t MAX_LINE_LENGTH = 256;
+
+    /**
+     * @brief 创建每个核心的环形缓冲区。
+     * @return bool `true` 表示成功。
+     */
+    static bool begin();
+
+    /**
+     * @brief 设置被唤醒去格式化日志的消费者任务。
+     * @param consumer Task_LogFormatter的任务句柄。
+     */
+    static void setConsumer(TaskHandle_t consumer);
+
+    /**
+     * @brief 与`esp_log_set_vprintf`兼容的捕获函数（热路径）。
+     * @return int 始终返回0（“写入串口的字节数”在延迟模型中没有意义）。
+     */
+    static int vprintf(const char* fmt, va_list args);
+
+    /**
+     * @brief 按全局序号取出下一条日志，并格式化为文本（由消费者任务调用）。
+     * @param[out] line 输出缓冲区，至少`MAX_LINE_LENGTH`字节。
+     * @param[out] len 文本长度（不含结尾的'\0'）。
+     * @return bool `true` 表示取到一条日志；所有缓冲区都为空时返回 `false`。
+     */
+    static bool formatNext(char* line, size_t& len);
+
+    /**
+     * @brief 读取并清零“因缓冲区满而丢弃的日志数”。
+     */
+    static uint32_t takeDroppedCount();
+
+private:
+    /** @brief 参与分区的核心数。*/
+    static constexpr size_t CORE_COUNT = portNUM_PROCESSORS;
+    /** @brief 每个核心的环形缓冲区大小（字节，位于PSRAM）。*/
+    static constexpr size_t RING_SIZE_PER_CORE = 8 * 1024;
+    /** @brief 单个`%s`参数在记录中保存的最大字节数。*/
+    static constexpr size_t MAX_STRING_ARG = 128;
+    /** @brief 编码失败时返回的标记值。*/
+    static constexpr size_t ENCODE_UNSUPPORTED = (size_t)-1;
+
+    /** @brief 记录标志位：记录体是已格式化好的文本，而不是编码后的参数。*/
+    static constexpr uint8_t RECORD_PREFORMATTED = (1 << 0);
+
+    /**
+     * @struct RecordHeader
+     * @brief 每条记录的头部，后面紧跟参数数据（或预格式化文本）。
+     */
+    struct RecordHeader {
+        /** @brief 全局序号，用于跨核心合并时恢复先后顺序。*/
+        uint32_t seq;
+        /** @brief 格式串指针（指向DROM）；预格式化记录为nullptr。*/
+        const char* fmt;
+        /** @brief 记录标志位。*/
+        uint8_t flags;
+    };
+
+    /**
+     * @brief 按格式串编码参数。
+     * @param out 输出缓冲区；为nullptr时只计算所需长度。
+     * @return size_t 参数数据的字节数；遇到不支持的转换符时返回`ENCODE_UNSUPPORTED`。
+     */
+    static size_t encodeArgs(const char* fmt, va_list args, uint8_t* out);
+
+    /**
+     * @brief 依据格式串和编码后的参数还原文本。
+     * @return size_t 文本长度。
+     */
+    static size_t decodeRecord(const RecordHeader& header, const uint8_t* body, size_t body_len, char* line, size_t cap);
+
+    /** @brief 每个核心的环形缓冲区。*/
+    static RingbufHandle_t _rings[CORE_COUNT];
+    /** @brief 消费者任务句柄。*/
+    static TaskHandle_t _consumer;
+    /** @brief 全局序号生成器。*/
+    static std::atomic<uint32_t> _sequence;
+    /** @brief 因缓冲区满而丢弃的日志数。*/
+    static std::atomic<uint32_t> _dropped;
+
+    /** @brief 消费者已从各缓冲区取出、尚未输出的记录（用于按序号合并）。*/
+    static void* _held_item[CORE_COUNT];
+    /** @brief `_held_item`对应的记录大小。*/
+    static size_t _held_size[CORE_COUNT];
+};
@@ -6,7 +6,7 @@
  *
  * @details
  * 该模块提供了一个静态的`run()`方法，用于执行一系列全面的系统检查，
- * 包括硬件信息、内存状态、分区表和文件系统。
+ * 包括硬件信息、内存状态、分区表和文件系统，以及图像内核的微基准测试。
  *
  * 它是专为开发和调试设计的工具，通过编译时宏`CORE_DEBUG_MODE`控制，
  * 在发布固件中将被完全移除，不占用任何资源。
@@ -45,6 +45,10 @@ private:
     static void checkPartitions();
     /** @brief 检查并打印已挂载文件系统的状态和内容。*/
     static void checkFileSystems();
+    /**
+     * @brief [新增] 图像内核微基准测试：在QVGA测试图像上对比优化版本与参考版本的耗时，并校验输出一致。
+     */
+    static void checkImageKernels();
     /** @brief 递归列出指定目录下的文件和文件夹，是一个辅助函数。*/
     static void listDir(fs::FS& fs, const char* dirname, uint8_t levels = 0);
 };
@@ -94,7 +94,7 @@ private:
         } else {
             ESP_LOGE("FS", "FATAL: Formatting '%s' partition failed!", partition_label);
             // [日志] 记录文件系统格式化失败的致命错误
-            Sys_FlashLogger::getInstance()->log("[FileSystem]", "FATAL: Formatting '%s' partition failed!", partition_label);
+            Sys_FlashLogger::getInstance()->log(ESP_LOG_ERROR, "[FileSystem]", "FATAL: Formatting '%s' partition failed!", partition_label);
             return false;
         }
     }
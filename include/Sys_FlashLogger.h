@@ -6,30 +6,247 @@
  *
  * @details
  * 该模块旨在解决直接、频繁地向Flash写入小数据块而导致的性能和寿命问题。
- * 它实现了一个基于PSRAM环形缓冲区的二级日志系统：
- * 1. 日志首先被快速、非阻塞地写入PSRAM中的`Ringbuf`。
- * 2. 一个低优先级的后台任务负责在满足条件（缓冲区满或超时）时，
- *    将缓冲区中的数据一次性、批量地写入Flash上的日志文件。
+ * 它实现了一个基于PSRAM双缓冲暂存区的二级日志系统：
+ * 1. 日志首先被快速、非阻塞地追加到PSRAM中的前台暂存缓冲区。
+ * 2. 一个低优先级的后台任务负责在满足条件（前台缓冲区满或超时）时交换前后台缓冲区，
+ *    将后台缓冲区中的数据一次性、批量地写入Flash上的日志文件。
+ *    [优化] 写Flash期间，`log()`调用者继续写入另一个缓冲区，从不等待；
+ *    两个缓冲区都满时日志被直接丢弃并计数，而不是阻塞调用者。
  *
  * 这种机制极大地减少了Flash的擦写次数，是构建可靠、长寿命产品的关键。
  *
+ * [优化] 结构化二进制日志格式：
+ * - **记录**：`FlashLogRecordHeader`(时间戳、级别、标签ID、长度) + 消息文本。
+ *   标签字符串只在每个分段中首次出现时以“标签定义记录”写入一次，之后只占1字节。
+ * - **数据块**：若干条记录组成一个数据块，可选地经`Sys_Lzss`压缩，前缀`FlashLogChunkHeader`。
+ * - **分段**：日志轮流写入`SEGMENT_COUNT`个固定大小的分段文件（`<base>.<n>.blog`），
+ *   写满后覆盖最旧的分段，不再无限增长。每个文件以`FlashLogSegmentHeader`开头。
+ * - **扇区对齐写入**：文件始终以整个4KB扇区为单位、在扇区对齐的偏移处写入，
+ *   文件保持打开状态，FAT元数据只在跨入新扇区时才更新。
+ *
+ * [新增] 稀疏索引与查询：
+ * - 每约`INDEX_INTERVAL_RECORDS`条记录生成一个`FlashLogIndexEntry`，汇总其覆盖范围内的时间区间、
+ *   级别位图和标签位图。活动分段的索引保存在PSRAM中（启动时由扫描重建），分段写满轮转时
+ *   一次性写入同名的`.idx`文件，因此索引本身不产生零碎的Flash写入。
+ * - `query()`（RPC `log.query` 与 HTTP `/api/log/query`）按从新到旧的顺序检索，借助索引
+ *   跳过不可能命中的范围，只读取和解压需要的数据块，并支持游标分页。
+ *
+ * 主机端解码工具见项目根目录下的`decode_flashlog.py`。
+ *
  * @note 本模块所有公共方法均设计为线程安全。
  */
 #pragma once
 
 #include <Arduino.h>
+#include "FS.h"
+#include "esp_log.h"            // 复用esp_log_level_t作为日志级别
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"   // 使用FreeRTOS高效的环形缓冲区
 #include "freertos/semphr.h"    // 引入信号量头文件，用于线程同步
 #include "Sys_LockGuard.h"      // 引入RAII锁
+#include "ArduinoJson.h"        // [新增] 查询结果直接写入JSON
+
+// --- 二进制日志格式定义（小端序，与`decode_flashlog.py`保持一致） ---
+
+/**
+ * @struct FlashLogSegmentHeader
+ * @brief 每个分段文件开头的文件头。
+ */
+struct FlashLogSegmentHeader {
+    /** @brief 魔数`FLASH_LOG_SEGMENT_MAGIC`（"SLOG"）。*/
+    uint32_t magic;
+    /** @brief 格式版本。*/
+    uint8_t version;
+    /** @brief 本结构体的大小，用于向前兼容。*/
+    uint8_t header_size;
+    /** @brief 写入时使用的扇区大小。*/
+    uint16_t sector_size;
+    /** @brief 分段序号，单调递增，用于确定各分段的先后顺序。*/
+    uint32_t segment_seq;
+    /** @brief 创建该分段时的启动序号。*/
+    uint16_t boot_seq;
+    /** @brief 保留。*/
+    uint16_t reserved;
+};
+
+/**
+ * @struct FlashLogChunkHeader
+ * @brief 每个数据块的块头，后面紧跟`stored_len`字节的数据。
+ */
+struct FlashLogChunkHeader {
+    /** @brief 魔数`FLASH_LOG_CHUNK_MAGIC`。读到其它值即表示分段中的有效数据到此结束。*/
+    uint16_t magic;
+    /** @brief 块标志位（见`FLASH_LOG_CHUNK_COMPRESSED`）。*/
+    uint8_t flags;
+    /** @brief 保留。*/
+    uint8_t reserved;
+    /** @brief 解压后的记录数据长度。*/
+    uint16_t raw_len;
+    /** @brief 块头之后实际存储的数据长度。*/
+    uint16_t stored_len;
+    /** @brief 块中的记录数（含标签定义记录）。*/
+    uint16_t record_count;
+    /** @brief 写入该块时的启动序号，用于区分不同次启动的`millis()`时间戳。*/
+    uint16_t boot_seq;
+    /** @brief 块中第一条记录的时间戳（毫秒）。*/
+    uint32_t first_timestamp_ms;
+};
+
+/**
+ * @struct FlashLogRecordHeader
+ * @brief 每条记录的记录头，后面紧跟`length`字节的消息文本（不含'\0'）。
+ */
+struct FlashLogRecordHeader {
+    /** @brief 自启动以来的毫秒数。*/
+    uint32_t timestamp_ms;
+    /** @brief 日志级别（`esp_log_level_t`），或`FLASH_LOG_LEVEL_TAG_DEFINITION`。*/
+    uint8_t level;
+    /** @brief 标签ID。*/
+    uint8_t tag_id;
+    /** @brief 消息文本长度。*/
+    uint16_t length;
+};
+
+static_assert(sizeof(FlashLogSegmentHeader) == 16, "FlashLogSegmentHeader layout changed");
+static_assert(sizeof(FlashLogChunkHeader) == 16, "FlashLogChunkHeader layout changed");
+static_assert(sizeof(FlashLogRecordHeader) == 8, "FlashLogRecordHeader layout changed");
+
+static constexpr uint32_t FLASH_LOG_SEGMENT_MAGIC = 0x474F4C53; // "SLOG"
+static constexpr uint8_t FLASH_LOG_FORMAT_VERSION = 1;
+static constexpr uint16_t FLASH_LOG_CHUNK_MAGIC = 0x4B43;       // "CK"
+/** @brief 块标志位：数据经过`Sys_Lzss`压缩。*/
+static constexpr uint8_t FLASH_LOG_CHUNK_COMPRESSED = (1 << 0);
+/** @brief 特殊的记录级别：该记录定义了`tag_id`对应的标签名（消息文本即标签名）。*/
+static constexpr uint8_t FLASH_LOG_LEVEL_TAG_DEFINITION = 0xFF;
+
+/**
+ * @struct FlashLogIndexEntry
+ * @brief [新增] 稀疏索引条目：汇总分段中`[offset, end_offset)`范围内的若干个连续数据块。
+ */
+struct FlashLogIndexEntry {
+    /** @brief 第一个数据块在分段文件中的偏移。*/
+    uint32_t offset;
+    /** @brief 最后一个数据块之后的偏移。*/
+    uint32_t end_offset;
+    /** @brief 范围内最早的时间戳。*/
+    uint32_t first_timestamp_ms;
+    /** @brief 范围内最晚的时间戳。*/
+    uint32_t last_timestamp_ms;
+    /** @brief 范围内出现过的标签ID位图。*/
+    uint64_t tag_mask;
+    /** @brief 启动序号（见`FLASH_LOG_INDEX_MIXED_BOOTS`）。*/
+    uint16_t boot_seq;
+    /** @brief 范围内的日志条数（不含标签定义记录）。*/
+    uint16_t record_count;
+    /** @brief 范围内出现过的日志级别位图（第n位对应级别n）。*/
+    uint8_t level_mask;
+    /** @brief 条目标志位。*/
+    uint8_t flags;
+    /** @brief 保留。*/
+    uint16_t reserved;
+};
+
+/**
+ * @struct FlashLogIndexHeader
+ * @brief `.idx`索引文件的文件头，后面紧跟`entry_count`个`FlashLogIndexEntry`。
+ */
+struct FlashLogIndexHeader {
+    /** @brief 魔数`FLASH_LOG_INDEX_MAGIC`（"SIDX"）。*/
+    uint32_t magic;
+    /** @brief 所索引分段的序号，与分段文件头不一致时索引视为过期。*/
+    uint32_t segment_seq;
+    /** @brief 条目数。*/
+    uint32_t entry_count;
+    /** @brief 保留。*/
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FlashLogIndexEntry) == 32, "FlashLogIndexEntry layout changed");
+static_assert(sizeof(FlashLogIndexHeader) == 16, "FlashLogIndexHeader layout changed");
+
+static constexpr uint32_t FLASH_LOG_INDEX_MAGIC = 0x58444953; // "SIDX"
+/** @brief 索引标志位：范围内含有标签定义记录。*/
+static constexpr uint8_t FLASH_LOG_INDEX_HAS_TAG_DEFS = (1 << 0);
+/** @brief 索引标志位：范围跨越了多次启动（索引表满时才会出现），时间与标签过滤不能据此跳过。*/
+static constexpr uint8_t FLASH_LOG_INDEX_MIXED_BOOTS = (1 << 1);
+
+/**
+ * @struct FlashLogQuery
+ * @brief [新增] 日志查询条件。结果按从新到旧的顺序返回。
+ */
+struct FlashLogQuery {
+    /** @brief 只返回该次启动的日志；-1表示不限。*/
+    int32_t boot_seq = -1;
+    /** @brief 时间范围下限（启动后毫秒数，含）。*/
+    uint32_t from_ms = 0;
+    /** @brief 时间范围上限（启动后毫秒数，含）。*/
+    uint32_t to_ms = UINT32_MAX;
+    /** @brief 最详细的级别（如`ESP_LOG_WARN`表示只要错误和警告）。*/
+    uint8_t max_level = ESP_LOG_VERBOSE;
+    /** @brief 标签过滤，空字符串表示不限。*/
+    char tag[16] = "";
+    /** @brief 本页最多返回的条数。*/
+    uint16_t limit = 50;
+    /** @brief 是否从游标处继续（只返回比游标更旧的日志）。*/
+    bool has_cursor = false;
+    /** @brief 游标：分段序号。*/
+    uint32_t cursor_segment_seq = 0;
+    /** @brief 游标：数据块偏移。*/
+    uint32_t cursor_offset = 0;
+    /** @brief 游标：数据块内的记录序号。*/
+    uint16_t cursor_record = 0;
+};
+
+/**
+ * @struct FlashLoggerStats
+ * @brief [新增] 闪存日志的运行统计。
+ */
+struct FlashLoggerStats {
+    /** @brief 成功进入暂存缓冲区的日志数。*/
+    uint32_t messages_logged = 0;
+    /** @brief 因两个暂存缓冲区都已满而丢弃的日志数。*/
+    uint32_t messages_dropped = 0;
+    /** @brief 完成的刷写批次数。*/
+    uint32_t flush_count = 0;
+    /** @brief 最近一次刷写的耗时（微秒）。*/
+    uint32_t last_flush_us = 0;
+    /** @brief 刷写耗时的最大值（微秒）。*/
+    uint32_t max_flush_us = 0;
+    /** @brief 刷写总耗时（微秒），除以`flush_count`即为平均耗时。*/
+    uint64_t total_flush_us = 0;
+    /** @brief 写入Flash的扇区数（含尾扇区的原位重写）。*/
+    uint32_t sectors_written = 0;
+};
 
 /**
  * @class Sys_FlashLogger
- * @brief 一个对Flash友好的、基于PSRAM环形缓冲区的日志记录器。
+ * @brief 一个对Flash友好的、基于PSRAM双缓冲暂存区的日志记录器。
  */
 class Sys_FlashLogger {
 public:
+    /** @brief 分段文件的个数。*/
+    static constexpr uint8_t SEGMENT_COUNT = 4;
+    /** @brief 每个分段文件的最大大小（字节），必须是`SECTOR_SIZE`的整数倍。*/
+    static constexpr size_t SEGMENT_SIZE = 256 * 1024;
+    /** @brief 写入单位：FFat（磨损均衡层）的扇区大小。*/
+    static constexpr size_t SECTOR_SIZE = 4096;
+    /** @brief 单个数据块解压后的最大长度。*/
+    static constexpr size_t CHUNK_RAW_CAPACITY = 4096;
+    /** @brief 可区分的标签数上限。*/
+    static constexpr uint8_t MAX_TAGS = 64;
+    /** @brief 标签名的最大长度（含'\0'）。*/
+    static constexpr size_t TAG_NAME_LENGTH = 16;
+    /** @brief 单条消息文本的最大长度。*/
+    static constexpr size_t MAX_MESSAGE_LENGTH = 248;
+    /** @brief [新增] 稀疏索引的粒度：每个索引条目大约覆盖的记录数。*/
+    static constexpr uint16_t INDEX_INTERVAL_RECORDS = 64;
+    /** @brief [新增] 每个分段的索引条目上限（超出后合并进最后一个条目）。*/
+    static constexpr size_t MAX_INDEX_ENTRIES = 1024;
+    /** @brief [新增] 单次查询返回条数的上限。*/
+    static constexpr uint16_t MAX_QUERY_LIMIT = 200;
+    /** @brief [新增] 单次查询最多解压的数据块数，超出后返回游标由调用者继续。*/
+    static constexpr size_t MAX_QUERY_CHUNKS = 256;
+
     /**
      * @brief 获取日志记录器的单例实例。
      * @note  必须在系统进入多任务调度前（如在setup()中）完成首次调用。
@@ -42,21 +259,33 @@ public:
 
     /**
      * @brief 初始化日志记录器，创建PSRAM缓冲区和后台写入任务。
-     * @details 必须在文件系统模块初始化之后调用。
-     * @param log_filepath 日志文件的完整路径 (例如, "/media/system.log")。
-     * @param buffer_size PSRAM中环形缓冲区的大小 (字节)。建议为4KB的倍数。
+     * @details 必须在文件系统模块初始化之后调用。启动时会扫描已有分段，
+     *          在最新分段的有效数据末尾继续追加。
+     * @param log_basepath 日志分段文件的路径前缀 (例如, "/sys/system" -> "/sys/system.0.blog")。
+     * @param buffer_size PSRAM中两个暂存缓冲区的总大小 (字节)，每个缓冲区各占一半，最大各为`CHUNK_RAW_CAPACITY`。
      * @param flush_interval_ms 后台任务定时强制刷写缓冲区的间隔 (毫秒)。
+     * @param compress 是否对数据块进行LZSS压缩。
      * @return bool `true` 表示初始化成功, `false` 表示失败。
      */
-    bool begin(const char* log_filepath, size_t buffer_size = 8192, uint32_t flush_interval_ms = 60000);
+    bool begin(const char* log_basepath, size_t buffer_size = 8192, uint32_t flush_interval_ms = 60000, bool compress = true);
+
+    /**
+     * @brief 以`ESP_LOG_INFO`级别记录一条格式化的日志。
+     * @details 这是一个快速的、线程安全的操作，它只将数据追加到PSRAM暂存缓冲区，然后立即返回，从不等待刷写。
+     * @param tag 日志标签（如"[WiFi]"，方括号会被去除）。
+     * @param format `printf`风格的格式化字符串。
+     * @param ... 可变参数。
+     */
+    void log(const char* tag, const char* format, ...);
 
     /**
-     * @brief 记录一条格式化的日志。
-     * @details 这是一个快速的、线程安全的操作，它只将数据写入PSRAM缓冲区，然后立即返回。
+     * @brief [新增] 以指定级别记录一条格式化的日志。
+     * @param level 日志级别。
+     * @param tag 日志标签。
      * @param format `printf`风格的格式化字符串。
      * @param ... 可变参数。
      */
-    void log(const char* format, ...);
+    void log(esp_log_level_t level, const char* tag, const char* format, ...);
 
     /**
      * @brief 强制将缓冲区中所有待处理的日志立即写入Flash。
@@ -64,14 +293,42 @@ public:
      *          用于在系统重启或发生严重错误前，确保所有日志都被保存。
      */
     void flush();
-    
+
     /**
-     * @brief 线程安全地删除当前的日志文件。
-     * @details 可用于实现日志的轮转(log rotation)或手动清理。
-     *          此操作会等待任何正在进行的写操作完成后再执行。
+     * @brief 线程安全地删除所有日志分段。
+     * @details 可用于手动清理。此操作会等待任何正在进行的写操作完成后再执行，
+     *          之后日志从一个新的空分段开始记录。
      */
     void clearLogFile();
 
+    /**
+     * @brief [新增] 获取运行统计的快照。
+     */
+    FlashLoggerStats getStats();
+
+    /**
+     * @brief [新增] 检索历史日志。
+     * @details 先把暂存区中尚未落盘的日志刷写到文件，再按从新到旧的顺序检索所有分段。
+     *          查询期间持有文件锁（后台刷写会等待，`log()`调用者不受影响）。
+     * @param query 查询条件。
+     * @param result 输出对象：`records`数组，以及还有更多结果时的`next_cursor`字符串（否则为null）。
+     * @return bool `true` 表示成功；未初始化或内存不足时返回 `false`。
+     */
+    bool query(const FlashLogQuery& query, JsonObject result);
+
+    /**
+     * @brief [新增] 从JSON参数解析查询条件（RPC与HTTP接口共用）。
+     * @param params 形如`{"boot":3,"from":0,"to":60000,"level":"W","tag":"WiFi","limit":200,"cursor":"..."}`，各字段均可省略。
+     * @param[out] query 解析结果。
+     * @return const char* 成功时返回nullptr，否则返回错误描述。
+     */
+    static const char* parseQuery(JsonVariantConst params, FlashLogQuery& query);
+
+    /**
+     * @brief 获取指定分段槽位的文件路径。
+     */
+    String segmentPath(uint8_t slot) const;
+
 private:
     // 私有构造函数
     Sys_FlashLogger();
@@ -80,31 +337,175 @@ private:
      * @brief 后台任务的核心循环函数，负责将缓冲区数据写入文件。
      */
     static void flushTask(void* parameter);
-    
+
     /**
-     * @brief 实际执行从缓冲区读取并写入文件操作的函数。
-     * @note  这个方法内部实现了对文件I/O的互斥访问。
+     * @brief 交换前后台暂存缓冲区，并把后台缓冲区写入文件，直到两个缓冲区都为空。
+     * @note  这个方法内部实现了对文件I/O的互斥访问；写文件期间不持有暂存区锁。
      */
     void writeBufferToFile();
 
+    /** @brief 所有`log()`重载的公共实现。*/
+    void logv(esp_log_level_t level, const char* tag, const char* format, va_list args);
+
+    /**
+     * @brief 查找或登记一个标签，返回其ID。
+     * @return uint8_t 标签ID；标签为空或标签表已满时返回0（保留的“-”标签）。
+     */
+    uint8_t internTag(const char* tag);
+
+    /**
+     * @brief 扫描已有分段，定位最新分段的有效数据末尾并准备继续追加（在文件锁保护下调用）。
+     * @return bool `true` 表示成功。
+     */
+    bool openNewestSegment();
+
+    /**
+     * @brief 在指定槽位开始一个全新的分段（截断旧文件并写入文件头）。
+     */
+    bool startSegment(uint8_t slot, uint32_t segment_seq);
+
+    /**
+     * @brief 将一条来自环形缓冲区的记录追加到当前数据块，必要时先写入标签定义记录。
+     */
+    void appendRecord(const uint8_t* record, size_t size);
+
+    /** @brief 把一段字节追加到当前数据块（调用前需确认空间足够）。*/
+    void appendToChunk(const void* data, size_t size);
+
+    /** @brief 封装当前数据块（可选压缩）并写入扇区缓冲区。*/
+    void sealChunk();
+
+    /** @brief 把数据追加到扇区缓冲区，写满一个扇区即写入文件。*/
+    void appendToSector(const uint8_t* data, size_t size);
+
+    /** @brief 把当前（可能未满的）尾扇区写入文件，未满部分以0填充。*/
+    void writeTailSector();
+
+    // --- [新增] 稀疏索引 ---
+
+    /**
+     * @struct ChunkSummary
+     * @brief 一个数据块的汇总信息，用于生成索引条目。
+     */
+    struct ChunkSummary {
+        uint32_t first_ts = 0;
+        uint32_t last_ts = 0;
+        uint64_t tag_mask = 0;
+        uint16_t records = 0;
+        uint8_t level_mask = 0;
+        bool has_tag_defs = false;
+    };
+
+    /** @brief 获取指定槽位的索引文件路径。*/
+    String indexPath(uint8_t slot) const;
+
+    /** @brief 把一个数据块的汇总信息并入索引表。*/
+    static void addToIndex(FlashLogIndexEntry* entries, size_t& count, uint32_t offset, uint32_t end_offset,
+                           uint16_t boot_seq, const ChunkSummary& summary);
+
+    /** @brief 解析已解压的数据块，得到其汇总信息。*/
+    static void summarizeChunk(const uint8_t* raw, size_t raw_len, uint16_t record_count, ChunkSummary& summary);
+
+    /**
+     * @brief 沿块头链扫描并解压一个分段，重建其索引。
+     * @param[out] end 有效数据的末尾。
+     * @param[out] last_boot_seq 最后一个数据块的启动序号。
+     */
+    void buildSegmentIndex(File& file, const FlashLogSegmentHeader& segment, FlashLogIndexEntry* entries,
+                           size_t& count, uint32_t& end, uint16_t& last_boot_seq);
+
+    /** @brief 把一个分段的索引写入其`.idx`文件（分段写满轮转时调用一次）。*/
+    void writeIndexFile(uint8_t slot, uint32_t segment_seq, const FlashLogIndexEntry* entries, size_t count);
+
+    /**
+     * @brief 加载一个已完成分段的索引。
+     * @details `.idx`文件缺失或与分段不匹配时（如旧版本固件写入的分段），当场重建并写回。
+     */
+    void loadSegmentIndex(File& file, uint8_t slot, const FlashLogSegmentHeader& segment,
+                          FlashLogIndexEntry* entries, size_t& count);
+
     /** @brief 单例实例指针。*/
     static Sys_FlashLogger* _instance;
-    
-    /** @brief FreeRTOS环形缓冲区的句柄。*/
-    RingbufHandle_t _ring_buffer_handle = NULL;
+
     /** @brief 后台刷写任务的句柄。*/
     TaskHandle_t _flush_task_handle = NULL;
     /** @brief 用于手动触发立即刷写的二进制信号量。*/
     SemaphoreHandle_t _flush_semaphore = NULL;
-    /** 
+    /**
      * @brief 用于保护文件I/O操作的互斥锁 (Mutex)。
      * @details 这是确保多任务环境下文件系统访问安全的关键。
      *          任何对日志文件的`open`, `write`, `remove`等操作都必须先获取此锁。
      */
     SemaphoreHandle_t _file_mutex = NULL;
-    
-    /** @brief 日志文件的路径。*/
-    String _log_filepath;
+    /** @brief 保护标签表的互斥锁。*/
+    SemaphoreHandle_t _tag_mutex = NULL;
+    /** @brief [新增] 保护暂存缓冲区指针、填充量和统计数据的互斥锁（只在拷贝或交换时短暂持有）。*/
+    SemaphoreHandle_t _stage_mutex = NULL;
+
+    // --- [新增] 双缓冲暂存区 ---
+    /** @brief 前台缓冲区：`log()`调用者追加记录。*/
+    uint8_t* _front_buffer = nullptr;
+    /** @brief 后台缓冲区：后台任务正在（或即将）把它写入文件。*/
+    uint8_t* _back_buffer = nullptr;
+    /** @brief 每个暂存缓冲区的大小。*/
+    size_t _stage_size = 0;
+    /** @brief 前台缓冲区中的字节数。*/
+    size_t _front_fill = 0;
+    /** @brief 后台缓冲区中待写入的字节数，0表示后台缓冲区空闲。*/
+    size_t _back_fill = 0;
+    /** @brief 运行统计。*/
+    FlashLoggerStats _stats;
+    /** @brief 上一次报告时的丢弃计数。*/
+    uint32_t _reported_drops = 0;
+
+    /** @brief 日志分段文件的路径前缀。*/
+    String _log_basepath;
     /** @brief 定时刷写的间隔。*/
     uint32_t _flush_interval_ms;
+    /** @brief 是否压缩数据块。*/
+    bool _compress = true;
+
+    // --- 标签表 ---
+    /** @brief 标签名，下标即标签ID。*/
+    char _tag_names[MAX_TAGS][TAG_NAME_LENGTH] = {};
+    /** @brief 已登记的标签数。*/
+    uint8_t _tag_count = 0;
+
+    // --- 写入状态（仅由后台任务在文件锁保护下访问） ---
+    /** @brief 当前分段的文件对象，保持打开以避免每次刷写都重新打开。*/
+    File _segment_file;
+    /** @brief 当前分段的槽位。*/
+    uint8_t _segment_slot = 0;
+    /** @brief 当前分段的序号。*/
+    uint32_t _segment_seq = 0;
+    /** @brief 本次启动的启动序号。*/
+    uint16_t _boot_seq = 0;
+    /** @brief 当前分段中已写入过标签定义的标签位图。*/
+    uint64_t _segment_tag_mask = 0;
+    /** @brief 扇区缓冲区在文件中对应的偏移（扇区对齐）。*/
+    size_t _sector_offset = 0;
+    /** @brief 扇区缓冲区中的有效字节数。*/
+    size_t _sector_fill = 0;
+    /** @brief 当前数据块中的字节数。*/
+    size_t _chunk_fill = 0;
+    /** @brief 当前数据块中的记录数。*/
+    uint16_t _chunk_records = 0;
+    /** @brief 已写入的扇区数（汇总进`_stats`）。*/
+    uint32_t _sectors_written = 0;
+    /** @brief [新增] 当前数据块的汇总信息（含第一条记录的时间戳）。*/
+    ChunkSummary _chunk_summary;
+    /** @brief [新增] 活动分段的稀疏索引（PSRAM，`MAX_INDEX_ENTRIES`个条目）。*/
+    FlashLogIndexEntry* _active_index = nullptr;
+    /** @brief 活动分段的索引条目数。*/
+    size_t _active_index_count = 0;
+
+    // --- PSRAM工作区 ---
+    /** @brief 尾扇区缓冲区（`SECTOR_SIZE`字节）。*/
+    uint8_t* _sector_buffer = nullptr;
+    /** @brief 未压缩的数据块缓冲区（`CHUNK_RAW_CAPACITY`字节）。*/
+    uint8_t* _chunk_buffer = nullptr;
+    /** @brief 压缩输出缓冲区。*/
+    uint8_t* _compress_buffer = nullptr;
+    /** @brief 压缩哈希表工作区。*/
+    uint16_t* _lz_workspace = nullptr;
 };
@@ -0,0 +1,108 @@
+/**
+ * @file Sys_ImageKernels.h
+ * @brief 条码预处理图像内核库的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 条码识别（`Task_CamAnalyze`）之前的预处理步骤：灰度转换、2倍盒式降采样、积分图和自适应二值化。
+ * 每个内核都有以下版本：
+ * - 可移植优化版本：在指针和宽度满足32位对齐时以SWAR（寄存器内SIMD）方式一次处理4个像素，
+ *   以32位访问代替逐字节访问PSRAM；RGB565转换使用查找表消除乘法；自适应二值化把窗口裁剪移出内部像素的循环。
+ *   不满足对齐条件的行首/行尾部分回退到逐像素处理。
+ * - [新增] PIE版本（`...Pie`，仅ESP32-S3）：灰度提取、2倍降采样和自适应二值化的主体部分使用128位向量指令
+ *   （`EE.VLD.128.IP` / `EE.VADDS` / `EE.VSUBS` / `EE.VUNZIP`等），一次处理16个像素（二值化为4个窗口和）。
+ *   数据不满足16字节对齐的部分，以及其余部分，回退到SWAR版本。
+ *   RGB565转换依赖查表、积分图是串行的前缀和，二者没有合适的向量形式，只有SWAR版本。
+ * - 参考版本（`...Reference`）：最直接的逐像素实现，作为正确性基准，也是性能对比的基线。
+ * 无后缀的版本选择当前目标上最快的实现（ESP32-S3上为PIE，其余为SWAR）。所有版本的输出逐字节一致，
+ * 微基准测试与一致性检查见`Sys_Diagnostics`（调试构建启动时运行）。
+ *
+ * esp-dsp的`dsps_*`/`dspm_*`函数面向浮点和16位定点信号，没有8位图像的对应实现，因此PIE版本使用内联汇编。
+ *
+ * 图像均为行优先存储，`stride`为相邻两行起始地址之间的字节数（积分图为元素数）。
+ *
+ * @note 本模块是一个纯静态工具类，不持有任何可变状态，可在任意任务中并发调用。
+ */
+#pragma once
+
+#include <Arduino.h>
+
+/** @brief [新增] 是否编译PIE版本：默认在ESP32-S3上启用，可通过`-DSYS_IMAGE_KERNELS_PIE=0`关闭。*/
+#ifndef SYS_IMAGE_KERNELS_PIE
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && CONFIG_IDF_TARGET_ESP32S3
+#define SYS_IMAGE_KERNELS_PIE 1
+#else
+#define SYS_IMAGE_KERNELS_PIE 0
+#endif
+#endif
+
+/**
+ * @class Sys_ImageKernels
+ * @brief 灰度图像预处理内核。
+ */
+class Sys_ImageKernels {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_ImageKernels() = delete;
+
+    /** @brief 自适应二值化允许的最大窗口半径（保证32位中间结果不溢出）。*/
+    static constexpr uint8_t MAX_THRESHOLD_RADIUS = 31;
+
+    /**
+     * @brief YUYV (YUV422) 转8位灰度：直接提取亮度分量。
+     * @param src YUYV数据，`2 * pixel_count`字节。
+     * @param dst 灰度输出，`pixel_count`字节。
+     */
+    static void yuyvToGray(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+    static void yuyvToGraySwar(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+    static void yuyvToGrayReference(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+#if SYS_IMAGE_KERNELS_PIE
+    static void yuyvToGrayPie(const uint8_t* src, uint8_t* dst, size_t pixel_count);
+#endif
+
+    /**
+     * @brief RGB565 转8位灰度（BT.601权重 77/150/29）。
+     * @param src 本机字节序的RGB565像素；摄像头输出大端序时需先交换字节。
+     */
+    static void rgb565ToGray(const uint16_t* src, uint8_t* dst, size_t pixel_count);
+    static void rgb565ToGrayReference(const uint16_t* src, uint8_t* dst, size_t pixel_count);
+
+    /**
+     * @brief 2倍盒式降采样：每个输出像素是对应2x2块的四舍五入平均值。
+     * @details 输出尺寸为`(width / 2) x (height / 2)`，奇数的最后一列/行被舍弃。
+     */
+    static void downscale2x(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride);
+    static void downscale2xSwar(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride);
+#if SYS_IMAGE_KERNELS_PIE
+    static void downscale2xPie(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride);
+#endif
+    static void downscale2xReference(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride);
+
+    /**
+     * @brief 计算积分图。
+     * @param dst `(width + 1) x (height + 1)`个元素，行距为`width + 1`；
+     *            `dst[y][x]`为源图像左上角`x * y`区域之和，首行首列为0。
+     */
+    static void integralImage(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint32_t* dst);
+    static void integralImageReference(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint32_t* dst);
+
+    /**
+     * @brief 基于积分图的自适应二值化（Bradley-Roth）。
+     * @details 像素值低于其`(2 * radius + 1)`窗口平均值的`(100 - bias_percent)%`时输出0，否则输出255。
+     *          窗口在图像边缘处被裁剪。
+     * @param integral `integralImage()`的输出。
+     * @param radius 窗口半径，1～`MAX_THRESHOLD_RADIUS`。
+     * @param bias_percent 偏置百分比，0～100。
+     */
+    static void adaptiveThreshold(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                  uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride);
+    static void adaptiveThresholdSwar(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                      uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride);
+#if SYS_IMAGE_KERNELS_PIE
+    static void adaptiveThresholdPie(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                     uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride);
+#endif
+    static void adaptiveThresholdReference(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                           uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride);
+};
@@ -0,0 +1,65 @@
+/**
+ * @file Sys_Lzss.h
+ * @brief 轻量级LZSS块压缩工具的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 为闪存日志等小数据块提供一种无需外部依赖、解码极其简单的LZ77变种压缩。
+ *
+ * 编码格式：每个控制字节之后跟随最多8个条目，控制字节的第i位（从最低位开始）
+ * 描述第i个条目：
+ * - `0`：字面量，1字节。
+ * - `1`：回溯匹配，2字节。`b0 = (offset-1) >> 4`，`b1 = ((offset-1) & 0x0F) << 4 | (length-3)`，
+ *   其中`offset`为1~4096，`length`为3~18。
+ *
+ * 最坏情况下输出大小为`n + ceil(n/8)`（无任何匹配）。主机端解码器见`decode_flashlog.py`。
+ *
+ * @note 本模块是一个纯静态工具类，不持有任何状态，可在任意任务中并发调用（各自提供工作区）。
+ */
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @class Sys_Lzss
+ * @brief 面向4KB级数据块的LZSS压缩/解压工具。
+ */
+class Sys_Lzss {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_Lzss() = delete;
+
+    /** @brief 回溯窗口大小（字节），也是单次压缩输入的推荐上限。*/
+    static constexpr size_t WINDOW_SIZE = 4096;
+    /** @brief 压缩工作区所需的`uint16_t`元素个数（哈希表）。*/
+    static constexpr size_t WORKSPACE_ENTRIES = 4096;
+
+    /**
+     * @brief 计算`input_len`字节输入在最坏情况下的输出大小。
+     */
+    static constexpr size_t maxCompressedSize(size_t input_len) {
+        return input_len + (input_len + 7) / 8;
+    }
+
+    /**
+     * @brief 压缩一个数据块。
+     * @param input 输入数据，长度不超过`WINDOW_SIZE`时压缩效果最佳（更长的输入同样正确）。
+     * @param input_len 输入长度。
+     * @param output 输出缓冲区。
+     * @param output_cap 输出缓冲区容量。
+     * @param workspace 调用者提供的哈希表工作区，至少`WORKSPACE_ENTRIES`个元素。
+     * @return size_t 压缩后的长度；输出缓冲区不足时返回0。
+     */
+    static size_t compress(const uint8_t* input, size_t input_len, uint8_t* output, size_t output_cap, uint16_t* workspace);
+
+    /**
+     * @brief 解压一个数据块。
+     * @param input 压缩数据。
+     * @param input_len 压缩数据长度。
+     * @param output 输出缓冲区。
+     * @param output_cap 输出缓冲区容量（即原始长度）。
+     * @return size_t 解压出的字节数；数据损坏时返回0。
+     */
+    static size_t decompress(const uint8_t* input, size_t input_len, uint8_t* output, size_t output_cap);
+};
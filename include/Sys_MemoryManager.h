@@ -1,29 +1,76 @@
 /**
  * @file Sys_MemoryManager.h
- * @brief PSRAM固定块内存池管理器的接口定义
+ * @brief PSRAM多级固定块内存池管理器的接口定义
  * @author [ANEAK]
  * @date [2025/7]
  *
  * @details
- *  该模块在应用层实现了一个专用的、固定块大小的内存池，以取代
+ *  该模块在应用层实现了一个专用的、按尺寸分级的内存池，以取代
  *  底层复杂的堆注册方案。它在系统启动时，从PSRAM中预留一块大容量
- *  内存（如4MB），并将其手动划分为若干个大块（如每块1MB）。
- *  这种“真池”方案通过简单的状态向量进行管理，实现了零碎片、高性能的
- *  大块内存分配，专门用于摄像头帧缓冲等关键任务。
+ *  内存（约6MB），并将其划分为若干个“尺寸级别(Size Class)”：
+ *  512B / 4KB / 32KB / 256KB / 1MB。每个级别内部是等长的固定块。
  *
- * @note  本模块的所有公共方法均为线程安全。
+ *  - 分配时选择能容纳请求尺寸的最小级别，该级别耗尽时向更大的级别溢出。
+ *  - 每个级别使用位图跟踪空闲块，借助`__builtin_ctz`实现O(1)分配。
+ *  - 每个级别独立统计在用块数、高水位、分配/失败次数。
+ *
+ *  小对象（如上传缓冲、JSON文档）不再浪费整整1MB，也不会落入通用堆造成碎片；
+ *  1MB级别依然专门服务于摄像头帧缓冲，并保持原先的4块：其中`Sys_CameraPipeline`在启动时
+ *  固定占用`FRAME_BLOCKS`（2）块，其余2块留给其它`getFrameBuffer()`调用者。
+ *
+ *  [优化] 分配/释放路径完全无锁：
+ *  - 每个级别的空闲位图是原子变量，通过CAS认领/归还块。
+ *  - 每个CPU核心拥有一个小型“弹匣(Magazine)”缓存，释放的块优先放回本核弹匣，
+ *    下次分配时通过一次原子交换即可取回，无需竞争共享位图。
+ *  - 本核弹匣和共享位图都为空时，会从另一个核心的弹匣中“窃取”，避免块被闲置囤积。
+ *  互斥锁仅保留给统计快照，常规路径从不触碰FreeRTOS信号量。
+ *
+ * @note  本模块的所有公共方法均为线程安全，但不可在ISR中调用。
  */
 #pragma once
 
 #include <Arduino.h>
-#include <vector> // 引入 vector
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "Sys_LockGuard.h" // 引入RAII锁
+#include "ArduinoJson.h"    // 需要 ArduinoJson::Allocator 接口
+
+/**
+ * @enum MemPoolClass
+ * @brief 内存池的尺寸级别，按块大小从小到大排列。
+ */
+enum class MemPoolClass : uint8_t {
+    POOL_512B = 0,  // 小对象：RPC请求、短消息
+    POOL_4KB,       // 中小对象：JSON文档、日志暂存
+    POOL_32KB,      // 中对象：文件上传缓冲
+    POOL_256KB,     // 大对象：大型JSON、降采样图像
+    POOL_1MB,       // 超大对象：摄像头帧缓冲
+    COUNT           // 级别总数（非有效级别）
+};
+
+/**
+ * @struct MemPoolStats
+ * @brief 单个尺寸级别的统计快照。
+ */
+struct MemPoolStats {
+    /** @brief 该级别中每个块的大小（字节）。*/
+    size_t block_size = 0;
+    /** @brief 该级别的块总数。*/
+    uint16_t block_count = 0;
+    /** @brief 当前正在使用的块数。*/
+    uint16_t in_use = 0;
+    /** @brief 自启动以来同时使用块数的最大值（高水位）。*/
+    uint16_t high_water = 0;
+    /** @brief 成功从该级别分配的累计次数。*/
+    uint32_t alloc_count = 0;
+    /** @brief 该级别已耗尽导致的分配失败（或溢出到更大级别）的累计次数。*/
+    uint32_t fail_count = 0;
+};
 
 /**
  * @class Sys_MemoryManager
- * @brief 一个用于PSRAM的、手动的、固定块内存池管理器。
+ * @brief 一个用于PSRAM的、按尺寸分级的固定块内存池管理器。
  */
 class Sys_MemoryManager {
 public:
@@ -37,13 +84,39 @@ public:
     Sys_MemoryManager& operator=(const Sys_MemoryManager&) = delete;
 
     /**
-     * @brief 在系统启动时调用，从PSRAM分配大块内存并初始化内存池。
+     * @brief 在系统启动时调用，从PSRAM分配大块内存并初始化所有尺寸级别。
      * @return bool `true` 如果内存池初始化成功, `false` 如果失败。
      */
     bool initializePools();
 
     /**
-     * @brief 从专用的摄像头帧缓冲池中获取一个内存块。
+     * @brief 按尺寸从内存池中分配一个块。
+     * @details 选择能容纳`size`的最小级别；若该级别已耗尽，则依次尝试更大的级别。
+     * @param size 需要的字节数。
+     * @return void* 指向内存块的指针；若所有合适级别均已耗尽或尺寸超过1MB，返回nullptr。
+     */
+    void* allocate(size_t size);
+
+    /**
+     * @brief 从指定的尺寸级别分配一个块，不向其它级别溢出。
+     * @param pool_class 目标尺寸级别。
+     * @return void* 指向内存块的指针，若该级别无可用块则返回nullptr。
+     */
+    void* allocateFromClass(MemPoolClass pool_class);
+
+    /**
+     * @brief 将一个由`allocate`/`allocateFromClass`获得的块释放回所属级别。
+     * @param buffer 指向要释放的内存块的指针。
+     */
+    void release(void* buffer);
+
+    /**
+     * @brief 判断一个指针是否属于本内存池管理的区域。
+     */
+    bool owns(const void* buffer) const;
+
+    /**
+     * @brief 从专用的摄像头帧缓冲级别(1MB)中获取一个内存块。
      * @return void* 指向可用内存块的指针，若无可用块则返回nullptr。
      */
     void* getFrameBuffer();
@@ -53,7 +126,15 @@ public:
      * @param buffer 指向要释放的内存块的指针。
      */
     void releaseFrameBuffer(void* buffer);
-    
+
+    /**
+     * @brief 获取指定尺寸级别的统计快照。
+     * @param pool_class 目标尺寸级别。
+     * @param out_stats 用于接收统计数据的结构体。
+     * @return bool `true` 表示成功，`false` 表示级别无效或内存池未初始化。
+     */
+    bool getPoolStats(MemPoolClass pool_class, MemPoolStats& out_stats);
+
     /**
      * @brief 打印内存池的当前使用状态，用于调试。
      */
@@ -63,19 +144,109 @@ private:
     // 私有构造函数
     Sys_MemoryManager();
 
+    /** @brief 每个级别最多支持的块数（决定位图长度）。*/
+    static constexpr size_t MAX_BLOCKS_PER_CLASS = 64;
+    /** @brief 位图所需的32位字数。*/
+    static constexpr size_t BITMAP_WORDS = MAX_BLOCKS_PER_CLASS / 32;
+    /** @brief 尺寸级别的数量。*/
+    static constexpr size_t POOL_CLASS_COUNT = static_cast<size_t>(MemPoolClass::COUNT);
+    /** @brief 参与弹匣缓存的CPU核心数。*/
+    static constexpr size_t CORE_COUNT = portNUM_PROCESSORS;
+    /** @brief 每个核心、每个级别的弹匣槽位数。*/
+    static constexpr size_t MAGAZINE_SLOTS = 4;
+    /** @brief 弹匣空槽位的标记值。*/
+    static constexpr int32_t MAGAZINE_EMPTY = -1;
+
+    /**
+     * @struct PoolClass
+     * @brief 单个尺寸级别的运行时状态。
+     * @details 几何字段在`initializePools()`后只读；其余字段均为原子变量，可被两个核心无锁并发访问。
+     */
+    struct PoolClass {
+        /** @brief 该级别在大块PSRAM中的起始地址。*/
+        uint8_t* base = nullptr;
+        /** @brief 每个块的大小（字节，总是2的幂）。*/
+        size_t block_size = 0;
+        /** @brief log2(block_size)，用于以移位代替除法计算块索引。*/
+        uint8_t block_shift = 0;
+        /** @brief 块总数。*/
+        uint16_t block_count = 0;
+        /** @brief 空闲位图，bit=1 表示对应的块空闲（且不在任何弹匣中）。*/
+        std::atomic<uint32_t> free_bitmap[BITMAP_WORDS];
+        /** @brief 每个核心的弹匣，槽位存放空闲块的索引或`MAGAZINE_EMPTY`。*/
+        std::atomic<int32_t> magazine[CORE_COUNT][MAGAZINE_SLOTS];
+        /** @brief 每个块的在用标记（1=已分配），释放时以`exchange(0)`检测重复释放，所有构建中均启用。*/
+        std::atomic<uint8_t> allocated[MAX_BLOCKS_PER_CLASS];
+        /** @brief 当前在用块数。*/
+        std::atomic<uint32_t> in_use{0};
+        /** @brief 在用块数的高水位。*/
+        std::atomic<uint32_t> high_water{0};
+        /** @brief 累计成功分配次数。*/
+        std::atomic<uint32_t> alloc_count{0};
+        /** @brief 累计失败次数。*/
+        std::atomic<uint32_t> fail_count{0};
+    };
+
+    /**
+     * @brief 无锁地从一个级别中取出一个空闲块。
+     * @details 依次尝试：本核弹匣 -> 共享位图(CAS) -> 其它核心的弹匣。
+     * @return void* 内存块指针，级别已满时返回nullptr。
+     */
+    void* takeBlock(PoolClass& pool);
+
+    /**
+     * @brief 通过CAS从共享位图中认领最低位的空闲块。
+     * @return int32_t 块索引，位图为空时返回`MAGAZINE_EMPTY`。
+     */
+    static int32_t claimFromBitmap(PoolClass& pool);
+
+    /**
+     * @brief 从指定核心的弹匣中取出一个块。
+     * @return int32_t 块索引，弹匣为空时返回`MAGAZINE_EMPTY`。
+     */
+    static int32_t popMagazine(PoolClass& pool, size_t core);
+
+    /**
+     * @brief 记录一次成功分配，更新在用计数和高水位。
+     */
+    static void recordAllocation(PoolClass& pool);
+
+    /**
+     * @brief 根据指针地址找到其所属的级别。
+     * @return PoolClass* 所属级别，若不属于任何级别则返回nullptr。
+     */
+    PoolClass* findOwnerClass(const void* buffer);
+
     /** @brief 单例实例指针。*/
     static Sys_MemoryManager* _instance;
 
-    /** @brief 互斥锁，用于保护对内存池状态的并发访问。*/
+    /** @brief 互斥锁，仅用于串行化统计快照的读取，分配/释放路径不使用。*/
     SemaphoreHandle_t _mutex = NULL;
 
     // --- 内存池核心数据结构 ---
-    /** @brief 预分配的4MB内存区域的起始地址。*/
-    static void* _framebuffer_heap_start;
-    /** @brief 用于跟踪每个内存块使用状态的标志位向量。*/
-    static std::vector<bool> _block_is_used;
-    /** @brief 池中每个内存块的大小（字节）。*/
-    static size_t _block_size;
-    /** @brief 池中内存块的总数。*/
-    static size_t _block_count;
+    /** @brief 预分配的PSRAM区域的起始地址。*/
+    uint8_t* _pool_heap_start = nullptr;
+    /** @brief 预分配的PSRAM区域的总大小。*/
+    size_t _pool_heap_size = 0;
+    /** @brief 所有尺寸级别的状态表，按块大小升序排列。*/
+    PoolClass _pools[POOL_CLASS_COUNT];
+};
+
+/**
+ * @class Sys_PsramJsonAllocator
+ * @brief 供ArduinoJson使用的PSRAM分配器。
+ * @details 将`JsonDocument`内部的节点池和字符串从PSRAM分配，避免频繁的小块分配
+ *          在稀缺的内部SRAM中造成碎片。PSRAM不可用时回退到默认堆。
+ *
+ * @example
+ * JsonDocument doc(Sys_PsramJsonAllocator::instance());
+ */
+class Sys_PsramJsonAllocator : public ArduinoJson::Allocator {
+public:
+    /** @brief 获取全局共享的分配器实例（无状态，可被任意数量的文档共享）。*/
+    static Sys_PsramJsonAllocator* instance();
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t new_size) override;
 };
@@ -9,12 +9,22 @@
  * 它被设计为上层管理器（如 `Sys_SettingsManager`）的底层服务，
  * 封装了NVS句柄的打开、关闭以及详细的错误处理，使得上层逻辑更清晰。
  * 这个类不应该被实例化。
+ *
+ * [优化] 句柄缓存与批量事务：
+ * - 每个命名空间的句柄在第一次使用时打开（读写模式），之后一直缓存复用，
+ *   读写操作不再每次都经历`nvs_open` → 操作 → `nvs_close`。
+ * - 写操作默认仍会立即提交。需要一次写入多个键时，使用`beginBatch()` / `set*()` / `commitBatch()`，
+ *   整批只提交一次；批量事务期间，同一任务对该命名空间的`write*()`调用也不会单独提交。
  */
 #pragma once
 
 #include <Arduino.h>
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include <type_traits> // 用于 std::is_same
 
 /**
@@ -46,7 +56,7 @@ public:
 
     /**
      * @brief 向NVS写入一个基本数据类型的值。
-     * @details 操作完成后会自动提交 (commit)。
+     * @details 操作完成后会自动提交 (commit)；在调用任务的批量事务中则推迟到`commitBatch()`。
      * @tparam T 要写入的值的类型。
      * @param ns_name NVS命名空间。
      * @param key 键名。
@@ -95,6 +105,14 @@ public:
      */
     static bool writeBlob(const char* ns_name, const char* key, const void* blob, size_t length);
     
+    /**
+     * @brief [新增] 擦除指定命名空间下的单个键。
+     * @param ns_name NVS命名空间。
+     * @param key 要擦除的键名。
+     * @return bool `true` 表示成功或键本来就不存在, `false` 表示失败。
+     */
+    static bool eraseKey(const char* ns_name, const char* key);
+
     /**
      * @brief 擦除指定命名空间下的所有键值对。
      * @warning 这是一个危险操作，会删除该命名空间下的所有数据。
@@ -102,6 +120,71 @@ public:
      * @return bool `true` 表示成功, `false` 表示失败。
      */
     static bool eraseNamespace(const char* ns_name);
+
+    // --- [新增] 批量事务 (Batch Transactions) ---
+
+    /**
+     * @brief 开始一个批量事务。
+     * @details 同一时刻只允许一个批量事务（其它任务的`beginBatch()`会等待）；
+     *          必须由同一个任务调用`commitBatch()`结束。
+     * @param ns_name 本次事务写入的NVS命名空间。
+     * @return bool `true` 表示事务已开始；`false` 表示无法打开命名空间（此时不需要调用`commitBatch()`）。
+     */
+    static bool beginBatch(const char* ns_name);
+
+    /** @brief 在当前批量事务中写入一个基本数据类型的值（不提交）。*/
+    template<typename T>
+    static bool setValue(const char* key, T value);
+
+    /** @brief 在当前批量事务中写入一个字符串（不提交）。*/
+    static bool setString(const char* key, const char* value);
+
+    /** @brief 在当前批量事务中写入一个BLOB（不提交）。*/
+    static bool setBlob(const char* key, const void* blob, size_t length);
+
+    /**
+     * @brief 提交并结束当前批量事务。
+     * @return bool `true` 表示提交成功，且事务中的所有`set*()`调用都成功。
+     */
+    static bool commitBatch();
+
+    /** @brief 句柄缓存可容纳的命名空间数。*/
+    static constexpr size_t MAX_CACHED_HANDLES = 8;
+
+private:
+    /**
+     * @brief 获取（必要时打开并缓存）命名空间的句柄。
+     * @return bool `true` 表示成功。
+     */
+    static bool getHandle(const char* ns_name, nvs_handle_t& out_handle);
+
+    /** @brief 提交写操作；若该句柄正处于调用任务的批量事务中，则推迟到`commitBatch()`。*/
+    static esp_err_t commitUnlessBatched(nvs_handle_t handle);
+
+    /**
+     * @struct CachedHandle
+     * @brief 句柄缓存中的一项。
+     */
+    struct CachedHandle {
+        /** @brief 命名空间名（NVS限制最长15个字符）。*/
+        char ns_name[16];
+        nvs_handle_t handle;
+    };
+
+    /** @brief 句柄缓存。*/
+    static CachedHandle _handles[MAX_CACHED_HANDLES];
+    /** @brief 缓存中的句柄数。*/
+    static size_t _handle_count;
+    /** @brief 保护句柄缓存的互斥锁。*/
+    static SemaphoreHandle_t _cache_mutex;
+    /** @brief 串行化批量事务的互斥锁，从`beginBatch()`一直持有到`commitBatch()`。*/
+    static SemaphoreHandle_t _batch_mutex;
+    /** @brief 当前批量事务的句柄。*/
+    static nvs_handle_t _batch_handle;
+    /** @brief 当前批量事务所属的任务，NULL表示没有进行中的事务。*/
+    static TaskHandle_t _batch_owner;
+    /** @brief 当前批量事务中是否有写入失败。*/
+    static bool _batch_failed;
 };
 
 // --- 模板函数的实现必须放在头文件中 ---
@@ -115,11 +198,11 @@ public:
 template<typename T>
 bool Sys_NvsManager::readValue(const char* ns_name, const char* key, T& out_value) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
+    if (!getHandle(ns_name, nvs_handle)) {
         // 如果打开命名空间失败，直接返回false。
         return false;
     }
+    esp_err_t err;
 
     // 使用if-constexpr (C++17) 或 std::is_same (C++11) 进行类型分发
     if (std::is_same<T, uint8_t>::value)       err = nvs_get_u8(nvs_handle, key, reinterpret_cast<uint8_t*>(&out_value));
@@ -141,7 +224,7 @@ bool Sys_NvsManager::readValue(const char* ns_name, const char* key, T& out_valu
         err = ESP_ERR_NVS_TYPE_MISMATCH;
     }
 
-    nvs_close(nvs_handle);
+    // [优化] 句柄由缓存持有，此处无需关闭
     return err == ESP_OK;
 }
 
@@ -151,8 +234,8 @@ bool Sys_NvsManager::readValue(const char* ns_name, const char* key, T& out_valu
 template<typename T>
 bool Sys_NvsManager::writeValue(const char* ns_name, const char* key, T value) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) return false;
+    if (!getHandle(ns_name, nvs_handle)) return false;
+    esp_err_t err;
 
     if (std::is_same<T, uint8_t>::value)       err = nvs_set_u8(nvs_handle, key, *reinterpret_cast<const uint8_t*>(&value));
     else if (std::is_same<T, int8_t>::value)   err = nvs_set_i8(nvs_handle, key, *reinterpret_cast<const int8_t*>(&value));
@@ -167,11 +250,40 @@ bool Sys_NvsManager::writeValue(const char* ns_name, const char* key, T value) {
         err = ESP_ERR_NVS_TYPE_MISMATCH;
     }
 
-    // 只有在set操作成功后，才执行commit操作。
+    // 只有在set操作成功后，才执行commit操作（批量事务中推迟到commitBatch()）。
     if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle);
+        err = commitUnlessBatched(nvs_handle);
+    }
+
+    return err == ESP_OK;
+}
+
+/**
+ * @brief `setValue` 模板函数的具体实现。
+ */
+template<typename T>
+bool Sys_NvsManager::setValue(const char* key, T value) {
+    if (_batch_owner != xTaskGetCurrentTaskHandle()) {
+        ESP_LOGE("NVS", "setValue('%s') called outside of a batch.", key);
+        return false;
+    }
+    nvs_handle_t nvs_handle = _batch_handle;
+    esp_err_t err;
+    if (std::is_same<T, uint8_t>::value)       err = nvs_set_u8(nvs_handle, key, *reinterpret_cast<const uint8_t*>(&value));
+    else if (std::is_same<T, int8_t>::value)   err = nvs_set_i8(nvs_handle, key, *reinterpret_cast<const int8_t*>(&value));
+    else if (std::is_same<T, uint16_t>::value) err = nvs_set_u16(nvs_handle, key, *reinterpret_cast<const uint16_t*>(&value));
+    else if (std::is_same<T, int16_t>::value)  err = nvs_set_i16(nvs_handle, key, *reinterpret_cast<const int16_t*>(&value));
+    else if (std::is_same<T, uint32_t>::value) err = nvs_set_u32(nvs_handle, key, *reinterpret_cast<const uint32_t*>(&value));
+    else if (std::is_same<T, int32_t>::value)  err = nvs_set_i32(nvs_handle, key, *reinterpret_cast<const int32_t*>(&value));
+    else if (std::is_same<T, uint64_t>::value) err = nvs_set_u64(nvs_handle, key, *reinterpret_cast<const uint64_t*>(&value));
+    else if (std::is_same<T, int64_t>::value)  err = nvs_set_i64(nvs_handle, key, *reinterpret_cast<const int64_t*>(&value));
+    else if (std::is_same<T, bool>::value)     err = nvs_set_u8(nvs_handle, key, static_cast<uint8_t>(*reinterpret_cast<const bool*>(&value)));
+    else {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
     }
 
-    nvs_close(nvs_handle);
+    if (err != ESP_OK) {
+        _batch_failed = true;
+    }
     return err == ESP_OK;
 }
\ No newline at end of file
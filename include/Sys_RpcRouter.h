@@ -0,0 +1,135 @@
+/**
+ * @file Sys_RpcRouter.h
+ * @brief 表驱动的JSON RPC方法路由器的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 该模块取代了`processJsonRpcRequest`中的`strcmp`链式分发。
+ * 各模块在启动阶段通过`registerMethod()`注册自己的RPC方法，路由器将它们
+ * 按FNV-1a哈希值排序存入一张固定容量的表中；分发时只需计算一次方法名的哈希，
+ * 再进行二分查找，最后用一次`strcmp`确认，开销与已注册方法的数量基本无关。
+ *
+ * 每个方法可以声明标志位：
+ * - `RPC_FLAG_LONG_RUNNING`：耗时操作（供任务调度参考）。
+ * - `RPC_FLAG_DEBUG_ONLY`：仅调试构建可用，且运行时调试开关关闭时视为不存在。
+ *
+ * @note 注册必须在`Sys_Tasks::begin()`启动任务之前（单线程的setup()中）完成，
+ *       之后的分发过程只读路由表，无需加锁。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "ArduinoJson.h"
+
+struct JsonRpcRequest;
+
+/**
+ * @enum RpcMethodFlags
+ * @brief RPC方法的属性标志位，可按位组合。
+ */
+enum RpcMethodFlags : uint8_t {
+    RPC_FLAG_NONE         = 0,
+    RPC_FLAG_LONG_RUNNING = (1 << 0), // 耗时/阻塞型操作
+    RPC_FLAG_DEBUG_ONLY   = (1 << 1), // 仅在调试模式下可用
+};
+
+/**
+ * @brief 编译期可求值的FNV-1a 32位哈希。
+ * @details 采用单return语句的递归写法，兼容C++11的constexpr限制，
+ *          因此既可用于运行时计算，也可用于`static_assert`或常量定义。
+ * @param str 以null结尾的字符串。
+ * @param hash 当前的哈希累积值（调用方无需提供）。
+ */
+constexpr uint32_t rpcMethodHash(const char* str, uint32_t hash = 2166136261u) {
+    return (*str == '\0') ? hash : rpcMethodHash(str + 1, (hash ^ static_cast<uint8_t>(*str)) * 16777619u);
+}
+
+/**
+ * @class Sys_RpcRouter
+ * @brief 一个提供方法注册、查找与分发的静态工具类。
+ */
+class Sys_RpcRouter {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_RpcRouter() = delete;
+
+    /** @brief RPC方法处理函数的类型。*/
+    using Handler = void (*)(const JsonRpcRequest& request);
+
+    /**
+     * @struct MethodEntry
+     * @brief 路由表中的一项。
+     */
+    struct MethodEntry {
+        /** @brief 方法名的FNV-1a哈希，路由表按此字段升序排列。*/
+        uint32_t hash;
+        /** @brief 方法名（必须是静态生命周期的字符串）。*/
+        const char* name;
+        /** @brief 处理函数。*/
+        Handler handler;
+        /** @brief `RpcMethodFlags`的按位组合。*/
+        uint8_t flags;
+    };
+
+    /**
+     * @brief 注册一个RPC方法。
+     * @details 在release构建(CORE_DEBUG_MODE=0)中，带`RPC_FLAG_DEBUG_ONLY`的方法会被直接忽略。
+     * @param name 方法名，例如 "system.reboot"。必须是静态生命周期的字符串。
+     * @param handler 处理函数。
+     * @param flags `RpcMethodFlags`的按位组合。
+     * @return bool `true` 表示成功；表已满、重名或哈希冲突时返回 `false`。
+     */
+    static bool registerMethod(const char* name, Handler handler, uint8_t flags = RPC_FLAG_NONE);
+
+    /**
+     * @brief 查找一个方法。
+     * @details 调试专用方法在运行时调试开关关闭时视为不存在。
+     * @param name 方法名。
+     * @return const MethodEntry* 找到的表项，未找到时返回nullptr。
+     */
+    static const MethodEntry* find(const char* name);
+
+    /**
+     * @brief 将请求分发给已注册的处理函数。
+     * @details 未找到方法时，自动回复 -32601 "Method not found"。
+     * @param request 已解析的请求对象。
+     */
+    static void dispatch(const JsonRpcRequest& request);
+
+    /**
+     * @brief [新增] 把一帧原始数据解析进请求对象，并校验JSON RPC 2.0格式。
+     * @details 成功时填充`doc`、`id`、`method`、`params`和`encoding`；`client_id`和`response_cb`由调用方设置。
+     *          WebSocket处理器和主机端测试驱动共用这一入口。
+     * @param request 由`JsonRpcRequest::create()`得到的空请求对象。
+     * @param data 帧数据。
+     * @param len 帧长度。
+     * @param msgpack 帧是否为MessagePack编码（否则按JSON解析）。
+     * @return int 0表示成功；否则为JSON RPC错误码（-32700 解析失败，-32600 请求无效）。
+     */
+    static int parseFrame(JsonRpcRequest& request, const char* data, size_t len, bool msgpack);
+
+    /**
+     * @brief 响应一个JSON RPC请求的辅助函数。
+     * @param request 原始请求，用于获取id和响应回调。
+     * @param result 要包含在响应中的`result`字段的JSON文档。
+     */
+    static void sendResult(const JsonRpcRequest& request, JsonDocument& result);
+
+    /**
+     * @brief 响应一个JSON RPC错误的辅助函数。
+     * @param request 原始请求。
+     * @param code JSON RPC 错误码。
+     * @param message 错误描述。
+     */
+    static void sendError(const JsonRpcRequest& request, int code, const char* message);
+
+private:
+    /** @brief 路由表的最大容量。*/
+    static constexpr size_t MAX_METHODS = 32;
+
+    /** @brief 按哈希升序排列的路由表。*/
+    static MethodEntry _methods[MAX_METHODS];
+    /** @brief 已注册的方法数量。*/
+    static size_t _method_count;
+};
@@ -0,0 +1,180 @@
+/**
+ * @file Sys_Scheduler.h
+ * @brief 事件驱动的定时器轮调度器的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 取代Task_SystemMonitor原先“每秒醒来一次、轮询所有模块”的循环。各模块在启动时创建定时器、
+ * 订阅系统事件，Task_SystemMonitor只在最近一个定时器到期、或有事件投递时才被唤醒：
+ * - **定时器**：单次或周期定时器，放在一个散列定时器轮（`WHEEL_SLOTS`个槽，每槽`TICK_MS`毫秒）中；
+ *   到期时间超过一圈的定时器留在槽中，直到真正到期。重新启动一个运行中的定时器即推迟它（去抖动）。
+ * - **事件**：`post()`设置一个事件位并唤醒调度任务，同一事件在处理前的多次投递合并为一次。
+ * - **休眠**：调度任务阻塞在任务通知上，超时时间就是到最近一个到期定时器的时间；
+ *   没有活动定时器时无限期阻塞，因此空闲系统可以进入自动Light-sleep（见`configurePowerManagement()`）。
+ *
+ * 所有回调都在Task_SystemMonitor中串行执行、且不持有调度器的锁，回调中可以再启动或停止定时器。
+ * 回调应当短小，耗时操作仍应投递到工作任务。
+ *
+ * @note `begin()`之外的公共方法均为线程安全，但不可在ISR中调用。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "ArduinoJson.h"
+
+/**
+ * @enum SysEvent
+ * @brief 可通过调度器投递的系统事件。新增事件时在`Sys_Scheduler.cpp`的名称表中添加名称。
+ */
+enum class SysEvent : uint8_t {
+    CLIENTS_CHANGED = 0, // WebSocket客户端连接或断开
+    SETTINGS_CHANGED,    // 内存中的配置发生变化（有待提交的修改）
+    COUNT                // 事件总数（非有效事件）
+};
+
+/** @brief 定时器句柄（即定时器表中的下标）。*/
+using TimerId = int8_t;
+/** @brief 无效的定时器句柄。*/
+static constexpr TimerId INVALID_TIMER = -1;
+
+/**
+ * @class Sys_Scheduler
+ * @brief 由Task_SystemMonitor驱动的定时器轮与事件分发器。
+ */
+class Sys_Scheduler {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_Scheduler() = delete;
+
+    /** @brief 定时器回调。*/
+    using TimerCallback = void (*)(void* arg);
+    /** @brief 事件处理函数。*/
+    using EventHandler = void (*)(SysEvent event);
+
+    /** @brief 定时器表的容量。*/
+    static constexpr size_t MAX_TIMERS = 16;
+    /** @brief 每个事件的最大处理函数数。*/
+    static constexpr size_t MAX_HANDLERS_PER_EVENT = 4;
+    /** @brief 定时器轮一个槽代表的时间（毫秒），也是定时器的精度。*/
+    static constexpr uint32_t TICK_MS = 10;
+    /** @brief 定时器轮的槽数（必须是2的幂）。*/
+    static constexpr size_t WHEEL_SLOTS = 64;
+
+    /**
+     * @brief 创建内部锁。
+     * @note 必须在任何模块创建定时器或订阅事件之前调用（`setup()`中在初始化WiFi管理器之前完成）。
+     */
+    static void begin();
+
+    /**
+     * @brief 调度循环，永不返回。由Task_SystemMonitor调用。
+     */
+    static void run();
+
+    /**
+     * @brief 创建一个（尚未启动的）定时器。
+     * @param name 定时器名称（用于日志），必须是静态生命周期的字符串。
+     * @param callback 到期时在Task_SystemMonitor中调用的函数。
+     * @param arg 传给回调的参数。
+     * @return TimerId 定时器句柄；表已满时返回`INVALID_TIMER`。
+     */
+    static TimerId createTimer(const char* name, TimerCallback callback, void* arg = nullptr);
+
+    /**
+     * @brief 启动（或重新启动）一个定时器。
+     * @details 定时器已在运行时，按新的参数重新计时，因此反复调用即可实现去抖动。
+     * @param id 定时器句柄。
+     * @param delay_ms 距第一次到期的时间（毫秒），0表示在调度任务下一次醒来时立即执行。
+     * @param period_ms 之后的重复周期（毫秒），0表示单次定时器。
+     */
+    static void startTimer(TimerId id, uint32_t delay_ms, uint32_t period_ms = 0);
+
+    /**
+     * @brief 停止一个定时器。定时器未运行时无操作。
+     */
+    static void stopTimer(TimerId id);
+
+    /**
+     * @brief 定时器是否在运行（已启动且尚未到期，或是周期定时器）。
+     */
+    static bool isTimerActive(TimerId id);
+
+    /**
+     * @brief 订阅一个系统事件。
+     * @note 应在启动阶段（调度任务运行前）完成订阅。
+     * @return bool `true` 表示成功；该事件的处理函数已满时返回 `false`。
+     */
+    static bool subscribe(SysEvent event, EventHandler handler);
+
+    /**
+     * @brief 投递一个事件并唤醒调度任务。调度任务启动前投递的事件会在其启动后处理。
+     */
+    static void post(SysEvent event);
+
+    /**
+     * @brief 写入调度器的统计（唤醒次数、定时器执行次数、事件数和活动定时器）。
+     */
+    static void writeStats(JsonObject out);
+
+    /**
+     * @brief [新增] 启用动态调频（DFS），可选地启用自动Light-sleep。
+     * @details 需要固件开启`CONFIG_PM_ENABLE`（自动Light-sleep还需要`CONFIG_FREERTOS_USE_TICKLESS_IDLE`）；
+     *          未开启时只输出一条警告。WiFi保持连接所需的Modem-sleep由WiFi驱动自行管理。
+     * @return bool `true` 表示电源管理配置成功。
+     */
+    static bool configurePowerManagement(uint32_t max_mhz, uint32_t min_mhz, bool light_sleep);
+
+private:
+    /** @brief 定时器表中的一项。*/
+    struct Timer {
+        const char* name = nullptr;
+        TimerCallback callback = nullptr;
+        void* arg = nullptr;
+        /** @brief 到期时刻（轮刻度，每`TICK_MS`一刻）。*/
+        uint32_t expiry = 0;
+        /** @brief 重复周期（轮刻度），0表示单次。*/
+        uint32_t period = 0;
+        /** @brief 同一槽中的下一个定时器，`INVALID_TIMER`表示链表末尾。*/
+        TimerId next = INVALID_TIMER;
+        bool active = false;
+        /** @brief 已被判定到期、等待在锁外执行回调；`stopTimer()`会撤销它。*/
+        bool due = false;
+    };
+
+    /** @brief 当前时刻（轮刻度）。*/
+    static uint32_t nowTick();
+    /** @brief 把定时器挂到其到期时刻对应的槽中。调用者必须持有`_mutex`。*/
+    static void link(TimerId id);
+    /** @brief 把定时器从其所在的槽中摘下。调用者必须持有`_mutex`。*/
+    static void unlink(TimerId id);
+    /** @brief 执行所有已到期的定时器。*/
+    static void runExpiredTimers();
+    /** @brief 计算到最近一个活动定时器的阻塞时间。*/
+    static TickType_t nextTimeout();
+    /** @brief 分发一组事件位。*/
+    static void dispatchEvents(uint32_t event_bits);
+
+    /** @brief 保护定时器表和定时器轮。*/
+    static SemaphoreHandle_t _mutex;
+    /** @brief 调度任务（Task_SystemMonitor）的句柄，`run()`开始前为NULL。*/
+    static std::atomic<TaskHandle_t> _task;
+    /** @brief 已投递、尚未处理的事件位。*/
+    static std::atomic<uint32_t> _pending_events;
+    static Timer _timers[MAX_TIMERS];
+    static size_t _timer_count;
+    /** @brief 定时器轮：每个槽是一个以`Timer::next`串联的链表的表头。*/
+    static TimerId _wheel[WHEEL_SLOTS];
+    /** @brief 最近一次处理到的轮刻度（每`TICK_MS`一刻）。*/
+    static uint32_t _processed_tick;
+    static EventHandler _handlers[static_cast<size_t>(SysEvent::COUNT)][MAX_HANDLERS_PER_EVENT];
+
+    // --- 统计 ---
+    static uint32_t _wakeups;
+    static uint32_t _timers_fired;
+    static uint32_t _events_dispatched;
+};
@@ -9,11 +9,27 @@
  * 它采用内存缓存和“脏标记”机制，实现了配置的快速读取和对Flash寿命友好的延迟写入。
  * 所有其他模块需要获取配置时，都应通过此管理器进行，以确保数据的一致性。
  *
- * @note  本模块的所有公共方法均为线程安全，内部通过互斥锁实现同步。
+ * [优化] 按字段持久化与写入合并：
+ * - 每个配置项保存为NVS中独立的键，脏标记也细化到字段。`commit()`只写入发生变化的字段，
+ *   不再因为一个开关的变化而重写整个配置结构体。
+ * - 修改后需保持“安静”一段时间（合并窗口，见`setCommitWindow()`）才会落盘，连续的修改被合并为一次写入；
+ *   持续修改时最迟在`MAX_COMMIT_DELAY_MS`后强制落盘。
+ * - NVS写入在锁外进行，Getter不会因为一次提交而阻塞。
+ * - NVS中保存了配置的模式版本号(`schema`)。版本不一致时逐级执行迁移（如v1的整体BLOB → v2的分字段键），
+ *   而不是直接恢复默认值。
+ *
+ * [优化] 无锁读取与变更通知：
+ * - 当前配置保存为不可变的快照，修改时先复制出新快照、修改后再原子地发布（RCU风格），
+ *   `getSettings()`及各Getter不再获取互斥锁，也不再拷贝整个结构体。
+ * - 其他模块可通过`addChangeListener()`订阅配置变化，回调中带有实际发生变化的字段位图，
+ *   以便只重新应用受影响的部分。
+ *
+ * @note  本模块的所有公共方法均为线程安全：读取无锁，修改之间通过互斥锁串行化。
  */
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "Sys_LockGuard.h" // 引入RAII锁
@@ -23,13 +39,15 @@
  * @brief 一个集中包含了所有系统可配置项的结构体。
  *
  * @details
- * 将所有配置项聚合在一个结构体中，便于作为一个整体从NVS中加载和保存(BLOB操作)。
+ * 将所有配置项聚合在一个结构体中，便于作为一个整体读取。
+ * [优化] 在NVS中，每个配置项保存为一个独立的键（见`Sys_SettingsManager.cpp`中的字段表），
+ * 新增配置项时只需在字段表中登记，旧版本固件留下的键不受影响。
  * 成员的默认值在此处通过C++11的成员初始化器定义，用于`loadDefaults()`。
  */
 struct SystemSettings {
     // --- 版本控制 ---
-    /** @brief 配置结构体的版本号，用于固件升级时的数据迁移。*/
-    uint32_t settings_version = 1;
+    /** @brief 配置的模式版本号，用于固件升级时的数据迁移。*/
+    uint32_t settings_version = 2;
 
     // --- WiFi 设置 ---
     /** @brief Station模式下连接的WiFi SSID。*/
@@ -84,46 +102,71 @@ public:
      */
     void begin();
 
+    class Snapshot;
+
     /**
-     * @brief 获取当前内存中所有配置的一份线程安全快照。
-     * @details 此方法返回一个配置的**副本**，适用于需要同时访问多个配置项，
-     *          并需要保证这些配置项在操作期间一致的场景。
-     * @return SystemSettings 配置结构体的副本。
+     * @brief 获取当前配置的只读快照。
+     * @details [优化] 无锁、无拷贝：返回的句柄引用一份不可变的配置，持有期间其内容不会被修改，
+     *          适用于需要同时访问多个配置项、并需要保证它们彼此一致的场景。
+     *          句柄应尽快释放（离开作用域即可），不要长期保存。
+     * @return Snapshot 配置快照句柄。
      */
-    SystemSettings getSettings();
+    Snapshot getSettings() const;
 
     // --- 线程安全的单个配置项 Getter ---
-    // 为频繁访问的单个配置项提供高效、线程安全的只读方法，避免不必要的结构体拷贝。
+    // 为频繁访问的单个配置项提供高效、线程安全的只读方法（无锁，读取当前快照）。
     
     /** @brief 线程安全地获取运行时调试模式状态。*/
-    bool isDebugModeEnabled();
+    bool isDebugModeEnabled() const;
     /** @brief 线程安全地获取WiFi模式。*/
-    SystemSettings::WiFiMode getWiFiMode();
+    SystemSettings::WiFiMode getWiFiMode() const;
     /** @brief 线程安全地获取蓝牙设备名称。*/
-    String getBluetoothName();
+    String getBluetoothName() const;
     // ... 未来可为其他需要单独访问的配置项添加getter ...
     
     // --- 修改与持久化 ---
 
+    /** @brief [新增] 默认的写入合并窗口（毫秒）。*/
+    static constexpr uint32_t DEFAULT_COMMIT_WINDOW_MS = 3000;
+    /** @brief [新增] 从第一次修改到落盘的最长延迟（毫秒），防止持续修改使配置一直得不到保存。*/
+    static constexpr uint32_t MAX_COMMIT_DELAY_MS = 30000;
+
     /**
      * @brief 将内存中的修改提交到NVS。
-     * @details 只有当`isDirty()`返回`true`时，才会执行实际的写入操作。
-     *          这个函数被`Task_SystemMonitor`周期性调用，实现了延迟写入。
-     * @return bool `true` 如果提交成功或无需提交，`false` 如果写入NVS失败。
+     * @details 只有当`isDirty()`返回`true`、且距最后一次修改已超过合并窗口（或距第一次修改已超过
+     *          `MAX_COMMIT_DELAY_MS`）时，才会执行实际的写入操作，并且只写入发生变化的字段。
+     *          [优化] 由调度器的提交定时器在`getCommitDelay()`给出的时刻调用，实现了延迟写入。
+     * @return bool `true` 如果提交成功或无需提交，`false` 如果写入NVS失败（失败的字段保持“脏”，下次重试）。
      */
     bool commit();
     
     /**
-     * @brief 强制将当前内存中的配置立即保存到NVS，无论是否“脏”。
+     * @brief 强制将当前内存中的配置立即保存到NVS，无论是否“脏”，也不等待合并窗口。
      * @details 用于在系统重启等关键操作前，确保所有配置都已持久化。
      */
     void forceSave();
 
+    /**
+     * @brief [新增] 设置写入合并窗口。
+     * @param window_ms 最后一次修改后需要保持不变的时间（毫秒）；0表示下一次`commit()`即写入。
+     */
+    void setCommitWindow(uint32_t window_ms);
+
     /**
      * @brief 检查是否有未保存的修改。
      * @return bool `true` 如果有未提交的修改，否则为 `false`。
      */
     bool isDirty();
+
+    /** @brief [新增] `getCommitDelay()`的返回值：没有未保存的修改。*/
+    static constexpr uint32_t NO_PENDING_COMMIT = UINT32_MAX;
+
+    /**
+     * @brief [新增] 计算距离`commit()`会真正写入NVS还有多久。
+     * @details 取合并窗口的剩余时间与`MAX_COMMIT_DELAY_MS`的剩余时间中较小者，供调度器安排提交定时器。
+     * @return uint32_t 毫秒数，0表示现在即可提交；没有未保存的修改时返回`NO_PENDING_COMMIT`。
+     */
+    uint32_t getCommitDelay();
     
     /**
      * @brief 将所有设置恢复到出厂默认值，并立即保存到NVS。
@@ -131,7 +174,7 @@ public:
     void factoryReset();
 
     // --- 线程安全的 Setter 接口 ---
-    // 每个setter都会修改内存中的值，并设置“脏”标记，以待`commit()`。
+    // 每个setter都会修改内存中的值，并为实际发生变化的字段设置“脏”标记，以待`commit()`。
     
     /** @brief 设置WiFi相关配置。*/
     void setWiFiConfig(const char* ssid, const char* password, SystemSettings::WiFiMode mode);
@@ -140,31 +183,158 @@ public:
     /** @brief 设置运行时调试模式开关。*/
     void setDebugMode(bool enabled);
 
+    /**
+     * @enum Field
+     * @brief [新增] 可单独持久化的配置项，顺序与`Sys_SettingsManager.cpp`中的字段表一致。
+     */
+    enum Field : uint8_t {
+        FIELD_WIFI_SSID,
+        FIELD_WIFI_PASSWORD,
+        FIELD_WIFI_MODE,
+        FIELD_WIFI_STATIC_IP_ENABLED,
+        FIELD_WIFI_STATIC_IP,
+        FIELD_WIFI_SUBNET,
+        FIELD_WIFI_GATEWAY,
+        FIELD_BLUETOOTH_ENABLED,
+        FIELD_BLUETOOTH_NAME,
+        FIELD_DEBUG_MODE,
+        FIELD_COUNT
+    };
+    /** @brief 所有字段的脏标记位图。*/
+    static constexpr uint32_t ALL_FIELDS = (1u << FIELD_COUNT) - 1;
+    /** @brief [新增] WiFi相关字段的位图。*/
+    static constexpr uint32_t WIFI_FIELDS = (1u << FIELD_WIFI_SSID) | (1u << FIELD_WIFI_PASSWORD) | (1u << FIELD_WIFI_MODE) |
+                                            (1u << FIELD_WIFI_STATIC_IP_ENABLED) | (1u << FIELD_WIFI_STATIC_IP) |
+                                            (1u << FIELD_WIFI_SUBNET) | (1u << FIELD_WIFI_GATEWAY);
+    /** @brief [新增] 蓝牙相关字段的位图。*/
+    static constexpr uint32_t BLUETOOTH_FIELDS = (1u << FIELD_BLUETOOTH_ENABLED) | (1u << FIELD_BLUETOOTH_NAME);
+
+    // --- [新增] 变更通知 ---
+
+    /**
+     * @brief 配置变更回调。
+     * @param changed_fields 实际发生变化的字段位图（已与订阅时的`field_mask`相与）。
+     * @note 回调在执行修改的任务中、锁外被调用，可以调用`getSettings()`读取新配置，
+     *       但不应长时间阻塞。并发修改时回调可能乱序到达，因此应读取最新快照，而不是依赖到达顺序。
+     */
+    using ChangeListener = void (*)(uint32_t changed_fields);
+
+    /** @brief 最多可注册的变更监听器数量。*/
+    static constexpr size_t MAX_CHANGE_LISTENERS = 8;
+
+    /**
+     * @brief 注册一个配置变更监听器。
+     * @param field_mask 关心的字段位图（如`WIFI_FIELDS`）。
+     * @param listener 回调函数。
+     * @return bool `false` 如果监听器数量已达上限。
+     * @note 应在系统进入多任务调度前（各模块的`begin()`中）注册。
+     */
+    bool addChangeListener(uint32_t field_mask, ChangeListener listener);
+
+private:
+    /**
+     * @struct Slot
+     * @brief [新增] 快照槽位：一份配置，以及当前持有它的读者数量。
+     */
+    struct Slot {
+        SystemSettings data;
+        std::atomic<uint32_t> readers{0};
+    };
+
+public:
+    /**
+     * @class Snapshot
+     * @brief [新增] 配置快照的RAII句柄，析构时自动释放对快照的引用。只能移动，不能拷贝。
+     */
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other) noexcept : _slot(other._slot) { other._slot = nullptr; }
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+        ~Snapshot() {
+            if (_slot) _slot->readers.fetch_sub(1);
+        }
+
+        const SystemSettings& operator*() const { return _slot->data; }
+        const SystemSettings* operator->() const { return &_slot->data; }
+
+    private:
+        friend class Sys_SettingsManager;
+        explicit Snapshot(Slot* slot) : _slot(slot) {}
+        Slot* _slot;
+    };
+
 private:
     // 私有构造函数，在其中创建同步机制。
     Sys_SettingsManager();
     
-    // 从NVS加载配置到内存缓存
-    void load();
-    // 将内存缓存中的配置保存到NVS
-    bool save(); // [优化] 返回bool值，便于上层判断是否成功
-    // 将出厂默认配置加载到内存缓存
-    void loadDefaults();
-    // 将“脏”标记设为true
-    void markAsDirty();
+    // 从NVS加载配置
+    void load(SystemSettings& settings);
+    // [新增] 从NVS中逐个读取分字段保存的配置项，缺失的字段保持默认值
+    void loadFields(SystemSettings& settings);
+    // [新增] 把NVS中的配置从`from_version`逐级迁移到当前版本
+    bool migrate(SystemSettings& settings, uint32_t from_version);
+    // [优化] 把快照中被`field_mask`选中的字段写入NVS，返回写入失败的字段位图
+    uint32_t writeFields(const SystemSettings& snapshot, uint32_t field_mask);
+    // [优化] 把当前配置中的脏字段写入NVS（在锁外执行I/O）
+    bool flushDirtyFields(uint32_t extra_mask);
+    // 将出厂默认配置加载到`settings`
+    void loadDefaults(SystemSettings& settings);
+    // [优化] 将指定字段标记为“脏”
+    void markAsDirty(uint32_t field_mask);
+    // [新增] 修改字符串字段：值发生变化时拷贝，返回变化的字段位图
+    static uint32_t updateString(Field field, char* dest, size_t dest_size, const char* value);
+    // [新增] 取得当前快照（增加读者计数）
+    Slot* acquireCurrent() const;
+    // [新增] 找到一个空闲槽位，并把当前配置复制进去作为新快照的草稿
+    Slot* beginUpdate();
+    // [新增] 发布新快照并标记脏字段；`changed_fields`为0时放弃草稿
+    void publish(Slot* draft, uint32_t changed_fields);
+    // [新增] 通知订阅了`changed_fields`中任一字段的监听器（在锁外调用）
+    void notifyListeners(uint32_t changed_fields);
 
     /** @brief 单例实例指针。*/
     static Sys_SettingsManager* _instance;
-    /** @brief 内存中的配置缓存，是系统的“唯一事实来源”。*/
-    SystemSettings _settings;
-    /** @brief “脏”标记，指示内存中的配置是否与NVS中的不一致。*/
-    bool _is_dirty = false;
+
+    /**
+     * @brief [新增] 快照槽位数量。
+     * @details 一个槽位是当前快照，其余槽位供仍被读者持有的旧快照和新快照的草稿使用。
+     *          读者持有快照的时间都很短，所有槽位同时被占用时写者会短暂等待。
+     */
+    static constexpr size_t SNAPSHOT_SLOTS = 4;
+    /** @brief 快照槽位。*/
+    Slot _slots[SNAPSHOT_SLOTS];
+    /** @brief 当前发布的快照，是系统的“唯一事实来源”。*/
+    std::atomic<Slot*> _current{&_slots[0]};
+
+    /** @brief [新增] 监听器表项。*/
+    struct ListenerEntry {
+        uint32_t field_mask;
+        ChangeListener listener;
+    };
+    /** @brief 已注册的变更监听器。*/
+    ListenerEntry _listeners[MAX_CHANGE_LISTENERS] = {};
+    /** @brief 已注册的监听器数量。*/
+    std::atomic<size_t> _listener_count{0};
+    /** @brief [优化] 按字段的“脏”标记位图（第n位对应`Field` n），0表示与NVS一致。*/
+    uint32_t _dirty_mask = 0;
+    /** @brief [新增] 第一次出现未保存修改的时间。*/
+    uint32_t _first_dirty_ms = 0;
+    /** @brief [新增] 最后一次修改的时间。*/
+    uint32_t _last_change_ms = 0;
+    /** @brief [新增] 写入合并窗口。*/
+    uint32_t _commit_window_ms = DEFAULT_COMMIT_WINDOW_MS;
     
-    /** @brief 互斥锁，用于保护对 _settings 和 _is_dirty 的并发访问。*/
+    /** @brief 互斥锁，用于串行化快照的发布并保护脏标记（不覆盖NVS写入，也不用于读取）。*/
     SemaphoreHandle_t _mutex = NULL;
+    /** @brief [新增] 串行化NVS写入的互斥锁，保证较新的快照不会被较旧的快照覆盖。*/
+    SemaphoreHandle_t _write_mutex = NULL;
     
     /** @brief 用于存储配置的NVS命名空间。*/
     static constexpr const char* NVS_NAMESPACE = "sys_config";
-    /** @brief 用于存储配置BLOB的NVS键名。*/
-    static constexpr const char* NVS_KEY_BLOB = "settings_v1";
+    /** @brief [新增] 保存配置模式版本号的NVS键名。*/
+    static constexpr const char* NVS_KEY_SCHEMA = "schema";
+    /** @brief v1固件用于存储整个配置BLOB的NVS键名，仅用于迁移。*/
+    static constexpr const char* NVS_KEY_LEGACY_BLOB = "settings_v1";
 };
@@ -0,0 +1,158 @@
+/**
+ * @file Sys_StateRegistry.h
+ * @brief 系统状态注册表的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 该模块取代了“每秒构建并推送一份完整`system.stateUpdate`快照”的做法。
+ * 各模块在启动时注册带类型的状态字段（如空闲堆、PSRAM、WiFi状态，将来的摄像头帧率），
+ * 之后只需调用`publish*()`更新字段值。
+ *
+ * - **变更检测**：只有值真正改变时，字段才会获得新的变更序号。
+ * - **按字段限速**：每个字段可声明最小推送间隔；间隔内的变更先被暂存，
+ *   间隔到期后由`tick()`统一生效，期间的多次变更自然合并为最后一个值。
+ * - **增量输出**：`writeDelta()`只写出变更序号大于给定序号、且在订阅位图中的字段。
+ *   新连接的客户端从序号0开始，因此第一次得到的就是完整快照。
+ *
+ * 推送侧（`Sys_WsBroadcaster`）为每个客户端记录已送达的序号和订阅位图，
+ * 序号和订阅相同的客户端共享同一份增量消息。
+ *
+ * @note 本模块的所有公共方法均为线程安全，但不可在ISR中调用。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "Sys_LockGuard.h" // 引入RAII锁
+#include "ArduinoJson.h"
+
+/**
+ * @enum StateFieldType
+ * @brief 状态字段的值类型。
+ */
+enum class StateFieldType : uint8_t {
+    INT,   // int32_t
+    UINT,  // uint32_t
+    FLOAT, // float
+    BOOL   // bool
+};
+
+/** @brief 状态字段的句柄（即注册表中的下标）。*/
+using StateFieldId = int8_t;
+/** @brief 无效的状态字段句柄。*/
+static constexpr StateFieldId INVALID_STATE_FIELD = -1;
+
+/**
+ * @class Sys_StateRegistry
+ * @brief 一个带变更序号和按字段限速的状态字段注册表。
+ */
+class Sys_StateRegistry {
+public:
+    /** @brief 注册表的最大字段数（subscription位图为32位）。*/
+    static constexpr size_t MAX_FIELDS = 32;
+    /** @brief 表示“订阅所有字段”的位图。*/
+    static constexpr uint32_t ALL_FIELDS = 0xFFFFFFFFu;
+
+    /**
+     * @brief 获取状态注册表的单例实例。
+     */
+    static Sys_StateRegistry* getInstance();
+
+    // 删除拷贝构造函数和赋值操作符，确保单例模式。
+    Sys_StateRegistry(const Sys_StateRegistry&) = delete;
+    Sys_StateRegistry& operator=(const Sys_StateRegistry&) = delete;
+
+    /**
+     * @brief 注册一个状态字段。
+     * @param name 字段名（即推送消息中的键名），必须是静态生命周期的字符串。
+     * @param type 字段的值类型。
+     * @param min_interval_ms 该字段两次推送之间的最小间隔（毫秒），0表示不限速。
+     * @return StateFieldId 字段句柄；表已满时返回`INVALID_STATE_FIELD`。重复注册同名字段返回已有句柄。
+     */
+    StateFieldId registerField(const char* name, StateFieldType type, uint32_t min_interval_ms = 0);
+
+    /**
+     * @brief 按名称查找字段。
+     * @return StateFieldId 字段句柄，未找到时返回`INVALID_STATE_FIELD`。
+     */
+    StateFieldId findField(const char* name);
+
+    /** @brief 更新一个`INT`字段。*/
+    void publishInt(StateFieldId id, int32_t value);
+    /** @brief 更新一个`UINT`字段。*/
+    void publishUInt(StateFieldId id, uint32_t value);
+    /** @brief 更新一个`FLOAT`字段。*/
+    void publishFloat(StateFieldId id, float value);
+    /** @brief 更新一个`BOOL`字段。*/
+    void publishBool(StateFieldId id, bool value);
+
+    /**
+     * @brief 让限速期已满的暂存变更生效。
+     * @details 由推送任务在每次生成增量前调用。
+     */
+    void tick();
+
+    /**
+     * @brief 获取当前的全局变更序号（0表示尚无任何字段发布过值）。
+     */
+    uint32_t getSequence();
+
+    /**
+     * @brief 将变更序号大于`since_seq`、且在`field_mask`中的字段写入JSON对象。
+     * @param params 目标JSON对象（通常是通知的`params`）。
+     * @param since_seq 客户端已收到的序号；传0得到完整快照。
+     * @param field_mask 订阅位图，第i位对应句柄为i的字段。
+     * @return size_t 写入的字段数。
+     */
+    size_t writeDelta(JsonObject params, uint32_t since_seq, uint32_t field_mask);
+
+private:
+    // 私有构造函数
+    Sys_StateRegistry();
+
+    /**
+     * @struct StateField
+     * @brief 单个状态字段的运行时数据。
+     */
+    struct StateField {
+        /** @brief 字段名。*/
+        const char* name = nullptr;
+        /** @brief 值类型。*/
+        StateFieldType type = StateFieldType::INT;
+        /** @brief 最小推送间隔（毫秒）。*/
+        uint32_t min_interval_ms = 0;
+        /** @brief 当前值的原始位模式（按`type`解释）。*/
+        uint32_t bits = 0;
+        /** @brief 最近一次生效变更的全局序号，0表示从未发布。*/
+        uint32_t changed_seq = 0;
+        /** @brief 最近一次生效变更的时间戳。*/
+        uint32_t last_change_ms = 0;
+        /** @brief 是否有因限速而暂存、尚未生效的变更。*/
+        bool deferred = false;
+    };
+
+    /**
+     * @brief 所有`publish*()`的公共实现：比较位模式，必要时生效或暂存变更。
+     */
+    void publishBits(StateFieldId id, uint32_t bits);
+
+    /**
+     * @brief 使一个字段的当前值生效（在锁的保护下调用）。
+     */
+    void commitChange(StateField& field, uint32_t now_ms);
+
+    /** @brief 单例实例指针。*/
+    static Sys_StateRegistry* _instance;
+
+    /** @brief 互斥锁，保护字段表和序号。*/
+    SemaphoreHandle_t _mutex = NULL;
+
+    /** @brief 字段表，下标即句柄。*/
+    StateField _fields[MAX_FIELDS];
+    /** @brief 已注册字段数。*/
+    size_t _field_count = 0;
+    /** @brief 全局变更序号。*/
+    uint32_t _sequence = 0;
+};
@@ -0,0 +1,84 @@
+/**
+ * @file Sys_TaskStats.h
+ * @brief 任务运行时统计模块的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 通过`uxTaskGetSystemState()`采集所有FreeRTOS任务的运行时计数器和栈高水位，
+ * 以相邻两次采样之间的差值计算每个任务的CPU占用率和每个核心的空闲率，并附带主要通信队列的深度。
+ * - RPC `system.taskStats`：立即返回一份统计；参数`interval_ms`可开启（>0）或关闭（0）周期推送。
+ * - 周期推送：[优化] 由`Sys_Scheduler`上的周期定时器驱动，到期时以同名通知`system.taskStats`广播；
+ *   关闭推送时定时器停止，不再唤醒Task_SystemMonitor。
+ * - 结果中的`scheduler`字段是调度器的唤醒次数、定时器执行次数和活动定时器。
+ *
+ * 运行时计数器依赖`CONFIG_FREERTOS_USE_TRACE_FACILITY`和`CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS`
+ * （见`platformio.ini`）；未启用时只返回队列深度，并在结果中注明。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "ArduinoJson.h"
+#include "Sys_Scheduler.h"
+
+struct JsonRpcRequest;
+
+/**
+ * @class Sys_TaskStats
+ * @brief 任务CPU占用、栈高水位和队列深度的采集器。
+ */
+class Sys_TaskStats {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_TaskStats() = delete;
+
+    /**
+     * @brief 分配采样缓冲区、创建推送定时器并注册`system.taskStats`方法。
+     * @note 必须在`Sys_Tasks::begin()`创建通信句柄之后、任务启动之前调用。
+     */
+    static void begin();
+
+    /**
+     * @brief 采集一份统计写入`out`。CPU占用率相对于上一次采集（首次采集相对于启动时刻）。
+     * @return bool 是否成功（采样缓冲区未分配时返回false）。
+     */
+    static bool collect(JsonObject out);
+
+    /** @brief 采样的最大任务数。*/
+    static constexpr size_t MAX_TASKS = 40;
+    /** @brief 周期推送的最小间隔（毫秒）。*/
+    static constexpr uint32_t MIN_STREAM_INTERVAL_MS = 1000;
+
+private:
+    /** @brief 上一次采样中一个任务的运行时计数器。*/
+    struct RunTimeSample {
+        TaskHandle_t handle;
+        uint32_t run_time;
+    };
+
+    /** @brief `system.taskStats`的RPC处理函数。*/
+    static void rpcTaskStats(const JsonRpcRequest& request);
+    /** @brief [新增] 推送定时器回调：广播一份统计。*/
+    static void onStreamTimer(void* arg);
+    /** @brief 查找任务在上一次采样中的运行时计数器，未找到时返回0（新任务）。*/
+    static uint32_t previousRunTime(TaskHandle_t handle);
+    /** @brief 写入主要通信队列的深度。*/
+    static void collectQueues(JsonObject out);
+
+    /** @brief 互斥锁，串行化RPC与周期推送的采集（两者共用上一次采样）。*/
+    static SemaphoreHandle_t _mutex;
+    /** @brief `uxTaskGetSystemState()`的输出缓冲区（位于PSRAM）。*/
+    static TaskStatus_t* _status;
+    /** @brief 上一次采样。*/
+    static RunTimeSample _previous[MAX_TASKS];
+    static size_t _previous_count;
+    static uint32_t _previous_total;
+    static uint32_t _previous_ms;
+    /** @brief 周期推送间隔，0表示关闭。*/
+    static uint32_t _stream_interval_ms;
+    /** @brief [新增] 周期推送定时器。*/
+    static TimerId _stream_timer;
+};
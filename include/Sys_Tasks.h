@@ -20,26 +20,36 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/event_groups.h"
+#include "freertos/ringbuf.h"  // [新增] 状态通知使用变长环形缓冲区
+#include "ArduinoJson.h"
 #include "ESPAsyncWebServer.h" // 需要 AsyncWebSocket 类型
 
 // --- 定义全局通信句柄 ---
 // 这些句柄在Sys_Tasks.cpp中被实际创建，在此处用`extern`声明以便其他模块可以引用。
 // 它们是任务间通信的桥梁，实现了模块间的解耦。
 
-/** @brief 命令队列：用于从前端接口（如WebServer）接收待处理的命令，由Task_Worker消费。*/
+/** @brief 命令队列（快速通道）：接收交互式的短命令，由Task_Worker消费。*/
 extern QueueHandle_t xCommandQueue;
-/** @brief 状态队列：用于从后台任务（如Task_SystemMonitor）收集需要推送到前端的状态信息。*/
-extern QueueHandle_t xStateQueue;
+/** @brief [新增] 慢速命令队列：接收声明了`RPC_FLAG_LONG_RUNNING`的耗时命令，由Task_SlowWorker消费。*/
+extern QueueHandle_t xSlowCommandQueue;
+/**
+ * @brief [优化] 状态通知环形缓冲区：收集需要推送到前端的一次性通知（如`wifi.scanResult`）。
+ * @details 变长条目(RINGBUF_TYPE_NOSPLIT)，存储区位于PSRAM。生产者通过`Sys_Tasks::postNotification()`
+ *          直接序列化进缓冲区，Task_WebSocketPusher就地读取后归还，全程没有定长槽位拷贝，也不会截断大消息。
+ */
+extern RingbufHandle_t xStateRingbuf;
 /** @brief 日志队列：用于从日志系统收集需要推送到前端的日志消息。*/
 extern QueueHandle_t xLogQueue;
 /** @brief 数据事件组：用于高效地通知Task_WebSocketPusher有新的数据需要推送，避免轮询队列。*/
 extern EventGroupHandle_t xDataEventGroup;
 
 // --- 事件组中的事件位定义 ---
-/** @brief 标记`xStateQueue`中有新数据的事件位。*/
+/** @brief 标记`xStateRingbuf`中有新数据的事件位。*/
 const EventBits_t BIT_STATE_QUEUE_READY = (1 << 0);
 /** @brief 标记日志队列（未来扩展）中有新数据的事件位。*/
 const EventBits_t BIT_LOG_QUEUE_READY   = (1 << 1);
+/** @brief [新增] 标记`Sys_StateRegistry`中有字段变更生效的事件位。*/
+const EventBits_t BIT_STATE_REGISTRY_DIRTY = (1 << 2);
 // ... 未来可在此添加其他事件位 ...
 
 
@@ -58,15 +68,45 @@ public:
      */
     static void begin(AsyncWebSocket* webSocket);
 
+    /**
+     * @brief [新增] 将一个已解析的RPC请求投递到其方法所声明的执行通道。
+     * @details 带`RPC_FLAG_LONG_RUNNING`标志的方法进入慢速通道，其余方法（包括未注册的方法，
+     *          它们只需回复一个错误）进入快速通道。耗时命令因此不会阻塞交互式命令。
+     * @param request 请求对象指针。投递成功后，所有权转移给工作任务。
+     * @return bool `true` 表示投递成功；`false` 表示对应队列已满，调用者仍持有请求对象。
+     */
+    static bool submitRpcRequest(struct JsonRpcRequest* request);
+
+    /**
+     * @brief [新增] 将一条通知文档序列化进状态通知环形缓冲区，并唤醒推送任务。
+     * @details 文档直接序列化到缓冲区中预留的空间（零拷贝），长度不受限于固定槽位。
+     * @param doc 完整的JSON RPC 2.0通知文档。
+     * @return bool `true` 表示成功；缓冲区空间不足或尚未初始化时返回 `false`。
+     */
+    static bool postNotification(JsonDocument& doc);
+
 private:
     // --- 任务参数定义 ---
     // 将所有任务的配置参数集中在此处，便于统一调整和管理。
 
-    /** @brief Task_Worker: 命令处理器任务 */
+    /** @brief Task_Worker: 快速通道命令处理器任务（交互式命令，优先级高于慢速通道） */
     static constexpr const char* TASK_WORKER_NAME = "Task_Worker";
     static constexpr uint32_t TASK_WORKER_STACK_SIZE = 4096;
-    static constexpr UBaseType_t TASK_WORKER_PRIORITY = 1;
+    static constexpr UBaseType_t TASK_WORKER_PRIORITY = 2;
     static constexpr BaseType_t TASK_WORKER_CORE = 1;
+    static constexpr UBaseType_t COMMAND_QUEUE_LENGTH = 10;
+
+    /** @brief [新增] Task_SlowWorker: 慢速通道命令处理器任务（耗时/阻塞型命令） */
+    static constexpr const char* TASK_SLOW_WORKER_NAME = "Task_SlowWorker";
+    static constexpr uint32_t TASK_SLOW_WORKER_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_SLOW_WORKER_PRIORITY = 1;
+    static constexpr BaseType_t TASK_SLOW_WORKER_CORE = 1;
+    static constexpr UBaseType_t SLOW_COMMAND_QUEUE_LENGTH = 4;
+
+    /** @brief [新增] 状态通知环形缓冲区的大小（字节，位于PSRAM）。单条通知最长约为其一半。*/
+    static constexpr size_t STATE_RINGBUF_SIZE = 16 * 1024;
+    /** @brief PSRAM不可用时，在内部SRAM中创建的回退缓冲区大小。*/
+    static constexpr size_t STATE_RINGBUF_FALLBACK_SIZE = 4 * 1024;
 
     /** @brief Task_SystemMonitor: 系统监视器任务 */
     static constexpr const char* TASK_MONITOR_NAME = "Task_SystemMonitor";
@@ -80,20 +120,31 @@ private:
     static constexpr UBaseType_t TASK_PUSHER_PRIORITY = 2; // 较高优先级，确保数据实时推送
     static constexpr BaseType_t TASK_PUSHER_CORE = 1;      // 在应用核心上运行
 
+    /** @brief [新增] Task_LogFormatter: 日志格式化任务（低优先级，在协议核心的空闲时间里运行） */
+    static constexpr const char* TASK_LOG_FORMATTER_NAME = "Task_LogFormatter";
+    static constexpr uint32_t TASK_LOG_FORMATTER_STACK_SIZE = 4096;
+    static constexpr UBaseType_t TASK_LOG_FORMATTER_PRIORITY = 1;
+    static constexpr BaseType_t TASK_LOG_FORMATTER_CORE = 0;
+
     // --- 任务的静态循环函数 ---
     // 声明为私有，防止外部直接调用，其地址被传递给`xTaskCreatePinnedToCore`。
     
-    /** @brief Task_Worker 的核心循环函数。*/
+    /**
+     * @brief Task_Worker / Task_SlowWorker 共用的核心循环函数。
+     * @param parameter 该工作任务所消费的命令队列(`QueueHandle_t`)。
+     */
     static void taskWorkerLoop(void* parameter);
     /** @brief Task_SystemMonitor 的核心循环函数。*/
     static void taskSystemMonitorLoop(void* parameter);
+    /** @brief [新增] Task_LogFormatter 的核心循环函数。*/
+    static void taskLogFormatterLoop(void* parameter);
     /** @brief Task_WebSocketPusher 的核心循环函数。*/
     static void taskWebSocketPusherLoop(void* parameter);
 
-    // --- [重构] JSON RPC 请求的统一处理入口 ---
+    // --- [重构] JSON RPC 方法注册 ---
     /**
-     * @brief 解析并分发JSON RPC请求到具体的处理逻辑。
-     * @param request 包含RPC方法和参数的请求对象。
+     * @brief 将系统、设置、WiFi和调试类RPC方法注册到`Sys_RpcRouter`。
+     * @details 分发由`Sys_RpcRouter::dispatch()`完成，不再使用strcmp链。
      */
-    static void processJsonRpcRequest(const struct JsonRpcRequest& request);
+    static void registerRpcMethods();
 };
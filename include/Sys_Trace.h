@@ -0,0 +1,174 @@
+/**
+ * @file Sys_Trace.h
+ * @brief 热路径延迟追踪模块的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 以CPU周期计数器为时间源，在少数几个固定的追踪点上统计延迟分布，通过RPC `system.traceStats`
+ * 导出每个追踪点的p50/p90/p99和最大值。
+ * - 直方图：每个追踪点一个固定桶数的对数直方图，每个2的幂区间再细分为4个子桶（相对误差约±12%），
+ *   记录只需一次`fetch_add`，不加锁、不分配内存。
+ * - 按核心分离：每个核心写入自己的一组直方图，两个核心之间没有写竞争；导出时再合并。
+ * - 周期计数器只在本核心内有意义：`Sys_TraceScope`跨越了核心迁移的样本会被丢弃并计数；
+ *   跨任务的区间（如RPC从WebSocket接收到响应发出）改用`esp_timer`的微秒时间戳。
+ *
+ * 编译开关：`SYS_TRACE_ENABLED`默认跟随`CORE_DEBUG_MODE`。为0时所有`SYS_TRACE_*`宏展开为空，
+ * 追踪点不产生任何代码，`system.traceStats`也不会被注册。
+ */
+#pragma once
+
+#ifndef CORE_DEBUG_MODE
+#define CORE_DEBUG_MODE 0 // 默认关闭
+#endif
+
+#ifndef SYS_TRACE_ENABLED
+#define SYS_TRACE_ENABLED CORE_DEBUG_MODE
+#endif
+
+#if SYS_TRACE_ENABLED
+
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "esp_cpu.h"
+#define SYS_TRACE_CYCLE_COUNT() esp_cpu_get_cycle_count()
+#else
+#include "hal/cpu_hal.h"
+#define SYS_TRACE_CYCLE_COUNT() cpu_hal_get_cycle_count()
+#endif
+#include "ArduinoJson.h"
+
+struct JsonRpcRequest;
+
+/**
+ * @enum TracePoint
+ * @brief 追踪点。新增追踪点时同时在`Sys_Trace.cpp`的名称表中添加名称。
+ */
+enum class TracePoint : uint8_t {
+    RPC_END_TO_END = 0, // 快速通道RPC：WebSocket帧接收 -> 处理函数返回（响应已经由response_cb发出）
+    RPC_SLOW_END_TO_END,// 慢速通道RPC：同上
+    RPC_DISPATCH,       // RPC处理函数本身的执行时间（不含排队）
+    PUSHER_BATCH,       // Task_WsPusher一次唤醒的处理时间（状态通知、状态增量、日志批次）
+    FLASHLOG_FLUSH,     // FlashLogger一次批量落盘（打包、写扇区、提交FAT）
+    NVS_COMMIT,         // 一次`nvs_commit()`
+    COUNT
+};
+
+/**
+ * @class Sys_Trace
+ * @brief 对数直方图的记录与导出。
+ */
+class Sys_Trace {
+public:
+    // 删除默认构造函数，明确表示这是一个纯静态工具类，禁止实例化。
+    Sys_Trace() = delete;
+
+    /** @brief 每个2的幂区间的子桶数（以位数表示）。*/
+    static constexpr uint8_t SUB_BUCKET_BITS = 2;
+    /** @brief 最小的2的幂区间：小于`2^MIN_OCTAVE`个周期的样本全部计入第一个桶。*/
+    static constexpr uint8_t MIN_OCTAVE = 6;
+    /** @brief 每个直方图的桶数，覆盖完整的32位周期范围。*/
+    static constexpr size_t BUCKET_COUNT = (32 - MIN_OCTAVE) << SUB_BUCKET_BITS;
+    /** @brief 核心数。*/
+    static constexpr size_t CORE_COUNT = portNUM_PROCESSORS;
+
+    /**
+     * @brief 注册`system.traceStats`方法。
+     */
+    static void begin();
+
+    /**
+     * @brief 在当前核心的直方图中记录一个以周期为单位的样本。
+     * @note 可在任意任务中调用，不可在ISR中调用。
+     */
+    static void recordCycles(TracePoint point, uint32_t cycles);
+
+    /**
+     * @brief 记录一个以微秒为单位的样本（跨任务/跨核心的区间）。
+     */
+    static void recordMicros(TracePoint point, int64_t micros);
+
+    /**
+     * @brief 记录一个因核心迁移而被丢弃的样本。
+     */
+    static void recordMigrated(TracePoint point);
+
+    /** @brief 跨任务区间的起点时间戳（微秒）。*/
+    static inline int64_t nowMicros() { return esp_timer_get_time(); }
+
+    /**
+     * @brief 合并所有核心的直方图，把每个追踪点的统计写入`out`。
+     * @param reset 导出后是否清零。
+     */
+    static void collect(JsonObject out, bool reset);
+
+private:
+    /** @brief 单个核心上单个追踪点的直方图。*/
+    struct Histogram {
+        std::atomic<uint32_t> buckets[BUCKET_COUNT];
+        std::atomic<uint32_t> max_cycles;
+        std::atomic<uint32_t> migrated;
+    };
+
+    /** @brief `system.traceStats`的RPC处理函数。*/
+    static void rpcTraceStats(const JsonRpcRequest& request);
+    /** @brief 样本所在的桶。*/
+    static size_t bucketIndex(uint32_t cycles);
+    /** @brief 桶的下界（周期）。*/
+    static uint64_t bucketLowerBound(size_t index);
+    /** @brief 在合并后的桶中按线性插值估算分位数（周期）。*/
+    static uint32_t percentile(const uint32_t* buckets, uint32_t count, uint32_t max_cycles, uint32_t permille);
+
+    static Histogram _histograms[CORE_COUNT][(size_t)TracePoint::COUNT];
+    /** @brief 每微秒的周期数（CPU主频，`begin()`时读取）。*/
+    static uint32_t _cycles_per_us;
+};
+
+/**
+ * @class Sys_TraceScope
+ * @brief RAII区间：构造时读取周期计数器，析构时把差值记入追踪点。
+ */
+class Sys_TraceScope {
+public:
+    explicit Sys_TraceScope(TracePoint point)
+        : _point(point), _core((uint8_t)xPortGetCoreID()), _start(SYS_TRACE_CYCLE_COUNT()) {}
+
+    ~Sys_TraceScope() {
+        const uint32_t elapsed = SYS_TRACE_CYCLE_COUNT() - _start;
+        if ((uint8_t)xPortGetCoreID() == _core) {
+            Sys_Trace::recordCycles(_point, elapsed);
+        } else {
+            Sys_Trace::recordMigrated(_point); // 两个核心的周期计数器互不同步，差值没有意义
+        }
+    }
+
+    Sys_TraceScope(const Sys_TraceScope&) = delete;
+    Sys_TraceScope& operator=(const Sys_TraceScope&) = delete;
+
+private:
+    const TracePoint _point;
+    const uint8_t _core;
+    const uint32_t _start;
+};
+
+#define SYS_TRACE_CONCAT_INNER(a, b) a##b
+#define SYS_TRACE_CONCAT(a, b) SYS_TRACE_CONCAT_INNER(a, b)
+
+/** @brief 追踪当前作用域的执行时间（周期计数器）。*/
+#define SYS_TRACE_SCOPE(point) Sys_TraceScope SYS_TRACE_CONCAT(_sys_trace_scope_, __LINE__)(point)
+/** @brief 把跨任务区间的起点时间戳写入`var`。*/
+#define SYS_TRACE_STAMP(var) ((var) = Sys_Trace::nowMicros())
+/** @brief 记录从`SYS_TRACE_STAMP(var)`到现在的时间。*/
+#define SYS_TRACE_SINCE(point, var) Sys_Trace::recordMicros((point), Sys_Trace::nowMicros() - (var))
+
+#else // SYS_TRACE_ENABLED
+
+#define SYS_TRACE_SCOPE(point) do {} while (0)
+#define SYS_TRACE_STAMP(var) ((void)0)
+#define SYS_TRACE_SINCE(point, var) ((void)0)
+
+#endif // SYS_TRACE_ENABLED
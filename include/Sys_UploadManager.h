@@ -0,0 +1,178 @@
+/**
+ * @file Sys_UploadManager.h
+ * @brief 流式文件上传管线的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 取代`handleFileUpload`中单个`static File`的实现：
+ * - 每个上传请求拥有独立的上传上下文，多个上传可以同时进行而互不干扰。
+ * - AsyncTCP每次交付的小数据块（约1.4KB）先汇集到PSRAM中的大缓冲区（`UPLOAD_BUFFER_SIZE`），
+ *   缓冲区写满后交给写入任务`Task_UploadWriter`写入FFat。async_tcp任务只做内存拷贝，
+ *   不再因闪存写入延迟而阻塞网络协议栈；只有当闪存持续跟不上网络时才会短暂等待（背压）。
+ * - 文件先写入`<目标路径>.part`，结束时回读整个文件计算CRC32，与写入时的CRC32以及客户端
+ *   提供的校验值（可选的`X-Upload-CRC32`请求头，十六进制）比对，全部一致后才重命名为目标文件。
+ * - 进度与结果通过WebSocket通知(`file.uploadProgress` / `file.uploadResult`)推送。
+ *
+ * 线程模型：上传回调、请求完成回调和断开回调都运行在async_tcp任务中；文件I/O只在写入任务中进行。
+ * 两者通过写入任务的作业队列和每个上下文的缓冲区信号量交接数据。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "FS.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "ESPAsyncWebServer.h"
+
+/**
+ * @class Sys_UploadManager
+ * @brief 管理上传上下文、PSRAM汇集缓冲区和后台写入任务。
+ */
+class Sys_UploadManager {
+public:
+    /**
+     * @brief 获取上传管理器的单例实例。
+     * @return Sys_UploadManager* 指向唯一实例的指针。
+     */
+    static Sys_UploadManager* getInstance();
+    // 删除拷贝构造函数和赋值操作符，确保单例模式。
+    Sys_UploadManager(const Sys_UploadManager&) = delete;
+    Sys_UploadManager& operator=(const Sys_UploadManager&) = delete;
+
+    /**
+     * @brief 分配PSRAM缓冲区并启动写入任务。
+     * @note 必须在Web服务器启动之前调用。
+     * @return bool 是否初始化成功；失败时所有上传请求都会被拒绝。
+     */
+    bool begin();
+
+    /**
+     * @brief 上传数据块回调（由Web服务器的上传处理器转发，运行在async_tcp任务中）。
+     * @details 参数含义与`ArUploadHandlerFunction`相同。
+     */
+    void handleChunk(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final);
+
+    /**
+     * @brief 上传请求的数据全部接收后的响应回调（运行在async_tcp任务中）。
+     * @details 返回`202 Accepted`和上传ID；文件此时可能仍在写入，最终结果通过`file.uploadResult`通知。
+     */
+    void handleRequestComplete(AsyncWebServerRequest* request);
+
+    // --- 配置常量 ---
+    /** @brief 最多同时进行的上传数。*/
+    static constexpr size_t MAX_CONCURRENT_UPLOADS = 2;
+    /** @brief 每个上传的汇集缓冲区数量（一个接收、其余等待写入）。*/
+    static constexpr size_t BUFFERS_PER_UPLOAD = 2;
+    /** @brief 汇集缓冲区大小（字节，位于PSRAM）。*/
+    static constexpr size_t UPLOAD_BUFFER_SIZE = 32 * 1024;
+    /** @brief 所有缓冲区都在等待写入时，async_tcp任务最多等待的时间（毫秒），超时则上传失败。*/
+    static constexpr uint32_t BUFFER_WAIT_MS = 2000;
+    /** @brief 两次进度通知之间至少写入的字节数。*/
+    static constexpr size_t PROGRESS_INTERVAL_BYTES = 128 * 1024;
+    /** @brief 上传文件的存放目录（FFat）。*/
+    static constexpr const char* UPLOAD_DIR = "/media/";
+
+private:
+    // 私有构造函数，由`getInstance()`调用。
+    Sys_UploadManager() = default;
+
+    /** @brief 写入任务的作业类型。*/
+    enum class JobType : uint8_t { OPEN, WRITE, FINISH, ABORT };
+
+    /**
+     * @struct UploadContext
+     * @brief 一个进行中的上传。
+     * @details 由请求一侧（async_tcp任务）和写入任务共同持有，`refs`归零时槽位才可复用。
+     */
+    struct UploadContext {
+        /** @brief 引用计数：请求一侧和写入任务各持有一个，0表示槽位空闲。*/
+        std::atomic<uint8_t> refs{0};
+        /** @brief 所属的请求；请求完成或断开后置为`nullptr`（只在async_tcp任务中访问）。*/
+        AsyncWebServerRequest* request = nullptr;
+        /** @brief 上传ID，用于关联进度通知。*/
+        uint32_t id = 0;
+        /** @brief 目标路径。*/
+        char path[64] = "";
+        /** @brief 临时文件路径（`<path>.part`）。*/
+        char temp_path[70] = "";
+        /** @brief 正在写入的临时文件（只在写入任务中访问）。*/
+        File file;
+        /** @brief 已接收的字节数（async_tcp任务）。*/
+        size_t received = 0;
+        /** @brief 已写入FFat的字节数（写入任务）。*/
+        size_t written = 0;
+        /** @brief 上一次进度通知时已写入的字节数（写入任务）。*/
+        size_t last_progress = 0;
+        /** @brief 请求体的总长度（含multipart边界），用于估算进度。*/
+        size_t request_length = 0;
+        /** @brief 写入数据的CRC32（写入任务）。*/
+        uint32_t crc = 0;
+        /** @brief 客户端提供的CRC32。*/
+        uint32_t expected_crc = 0;
+        bool has_expected_crc = false;
+        /** @brief 汇集缓冲区（位于PSRAM）。*/
+        uint8_t* buffers[BUFFERS_PER_UPLOAD] = {};
+        /** @brief 当前正在接收数据的缓冲区，以及其中已有的字节数。*/
+        uint8_t fill_buffer = 0;
+        size_t fill_len = 0;
+        /** @brief 空闲缓冲区计数信号量，写入任务写完一个缓冲区后归还。*/
+        SemaphoreHandle_t free_buffers = NULL;
+        /** @brief 请求一侧出错（已通知写入任务放弃）。*/
+        bool failed = false;
+        /** @brief 写入任务出错，之后的数据块直接丢弃。*/
+        std::atomic<bool> write_failed{false};
+        /** @brief 数据已全部交给写入任务。*/
+        bool finished = false;
+        /** @brief 请求一侧的错误信息，用于HTTP响应。*/
+        const char* error = nullptr;
+        /** @brief 写入任务一侧的错误信息，用于结果通知。*/
+        const char* write_error = nullptr;
+    };
+
+    /** @brief 写入任务的一个作业。*/
+    struct UploadJob {
+        UploadContext* context;
+        JobType type;
+        uint8_t buffer;
+        uint32_t len;
+    };
+
+    // --- async_tcp任务一侧 ---
+    UploadContext* acquireContext(AsyncWebServerRequest* request);
+    UploadContext* findContext(AsyncWebServerRequest* request);
+    bool startUpload(UploadContext* context, AsyncWebServerRequest* request, const String& filename);
+    bool submitFillBuffer(UploadContext* context, JobType type);
+    void failUpload(UploadContext* context, const char* error);
+    void onRequestDisconnected(AsyncWebServerRequest* request);
+    void releaseContext(UploadContext* context);
+
+    // --- 写入任务一侧 ---
+    static void writerTask(void* parameter);
+    void processJob(const UploadJob& job);
+    void finishUpload(UploadContext* context);
+    void discardUpload(UploadContext* context);
+    void postProgress(UploadContext* context);
+    void postResult(UploadContext* context, bool ok, const char* error);
+
+    /** @brief Task_UploadWriter 的任务参数。*/
+    static constexpr const char* WRITER_TASK_NAME = "Task_UploadWriter";
+    static constexpr uint32_t WRITER_TASK_STACK_SIZE = 4096;
+    static constexpr UBaseType_t WRITER_TASK_PRIORITY = 1;
+    static constexpr BaseType_t WRITER_TASK_CORE = 1;
+    /** @brief 作业队列长度：每个上下文最多同时有`BUFFERS_PER_UPLOAD`个写作业，另加打开/结束作业。*/
+    static constexpr UBaseType_t JOB_QUEUE_LENGTH = MAX_CONCURRENT_UPLOADS * (BUFFERS_PER_UPLOAD + 2);
+
+    /** @brief 单例实例指针。*/
+    static Sys_UploadManager* _instance;
+    /** @brief 上传上下文槽位。*/
+    UploadContext _contexts[MAX_CONCURRENT_UPLOADS];
+    /** @brief 写入任务的作业队列。*/
+    QueueHandle_t _jobs = NULL;
+    /** @brief 下一个上传ID。*/
+    uint32_t _next_id = 1;
+    /** @brief 是否已初始化。*/
+    bool _ready = false;
+};
@@ -19,6 +19,8 @@
 #include "ESPAsyncWebServer.h"
 #include "ArduinoJson.h" // 需要JsonVariant
 
+struct CachedAsset;
+
 class Sys_WebServer {
 public:
     /**
@@ -70,11 +72,48 @@ private:
     static void handleSaveSettings(AsyncWebServerRequest *request, JsonVariant &json);
     /** @brief 处理WiFi扫描的GET请求。*/
     static void handleScanWiFi(AsyncWebServerRequest *request);
-    /** @brief 处理文件上传。*/
+    /** @brief [新增] 处理日志查询的GET请求（`log.query`的HTTP版本）。*/
+    static void handleLogQuery(AsyncWebServerRequest *request);
+    /** @brief 处理文件上传（转发给`Sys_UploadManager`）。*/
     static void handleFileUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final);
+    /**
+     * @brief [新增] 响应静态资源请求（处理`If-None-Match`）。
+     * @param versioned 是否通过内容哈希路径请求，决定`Cache-Control`。
+     */
+    static void serveAsset(AsyncWebServerRequest *request, const CachedAsset* asset, bool versioned);
     /** @brief 处理所有未找到的路由 (404)。*/
     static void handleNotFound(AsyncWebServerRequest *request);
 
+    // --- [新增] MJPEG 实时流 ---
+    /** @brief 一个`/stream`观看者的推流状态（定义见实现文件）。*/
+    struct MjpegStreamState;
+    /**
+     * @brief 处理`/stream`请求：以`multipart/x-mixed-replace`分块响应推送摄像头管线的最新帧。
+     * @details 可选查询参数`fps`设置帧率上限（1～`STREAM_MAX_FPS`）。
+     */
+    static void handleStream(AsyncWebServerRequest *request);
+    /**
+     * @brief 分块响应回调：直接从帧缓冲向TCP发送缓冲区写入下一段数据。
+     * @return size_t 写入的字节数；没有可发送的新帧时返回`RESPONSE_TRY_AGAIN`。
+     */
+    static size_t fillStreamChunk(MjpegStreamState& state, uint8_t* buffer, size_t max_len);
+
+    /** @brief 同时观看的最大客户端数。*/
+    static constexpr uint8_t STREAM_MAX_CLIENTS = 3;
+    /** @brief 未指定`fps`参数时的帧率上限。*/
+    static constexpr uint32_t STREAM_DEFAULT_FPS = 10;
+    /** @brief 允许的最高帧率。*/
+    static constexpr uint32_t STREAM_MAX_FPS = 25;
+    /**
+     * @brief 每次回调最多写入的字节数。
+     * @details 推流与WebSocket共享async_tcp任务；限制单次写入量，使控制通道的消息不必排在整帧图像之后。
+     */
+    static constexpr size_t STREAM_CHUNK_LIMIT = 8 * 1024;
+    /** @brief multipart分隔符。*/
+    static constexpr const char* STREAM_BOUNDARY = "frame";
+    /** @brief 当前的观看者数量（只在async_tcp任务中访问）。*/
+    static uint8_t _stream_clients;
+
     // --- WebSocket 事件处理 ---
     /**
      * @brief WebSocket的核心事件回调函数。
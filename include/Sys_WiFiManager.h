@@ -11,6 +11,14 @@
  * 1. 引入互斥锁，确保所有WiFi操作的原子性，防止竞态条件。
  * 2. 引入智能重连机制，对永久性失败（如密码错误）进行有限次重试，避免无效功耗。
  * 3. 状态转换逻辑全部集中在事件回调中，使状态机模型更纯粹。
+ * 4. [优化] 断开后的超时重连由`Sys_Scheduler`的单次定时器驱动，不再需要周期性轮询。
+ * 5. [优化] 快速连接：每次获取IP后，把AP的BSSID、信道（以及DHCP分配的地址）缓存到NVS。
+ *    启动和重连时，若缓存对应当前SSID，则直接连接该BSSID/信道，跳过全信道扫描；
+ *    快速连接失败时立即回退到一次常规的扫描连接。
+ * 6. [优化] 重连间隔按指数退避（带随机抖动）增长，连接成功或配置变化后复位。
+ *
+ * 定义`SYS_WIFI_REUSE_IP=1`时，快速连接还会直接使用缓存的IP地址（静态配置），跳过DHCP；
+ * 仅适用于DHCP服务器为设备保留固定地址的网络，默认关闭。
  */
 #pragma once
 
@@ -19,6 +27,11 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "Sys_LockGuard.h" // 引入RAII锁
+#include "Sys_Scheduler.h" // [新增] 重连定时器
+
+#ifndef SYS_WIFI_REUSE_IP
+#define SYS_WIFI_REUSE_IP 0
+#endif
 
 // 定义清晰的WiFi状态，供外部模块查询
 enum class WiFiState {
@@ -40,20 +53,19 @@ public:
     Sys_WiFiManager& operator=(const Sys_WiFiManager&) = delete;
 
     /**
-     * @brief 在系统启动时调用，注册WiFi事件回调并创建同步机制。
+     * @brief 在系统启动时调用，注册WiFi事件回调并创建重连定时器。
+     * @note 必须在`Sys_Scheduler::begin()`之后调用。
      */
     void begin();
-
-    /**
-     * @brief 由 Task_SystemMonitor 周期性调用，用于处理非事件驱动的逻辑（如超时重连）。
-     */
-    void update();
     
     /**
      * @brief 应用最新的系统设置。这是控制WiFi行为的核心入口。
      * @details 这是一个线程安全的操作，它会根据新设置触发相应的WiFi动作。
+     *          [优化] 只处理`changed_fields`涉及的部分：仅STA参数变化时只重连STA，不会重启AP；
+     *          WiFi模式变化时才重新设置模式并启停STA/AP。
+     * @param changed_fields 发生变化的配置字段位图（`Sys_SettingsManager::Field`），默认全部重新应用。
      */
-    void applySettings();
+    void applySettings(uint32_t changed_fields = Sys_SettingsManager::WIFI_FIELDS);
 
     /**
      * @brief 获取当前WiFi模块的聚合状态。
@@ -67,19 +79,60 @@ public:
      */
     String getIPAddress();
 
+    /**
+     * @brief [新增] 启动一次异步WiFi扫描。
+     * @details 立即返回，不阻塞调用者。扫描完成后，结果在WiFi事件回调中被打包为
+     *          `wifi.scanResult`通知推送到通知环形缓冲区。若已有扫描在进行中，则直接复用该次扫描。
+     * @return bool `true` 表示扫描已启动或正在进行；`false` 表示启动失败。
+     */
+    bool startScan();
+
 private:
     // 私有构造函数
     Sys_WiFiManager();
     
     // WiFi事件的静态回调函数
     static void WiFiEvent(WiFiEvent_t event, arduino_event_info_t info);
+    // [新增] 配置变更回调（在修改配置的任务中调用）
+    static void onSettingsChanged(uint32_t changed_fields);
+    // [新增] 重连定时器回调（在Task_SystemMonitor中调用）
+    static void onReconnectTimer(void* arg);
+    // [新增] 连接缓存保存定时器回调（在Task_SystemMonitor中调用，NVS写入不占用WiFi事件任务）
+    static void onCacheSaveTimer(void* arg);
+
+    /**
+     * @brief [新增] 快速连接所需的AP信息，以BLOB形式保存在NVS中。
+     */
+    struct ConnectionCache {
+        /** @brief DHCP分配的地址（网络字节序），仅在`SYS_WIFI_REUSE_IP`时使用。*/
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint8_t version;
+        uint8_t channel;
+        uint8_t bssid[6];
+        char ssid[36]; // 最长32个字符，补齐到4字节使结构体没有填充字节（按memcmp比较）
+    };
+    static constexpr uint8_t CONNECTION_CACHE_VERSION = 1;
+    static constexpr const char* NVS_NAMESPACE = "wifi_cache";
+    static constexpr const char* NVS_KEY_CONNECTION = "sta";
 
     // 内部启动STA和AP的辅助函数
     void startSTA(const SystemSettings& settings);
+    // [新增] 发起一次STA连接：缓存可用时走快速路径，否则全信道扫描
+    void connectSTA(const SystemSettings& settings);
+    // [新增] 按当前退避次数计算下一次重连的等待时间（带随机抖动）
+    uint32_t reconnectDelay() const;
     void startAP(const SystemSettings& settings);
     void stopSTA();
     void stopAP();
 
+    // [新增] 将扫描结果打包为通知并推送（在事件回调中、锁的保护下调用）
+    void publishScanResults();
+    // [新增] 获取IP后记录当前AP的BSSID、信道和地址，并安排写入NVS（在事件回调中、锁的保护下调用）
+    void updateConnectionCache(const arduino_event_info_t& info);
+
     // 单例实例指针
     static Sys_WiFiManager* _instance;
     
@@ -89,7 +142,19 @@ private:
     // [优化] 引入互斥锁，保护所有临界区
     SemaphoreHandle_t _mutex = NULL;
     
-    // 非阻塞重连逻辑所需的计时器和计数器
-    unsigned long _last_reconnect_attempt_ms = 0;
+    // [优化] 非阻塞重连逻辑所需的定时器和计数器
+    TimerId _reconnect_timer = INVALID_TIMER;
     uint8_t _sta_retry_count = 0; // [优化] STA重试计数器
+    uint8_t _backoff_count = 0;   // [新增] 连续重连次数，决定下一次的退避间隔
+
+    // [新增] 快速连接缓存
+    ConnectionCache _cache = {};     // 当前使用的缓存
+    ConnectionCache _saved = {};     // NVS中的内容，用于避免重复写入
+    bool _cache_valid = false;       // `_cache`是否可用于快速连接
+    bool _fast_connect_pending = false; // 当前这次连接是否走了快速路径（尚未获取IP）
+    bool _static_ip_from_cache = false; // 当前是否使用了缓存的IP（回退时需恢复DHCP）
+    TimerId _cache_save_timer = INVALID_TIMER;
+
+    // [新增] 是否有异步扫描正在进行
+    bool _scan_in_progress = false;
 };
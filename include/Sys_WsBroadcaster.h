@@ -0,0 +1,214 @@
+/**
+ * @file Sys_WsBroadcaster.h
+ * @brief 感知客户端背压的WebSocket广播器的接口定义
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 该模块取代了`Task_WebSocketPusher`中对`textAll()`的直接调用。
+ * `textAll()`会无差别地向每个客户端的发送队列追加消息，一个处于弱信号下的
+ * 慢速浏览器会让AsyncTCP队列持续堆积，占用堆内存并拖慢所有客户端。
+ *
+ * 本模块为每个客户端维护一个会话槽位，并按消息类型采取不同的投递策略：
+ * - **状态更新(`flushStateDeltas`)**：[优化] 状态来自`Sys_StateRegistry`，每个客户端记录已送达的
+ *   变更序号，只接收之后变化、且在其订阅范围内的字段；新客户端首次得到完整快照。
+ *   客户端不可写或投递失败（如暂存缓冲区分配失败）时不推进其序号，期间的多次变更自然合并为下一次的单条增量。
+ * - **通知/日志批次(`broadcast`)**：每个客户端的积压上限为`MAX_CLIENT_BACKLOG`条，
+ *   超过上限的消息对该客户端直接丢弃，并累加丢弃计数。
+ *
+ * 慢速客户端只会丢失它自己的消息，不会影响其他客户端的延迟和堆占用。
+ *
+ * [优化] 一次序列化，多次发送：
+ * 当本次投递的目标覆盖了所有已连接客户端时，消息被直接序列化（或拷贝一次）进
+ * 一个由库引用计数的`AsyncWebSocketMessageBuffer`，再通过`textAll(buffer)`共享给所有客户端，
+ * 不再为每个客户端各拷贝一份负载。只有部分客户端拥塞时，才退回到逐个客户端发送，
+ * 此时的序列化暂存区从`Sys_MemoryManager`的PSRAM内存池中分配。
+ *
+ * [新增] 双编码：每个客户端可通过`server.setEncoding`选择JSON文本帧或MessagePack二进制帧。
+ * 广播时按编码分组，每组只编码一次；仅当全部已连接客户端属于同一编码且均可写时才使用共享缓冲区。
+ *
+ * @note 线程模型：
+ *  - `onClientConnected`/`onClientDisconnected`由AsyncTCP任务调用，只通过原子操作修改会话槽位的归属。
+ *  - 其余方法只允许由`Task_WebSocketPusher`单一任务调用，因此无需加锁。
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "ESPAsyncWebServer.h"
+#include "ArduinoJson.h"
+#include "types.h" // WsEncoding
+
+/**
+ * @class Sys_WsBroadcaster
+ * @brief 一个按客户端控制背压、对状态更新进行合并的WebSocket广播器。
+ */
+class Sys_WsBroadcaster {
+public:
+    /**
+     * @brief 获取广播器的单例实例。
+     */
+    static Sys_WsBroadcaster* getInstance();
+
+    // 删除拷贝构造函数和赋值操作符，确保单例模式。
+    Sys_WsBroadcaster(const Sys_WsBroadcaster&) = delete;
+    Sys_WsBroadcaster& operator=(const Sys_WsBroadcaster&) = delete;
+
+    /**
+     * @brief 绑定要广播的WebSocket服务器。
+     * @param webSocket WebSocket服务器实例指针。
+     */
+    void begin(AsyncWebSocket* webSocket);
+
+    /**
+     * @brief 登记一个新连接的客户端（由WebSocket事件回调调用）。
+     * @param client_id 客户端ID。
+     */
+    void onClientConnected(uint32_t client_id);
+
+    /**
+     * @brief 注销一个已断开的客户端（由WebSocket事件回调调用）。
+     * @param client_id 客户端ID。
+     */
+    void onClientDisconnected(uint32_t client_id);
+
+    /**
+     * @brief 当前是否至少有一个已登记的客户端。
+     */
+    bool hasClients() const;
+
+    /**
+     * @brief 将状态注册表中的增量推送给所有可写的客户端。
+     * @details 由Task_WebSocketPusher在每次唤醒（包括超时唤醒）时调用。已送达序号、订阅位图和编码
+     *          都相同的客户端被归为一组，每组只生成并序列化一次增量消息。
+     */
+    void flushStateDeltas();
+    /**
+     * @brief 向所有客户端广播一条不可合并的消息（如日志批次、扫描结果）。
+     * @details 积压已达上限的客户端会丢弃本条消息，并累加其丢弃计数。
+     * @param message 以null结尾的JSON消息。
+     * @param len 消息长度。
+     */
+    void broadcast(const char* message, size_t len);
+
+    /**
+     * @brief 将一个JSON文档序列化一次，并广播给所有客户端。
+     * @details 积压策略与`broadcast(const char*, size_t)`相同。所有客户端均可写时，
+     *          文档被直接序列化进共享的消息缓冲区，没有中间字符串。
+     * @param doc 要广播的JSON文档。
+     */
+    void broadcast(JsonDocument& doc);
+
+    /**
+     * @brief [新增] 设置一个客户端接收推送和响应时使用的编码。
+     * @param client_id 客户端ID。
+     * @param encoding 新的编码格式。
+     * @return bool `true` 表示成功；客户端未登记时返回 `false`。
+     */
+    bool setClientEncoding(uint32_t client_id, WsEncoding encoding);
+
+    /**
+     * @brief [新增] 获取一个客户端当前使用的编码（未登记的客户端视为JSON）。
+     */
+    WsEncoding getClientEncoding(uint32_t client_id) const;
+
+    /**
+     * @brief [新增] 设置一个客户端订阅的状态字段。
+     * @details 设置后，该客户端会在下一次推送时收到所订阅字段的完整快照。
+     * @param client_id 客户端ID。
+     * @param field_mask 订阅位图（第i位对应句柄为i的状态字段），`Sys_StateRegistry::ALL_FIELDS`表示全部。
+     * @return bool `true` 表示成功；客户端未登记时返回 `false`。
+     */
+    bool setClientSubscription(uint32_t client_id, uint32_t field_mask);
+
+private:
+    // 私有构造函数
+    Sys_WsBroadcaster() = default;
+
+    /** @brief 会话表容量，与AsyncWebSocket的默认最大客户端数一致。*/
+    static constexpr size_t MAX_CLIENTS = 8;
+    /** @brief 每个客户端允许在AsyncTCP发送队列中积压的最大消息数。*/
+    static constexpr size_t MAX_CLIENT_BACKLOG = 4;
+    /** @brief 会话槽位空闲的标记值（AsyncWebSocket的客户端ID从1开始）。*/
+    static constexpr uint32_t FREE_SLOT = 0;
+    /** @brief 编码格式的数量。*/
+    static constexpr size_t ENCODING_COUNT = 2;
+
+    /**
+     * @struct ClientSession
+     * @brief 单个客户端的投递状态。
+     * @details `client_id`由AsyncTCP任务原子地认领/释放；其余字段仅由推送任务读写。
+     */
+    struct ClientSession {
+        /** @brief 占用该槽位的客户端ID，`FREE_SLOT`表示空闲。*/
+        std::atomic<uint32_t> client_id{FREE_SLOT};
+        /** @brief 该客户端选择的`WsEncoding`，由RPC工作任务写入、推送任务读取。*/
+        std::atomic<uint8_t> encoding{static_cast<uint8_t>(WsEncoding::JSON)};
+        /** @brief 订阅的状态字段位图，由RPC工作任务写入、推送任务读取。*/
+        std::atomic<uint32_t> subscription_mask{0xFFFFFFFFu};
+        /** @brief 订阅变更后请求补发快照的标记，由推送任务消费。*/
+        std::atomic<bool> snapshot_requested{false};
+        /** @brief 推送任务上次观察到的归属者，用于发现槽位易主并重置计数。*/
+        uint32_t owner_id = FREE_SLOT;
+        /** @brief 已投递给该客户端的状态注册表序号。*/
+        uint32_t delivered_state_seq = 0;
+        /** @brief 上次因不可写而推迟投递时的注册表序号，用于统计合并次数。*/
+        uint32_t deferred_state_seq = 0;
+        /** @brief 因客户端不可写而被合并进后续增量的状态变更批次数。*/
+        uint32_t states_coalesced = 0;
+        /** @brief 因积压超限而丢弃的消息数。*/
+        uint32_t messages_dropped = 0;
+    };
+
+    /**
+     * @brief 同步会话槽位的归属变化：新客户端重置计数，离开的客户端输出丢弃统计。
+     * @return AsyncWebSocketClient* 该槽位当前对应的、仍处于连接状态的客户端，否则为nullptr。
+     */
+    AsyncWebSocketClient* resolveClient(ClientSession& session);
+
+    /**
+     * @brief 判断客户端当前的发送队列是否还有余量。
+     */
+    static bool isWritable(AsyncWebSocketClient* client);
+
+    /**
+     * @struct DeliveryPlan
+     * @brief 一次投递的目标快照，所有位图均以会话槽位下标为位号。
+     */
+    struct DeliveryPlan {
+        /** @brief 所有已连接客户端。*/
+        uint32_t connected_mask = 0;
+        /** @brief 本次投递的目标客户端，按编码分组。*/
+        uint32_t target_mask[ENCODING_COUNT] = {0, 0};
+    };
+
+    /**
+     * @brief 收集本次广播的目标客户端，并为积压超限的客户端累加丢弃计数。
+     */
+    DeliveryPlan collectWritableClients();
+
+    /**
+     * @brief 将一段已编码的消息投递给位图中的客户端。
+     * @details 目标覆盖全部已连接客户端时，拷贝一次进共享缓冲区并`textAll`/`binaryAll`；否则逐个发送。
+     */
+    void deliver(const char* message, size_t len, uint32_t target_mask, WsEncoding encoding, const DeliveryPlan& plan);
+
+    /**
+     * @brief 将一个文档按指定编码序列化一次，并投递给位图中的客户端。
+     * @return bool `false` 表示文档不完整或没有可用的序列化缓冲区，消息未发送给任何目标。
+     */
+    bool deliverDocument(JsonDocument& doc, uint32_t target_mask, WsEncoding encoding, const DeliveryPlan& plan);
+
+    /**
+     * @brief 逐个客户端发送一段已编码的消息。
+     */
+    void sendEach(const char* message, size_t len, uint32_t target_mask, WsEncoding encoding);
+
+    /** @brief 单例实例指针。*/
+    static Sys_WsBroadcaster* _instance;
+
+    /** @brief WebSocket服务器实例。*/
+    AsyncWebSocket* _ws = nullptr;
+    /** @brief 客户端会话表。*/
+    ClientSession _sessions[MAX_CLIENTS];
+};
@@ -12,11 +12,34 @@
 #pragma once
 #include <stdint.h> // For uint32_t
 #include <functional> // For std::function
+#include "ArduinoJson.h" // For JsonDocument
+#include "Sys_Trace.h" // For SYS_TRACE_ENABLED
+
+/**
+ * @enum WsEncoding
+ * @brief WebSocket消息的编码格式。
+ * @details 每个客户端可通过`server.setEncoding`在文本JSON与二进制MessagePack之间选择；
+ *          两种编码承载完全相同的JSON RPC 2.0消息结构。
+ */
+enum class WsEncoding : uint8_t {
+    JSON = 0,   // 文本帧，JSON编码（默认）
+    MSGPACK = 1 // 二进制帧，MessagePack编码
+};
 
 /**
  * @struct JsonRpcRequest
  * @brief 定义了从前端接口到Task_Worker的JSON RPC 2.0请求的内部表示。
- *        它被放入命令队列中，由Task_Worker消费。
+ *
+ * @details
+ *  [优化] 零拷贝请求路径：
+ *  - 请求对象从`Sys_MemoryManager`的小块内存池中分配（`create()`），
+ *    命令队列中只传递指针，不再按值拷贝整个结构体（包括`std::function`）。
+ *  - WebSocket处理器只解析一次帧，解析结果保存在`doc`中（节点位于PSRAM），
+ *    `method`和`params`直接指向该文档，Task_Worker不再二次反序列化。
+ *  - `params`不再受固定长度缓冲区限制，大型RPC负载不会被静默截断。
+ *
+ *  生命周期：生产者`create()` -> 入队指针 -> Task_Worker处理 -> `release()`。
+ *  入队失败时，生产者负责调用`release()`。
  */
 struct JsonRpcRequest {
     /** @brief JSON RPC 请求的ID，用于匹配响应。对于通知，此ID可能无效或为0。*/
@@ -25,17 +48,47 @@ struct JsonRpcRequest {
     /** @brief 发起请求的WebSocket客户端ID，用于定向响应。*/
     uint32_t client_id = 0;
 
-    /** @brief JSON RPC 的方法名 (例如 "system.reboot", "settings.saveWiFi")。*/
-    char method[64] = "";
+    /** @brief JSON RPC 的方法名 (例如 "system.reboot")，指向`doc`内部的字符串。*/
+    const char* method = nullptr;
+
+    /** @brief 完整的、已解析的请求帧。*/
+    JsonDocument doc;
+
+    /** @brief 请求的`params`成员，指向`doc`内部；不存在时为null。*/
+    JsonVariantConst params;
+
+    /** @brief [新增] 响应的编码格式，与请求帧的编码一致。*/
+    WsEncoding encoding = WsEncoding::JSON;
+
+#if SYS_TRACE_ENABLED
+    /** @brief [新增] 收到请求帧的时间（`esp_timer`微秒），用于统计端到端延迟。*/
+    int64_t received_us = 0;
+#endif
 
-    /** @brief 携带JSON RPC的`params`对象的JSON字符串。*/
-    char params[512] = "";
     /**
      * @brief 响应闭包，用于Task_Worker直接回调，将响应发回给正确的客户端。
-     * @details 定义一个响应函数类型：参数为JSON字符串，返回值为void。
+     * @details 定义一个响应函数类型：参数为已按`encoding`编码的响应数据及其长度，返回值为void。
      */
-    using ResponseCallback = std::function<void(const char* json_response)>;
+    using ResponseCallback = std::function<void(const char* response, size_t len)>;
     ResponseCallback response_cb;
+
+    /**
+     * @brief 从内存池分配并构造一个空的请求对象。
+     * @details 内存池耗尽时回退到通用堆。
+     * @return JsonRpcRequest* 新的请求对象，内存不足时返回nullptr。
+     */
+    static JsonRpcRequest* create();
+
+    /**
+     * @brief 析构请求对象并将其内存归还给来源（内存池或通用堆）。
+     * @param request 由`create()`返回的指针，可以为nullptr。
+     */
+    static void release(JsonRpcRequest* request);
+
+    JsonRpcRequest();
+    ~JsonRpcRequest() = default;
+    JsonRpcRequest(const JsonRpcRequest&) = delete;
+    JsonRpcRequest& operator=(const JsonRpcRequest&) = delete;
 };
 
 // --- 未来可以添加其他共享类型 ---
@@ -0,0 +1,46 @@
+/**
+ * @file Arduino.h
+ * @brief [native] Arduino-ESP32核心API的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 只在`[env:native]`中使用，让不直接操作硬件的核心模块（设置、NVS、RPC路由、闪存日志、内存池）
+ * 能在工作站上编译运行，用于性能分析、valgrind/sanitizer和模糊测试。
+ * 与Arduino-ESP32一样，本头文件同时引入FreeRTOS、日志和错误码的定义，
+ * 依赖这些间接包含的模块无需修改。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "WString.h"
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+uint32_t getCpuFrequencyMhz(void);
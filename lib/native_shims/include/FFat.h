@@ -0,0 +1,18 @@
+/**
+ * @file FFat.h
+ * @brief [native] FFat文件系统对象的主机端替代（主机目录`<根目录>/ffat`）
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+class F_Fat : public FS {
+public:
+    F_Fat() : FS("ffat", 0x1F0000) {} // 与my_8MB.csv中ffat分区的大小一致
+};
+} // namespace fs
+
+extern fs::F_Fat FFat;
@@ -0,0 +1,119 @@
+/**
+ * @file FS.h
+ * @brief [native] Arduino文件系统抽象（`fs::FS`/`fs::File`）的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 每个文件系统映射到主机上的一个目录：`<根目录>/<分区标签>`，根目录取环境变量`SYS_NATIVE_FS_ROOT`，
+ * 默认为当前目录下的`.native_fs`。文件通过`FILE*`访问，目录通过`opendir()`遍历。
+ * 语义与Arduino-ESP32一致：`File`的拷贝共享同一个底层句柄，任何一个拷贝调用`close()`都会关闭它；
+ * 打开模式使用`fopen()`的模式字符串。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <memory>
+#include <string>
+#include "WString.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File {
+public:
+    File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t read(uint8_t* buf, size_t size);
+    size_t readBytes(char* buffer, size_t length) { return read((uint8_t*)buffer, length); }
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char* path() const;
+    const char* name() const;
+
+    bool isDirectory(void);
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory(void);
+
+private:
+    FileImplPtr _p;
+};
+
+/**
+ * @class FS
+ * @brief 一个挂载在主机目录上的文件系统。
+ */
+class FS {
+public:
+    /**
+     * @param label 分区标签，同时是主机目录名。
+     * @param capacity `totalBytes()`报告的容量，与分区表中的大小一致。
+     */
+    FS(const char* label, uint64_t capacity) : _label(label), _capacity(capacity) {}
+
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, const bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* path_from, const char* path_to);
+    bool rename(const String& path_from, const String& path_to) { return rename(path_from.c_str(), path_to.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+    // --- 与LittleFSFS/F_Fat对应的挂载与容量接口 ---
+    bool begin(bool format_on_fail = false, const char* base_path = "/", uint8_t max_open_files = 10, const char* partition_label = nullptr);
+    bool format();
+    void end();
+    uint64_t totalBytes() const { return _capacity; }
+    uint64_t usedBytes();
+    uint64_t freeBytes() { const uint64_t used = usedBytes(); return used < _capacity ? _capacity - used : 0; }
+
+private:
+    /** @brief 把文件系统内的路径映射为主机路径。*/
+    std::string hostPath(const char* path) const;
+
+    const char* _label;
+    const uint64_t _capacity;
+    std::string _root;
+    bool _mounted = false;
+};
+
+} // namespace fs
+
+#ifndef FS_NO_GLOBALS
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+#endif
@@ -0,0 +1,18 @@
+/**
+ * @file LittleFS.h
+ * @brief [native] LittleFS文件系统对象的主机端替代（主机目录`<根目录>/littlefs`）
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+class LittleFSFS : public FS {
+public:
+    LittleFSFS() : FS("littlefs", 0xE9000) {} // 与my_8MB.csv中littlefs分区的大小一致
+};
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
@@ -0,0 +1,93 @@
+/**
+ * @file WString.h
+ * @brief [native] Arduino `String`的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 以`std::string`为存储，只实现核心模块和ArduinoJson（`ARDUINOJSON_ENABLE_ARDUINO_STRING`）用到的接口。
+ * 与Arduino一致：以空指针构造或赋值得到空字符串，越界的`substring`返回空字符串。
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+class String {
+public:
+    String() = default;
+    String(const char* str) : _str(str ? str : "") {}
+    String(const char* str, size_t length) : _str(str ? std::string(str, length) : std::string()) {}
+    explicit String(char c) : _str(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) : String((unsigned long)value, base) {}
+    explicit String(int value, unsigned char base = 10) : String((long)value, base) {}
+    explicit String(unsigned int value, unsigned char base = 10) : String((unsigned long)value, base) {}
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimal_places = 2) : String((double)value, decimal_places) {}
+    explicit String(double value, unsigned int decimal_places = 2);
+
+    String& operator=(const char* str) { _str = str ? str : ""; return *this; }
+
+    const char* c_str() const { return _str.c_str(); }
+    unsigned int length() const { return (unsigned int)_str.size(); }
+    bool isEmpty() const { return _str.empty(); }
+    bool reserve(unsigned int size) { _str.reserve(size); return true; }
+    void clear() { _str.clear(); }
+
+    bool concat(const String& str) { _str += str._str; return true; }
+    bool concat(const char* str) { if (str) _str += str; return str != nullptr; }
+    bool concat(const char* str, unsigned int length) { if (str) _str.append(str, length); return str != nullptr; }
+    bool concat(char c) { _str += c; return true; }
+
+    String& operator+=(const String& rhs) { concat(rhs); return *this; }
+    String& operator+=(const char* rhs) { concat(rhs); return *this; }
+    String& operator+=(char rhs) { concat(rhs); return *this; }
+
+    char charAt(unsigned int index) const { return index < _str.size() ? _str[index] : '\0'; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(_str.find(c, from)); }
+    int indexOf(const char* str, unsigned int from = 0) const { return toIndex(_str.find(str ? str : "", from)); }
+    int lastIndexOf(char c) const { return toIndex(_str.rfind(c)); }
+    int lastIndexOf(const char* str) const { return toIndex(_str.rfind(str ? str : "")); }
+
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    bool startsWith(const String& prefix) const { return _str.compare(0, prefix._str.size(), prefix._str) == 0; }
+    bool endsWith(const String& suffix) const {
+        return suffix._str.size() <= _str.size() && _str.compare(_str.size() - suffix._str.size(), suffix._str.size(), suffix._str) == 0;
+    }
+    bool equals(const String& other) const { return _str == other._str; }
+    bool equals(const char* other) const { return _str == (other ? other : ""); }
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator==(const char* other) const { return equals(other); }
+    bool operator!=(const String& other) const { return !equals(other); }
+    bool operator!=(const char* other) const { return !equals(other); }
+    bool operator<(const String& other) const { return _str < other._str; }
+
+    long toInt() const { return strtol(_str.c_str(), nullptr, 10); }
+    double toDouble() const { return strtod(_str.c_str(), nullptr); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+private:
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    std::string _str;
+};
+
+/** @brief ArduinoJson的字符串适配器按类型名识别`StringSumHelper`，这里只需要该类型存在。*/
+class StringSumHelper : public String {
+public:
+    using String::String;
+    StringSumHelper(const String& str) : String(str) {}
+};
+
+inline String operator+(const String& lhs, const String& rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, const char* rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const char* lhs, const String& rhs) { String result(lhs); result += rhs; return result; }
+inline String operator+(const String& lhs, char rhs) { String result(lhs); result += rhs; return result; }
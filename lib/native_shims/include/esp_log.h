@@ -0,0 +1,45 @@
+/**
+ * @file esp_log.h
+ * @brief [native] ESP-IDF日志宏的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 日志以与设备相同的`L (ms) tag: message`格式写到stderr。
+ * 输出级别由编译标志`SYS_NATIVE_LOG_LEVEL`决定（默认`ESP_LOG_INFO`），级别之上的宏展开为空。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdarg.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifndef SYS_NATIVE_LOG_LEVEL
+#define SYS_NATIVE_LOG_LEVEL ESP_LOG_INFO
+#endif
+
+typedef int (*vprintf_like_t)(const char*, va_list);
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+uint32_t esp_log_timestamp(void);
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+void esp_log_level_set(const char* tag, esp_log_level_t level);
+
+#define SYS_NATIVE_LOG(level, letter, tag, format, ...) do {                                              \
+        if (SYS_NATIVE_LOG_LEVEL >= level)                                                                \
+            esp_log_write(level, tag, letter " (%u) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__); \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) SYS_NATIVE_LOG(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) SYS_NATIVE_LOG(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) SYS_NATIVE_LOG(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) SYS_NATIVE_LOG(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) SYS_NATIVE_LOG(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
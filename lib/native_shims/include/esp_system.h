@@ -0,0 +1,15 @@
+/**
+ * @file esp_system.h
+ * @brief [native] 系统API的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/** @brief 伪随机数（`std::mt19937`）；模糊测试时可通过`SYS_NATIVE_SEED`环境变量固定种子。*/
+uint32_t esp_random(void);
+void esp_restart(void);
+const char* esp_get_idf_version(void);
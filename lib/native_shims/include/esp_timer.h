@@ -0,0 +1,11 @@
+/**
+ * @file esp_timer.h
+ * @brief [native] 高精度时间戳的主机端替代（单调时钟，自进程启动起的微秒数）
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,33 @@
+/**
+ * @file FreeRTOS.h
+ * @brief [native] FreeRTOS基本类型与常量的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 只提供核心模块用到的子集。一个tick等于1毫秒；"核心"只是每个线程的一个标号，
+ * 由`xTaskCreatePinnedToCore()`的参数决定（主线程为1，与Arduino的loopTask一致）。
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdFAIL  pdFALSE
+#define pdPASS  pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)(1000 / configTICK_RATE_HZ))
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portNUM_PROCESSORS 2
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+/** @brief 当前线程的"核心"标号。*/
+BaseType_t xPortGetCoreID(void);
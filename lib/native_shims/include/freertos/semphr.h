@@ -0,0 +1,24 @@
+/**
+ * @file semphr.h
+ * @brief [native] FreeRTOS信号量的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 互斥锁、二值信号量和计数信号量共用一个基于`std::mutex`与`std::condition_variable`的计数实现：
+ * 互斥锁是初始计数为1、上限为1的信号量（不支持递归获取和优先级继承，与核心模块的用法一致）。
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+struct NativeSemaphore;
+typedef NativeSemaphore* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
@@ -0,0 +1,28 @@
+/**
+ * @file task.h
+ * @brief [native] FreeRTOS任务API的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 每个任务是一个分离的`std::thread`；优先级和栈大小被忽略。
+ * `vTaskDelete(NULL)`通过`pthread_exit()`结束当前线程，删除其它任务不受支持。
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+struct NativeTask;
+typedef NativeTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core_id);
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* created_task);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+TickType_t xTaskGetTickCount(void);
+const char* pcTaskGetName(TaskHandle_t task);
+#define pcTaskGetTaskName pcTaskGetName
@@ -0,0 +1,12 @@
+/**
+ * @file nvs_flash.h
+ * @brief [native] NVS分区初始化的主机端替代
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#pragma once
+
+#include "esp_err.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
@@ -0,0 +1,118 @@
+/**
+ * @file native_freertos.cpp
+ * @brief [native] FreeRTOS任务与信号量的主机端实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct NativeTask {
+    std::string name;
+    BaseType_t core;
+};
+
+struct NativeSemaphore {
+    std::mutex mutex;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+// 主线程模拟Arduino的loopTask（运行在核心1上）
+static NativeTask s_main_task{"loopTask", 1};
+static thread_local NativeTask* t_current_task = &s_main_task;
+
+// --- 任务 ---
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* created_task, BaseType_t core_id) {
+    (void)stack_depth;
+    (void)priority;
+    // 任务句柄在进程生命周期内保持有效（与`pcTaskGetName()`的用法一致），因此不回收
+    NativeTask* task = new NativeTask{name ? name : "", core_id == tskNO_AFFINITY ? 0 : core_id};
+    if (created_task) *created_task = task;
+    std::thread([function, parameter, task] {
+        t_current_task = task;
+        function(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* created_task) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, parameter, priority, created_task, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == t_current_task) {
+        pthread_exit(nullptr);
+    }
+    fprintf(stderr, "vTaskDelete() of another task is not supported on native.\n");
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return t_current_task; }
+
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(esp_timer_get_time() / 1000); }
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    return (task ? task : t_current_task)->name.c_str();
+}
+
+BaseType_t xPortGetCoreID(void) { return t_current_task->core; }
+
+// --- 信号量 ---
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    NativeSemaphore* semaphore = new NativeSemaphore();
+    semaphore->count = initial_count;
+    semaphore->max_count = max_count;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return xSemaphoreCreateCounting(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xSemaphoreCreateCounting(1, 0); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait) {
+    if (!semaphore) return pdFALSE;
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    auto available = [semaphore] { return semaphore->count > 0; };
+    if (ticks_to_wait == portMAX_DELAY) {
+        semaphore->cv.wait(lock, available);
+    } else if (!semaphore->cv.wait_for(lock, std::chrono::milliseconds(ticks_to_wait), available)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (!semaphore) return pdFALSE;
+    {
+        std::lock_guard<std::mutex> lock(semaphore->mutex);
+        if (semaphore->count >= semaphore->max_count) return pdFALSE;
+        semaphore->count++;
+    }
+    semaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    if (!semaphore) return 0;
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    return semaphore->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) { delete semaphore; }
@@ -0,0 +1,263 @@
+/**
+ * @file native_fs.cpp
+ * @brief [native] `fs::FS`/`fs::File`的主机端实现，以及`FFat`/`LittleFS`全局对象
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#include "FS.h"
+#include "FFat.h"
+#include "LittleFS.h"
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+fs::F_Fat FFat;
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+/**
+ * @class FileImpl
+ * @brief 一个已打开的文件（`FILE*`）或目录（`DIR*`）。
+ */
+class FileImpl {
+public:
+    FileImpl(std::string fs_path, std::string host_path, FILE* file, DIR* dir)
+        : fs_path(std::move(fs_path)), host_path(std::move(host_path)), file(file), dir(dir) {
+        const size_t slash = this->fs_path.find_last_of('/');
+        name = slash == std::string::npos ? this->fs_path : this->fs_path.substr(slash + 1);
+    }
+    ~FileImpl() { close(); }
+
+    void close() {
+        if (file) { fclose(file); file = nullptr; }
+        if (dir) { closedir(dir); dir = nullptr; }
+    }
+
+    std::string fs_path;
+    std::string host_path;
+    std::string name;
+    FILE* file;
+    DIR* dir;
+};
+
+// --- File ---
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    return (_p && _p->file) ? fwrite(buf, 1, size, _p->file) : 0;
+}
+
+int File::available() {
+    if (!_p || !_p->file) return 0;
+    const size_t length = size();
+    const size_t pos = position();
+    return pos < length ? (int)(length - pos) : 0;
+}
+
+int File::read() {
+    if (!_p || !_p->file) return -1;
+    const int c = fgetc(_p->file);
+    return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+    if (!_p || !_p->file) return -1;
+    const int c = fgetc(_p->file);
+    if (c == EOF) return -1;
+    ungetc(c, _p->file);
+    return c;
+}
+
+void File::flush() {
+    if (_p && _p->file) fflush(_p->file);
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    return (_p && _p->file) ? fread(buf, 1, size, _p->file) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_p || !_p->file) return false;
+    const int whence = mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END);
+    return fseek(_p->file, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!_p || !_p->file) return 0;
+    const long pos = ftell(_p->file);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!_p || !_p->file) return 0;
+    fflush(_p->file); // 让缓冲中的写入反映到文件大小上
+    struct stat st;
+    return fstat(fileno(_p->file), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    if (_p) {
+        _p->close();
+        _p.reset();
+    }
+}
+
+File::operator bool() const {
+    return _p && (_p->file || _p->dir);
+}
+
+time_t File::getLastWrite() {
+    if (!_p) return 0;
+    struct stat st;
+    return stat(_p->host_path.c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+const char* File::path() const { return _p ? _p->fs_path.c_str() : nullptr; }
+const char* File::name() const { return _p ? _p->name.c_str() : nullptr; }
+
+bool File::isDirectory(void) { return _p && _p->dir; }
+
+File File::openNextFile(const char* mode) {
+    if (!_p || !_p->dir) return File();
+    while (struct dirent* entry = readdir(_p->dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        std::string fs_path = _p->fs_path;
+        if (fs_path.empty() || fs_path.back() != '/') fs_path += '/';
+        fs_path += entry->d_name;
+        const std::string host_path = _p->host_path + "/" + entry->d_name;
+        struct stat st;
+        if (stat(host_path.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            DIR* dir = opendir(host_path.c_str());
+            if (dir) return File(std::make_shared<FileImpl>(fs_path, host_path, nullptr, dir));
+        } else {
+            FILE* file = fopen(host_path.c_str(), mode);
+            if (file) return File(std::make_shared<FileImpl>(fs_path, host_path, file, nullptr));
+        }
+    }
+    return File();
+}
+
+void File::rewindDirectory(void) {
+    if (_p && _p->dir) rewinddir(_p->dir);
+}
+
+// --- FS ---
+
+static bool makeDirectories(const std::string& path) {
+    std::string partial;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t slash = path.find('/', start);
+        if (slash == std::string::npos) slash = path.size();
+        partial = path.substr(0, slash);
+        if (!partial.empty() && ::mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        start = slash + 1;
+    }
+    return true;
+}
+
+static bool removeTree(const std::string& path, bool remove_self) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return false;
+    bool ok = true;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        const std::string child = path + "/" + entry->d_name;
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) continue;
+        ok &= S_ISDIR(st.st_mode) ? removeTree(child, true) : (::unlink(child.c_str()) == 0);
+    }
+    closedir(dir);
+    if (remove_self) ok &= (::rmdir(path.c_str()) == 0);
+    return ok;
+}
+
+static uint64_t treeSize(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return 0;
+    uint64_t total = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        const std::string child = path + "/" + entry->d_name;
+        struct stat st;
+        if (stat(child.c_str(), &st) != 0) continue;
+        total += S_ISDIR(st.st_mode) ? treeSize(child) : (uint64_t)st.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+std::string FS::hostPath(const char* path) const {
+    std::string result = _root;
+    if (!path || path[0] != '/') result += '/';
+    if (path) result += path;
+    while (result.size() > _root.size() + 1 && result.back() == '/') result.pop_back();
+    return result;
+}
+
+bool FS::begin(bool format_on_fail, const char* base_path, uint8_t max_open_files, const char* partition_label) {
+    (void)format_on_fail;
+    (void)base_path;
+    (void)max_open_files;
+    (void)partition_label;
+    if (_mounted) return true;
+    const char* root = getenv("SYS_NATIVE_FS_ROOT");
+    _root = std::string(root ? root : ".native_fs") + "/" + _label;
+    _mounted = makeDirectories(_root);
+    return _mounted;
+}
+
+bool FS::format() {
+    if (_root.empty() && !begin()) return false;
+    return removeTree(_root, false);
+}
+
+void FS::end() { _mounted = false; }
+
+uint64_t FS::usedBytes() { return _mounted ? treeSize(_root) : 0; }
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    if (!_mounted || !path) return File();
+    const std::string host_path = hostPath(path);
+    struct stat st;
+    if (stat(host_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(host_path.c_str());
+        return dir ? File(std::make_shared<FileImpl>(path, host_path, nullptr, dir)) : File();
+    }
+    if (create) {
+        const size_t slash = host_path.find_last_of('/');
+        if (slash != std::string::npos) makeDirectories(host_path.substr(0, slash));
+    }
+    FILE* file = fopen(host_path.c_str(), mode);
+    return file ? File(std::make_shared<FileImpl>(path, host_path, file, nullptr)) : File();
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return _mounted && path && stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return _mounted && path && ::unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* path_from, const char* path_to) {
+    return _mounted && path_from && path_to && ::rename(hostPath(path_from).c_str(), hostPath(path_to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return _mounted && path && ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+    return _mounted && path && ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,261 @@
+/**
+ * @file native_nvs.cpp
+ * @brief [native] NVS键值存储的主机端实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#include "nvs.h"
+#include "nvs_flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum class EntryType : uint8_t { I8, U8, I16, U16, I32, U32, I64, U64, STR, BLOB };
+
+struct Entry {
+    EntryType type;
+    std::vector<uint8_t> bytes; // STR 类型包含结尾的'\0'
+};
+
+struct Handle {
+    std::string ns;
+    bool writable;
+};
+
+constexpr size_t NVS_KEY_NAME_MAX_SIZE = 16; // 含结尾'\0'，与设备一致
+constexpr size_t NVS_STR_MAX_SIZE = 4000;
+constexpr size_t NVS_BLOB_MAX_SIZE = 508000;
+
+std::mutex s_mutex;
+bool s_initialized = false;
+std::map<std::string, std::map<std::string, Entry>> s_store;
+std::map<nvs_handle_t, Handle> s_handles;
+nvs_handle_t s_next_handle = 1;
+
+// --- 可选的文件持久化 ---
+// 格式：重复的 [ns长度u8][ns][key长度u8][key][类型u8][值长度u32][值]
+
+const char* persistPath() { return getenv("SYS_NATIVE_NVS_FILE"); }
+
+void loadFromFile() {
+    const char* path = persistPath();
+    if (!path) return;
+    FILE* f = fopen(path, "rb");
+    if (!f) return;
+    while (true) {
+        uint8_t ns_len, key_len, type;
+        uint32_t value_len;
+        char ns[256], key[256];
+        if (fread(&ns_len, 1, 1, f) != 1 || fread(ns, 1, ns_len, f) != ns_len) break;
+        if (fread(&key_len, 1, 1, f) != 1 || fread(key, 1, key_len, f) != key_len) break;
+        if (fread(&type, 1, 1, f) != 1 || fread(&value_len, sizeof(value_len), 1, f) != 1) break;
+        Entry entry{(EntryType)type, std::vector<uint8_t>(value_len)};
+        if (value_len && fread(entry.bytes.data(), 1, value_len, f) != value_len) break;
+        s_store[std::string(ns, ns_len)][std::string(key, key_len)] = std::move(entry);
+    }
+    fclose(f);
+}
+
+void saveToFile() {
+    const char* path = persistPath();
+    if (!path) return;
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    for (const auto& ns : s_store) {
+        for (const auto& kv : ns.second) {
+            const uint8_t ns_len = (uint8_t)ns.first.size();
+            const uint8_t key_len = (uint8_t)kv.first.size();
+            const uint8_t type = (uint8_t)kv.second.type;
+            const uint32_t value_len = (uint32_t)kv.second.bytes.size();
+            fwrite(&ns_len, 1, 1, f);
+            fwrite(ns.first.data(), 1, ns_len, f);
+            fwrite(&key_len, 1, 1, f);
+            fwrite(kv.first.data(), 1, key_len, f);
+            fwrite(&type, 1, 1, f);
+            fwrite(&value_len, sizeof(value_len), 1, f);
+            fwrite(kv.second.bytes.data(), 1, value_len, f);
+        }
+    }
+    fclose(f);
+}
+
+// --- 通用读写 ---
+
+esp_err_t checkKey(const char* key) {
+    if (!key) return ESP_ERR_NVS_INVALID_NAME;
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_KEY_TOO_LONG;
+    return ESP_OK;
+}
+
+esp_err_t setEntry(nvs_handle_t handle, const char* key, EntryType type, const void* data, size_t length) {
+    esp_err_t err = checkKey(key);
+    if (err != ESP_OK) return err;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_handles.find(handle);
+    if (it == s_handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!it->second.writable) return ESP_ERR_NVS_READ_ONLY;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    s_store[it->second.ns][key] = Entry{type, std::vector<uint8_t>(bytes, bytes + length)};
+    return ESP_OK;
+}
+
+/** @brief 查找条目并检查类型；调用者必须持有`s_mutex`。*/
+esp_err_t findEntry(nvs_handle_t handle, const char* key, EntryType type, const Entry** out_entry) {
+    esp_err_t err = checkKey(key);
+    if (err != ESP_OK) return err;
+    auto it = s_handles.find(handle);
+    if (it == s_handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    auto ns = s_store.find(it->second.ns);
+    if (ns == s_store.end()) return ESP_ERR_NVS_NOT_FOUND;
+    auto entry = ns->second.find(key);
+    if (entry == ns->second.end()) return ESP_ERR_NVS_NOT_FOUND;
+    if (entry->second.type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+    *out_entry = &entry->second;
+    return ESP_OK;
+}
+
+template <typename T>
+esp_err_t getScalar(nvs_handle_t handle, const char* key, EntryType type, T* out_value) {
+    if (!out_value) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const Entry* entry = nullptr;
+    esp_err_t err = findEntry(handle, key, type, &entry);
+    if (err != ESP_OK) return err;
+    memcpy(out_value, entry->bytes.data(), sizeof(T));
+    return ESP_OK;
+}
+
+esp_err_t getVariable(nvs_handle_t handle, const char* key, EntryType type, void* out_value, size_t* length) {
+    if (!length) return ESP_ERR_INVALID_ARG;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const Entry* entry = nullptr;
+    esp_err_t err = findEntry(handle, key, type, &entry);
+    if (err != ESP_OK) return err;
+    const size_t required = entry->bytes.size();
+    if (out_value == nullptr) {
+        *length = required;
+        return ESP_OK;
+    }
+    if (*length < required) {
+        *length = required;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, entry->bytes.data(), required);
+    *length = required;
+    return ESP_OK;
+}
+
+} // namespace
+
+// --- 分区 ---
+
+esp_err_t nvs_flash_init(void) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!s_initialized) {
+        loadFromFile();
+        s_initialized = true;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_store.clear();
+    saveToFile();
+    return ESP_OK;
+}
+
+// --- 句柄 ---
+
+esp_err_t nvs_open(const char* namespace_name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    if (!namespace_name || !out_handle) return ESP_ERR_INVALID_ARG;
+    if (strlen(namespace_name) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_NVS_KEY_TOO_LONG;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!s_initialized) return ESP_ERR_NVS_NOT_INITIALIZED;
+    // 与设备一致：只读打开一个不存在的命名空间会失败
+    if (open_mode == NVS_READONLY && s_store.find(namespace_name) == s_store.end()) return ESP_ERR_NVS_NOT_FOUND;
+    const nvs_handle_t handle = s_next_handle++;
+    s_handles[handle] = Handle{namespace_name, open_mode == NVS_READWRITE};
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (s_handles.find(handle) == s_handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    saveToFile();
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    esp_err_t err = checkKey(key);
+    if (err != ESP_OK) return err;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_handles.find(handle);
+    if (it == s_handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!it->second.writable) return ESP_ERR_NVS_READ_ONLY;
+    return s_store[it->second.ns].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto it = s_handles.find(handle);
+    if (it == s_handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!it->second.writable) return ESP_ERR_NVS_READ_ONLY;
+    s_store[it->second.ns].clear();
+    return ESP_OK;
+}
+
+// --- 写入 ---
+
+esp_err_t nvs_set_i8(nvs_handle_t h, const char* key, int8_t v) { return setEntry(h, key, EntryType::I8, &v, sizeof(v)); }
+esp_err_t nvs_set_u8(nvs_handle_t h, const char* key, uint8_t v) { return setEntry(h, key, EntryType::U8, &v, sizeof(v)); }
+esp_err_t nvs_set_i16(nvs_handle_t h, const char* key, int16_t v) { return setEntry(h, key, EntryType::I16, &v, sizeof(v)); }
+esp_err_t nvs_set_u16(nvs_handle_t h, const char* key, uint16_t v) { return setEntry(h, key, EntryType::U16, &v, sizeof(v)); }
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t v) { return setEntry(h, key, EntryType::I32, &v, sizeof(v)); }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char* key, uint32_t v) { return setEntry(h, key, EntryType::U32, &v, sizeof(v)); }
+esp_err_t nvs_set_i64(nvs_handle_t h, const char* key, int64_t v) { return setEntry(h, key, EntryType::I64, &v, sizeof(v)); }
+esp_err_t nvs_set_u64(nvs_handle_t h, const char* key, uint64_t v) { return setEntry(h, key, EntryType::U64, &v, sizeof(v)); }
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    if (!value) return ESP_ERR_INVALID_ARG;
+    const size_t length = strlen(value) + 1;
+    if (length > NVS_STR_MAX_SIZE) return ESP_ERR_NVS_VALUE_TOO_LONG;
+    return setEntry(handle, key, EntryType::STR, value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    if (!value && length) return ESP_ERR_INVALID_ARG;
+    if (length > NVS_BLOB_MAX_SIZE) return ESP_ERR_NVS_VALUE_TOO_LONG;
+    return setEntry(handle, key, EntryType::BLOB, value, length);
+}
+
+// --- 读取 ---
+
+esp_err_t nvs_get_i8(nvs_handle_t h, const char* key, int8_t* v) { return getScalar(h, key, EntryType::I8, v); }
+esp_err_t nvs_get_u8(nvs_handle_t h, const char* key, uint8_t* v) { return getScalar(h, key, EntryType::U8, v); }
+esp_err_t nvs_get_i16(nvs_handle_t h, const char* key, int16_t* v) { return getScalar(h, key, EntryType::I16, v); }
+esp_err_t nvs_get_u16(nvs_handle_t h, const char* key, uint16_t* v) { return getScalar(h, key, EntryType::U16, v); }
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* v) { return getScalar(h, key, EntryType::I32, v); }
+esp_err_t nvs_get_u32(nvs_handle_t h, const char* key, uint32_t* v) { return getScalar(h, key, EntryType::U32, v); }
+esp_err_t nvs_get_i64(nvs_handle_t h, const char* key, int64_t* v) { return getScalar(h, key, EntryType::I64, v); }
+esp_err_t nvs_get_u64(nvs_handle_t h, const char* key, uint64_t* v) { return getScalar(h, key, EntryType::U64, v); }
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    return getVariable(handle, key, EntryType::STR, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    return getVariable(handle, key, EntryType::BLOB, out_value, length);
+}
@@ -0,0 +1,190 @@
+/**
+ * @file native_platform.cpp
+ * @brief [native] 时间、随机数、内存、日志与错误码的主机端实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#include <Arduino.h>
+#include "esp_timer.h"
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// --- 时间 ---
+
+static const std::chrono::steady_clock::time_point s_process_start = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_process_start).count();
+}
+
+unsigned long millis(void) { return (unsigned long)(esp_timer_get_time() / 1000); }
+unsigned long micros(void) { return (unsigned long)esp_timer_get_time(); }
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield(void) { std::this_thread::yield(); }
+uint32_t getCpuFrequencyMhz(void) { return 240; }
+
+// --- 系统 ---
+
+uint32_t esp_random(void) {
+    static std::mutex mutex;
+    static std::mt19937 generator([] {
+        const char* seed = getenv("SYS_NATIVE_SEED");
+        return seed ? (uint32_t)strtoul(seed, nullptr, 0) : std::random_device{}();
+    }());
+    std::lock_guard<std::mutex> lock(mutex);
+    return generator();
+}
+
+void esp_restart(void) {
+    fprintf(stderr, "esp_restart() called, exiting.\n");
+    exit(0);
+}
+
+const char* esp_get_idf_version(void) { return "native"; }
+
+// --- 内存 ---
+
+static constexpr size_t NATIVE_PSRAM_BYTES = 8 * 1024 * 1024;
+static constexpr size_t NATIVE_SRAM_BYTES = 320 * 1024;
+
+void* heap_caps_malloc(size_t size, uint32_t caps) { (void)caps; return malloc(size); }
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) { (void)caps; return calloc(n, size); }
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) { (void)caps; return realloc(ptr, size); }
+void heap_caps_free(void* ptr) { free(ptr); }
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? NATIVE_PSRAM_BYTES : NATIVE_SRAM_BYTES;
+}
+size_t heap_caps_get_free_size(uint32_t caps) { return heap_caps_get_total_size(caps); }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heap_caps_get_total_size(caps); }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return heap_caps_get_total_size(caps); }
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+    memset(info, 0, sizeof(*info));
+    info->total_free_bytes = heap_caps_get_free_size(caps);
+    info->largest_free_block = heap_caps_get_largest_free_block(caps);
+    info->minimum_free_bytes = heap_caps_get_minimum_free_size(caps);
+}
+
+// --- 日志 ---
+
+static vprintf_like_t s_log_vprintf = vprintf;
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    (void)level;
+    (void)tag;
+    va_list args;
+    va_start(args, format);
+    if (s_log_vprintf == vprintf) {
+        vfprintf(stderr, format, args); // 日志走stderr，stdout留给基准测试结果
+    } else {
+        s_log_vprintf(format, args);
+    }
+    va_end(args);
+}
+
+uint32_t esp_log_timestamp(void) { return (uint32_t)millis(); }
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    vprintf_like_t previous = s_log_vprintf;
+    s_log_vprintf = func ? func : vprintf;
+    return previous;
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    (void)tag;
+    (void)level;
+}
+
+// --- 错误码 ---
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+        case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+        case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+        case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+        case ESP_ERR_NVS_KEY_TOO_LONG: return "ESP_ERR_NVS_KEY_TOO_LONG";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+        case ESP_ERR_NVS_VALUE_TOO_LONG: return "ESP_ERR_NVS_VALUE_TOO_LONG";
+        case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+void esp_native_abort_on_error(esp_err_t code, const char* file, int line, const char* expression) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n",
+            code, esp_err_to_name(code), file, line, expression);
+    abort();
+}
+
+// --- String ---
+
+String::String(long value, unsigned char base) {
+    if (base == 10) {
+        _str = std::to_string(value);
+    } else {
+        const bool negative = value < 0;
+        *this = String((unsigned long)(negative ? -value : value), base);
+        if (negative) _str.insert(_str.begin(), '-');
+    }
+}
+
+String::String(unsigned long value, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char buffer[8 * sizeof(unsigned long) + 1];
+    char* p = buffer + sizeof(buffer) - 1;
+    *p = '\0';
+    do {
+        const unsigned digit = value % base;
+        *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value != 0);
+    _str = p;
+}
+
+String::String(double value, unsigned int decimal_places) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimal_places, value);
+    _str = buffer;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= _str.size()) return String();
+    if (to > _str.size()) to = (unsigned int)_str.size();
+    return String(_str.c_str() + from, to - from);
+}
+
+void String::toLowerCase() {
+    for (char& c : _str) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase() {
+    for (char& c : _str) c = (char)toupper((unsigned char)c);
+}
+
+void String::trim() {
+    const size_t first = _str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        _str.clear();
+        return;
+    }
+    const size_t last = _str.find_last_not_of(" \t\r\n");
+    _str = _str.substr(first, last - first + 1);
+}
@@ -1,8 +1,24 @@
-# minify_gzip.py (v4 包含原始文件删除逻辑)
+# minify_gzip.py (v6 编译期资源清单 + 内容哈希文件名)
 # PlatformIO extra_script to minify and gzip web files before building the filesystem image.
+#
+# [优化] 脚本分为两部分，共用同一个可复现的处理流程 (build_assets)：
+#   1. 每次构建固件时：在内存中完成缩小+Gzip，生成资源清单头文件 Sys_AssetManifest.h
+#      (请求路径、内容哈希路径、Gzip大小、ETag、MIME类型)，编译进固件。固件因此在请求路径中
+#      不再探测文件系统，ETag和MIME表也都来自清单。
+#   2. 构建文件系统镜像 (buildfs) 前：把同样的结果写成 .gz 文件，并删除原始文件。
+# Gzip输出是可复现的（固定mtime），两部分得到的字节完全一致，因此清单与文件系统镜像始终匹配。
+#
+# [新增] 内容哈希文件名：除HTML以外的资源额外获得一个带内容哈希的请求路径，
+#        如 /main.js -> /main.3f2a9c0d.js，HTML中对它们的引用会被改写为该路径。
+#        内容变化时路径随之变化，浏览器可以永久缓存这些资源 (Cache-Control: immutable)。
+#        文件系统中仍以原名存储 (/main.js.gz)，哈希路径只存在于清单中。
+# 格式见 include/Sys_AssetCache.h 与 src/Sys_AssetCache.cpp，两者必须保持一致。
 
 import os
+import re
+import io
 import gzip
+import hashlib
 import shutil
 
 # 确保 env 变量在脚本的全局作用域中可用，尤其是在早期的错误处理中。
@@ -21,6 +37,210 @@ except ImportError:
     print("pip install minify-html rcssmin rjsmin")
     env.Exit(1)
 
+# 生成的清单头文件名
+MANIFEST_HEADER = "Sys_AssetManifest.h"
+
+# 内容哈希的长度（十六进制字符数），ETag与哈希文件名共用
+HASH_LENGTH = 16
+# 哈希文件名中使用的哈希长度
+NAME_HASH_LENGTH = 8
+
+# MIME类型表
+MIME_TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.svg': 'image/svg+xml',
+    '.png': 'image/png',
+    '.jpg': 'image/jpeg',
+    '.ico': 'image/x-icon',
+    '.woff2': 'font/woff2',
+}
+
+
+def gzip_bytes(content):
+    """
+    以可复现的方式Gzip压缩：文件头中的修改时间固定为0、不记录原始文件名，
+    相同的内容总是得到相同的字节，内容哈希(ETag)因此只随内容变化。
+    """
+    buffer = io.BytesIO()
+    # compresslevel=9 提供最高压缩比，但会增加处理时间
+    with gzip.GzipFile(filename="", mode="wb", compresslevel=9, fileobj=buffer, mtime=0) as f_out:
+        f_out.write(content)
+    return buffer.getvalue()
+
+
+def minify(file_path, content_bytes):
+    """
+    缩小HTML/CSS/JS内容。
+    返回 (内容, 是否已缩小)；出错或该文件类型不需要缩小时返回原始内容。
+    """
+    file_ext = os.path.splitext(file_path)[1].lower()
+    if file_ext not in ('.html', '.css', '.js'):
+        return content_bytes, False
+    try:
+        if file_ext == '.html':
+            # minify_html 默认输入字符串，输出字符串，需要编解码
+            return minify_html.minify(
+                content_bytes.decode('utf-8'),
+                minify_js=True,
+                minify_css=True
+            ).encode('utf-8'), True
+        elif file_ext == '.css':
+            # rcssmin 和 rjsmin 期望输入字符串，需要编解码
+            return rcssmin.cssmin(content_bytes.decode('utf-8')).encode('utf-8'), True
+        else:
+            return rjsmin.jsmin(content_bytes.decode('utf-8')).encode('utf-8'), True
+    except Exception as e:
+        print(f"     [警告] 缩小文件 '{os.path.basename(file_path)}' 时出错: {e}. 将使用原始文件进行Gzip压缩。")
+        return content_bytes, False
+
+
+def hashed_url(url_path, digest):
+    """/main.js -> /main.3f2a9c0d.js"""
+    stem, ext = os.path.splitext(url_path)
+    return f"{stem}.{digest[:NAME_HASH_LENGTH]}{ext}"
+
+
+def rewrite_references(html, url_path, rename_map):
+    """
+    把HTML中 href="..." / src="..." 对资源的引用改写为内容哈希路径。
+    同时识别相对路径 (main.js) 和绝对路径 (/main.js)。
+    """
+    base_dir = os.path.dirname(url_path)
+
+    def replace(match):
+        attr, quote, ref = match.group(1), match.group(2), match.group(3)
+        if ref.startswith("/"):
+            target = ref
+        else:
+            target = os.path.normpath(os.path.join(base_dir, ref)).replace(os.sep, "/")
+        if target not in rename_map:
+            return match.group(0)
+        new_ref = rename_map[target] if ref.startswith("/") else os.path.relpath(rename_map[target], base_dir).replace(os.sep, "/")
+        return f"{attr}={quote}{new_ref}{quote}"
+
+    return re.sub(r'\b(href|src)=(["\'])([^"\'?#]+)\2', replace, html.decode('utf-8')).encode('utf-8')
+
+
+def build_assets(data_dir, verbose):
+    """
+    在内存中处理data_dir中的所有资源，不修改任何文件。
+    返回资源列表，每项为字典:
+      source   - 原始文件路径（已经是.gz时为该.gz文件）
+      url      - 请求路径，如 /main.js
+      hashed   - 内容哈希路径，如 /main.3f2a9c0d.js（HTML为None）
+      gz       - Gzip后的字节
+      digest   - Gzip字节的SHA-256（十六进制）
+      minified - 是否已缩小
+    先处理HTML以外的资源，得到它们的哈希路径后，再改写并处理HTML。
+    """
+    sources = []
+    for root, dirs, files in os.walk(data_dir):
+        for file in files:
+            sources.append(os.path.join(root, file))
+
+    # 同一资源可能同时存在原始文件和之前构建留下的.gz文件：以原始文件为准
+    originals = {p for p in sources if not p.endswith(".gz")}
+    sources = [p for p in sources if not (p.endswith(".gz") and p[:-len(".gz")] in originals)]
+
+    def url_of(path):
+        rel = os.path.relpath(path, data_dir).replace(os.sep, "/")
+        return "/" + (rel[:-len(".gz")] if rel.endswith(".gz") else rel)
+
+    def is_html(path):
+        return url_of(path).lower().endswith(".html")
+
+    assets = []
+    rename_map = {}
+    for file_path in sorted(sources, key=lambda p: (is_html(p), p)):
+        url_path = url_of(file_path)
+        if verbose:
+            print(f"  -> 正在处理: {os.path.relpath(file_path, data_dir)}")
+        try:
+            with open(file_path, "rb") as f_in:
+                content_bytes = f_in.read()
+        except Exception as e:
+            print(f"     [错误] 读取文件失败: {e}")
+            continue
+
+        minified = False
+        if file_path.endswith(".gz"):
+            # 之前构建中已Gzip的文件（原始文件已被删除）：内容保持不变
+            gz = content_bytes
+        else:
+            content, minified = minify(file_path, content_bytes)
+            if is_html(file_path):
+                content = rewrite_references(content, url_path, rename_map)
+            gz = gzip_bytes(content)
+
+        digest = hashlib.sha256(gz).hexdigest()
+        hashed = None if is_html(file_path) else hashed_url(url_path, digest)
+        if hashed:
+            rename_map[url_path] = hashed
+        assets.append({
+            "source": file_path, "url": url_path, "hashed": hashed,
+            "gz": gz, "digest": digest, "minified": minified,
+        })
+    return assets
+
+
+def c_string(value):
+    return "nullptr" if value is None else '"' + value.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def write_manifest_header(assets, header_path):
+    """生成编译进固件的资源清单。内容未变化时不重写文件，避免触发不必要的重新编译。"""
+    entries = []
+    for asset in assets:
+        ext = os.path.splitext(asset["url"])[1].lower()
+        mime = MIME_TYPES.get(ext, "application/octet-stream")
+        etag = '"' + asset["digest"][:HASH_LENGTH] + '"'
+        entries.append(f'    {{ {c_string(asset["url"])}, {c_string(asset["hashed"])}, {len(asset["gz"])}, {c_string(etag)}, {c_string(mime)} }},')
+
+    lines = [
+        "// Generated by minify_gzip.py from the data/ directory. Do not edit.",
+        "#pragma once",
+        "",
+        '#include "Sys_AssetCache.h"',
+        "",
+    ]
+    if entries:
+        lines += ["static const AssetManifestEntry ASSET_MANIFEST[] = {"] + entries + [
+            "};",
+            "static constexpr size_t ASSET_MANIFEST_COUNT = sizeof(ASSET_MANIFEST) / sizeof(ASSET_MANIFEST[0]);",
+        ]
+    else:
+        # C++不允许空数组
+        lines += [
+            "static const AssetManifestEntry* const ASSET_MANIFEST = nullptr;",
+            "static constexpr size_t ASSET_MANIFEST_COUNT = 0;",
+        ]
+    lines.append("")
+    text = "\n".join(lines)
+
+    if os.path.isfile(header_path):
+        with open(header_path, "r", encoding="utf-8") as f_in:
+            if f_in.read() == text:
+                return
+    os.makedirs(os.path.dirname(header_path), exist_ok=True)
+    with open(header_path, "w", encoding="utf-8", newline="\n") as f_out:
+        f_out.write(text)
+    print(f"[minify_gzip.py] 已生成资源清单: {header_path} ({len(assets)} 个资源)")
+
+
+def generate_asset_manifest(env):
+    """
+    在编译固件前生成资源清单头文件，放在构建目录中并加入头文件搜索路径。
+    """
+    data_dir = env.get("PROJECT_DATA_DIR")
+    generated_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    env.Append(CPPPATH=[generated_dir])
+    assets = build_assets(data_dir, verbose=False) if os.path.isdir(data_dir) else []
+    write_manifest_header(assets, os.path.join(generated_dir, MANIFEST_HEADER))
+
+
 def minify_and_gzip_web_files(source, target, env):
     """
     此函数由PlatformIO在构建文件系统前调用。
@@ -31,75 +251,35 @@ def minify_and_gzip_web_files(source, target, env):
     if not os.path.isdir(data_dir):
         print(f"\n[minify_gzip.py] '{data_dir}' 目录不存在，跳过处理。")
         return
-        
+
     print(f"\n[minify_gzip.py] 开始处理 '{data_dir}' 目录中的Web资源...")
 
     # 用于存储需要删除的原始文件路径
     # 我们先收集所有要删除的文件，在主循环结束后再统一删除，
     # 避免在迭代过程中修改正在遍历的目录结构。
-    files_to_delete = [] 
+    files_to_delete = []
 
-    for root, dirs, files in os.walk(data_dir):
-        for file in files:
-            file_path = os.path.join(root, file)
-            file_ext = os.path.splitext(file)[1].lower()
-            
-            # 跳过已经Gzip的文件，避免重复处理和无限添加.gz扩展名
-            if file_ext == '.gz':
-                print(f"  -> 跳过已Gzip文件: {os.path.relpath(file_path, data_dir)}")
-                continue
+    for asset in build_assets(data_dir, verbose=True):
+        file_path = asset["source"]
+        if file_path.endswith(".gz"):
+            print(f"  -> 跳过已Gzip文件: {os.path.relpath(file_path, data_dir)}")
+            continue
 
-            print(f"  -> 正在处理: {os.path.relpath(file_path, data_dir)}")
-            
-            try:
-                with open(file_path, "rb") as f_in:
-                    content_bytes = f_in.read()
-            except Exception as e:
-                print(f"     [错误] 读取文件失败: {e}")
-                continue
-
-            minified_content_bytes = None
-            is_minified = False
-
-            # 仅对特定类型的文件进行缩小操作
-            if file_ext in ('.html', '.css', '.js'):
-                try:
-                    if file_ext == '.html':
-                        # minify_html 默认输入字符串，输出字符串，需要编解码
-                        minified_content_bytes = minify_html.minify(
-                            content_bytes.decode('utf-8'), 
-                            minify_js=True, 
-                            minify_css=True
-                        ).encode('utf-8')
-                    elif file_ext == '.css':
-                        # rcssmin 和 rjsmin 期望输入字符串，需要编解码
-                        minified_content_bytes = rcssmin.cssmin(content_bytes.decode('utf-8')).encode('utf-8')
-                    elif file_ext == '.js':
-                        minified_content_bytes = rjsmin.jsmin(content_bytes.decode('utf-8')).encode('utf-8')
-                    is_minified = True
-                except Exception as e:
-                    print(f"     [警告] 缩小文件 '{os.path.basename(file_path)}' 时出错: {e}. 将使用原始文件进行Gzip压缩。")
-                    minified_content_bytes = None # 出错则回退
-
-            # 如果没有缩小成功，或者该文件类型不需要缩小，则使用原始内容进行Gzip
-            content_to_compress = minified_content_bytes if minified_content_bytes else content_bytes
-            
-            gzipped_file_path = file_path + ".gz"
-            try:
-                # compresslevel=9 提供最高压缩比，但会增加处理时间
-                with gzip.open(gzipped_file_path, "wb", compresslevel=9) as f_out:
-                    f_out.write(content_to_compress)
-                
-                if is_minified:
-                    print(f"     [成功] 已缩小并Gzip压缩至: {os.path.basename(gzipped_file_path)}")
-                else:
-                    print(f"     [成功] 已Gzip压缩至: {os.path.basename(gzipped_file_path)} (未缩小)")
-                
-                # 成功处理并Gzip后，将原始文件路径添加到待删除列表
-                files_to_delete.append(file_path)
-
-            except Exception as e:
-                print(f"     [错误] Gzip压缩文件 '{os.path.basename(file_path)}' 失败: {e}")
+        gzipped_file_path = file_path + ".gz"
+        try:
+            with open(gzipped_file_path, "wb") as f_out:
+                f_out.write(asset["gz"])
+
+            if asset["minified"]:
+                print(f"     [成功] 已缩小并Gzip压缩至: {os.path.basename(gzipped_file_path)}")
+            else:
+                print(f"     [成功] 已Gzip压缩至: {os.path.basename(gzipped_file_path)} (未缩小)")
+
+            # 成功处理并Gzip后，将原始文件路径添加到待删除列表
+            files_to_delete.append(file_path)
+
+        except Exception as e:
+            print(f"     [错误] Gzip压缩文件 '{os.path.basename(file_path)}' 失败: {e}")
 
     # 在所有文件处理完毕后，统一删除原始文件
     for file_to_del in files_to_delete:
@@ -111,5 +291,8 @@ def minify_and_gzip_web_files(source, target, env):
 
     print("[minify_gzip.py] Web资源处理完成。\n")
 
+# 编译固件前生成资源清单（作为pre脚本，每次构建都会执行到这里）
+generate_asset_manifest(env)
+
 # 将函数注册到PlatformIO的buildfs操作之前执行
-env.AddPreAction("buildfs", minify_and_gzip_web_files)
\ No newline at end of file
+env.AddPreAction("buildfs", minify_and_gzip_web_files)
@@ -0,0 +1,147 @@
+/**
+ * @file Sys_AssetCache.cpp
+ * @brief 静态Web资源内存缓存的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 资源清单`Sys_AssetManifest.h`由`minify_gzip.py`在每次构建时生成到构建目录，
+ * 不纳入版本控制。未通过PlatformIO构建（没有生成清单）时使用空清单，所有静态资源请求返回404。
+ */
+#include "Sys_AssetCache.h"
+#include "Sys_Debug.h"
+#include "LittleFS.h"
+#include "esp_heap_caps.h"
+#include "mbedtls/sha256.h"
+
+#if __has_include("Sys_AssetManifest.h")
+#include "Sys_AssetManifest.h"
+#else
+static const AssetManifestEntry* const ASSET_MANIFEST = nullptr;
+static constexpr size_t ASSET_MANIFEST_COUNT = 0;
+#endif
+
+static_assert(ASSET_MANIFEST_COUNT <= Sys_AssetCache::MAX_ASSETS, "Too many web assets; raise Sys_AssetCache::MAX_ASSETS");
+
+/**
+ * @brief 检查内容的SHA-256是否与ETag（哈希的前16个十六进制字符，含双引号）一致。
+ */
+static bool matchesEtag(const uint8_t* data, size_t len, const char* etag) {
+    uint8_t digest[32];
+    if (mbedtls_sha256_ret(data, len, digest, 0) != 0) {
+        return false;
+    }
+    char expected[20];
+    snprintf(expected, sizeof(expected), "\"%02x%02x%02x%02x%02x%02x%02x%02x\"",
+             digest[0], digest[1], digest[2], digest[3], digest[4], digest[5], digest[6], digest[7]);
+    return strcmp(expected, etag) == 0;
+}
+
+// 初始化静态单例指针
+Sys_AssetCache* Sys_AssetCache::_instance = nullptr;
+
+/**
+ * @brief 获取资源缓存的单例实例。
+ */
+Sys_AssetCache* Sys_AssetCache::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new Sys_AssetCache();
+    }
+    return _instance;
+}
+
+/**
+ * @brief 按照资源清单载入资源。
+ */
+size_t Sys_AssetCache::begin() {
+    if (ASSET_MANIFEST_COUNT == 0) {
+        ESP_LOGW("AssetCache", "Firmware was built without an asset manifest; the web UI is unavailable.");
+        return 0;
+    }
+
+    size_t cached = 0;
+    for (size_t i = 0; i < ASSET_MANIFEST_COUNT; ++i) {
+        loadAsset(ASSET_MANIFEST[i]);
+    }
+    for (size_t i = 0; i < _asset_count; ++i) {
+        if (_assets[i].data != nullptr) cached++;
+    }
+    ESP_LOGI("AssetCache", "%u/%u web assets cached (%u KB in PSRAM).", cached, ASSET_MANIFEST_COUNT, _cached_bytes / 1024);
+    return cached;
+}
+
+/**
+ * @brief 检查清单中的一个资源，并在预算允许时把它的Gzip内容读入PSRAM。
+ * @details 只在启动时访问文件系统；LittleFS中缺失的资源不登记，请求时直接返回404。
+ */
+void Sys_AssetCache::loadAsset(const AssetManifestEntry& entry) {
+    const String gz_path = String(entry.path) + ".gz";
+    File file = LittleFS.open(gz_path, "r");
+    if (!file) {
+        ESP_LOGW("AssetCache", "Manifest lists %s, but it is missing from LittleFS.", gz_path.c_str());
+        return;
+    }
+
+    CachedAsset& asset = _assets[_asset_count++];
+    asset.entry = &entry;
+    asset.data = nullptr;
+    asset.matches_manifest = (file.size() == entry.gzip_size);
+    if (!asset.matches_manifest) {
+        // 文件系统镜像与固件来自不同的构建：仍然提供该文件，但不缓存，也不发送ETag
+        ESP_LOGW("AssetCache", "%s does not match the manifest (%u vs %u bytes). Re-upload the filesystem image.",
+                 gz_path.c_str(), file.size(), entry.gzip_size);
+        return;
+    }
+    if (_cached_bytes + entry.gzip_size > MAX_CACHE_BYTES) {
+        ESP_LOGW("AssetCache", "Cache budget exceeded, serving %s from LittleFS.", entry.path);
+        return;
+    }
+
+    uint8_t* data = (uint8_t*)heap_caps_malloc(entry.gzip_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (data == nullptr) {
+        ESP_LOGE("AssetCache", "Out of PSRAM caching %s.", entry.path);
+        return;
+    }
+    if (file.read(data, entry.gzip_size) != entry.gzip_size) {
+        ESP_LOGE("AssetCache", "Failed to read %s.", gz_path.c_str());
+        heap_caps_free(data);
+        return;
+    }
+    if (!matchesEtag(data, entry.gzip_size, entry.etag)) {
+        // 大小相同但内容不同：同样视为与清单不一致
+        ESP_LOGW("AssetCache", "%s does not match the manifest hash. Re-upload the filesystem image.", gz_path.c_str());
+        asset.matches_manifest = false;
+        heap_caps_free(data);
+        return;
+    }
+    asset.data = data;
+    _cached_bytes += entry.gzip_size;
+    DEBUG_LOG("Cached asset %s (%u bytes, ETag %s).", entry.path, entry.gzip_size, entry.etag);
+}
+
+/**
+ * @brief 按请求路径查找资源。
+ * @details 资源数量很少，线性查找即可。
+ */
+const CachedAsset* Sys_AssetCache::find(const String& path, bool& versioned) const {
+    const char* url = path.c_str();
+    const size_t url_len = path.length();
+    const bool is_dir = url_len > 0 && url[url_len - 1] == '/';
+    for (size_t i = 0; i < _asset_count; ++i) {
+        const AssetManifestEntry* entry = _assets[i].entry;
+        if (is_dir) {
+            // "/" -> "/index.html"
+            if (strncmp(entry->path, url, url_len) == 0 && strcmp(entry->path + url_len, "index.html") == 0) {
+                versioned = false;
+                return &_assets[i];
+            }
+        } else if (strcmp(entry->path, url) == 0) {
+            versioned = false;
+            return &_assets[i];
+        } else if (entry->hashed_path != nullptr && strcmp(entry->hashed_path, url) == 0) {
+            versioned = true;
+            return &_assets[i];
+        }
+    }
+    return nullptr;
+}
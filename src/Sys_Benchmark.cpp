@@ -0,0 +1,502 @@
+/**
+ * @file Sys_Benchmark.cpp
+ * @brief 板载基准测试套件的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 所有计时都使用`esp_timer_get_time()`；带宽以MB/s（10^6字节/秒）表示，吞吐量以ops/s表示。
+ * 多任务测试的计时从同时放行所有任务开始，到最后一个任务完成为止。
+ * 通过`#if SYS_BENCH_MODE`宏，确保本文件所有代码只在基准测试固件中被编译。
+ */
+#include "Sys_Benchmark.h"
+
+#if SYS_BENCH_MODE
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "FFat.h"
+#include "LittleFS.h"
+#include "ArduinoJson.h"
+#include "Sys_MemoryManager.h"
+#include "Sys_Filesystem.h"
+
+static const char* TAG = "Benchmark";
+
+/** @brief `runTasks()`创建的任务共享的放行/完成信号。*/
+struct BenchTaskContext {
+    void (*op)(void* arg);
+    void* arg;
+    EventGroupHandle_t start;
+    SemaphoreHandle_t done;
+};
+
+static constexpr EventBits_t BIT_BENCH_START = (1 << 0);
+
+// --- 主入口函数 ---
+
+/**
+ * @brief 依次运行所有基准测试。
+ */
+void Sys_Benchmark::run(const char* firmware_version) {
+    ESP_LOGI(TAG, "Running benchmark suite, results are printed as 'BENCH {json}' lines.");
+
+    JsonDocument meta;
+    meta["suite"] = "meta";
+    meta["firmware"] = firmware_version;
+    meta["idf"] = esp_get_idf_version();
+    meta["cpu_mhz"] = getCpuFrequencyMhz();
+    meta["psram_bytes"] = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    Serial.print("BENCH ");
+    serializeJson(meta, Serial);
+    Serial.println();
+
+    benchMemcpy();
+    benchMemoryPool();
+    Sys_Filesystem* filesystem = Sys_Filesystem::getInstance();
+    if (filesystem->isFFatMounted()) {
+        benchFilesystem("ffat", FFat, 1024 * 1024);
+    } else {
+        ESP_LOGW(TAG, "FFat not mounted, filesystem benchmark skipped.");
+    }
+    if (filesystem->isLittleFSMounted()) {
+        benchFilesystem("littlefs", LittleFS, 256 * 1024);
+    } else {
+        ESP_LOGW(TAG, "LittleFS not mounted, filesystem benchmark skipped.");
+    }
+    benchMessaging();
+    benchJson();
+
+    Serial.println("BENCH {\"suite\":\"done\"}");
+    ESP_LOGI(TAG, "Benchmark suite complete.");
+}
+
+// --- 私有辅助函数 ---
+
+/**
+ * @brief 输出一行结果。
+ */
+void Sys_Benchmark::report(const char* suite, const char* name, double value, const char* unit) {
+    JsonDocument doc;
+    doc["suite"] = suite;
+    doc["name"] = name;
+    doc["value"] = serialized(String(value, 3));
+    doc["unit"] = unit;
+    Serial.print("BENCH ");
+    serializeJson(doc, Serial);
+    Serial.println();
+}
+
+/**
+ * @brief 任务入口：等待放行，执行测试函数，发出完成信号后自我删除。
+ */
+void Sys_Benchmark::benchTaskEntry(void* parameter) {
+    BenchTaskContext* context = (BenchTaskContext*)parameter;
+    xEventGroupWaitBits(context->start, BIT_BENCH_START, pdFALSE, pdTRUE, portMAX_DELAY);
+    context->op(context->arg);
+    xSemaphoreGive(context->done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 创建任务、同时放行并等待全部完成。
+ */
+int64_t Sys_Benchmark::runTasks(const BenchTask* tasks, uint8_t count) {
+    static constexpr uint8_t MAX_TASKS = 2;
+    if (count == 0 || count > MAX_TASKS) {
+        return -1;
+    }
+    EventGroupHandle_t start = xEventGroupCreate();
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(count, 0);
+    BenchTaskContext contexts[MAX_TASKS];
+    TaskHandle_t handles[MAX_TASKS] = {};
+    uint8_t created = 0;
+    if (start != NULL && done != NULL) {
+        for (; created < count; ++created) {
+            contexts[created] = {tasks[created].op, tasks[created].arg, start, done};
+            // 优先级高于Arduino的loopTask，测试期间不会被主循环打断
+            if (xTaskCreatePinnedToCore(benchTaskEntry, "Task_Bench", 4096, &contexts[created], 2, &handles[created], tasks[created].core) != pdPASS) {
+                ESP_LOGE(TAG, "Failed to create benchmark task %u.", created);
+                break;
+            }
+        }
+    }
+
+    int64_t elapsed_us = -1;
+    if (created == count) {
+        const int64_t start_us = esp_timer_get_time();
+        xEventGroupSetBits(start, BIT_BENCH_START);
+        for (uint8_t i = 0; i < created; ++i) {
+            xSemaphoreTake(done, portMAX_DELAY);
+        }
+        elapsed_us = esp_timer_get_time() - start_us;
+    } else {
+        // 不放行：例如只有生产者时，它会在写满通道后永久阻塞。已创建的任务仍停在放行位上，直接删除
+        for (uint8_t i = 0; i < created; ++i) {
+            vTaskDelete(handles[i]);
+        }
+        ESP_LOGE(TAG, "Benchmark run aborted: only %u of %u tasks created.", created, count);
+    }
+
+    if (start != NULL) vEventGroupDelete(start);
+    if (done != NULL) vSemaphoreDelete(done);
+    return elapsed_us;
+}
+
+// --- 1. memcpy 带宽 ---
+
+/**
+ * @brief SRAM/PSRAM之间四种组合的拷贝带宽。
+ * @details 缓冲区大小为32KB（内部SRAM可以容纳，且远大于PSRAM的Cache），每种组合总共拷贝4MB。
+ */
+void Sys_Benchmark::benchMemcpy() {
+    static constexpr size_t BUFFER_SIZE = 32 * 1024;
+    static constexpr size_t TOTAL_BYTES = 4 * 1024 * 1024;
+
+    uint8_t* sram_a = (uint8_t*)heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t* sram_b = (uint8_t*)heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t* psram_a = (uint8_t*)heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t* psram_b = (uint8_t*)heap_caps_malloc(BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!sram_a || !sram_b || !psram_a || !psram_b) {
+        ESP_LOGE(TAG, "memcpy benchmark: allocation failed.");
+    } else {
+        struct Case {
+            const char* name;
+            uint8_t* dst;
+            const uint8_t* src;
+        };
+        const Case cases[] = {
+            {"sram_to_sram", sram_b, sram_a},
+            {"psram_to_psram", psram_b, psram_a},
+            {"sram_to_psram", psram_a, sram_a},
+            {"psram_to_sram", sram_a, psram_a},
+        };
+        memset(sram_a, 0xA5, BUFFER_SIZE);
+        memset(psram_a, 0x5A, BUFFER_SIZE);
+        for (const Case& c : cases) {
+            const int64_t start_us = esp_timer_get_time();
+            for (size_t copied = 0; copied < TOTAL_BYTES; copied += BUFFER_SIZE) {
+                memcpy(c.dst, c.src, BUFFER_SIZE);
+            }
+            const int64_t elapsed_us = esp_timer_get_time() - start_us;
+            report("memcpy", c.name, (double)TOTAL_BYTES / elapsed_us, "MB/s");
+        }
+    }
+    heap_caps_free(sram_a);
+    heap_caps_free(sram_b);
+    heap_caps_free(psram_a);
+    heap_caps_free(psram_b);
+}
+
+// --- 2. 内存池分配/释放吞吐量 ---
+
+/** @brief 每个任务执行的分配/释放对数。*/
+static constexpr uint32_t POOL_ITERATIONS = 20000;
+/** @brief 每一轮连续持有的块数（模拟请求对象的并发生命周期）。*/
+static constexpr uint8_t POOL_BATCH = 8;
+
+static void poolOp(void* arg) {
+    const size_t size = (size_t)(uintptr_t)arg;
+    Sys_MemoryManager* memory = Sys_MemoryManager::getInstance();
+    void* blocks[POOL_BATCH];
+    for (uint32_t i = 0; i < POOL_ITERATIONS; i += POOL_BATCH) {
+        for (uint8_t j = 0; j < POOL_BATCH; ++j) blocks[j] = memory->allocate(size);
+        for (uint8_t j = 0; j < POOL_BATCH; ++j) memory->release(blocks[j]);
+    }
+}
+
+static void heapOp(void* arg) {
+    const size_t size = (size_t)(uintptr_t)arg;
+    void* blocks[POOL_BATCH];
+    for (uint32_t i = 0; i < POOL_ITERATIONS; i += POOL_BATCH) {
+        for (uint8_t j = 0; j < POOL_BATCH; ++j) blocks[j] = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        for (uint8_t j = 0; j < POOL_BATCH; ++j) heap_caps_free(blocks[j]);
+    }
+}
+
+/**
+ * @brief `Sys_MemoryManager`与PSRAM堆的分配/释放吞吐量，1个任务以及2个任务（每核一个）同时运行。
+ */
+void Sys_Benchmark::benchMemoryPool() {
+    static constexpr size_t ALLOC_SIZE = 256; // 512B级别，与RPC请求对象相同
+    struct Case {
+        const char* name;
+        void (*op)(void*);
+    };
+    const Case cases[] = {{"pool", poolOp}, {"heap_psram", heapOp}};
+    char name[48];
+    for (const Case& c : cases) {
+        for (uint8_t cores = 1; cores <= 2; ++cores) {
+            const BenchTask tasks[2] = {
+                {c.op, (void*)(uintptr_t)ALLOC_SIZE, 1},
+                {c.op, (void*)(uintptr_t)ALLOC_SIZE, 0},
+            };
+            const int64_t elapsed_us = runTasks(tasks, cores);
+            if (elapsed_us <= 0) continue;
+            snprintf(name, sizeof(name), "%s.alloc_free.%ucore", c.name, cores);
+            report("mempool", name, (double)POOL_ITERATIONS * cores * 1000000.0 / elapsed_us, "ops/s");
+        }
+    }
+}
+
+// --- 3. 文件系统读写带宽 ---
+
+/**
+ * @brief 顺序写/读、随机读/写的带宽，块大小分别为512B、4KB和32KB。
+ * @details 顺序写的计时包含`close()`（提交FAT/元数据）；随机操作的偏移按块对齐，总量与文件大小相同。
+ */
+void Sys_Benchmark::benchFilesystem(const char* fs_name, fs::FS& fs, size_t file_size) {
+    static constexpr size_t CHUNK_SIZES[] = {512, 4096, 32768};
+    static const char* PATH = "/bench.bin";
+    char name[48];
+
+    for (size_t chunk : CHUNK_SIZES) {
+        uint8_t* buffer = (uint8_t*)heap_caps_malloc(chunk, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (buffer == nullptr) {
+            ESP_LOGE(TAG, "fs benchmark: no memory for a %u byte chunk.", chunk);
+            continue;
+        }
+        for (size_t i = 0; i < chunk; ++i) buffer[i] = (uint8_t)i;
+        const size_t chunk_count = file_size / chunk;
+        bool ok = true;
+
+        // 顺序写
+        int64_t start_us = esp_timer_get_time();
+        File file = fs.open(PATH, FILE_WRITE);
+        ok = (bool)file;
+        for (size_t i = 0; ok && i < chunk_count; ++i) {
+            ok = file.write(buffer, chunk) == chunk;
+        }
+        if (file) file.close();
+        int64_t elapsed_us = esp_timer_get_time() - start_us;
+        if (ok) {
+            snprintf(name, sizeof(name), "%s.seq_write.%u", fs_name, chunk);
+            report("fs", name, (double)file_size / elapsed_us, "MB/s");
+        }
+
+        // 顺序读
+        if (ok) {
+            start_us = esp_timer_get_time();
+            file = fs.open(PATH, FILE_READ);
+            ok = (bool)file;
+            for (size_t i = 0; ok && i < chunk_count; ++i) {
+                ok = file.read(buffer, chunk) == chunk;
+            }
+            if (file) file.close();
+            elapsed_us = esp_timer_get_time() - start_us;
+            if (ok) {
+                snprintf(name, sizeof(name), "%s.seq_read.%u", fs_name, chunk);
+                report("fs", name, (double)file_size / elapsed_us, "MB/s");
+            }
+        }
+
+        // 随机读
+        if (ok) {
+            start_us = esp_timer_get_time();
+            file = fs.open(PATH, FILE_READ);
+            ok = (bool)file;
+            for (size_t i = 0; ok && i < chunk_count; ++i) {
+                ok = file.seek((esp_random() % chunk_count) * chunk) && file.read(buffer, chunk) == chunk;
+            }
+            if (file) file.close();
+            elapsed_us = esp_timer_get_time() - start_us;
+            if (ok) {
+                snprintf(name, sizeof(name), "%s.rand_read.%u", fs_name, chunk);
+                report("fs", name, (double)file_size / elapsed_us, "MB/s");
+            }
+        }
+
+        // 随机写（原地覆盖）
+        if (ok) {
+            start_us = esp_timer_get_time();
+            file = fs.open(PATH, "r+");
+            ok = (bool)file;
+            for (size_t i = 0; ok && i < chunk_count; ++i) {
+                ok = file.seek((esp_random() % chunk_count) * chunk) && file.write(buffer, chunk) == chunk;
+            }
+            if (file) file.close();
+            elapsed_us = esp_timer_get_time() - start_us;
+            if (ok) {
+                snprintf(name, sizeof(name), "%s.rand_write.%u", fs_name, chunk);
+                report("fs", name, (double)file_size / elapsed_us, "MB/s");
+            }
+        }
+
+        if (!ok) {
+            ESP_LOGE(TAG, "fs benchmark on %s failed with %u byte chunks.", fs_name, chunk);
+        }
+        fs.remove(PATH);
+        heap_caps_free(buffer);
+    }
+}
+
+// --- 4. 队列与环形缓冲区的消息吞吐量 ---
+
+/** @brief 每次测试传递的消息数。*/
+static constexpr uint32_t MESSAGE_COUNT = 5000;
+/** @brief 通道容量（消息数）。*/
+static constexpr uint32_t CHANNEL_DEPTH = 16;
+
+/** @brief 一对生产者/消费者共用的通道描述。*/
+struct MessageChannel {
+    QueueHandle_t queue;
+    RingbufHandle_t ringbuf;
+    size_t message_size;
+};
+
+static void producerOp(void* arg) {
+    MessageChannel* channel = (MessageChannel*)arg;
+    uint8_t message[256];
+    memset(message, 0x3C, sizeof(message));
+    for (uint32_t i = 0; i < MESSAGE_COUNT; ++i) {
+        message[0] = (uint8_t)i;
+        if (channel->queue != NULL) {
+            xQueueSend(channel->queue, message, portMAX_DELAY);
+        } else {
+            xRingbufferSend(channel->ringbuf, message, channel->message_size, portMAX_DELAY);
+        }
+    }
+}
+
+static void consumerOp(void* arg) {
+    MessageChannel* channel = (MessageChannel*)arg;
+    uint8_t message[256];
+    for (uint32_t i = 0; i < MESSAGE_COUNT; ++i) {
+        if (channel->queue != NULL) {
+            xQueueReceive(channel->queue, message, portMAX_DELAY);
+        } else {
+            size_t size = 0;
+            void* item = xRingbufferReceive(channel->ringbuf, &size, portMAX_DELAY);
+            if (item != NULL) vRingbufferReturnItem(channel->ringbuf, item);
+        }
+    }
+}
+
+/**
+ * @brief 队列与环形缓冲区（NOSPLIT，与`xStateRingbuf`相同）在同核/跨核下的消息吞吐量。
+ */
+void Sys_Benchmark::benchMessaging() {
+    static constexpr size_t MESSAGE_SIZES[] = {32, 256};
+    char name[48];
+    for (size_t size : MESSAGE_SIZES) {
+        for (uint8_t kind = 0; kind < 2; ++kind) {
+            for (uint8_t cross_core = 0; cross_core < 2; ++cross_core) {
+                MessageChannel channel = {NULL, NULL, size};
+                if (kind == 0) {
+                    channel.queue = xQueueCreate(CHANNEL_DEPTH, size);
+                } else {
+                    // 每个条目另有8字节头部，并按4字节对齐
+                    channel.ringbuf = xRingbufferCreate(CHANNEL_DEPTH * (size + 8), RINGBUF_TYPE_NOSPLIT);
+                }
+                if (channel.queue == NULL && channel.ringbuf == NULL) {
+                    ESP_LOGE(TAG, "msg benchmark: failed to create the channel.");
+                    continue;
+                }
+                const BenchTask tasks[2] = {
+                    {producerOp, &channel, cross_core ? 0 : 1},
+                    {consumerOp, &channel, 1},
+                };
+                const int64_t elapsed_us = runTasks(tasks, 2);
+                if (elapsed_us > 0) {
+                    snprintf(name, sizeof(name), "%s.%u.%s", kind == 0 ? "queue" : "ringbuf", size, cross_core ? "cross_core" : "same_core");
+                    report("msg", name, (double)MESSAGE_COUNT * 1000000.0 / elapsed_us, "msgs/s");
+                }
+                if (channel.queue != NULL) vQueueDelete(channel.queue);
+                if (channel.ringbuf != NULL) vRingbufferDelete(channel.ringbuf);
+            }
+        }
+    }
+}
+
+// --- 5. ArduinoJson 序列化/反序列化 ---
+
+/**
+ * @brief 以项目实际的RPC消息测量JSON与MessagePack两种编码的解析和序列化耗时。
+ * @details 文档使用与生产路径相同的PSRAM分配器。
+ */
+void Sys_Benchmark::benchJson() {
+    static constexpr int ITERATIONS = 500;
+    static const char* RPC_REQUEST =
+        "{\"jsonrpc\":\"2.0\",\"method\":\"settings.saveWiFi\","
+        "\"params\":{\"ssid\":\"MyHomeNetwork\",\"password\":\"correct horse battery staple\"},\"id\":42}";
+
+    // 构造三类代表性消息：RPC请求、状态响应、日志批次
+    JsonDocument request(Sys_PsramJsonAllocator::instance());
+    deserializeJson(request, RPC_REQUEST);
+
+    JsonDocument status(Sys_PsramJsonAllocator::instance());
+    status["jsonrpc"] = "2.0";
+    status["id"] = 42;
+    JsonObject result = status["result"].to<JsonObject>();
+    result["uptime_ms"] = 61234567;
+    result["free_heap"] = 183420;
+    result["free_psram"] = 7321456;
+    JsonObject wifi = result["wifi"].to<JsonObject>();
+    wifi["mode"] = "STA";
+    wifi["ssid"] = "MyHomeNetwork";
+    wifi["ip"] = "192.168.1.57";
+    wifi["rssi"] = -61;
+    JsonObject storage = result["storage"].to<JsonObject>();
+    storage["ffat_total"] = 2031616;
+    storage["ffat_used"] = 524288;
+    storage["littlefs_total"] = 954368;
+    storage["littlefs_used"] = 327680;
+
+    JsonDocument log_batch(Sys_PsramJsonAllocator::instance());
+    log_batch["jsonrpc"] = "2.0";
+    log_batch["method"] = "log.batch";
+    JsonArray params = log_batch["params"].to<JsonArray>();
+    for (int i = 0; i < 20; ++i) {
+        JsonObject entry = params.add<JsonObject>();
+        entry["msg"] = "[WiFiManager] Connection attempt finished, RSSI -61 dBm, channel 6, ip 192.168.1.57";
+    }
+
+    struct Case {
+        const char* name;
+        JsonDocument* doc;
+    };
+    const Case cases[] = {{"rpc_request", &request}, {"status_response", &status}, {"log_batch", &log_batch}};
+
+    const size_t capacity = 4096;
+    char* encoded = (char*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (encoded == nullptr) {
+        ESP_LOGE(TAG, "json benchmark: allocation failed.");
+        return;
+    }
+    char name[48];
+    JsonDocument parsed(Sys_PsramJsonAllocator::instance());
+    for (const Case& c : cases) {
+        for (uint8_t msgpack = 0; msgpack < 2; ++msgpack) {
+            const char* format = msgpack ? "msgpack" : "json";
+
+            size_t length = 0;
+            int64_t start_us = esp_timer_get_time();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                length = msgpack ? serializeMsgPack(*c.doc, encoded, capacity) : serializeJson(*c.doc, encoded, capacity);
+            }
+            int64_t elapsed_us = esp_timer_get_time() - start_us;
+            snprintf(name, sizeof(name), "%s.%s.serialize", c.name, format);
+            report("json", name, (double)elapsed_us / ITERATIONS, "us/op");
+            snprintf(name, sizeof(name), "%s.%s.bytes", c.name, format);
+            report("json", name, (double)length, "bytes");
+
+            start_us = esp_timer_get_time();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                msgpack ? deserializeMsgPack(parsed, encoded, length) : deserializeJson(parsed, encoded, length);
+            }
+            elapsed_us = esp_timer_get_time() - start_us;
+            snprintf(name, sizeof(name), "%s.%s.deserialize", c.name, format);
+            report("json", name, (double)elapsed_us / ITERATIONS, "us/op");
+        }
+    }
+    heap_caps_free(encoded);
+}
+
+#endif // SYS_BENCH_MODE
@@ -63,37 +63,41 @@ void Sys_BlueToothManager::begin() {
 
     _currentState = BlueToothState::BT_DISABLED; // 初始状态为已初始化但禁用
 
-    // 步骤5: 初始化完成后，立即应用一次当前的系统配置
+    // 步骤5: 初始化完成后，立即应用一次当前的系统配置，并订阅之后的蓝牙配置变更
     applySettings();
-}
-
-/**
- * @brief 周期性更新函数。
- */
-void Sys_BlueToothManager::update() {
-    // NimBLE是事件驱动的，此函数暂时为空。
+    Sys_SettingsManager::getInstance()->addChangeListener(Sys_SettingsManager::BLUETOOTH_FIELDS, onSettingsChanged);
 }
 
 /**
  * @brief 应用最新的系统设置。
  */
-void Sys_BlueToothManager::applySettings() {
-    DEBUG_LOG("Applying new BLE settings...");
-    const auto& settings = Sys_SettingsManager::getInstance()->getSettings();
-    
-    bool shouldBeEnabled = settings.bluetooth_enabled;
-    bool isAdvertising = (_currentState == BlueToothState::ADVERTISING);
+void Sys_BlueToothManager::applySettings(uint32_t changed_fields) {
+    DEBUG_LOG("Applying new BLE settings (changed fields 0x%03X)...", changed_fields);
+    const auto settings = Sys_SettingsManager::getInstance()->getSettings();
 
     // 更新设备名称
-    setDeviceName(settings.bluetooth_name);
+    if (changed_fields & (1u << Sys_SettingsManager::FIELD_BLUETOOTH_NAME)) {
+        setDeviceName(settings->bluetooth_name);
+    }
 
-    if (shouldBeEnabled && !isAdvertising) {
-        startAdvertising();
-    } else if (!shouldBeEnabled && isAdvertising) {
-        stopAdvertising();
+    if (changed_fields & (1u << Sys_SettingsManager::FIELD_BLUETOOTH_ENABLED)) {
+        bool shouldBeEnabled = settings->bluetooth_enabled;
+        bool isAdvertising = (_currentState == BlueToothState::ADVERTISING);
+        if (shouldBeEnabled && !isAdvertising) {
+            startAdvertising();
+        } else if (!shouldBeEnabled && isAdvertising) {
+            stopAdvertising();
+        }
     }
 }
 
+/**
+ * @brief 配置变更回调。
+ */
+void Sys_BlueToothManager::onSettingsChanged(uint32_t changed_fields) {
+    getInstance()->applySettings(changed_fields);
+}
+
 /**
  * @brief 获取当前状态。
  */
@@ -121,8 +125,7 @@ void Sys_BlueToothManager::onDisconnect(NimBLEServer* pServer) {
     // [日志] 记录客户端断开连接事件
     Sys_FlashLogger::getInstance()->log("[Bluetooth]", "Client disconnected.");
     // 断开连接后，根据配置决定是返回禁用状态还是重新开始广播
-    const auto& settings = Sys_SettingsManager::getInstance()->getSettings();
-    if (settings.bluetooth_enabled) {
+    if (Sys_SettingsManager::getInstance()->getSettings()->bluetooth_enabled) {
         // 延迟一小段时间后重新广播，给客户端一些时间来处理断开
         vTaskDelay(pdMS_TO_TICKS(100));
         startAdvertising();
@@ -0,0 +1,171 @@
+/**
+ * @file Sys_Boot.cpp
+ * @brief 分阶段启动器的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 两个执行者按表的顺序扫描，领取第一个依赖已全部完成的阶段；没有可领取的阶段时，
+ * 阻塞在完成事件组上，等待任意一个尚未完成的阶段完成。完成位只置位不清除，因此不会错过唤醒。
+ */
+#include "Sys_Boot.h"
+#include "Sys_Debug.h"
+#include "Sys_LockGuard.h"
+#include "Sys_StateRegistry.h"
+#include "esp_timer.h"
+
+// --- 静态成员初始化 ---
+const Sys_Boot::Stage* Sys_Boot::_stages = nullptr;
+size_t Sys_Boot::_count = 0;
+uint32_t Sys_Boot::_all_mask = 0;
+uint32_t Sys_Boot::_claimed_mask = 0;
+EventGroupHandle_t Sys_Boot::_done_group = NULL;
+SemaphoreHandle_t Sys_Boot::_claim_mutex = NULL;
+SemaphoreHandle_t Sys_Boot::_helper_exit = NULL;
+Sys_Boot::StageResult Sys_Boot::_results[Sys_Boot::MAX_STAGES] = {};
+char Sys_Boot::_field_names[Sys_Boot::MAX_STAGES][Sys_Boot::MAX_NAME_LENGTH + 9] = {};
+
+/**
+ * @brief 执行阶段表。
+ */
+bool Sys_Boot::run(const Stage* stages, size_t count) {
+    if (count > MAX_STAGES) {
+        ESP_LOGE("Boot", "Too many boot stages (%u), only the first %u run.", count, MAX_STAGES);
+        count = MAX_STAGES;
+    }
+    _stages = stages;
+    _count = count;
+    _all_mask = (1u << count) - 1;
+    _claimed_mask = 0;
+
+    _done_group = xEventGroupCreate();
+    _claim_mutex = xSemaphoreCreateMutex();
+    _helper_exit = xSemaphoreCreateBinary();
+    if (!_done_group || !_claim_mutex || !_helper_exit) {
+        // 退化为按表的顺序串行执行
+        ESP_LOGE("Boot", "Failed to create boot synchronization handles, stages run sequentially.");
+        if (_done_group) vEventGroupDelete(_done_group);
+        if (_claim_mutex) vSemaphoreDelete(_claim_mutex);
+        if (_helper_exit) vSemaphoreDelete(_helper_exit);
+        _done_group = NULL;
+        _claim_mutex = NULL;
+        _helper_exit = NULL;
+        for (size_t i = 0; i < count; ++i) {
+            runStage(i);
+        }
+    } else {
+        // 启动辅助执行者；创建失败时所有阶段由当前任务执行
+        const bool helper_started = xTaskCreatePinnedToCore(helperTask, HELPER_TASK_NAME, HELPER_STACK_SIZE, NULL,
+                                                            HELPER_PRIORITY, NULL, HELPER_CORE) == pdPASS;
+        if (!helper_started) {
+            ESP_LOGW("Boot", "Boot helper task unavailable, stages run sequentially.");
+        }
+
+        workerLoop();
+        xEventGroupWaitBits(_done_group, _all_mask, pdFALSE, pdTRUE, portMAX_DELAY);
+        if (helper_started) {
+            xSemaphoreTake(_helper_exit, portMAX_DELAY);
+        }
+
+        vEventGroupDelete(_done_group);
+        vSemaphoreDelete(_claim_mutex);
+        vSemaphoreDelete(_helper_exit);
+        _done_group = NULL;
+        _claim_mutex = NULL;
+        _helper_exit = NULL;
+    }
+
+    bool all_ok = true;
+    for (size_t i = 0; i < count; ++i) {
+        all_ok &= _results[i].ok;
+    }
+    return all_ok;
+}
+
+/**
+ * @brief 注册并发布启动耗时的状态字段。
+ */
+void Sys_Boot::publishTiming() {
+    Sys_StateRegistry* registry = Sys_StateRegistry::getInstance();
+    const uint32_t total_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    registry->publishUInt(registry->registerField("boot_ms", StateFieldType::UINT), total_ms);
+
+    for (size_t i = 0; i < _count; ++i) {
+        snprintf(_field_names[i], sizeof(_field_names[i]), "boot_%s_ms", _stages[i].name);
+        registry->publishUInt(registry->registerField(_field_names[i], StateFieldType::UINT), _results[i].duration_us / 1000);
+    }
+    ESP_LOGI("Boot", "Boot completed in %u ms.", total_ms);
+}
+
+// --- 私有辅助函数 ---
+
+/**
+ * @brief 执行者循环。
+ */
+void Sys_Boot::workerLoop() {
+    for (;;) {
+        const uint32_t done = (uint32_t)xEventGroupGetBits(_done_group);
+        int next = -1;
+        bool all_claimed;
+        {
+            Sys_LockGuard lock(_claim_mutex);
+            for (size_t i = 0; i < _count; ++i) {
+                const uint32_t bit = 1u << i;
+                // 只认可指向前面阶段的依赖，指向自身或后面阶段的依赖位被忽略，图中因此不会有环
+                const uint32_t depends_on = _stages[i].depends_on & (bit - 1);
+                if ((_claimed_mask & bit) == 0 && (depends_on & ~done) == 0) {
+                    _claimed_mask |= bit;
+                    next = (int)i;
+                    break;
+                }
+            }
+            all_claimed = (_claimed_mask == _all_mask);
+        }
+
+        if (next >= 0) {
+            runStage((size_t)next);
+        } else if (all_claimed) {
+            return;
+        } else {
+            // 等待任意一个尚未完成的阶段完成；期间已完成的位会让等待立即返回
+            xEventGroupWaitBits(_done_group, _all_mask & ~done, pdFALSE, pdFALSE, portMAX_DELAY);
+        }
+    }
+}
+
+/**
+ * @brief 辅助执行者任务。
+ */
+void Sys_Boot::helperTask(void* parameter) {
+    workerLoop();
+    xSemaphoreGive(_helper_exit);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 执行一个阶段并记录结果。
+ */
+void Sys_Boot::runStage(size_t index) {
+    const Stage& stage = _stages[index];
+    if (stage.depends_on & ~((1u << index) - 1)) {
+        ESP_LOGE("Boot", "Stage '%s' depends on itself or a later stage, those dependencies are ignored.", stage.name);
+    }
+    DEBUG_LOG("Stage '%s' starting on core %d...", stage.name, xPortGetCoreID());
+
+    StageResult& result = _results[index];
+    const int64_t start_us = esp_timer_get_time();
+    result.ok = (stage.init == nullptr) || stage.init();
+    result.duration_us = (uint32_t)(esp_timer_get_time() - start_us);
+    result.start_us = (uint32_t)start_us;
+    result.core = (int8_t)xPortGetCoreID();
+
+    if (result.ok) {
+        ESP_LOGI("Boot", "[%u/%u] %s: %u ms on core %d (+%u ms).", index + 1, _count, stage.name,
+                 result.duration_us / 1000, result.core, result.start_us / 1000);
+    } else {
+        ESP_LOGE("Boot", "[%u/%u] %s FAILED after %u ms.", index + 1, _count, stage.name, result.duration_us / 1000);
+    }
+    if (_done_group != NULL) {
+        xEventGroupSetBits(_done_group, 1u << index);
+    }
+}
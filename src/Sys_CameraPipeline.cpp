@@ -0,0 +1,309 @@
+/**
+ * @file Sys_CameraPipeline.cpp
+ * @brief Core 0 摄像头帧处理管线的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 帧的所有权流转（括号内为引用持有者）：
+ * 1. 采集级从空闲位图取得槽位（采集级），写入JPEG后发布为最新帧（+最新帧），再放入解码通道（转移给通道）；
+ * 2. 解码级取出帧（解码级），解码成功后放入分析通道（转移给通道），否则直接释放；
+ * 3. 分析级取出帧（分析级），分析完成后释放。
+ * 被通道顶替或被采集级收回的帧计入`dropped`。
+ */
+#include "Sys_CameraPipeline.h"
+#include "Sys_Debug.h"
+#include "Sys_MemoryManager.h"
+
+// 初始化静态单例指针
+Sys_CameraPipeline* Sys_CameraPipeline::_instance = nullptr;
+
+static_assert(Sys_CameraPipeline::MAX_FRAMES <= 32, "Free-slot bitmap is a single 32-bit word");
+static_assert(Sys_CameraPipeline::GRAY_CAPACITY >= 640 * 480, "Frame slot must hold a VGA grayscale plane");
+
+/**
+ * @brief 获取摄像头管线的单例实例。
+ */
+Sys_CameraPipeline* Sys_CameraPipeline::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new Sys_CameraPipeline();
+    }
+    return _instance;
+}
+
+/**
+ * @brief 取得帧缓冲块、切分帧槽位并启动处理任务。
+ */
+bool Sys_CameraPipeline::begin() {
+    // 步骤1：从内存池的帧缓冲级别取得块，每块切分为多个帧槽位
+    for (size_t block = 0; block < FRAME_BLOCKS; ++block) {
+        uint8_t* base = static_cast<uint8_t*>(Sys_MemoryManager::getInstance()->getFrameBuffer());
+        if (base == nullptr) {
+            break;
+        }
+        for (size_t i = 0; i < FRAMES_PER_BLOCK; ++i) {
+            CameraFrame& frame = _frames[_frame_count];
+            frame.jpeg = base + i * FRAME_SLOT_SIZE;
+            frame.gray = frame.jpeg + JPEG_CAPACITY;
+            _free_mask.fetch_or(1u << _frame_count);
+            _frame_count++;
+        }
+    }
+    // 至少需要两个槽位：一个正在采集，一个在下游处理或推流
+    if (_frame_count < 2) {
+        ESP_LOGE("Camera", "Not enough frame buffers for the camera pipeline (%u slots).", _frame_count);
+        return false;
+    }
+
+    // 步骤2：创建Core 0上的处理任务，并把消费者任务绑定到各自的输入通道
+    TaskHandle_t decode_handle = NULL;
+    TaskHandle_t analyze_handle = NULL;
+    if (xTaskCreatePinnedToCore(decodeTask, DECODE_TASK_NAME, DECODE_TASK_STACK_SIZE, this, DECODE_TASK_PRIORITY, &decode_handle, TASK_CORE) != pdPASS ||
+        xTaskCreatePinnedToCore(analyzeTask, ANALYZE_TASK_NAME, ANALYZE_TASK_STACK_SIZE, this, ANALYZE_TASK_PRIORITY, &analyze_handle, TASK_CORE) != pdPASS) {
+        ESP_LOGE("Camera", "Failed to create camera pipeline tasks!");
+        return false;
+    }
+    _decode_channel.setConsumer(decode_handle);
+    _analyze_channel.setConsumer(analyze_handle);
+    if (xTaskCreatePinnedToCore(captureTask, CAPTURE_TASK_NAME, CAPTURE_TASK_STACK_SIZE, this, CAPTURE_TASK_PRIORITY, &_capture_task, TASK_CORE) != pdPASS) {
+        ESP_LOGE("Camera", "Failed to create camera capture task!");
+        return false;
+    }
+
+    ESP_LOGI("Camera", "Camera pipeline ready: %u frame slots of %u KB on Core %d.", _frame_count, FRAME_SLOT_SIZE / 1024, TASK_CORE);
+    return true;
+}
+
+/**
+ * @brief 设置采集回调，并唤醒可能正在等待采集源的采集任务。
+ */
+void Sys_CameraPipeline::setSource(CaptureFn fn) {
+    _capture_fn.store(fn);
+    if (fn != nullptr && _capture_task != NULL) {
+        xTaskNotifyGive(_capture_task);
+    }
+}
+
+void Sys_CameraPipeline::setDecoder(DecodeFn fn) {
+    _decode_fn.store(fn);
+}
+
+void Sys_CameraPipeline::setAnalyzer(AnalyzeFn fn) {
+    _analyze_fn.store(fn);
+}
+
+/**
+ * @brief 取得最新帧并增加一个引用。
+ * @details `_latest`自身持有一个引用，因此在临界区内读取并加引用时，该帧不可能被回收。
+ */
+CameraFrame* Sys_CameraPipeline::acquireLatestFrame(uint32_t after_seq) {
+    portENTER_CRITICAL(&_latest_mux);
+    CameraFrame* frame = _latest;
+    if (frame != nullptr && frame->seq > after_seq) {
+        frame->refs.fetch_add(1);
+    } else {
+        frame = nullptr;
+    }
+    portEXIT_CRITICAL(&_latest_mux);
+    return frame;
+}
+
+/**
+ * @brief 释放一个引用。
+ */
+void Sys_CameraPipeline::releaseFrame(CameraFrame* frame) {
+    if (frame == nullptr) {
+        return;
+    }
+    const uint8_t previous = frame->refs.fetch_sub(1);
+    if (previous == 1) {
+        _free_mask.fetch_or(1u << (frame - _frames));
+    } else if (previous == 0) {
+        ESP_LOGE("Camera", "Frame #%u released more times than it was acquired!", frame->seq);
+    }
+}
+
+/**
+ * @brief 获取统计快照。
+ */
+void Sys_CameraPipeline::getStats(CameraPipelineStats& out_stats) const {
+    out_stats.captured = _captured.load();
+    out_stats.dropped = _dropped.load();
+    out_stats.decoded = _decoded.load();
+    out_stats.analyzed = _analyzed.load();
+    out_stats.frame_slots = static_cast<uint8_t>(_frame_count);
+    out_stats.frames_in_use = static_cast<uint8_t>(_frame_count - __builtin_popcount(_free_mask.load()));
+}
+
+// =================================================================================================
+// 帧通道
+// =================================================================================================
+
+/**
+ * @brief 放入一帧并唤醒消费者，返回被顶替的旧帧。
+ */
+CameraFrame* Sys_CameraPipeline::FrameChannel::put(CameraFrame* frame) {
+    CameraFrame* displaced = _slot.exchange(frame);
+    if (_consumer != NULL) {
+        xTaskNotifyGive(_consumer);
+    }
+    return displaced;
+}
+
+/**
+ * @brief 取出一帧，通道为空时最多等待`wait`。
+ * @note 通知可能先于帧被收回而到达，因此唤醒后仍可能返回`nullptr`。
+ */
+CameraFrame* Sys_CameraPipeline::FrameChannel::take(TickType_t wait) {
+    CameraFrame* frame = _slot.exchange(nullptr);
+    if (frame == nullptr && ulTaskNotifyTake(pdTRUE, wait) > 0) {
+        frame = _slot.exchange(nullptr);
+    }
+    return frame;
+}
+
+// =================================================================================================
+// 帧槽位
+// =================================================================================================
+
+/**
+ * @brief 通过CAS从空闲位图认领一个槽位，返回的帧带有一个引用。
+ */
+CameraFrame* Sys_CameraPipeline::allocFrame() {
+    uint32_t mask = _free_mask.load();
+    while (mask != 0) {
+        const uint32_t bit = __builtin_ctz(mask);
+        if (_free_mask.compare_exchange_weak(mask, mask & (mask - 1))) {
+            CameraFrame* frame = &_frames[bit];
+            frame->refs.store(1);
+            return frame;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 丢弃一帧（释放其引用并计数）。
+ */
+void Sys_CameraPipeline::dropFrame(CameraFrame* frame) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    releaseFrame(frame);
+}
+
+/**
+ * @brief 把一帧发布为最新帧，并释放被替换帧的引用。
+ */
+void Sys_CameraPipeline::publishLatest(CameraFrame* frame) {
+    frame->refs.fetch_add(1);
+    portENTER_CRITICAL(&_latest_mux);
+    CameraFrame* previous = _latest;
+    _latest = frame;
+    portEXIT_CRITICAL(&_latest_mux);
+    releaseFrame(previous);
+}
+
+// =================================================================================================
+// 任务循环
+// =================================================================================================
+
+/**
+ * @brief Task_CamCapture：采集JPEG帧，槽位耗尽时收回最旧的未处理帧，从不阻塞等待下游。
+ * @details 未设置采集回调时阻塞在任务通知上，不做轮询。
+ */
+void Sys_CameraPipeline::captureTask(void* parameter) {
+    Sys_CameraPipeline* self = static_cast<Sys_CameraPipeline*>(parameter);
+    for (;;) {
+        CaptureFn capture = self->_capture_fn.load();
+        if (capture == nullptr) {
+            // 没有采集源时阻塞，直到setSource()通知；通知计数会保留，先设置后等待也不会错过
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        CameraFrame* frame = self->allocFrame();
+        if (frame == nullptr) {
+            // 分析通道中的帧已经过解码，比解码通道中的更旧，优先收回
+            CameraFrame* oldest = self->_analyze_channel.reclaim();
+            if (oldest == nullptr) {
+                oldest = self->_decode_channel.reclaim();
+            }
+            if (oldest != nullptr) {
+                self->dropFrame(oldest);
+                frame = self->allocFrame();
+            }
+        }
+        if (frame == nullptr) {
+            // 所有槽位都正被处理或推流：让驱动丢弃这一帧
+            capture(nullptr, 0, CAPTURE_TIMEOUT_MS);
+            self->_dropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        const size_t len = capture(frame->jpeg, JPEG_CAPACITY, CAPTURE_TIMEOUT_MS);
+        if (len == 0) {
+            self->releaseFrame(frame);
+            continue;
+        }
+        frame->jpeg_len = len;
+        frame->width = 0;
+        frame->height = 0;
+        frame->seq = self->_next_seq++;
+        frame->timestamp_ms = millis();
+        self->_captured.fetch_add(1, std::memory_order_relaxed);
+
+        self->publishLatest(frame);
+        CameraFrame* displaced = self->_decode_channel.put(frame);
+        if (displaced != nullptr) {
+            self->dropFrame(displaced);
+        }
+    }
+}
+
+/**
+ * @brief Task_CamDecode：把JPEG解码为灰度平面后交给分析级。
+ */
+void Sys_CameraPipeline::decodeTask(void* parameter) {
+    Sys_CameraPipeline* self = static_cast<Sys_CameraPipeline*>(parameter);
+    for (;;) {
+        CameraFrame* frame = self->_decode_channel.take(portMAX_DELAY);
+        if (frame == nullptr) {
+            continue;
+        }
+
+        DecodeFn decode = self->_decode_fn.load();
+        uint16_t width = 0;
+        uint16_t height = 0;
+        if (decode == nullptr || self->_analyze_fn.load() == nullptr ||
+            !decode(frame->jpeg, frame->jpeg_len, frame->gray, GRAY_CAPACITY, width, height)) {
+            self->releaseFrame(frame);
+            continue;
+        }
+        frame->width = width;
+        frame->height = height;
+        self->_decoded.fetch_add(1, std::memory_order_relaxed);
+
+        CameraFrame* displaced = self->_analyze_channel.put(frame);
+        if (displaced != nullptr) {
+            self->dropFrame(displaced);
+        }
+    }
+}
+
+/**
+ * @brief Task_CamAnalyze：对灰度平面运行分析回调。
+ */
+void Sys_CameraPipeline::analyzeTask(void* parameter) {
+    Sys_CameraPipeline* self = static_cast<Sys_CameraPipeline*>(parameter);
+    for (;;) {
+        CameraFrame* frame = self->_analyze_channel.take(portMAX_DELAY);
+        if (frame == nullptr) {
+            continue;
+        }
+        AnalyzeFn analyze = self->_analyze_fn.load();
+        if (analyze != nullptr) {
+            analyze(*frame);
+            self->_analyzed.fetch_add(1, std::memory_order_relaxed);
+        }
+        self->releaseFrame(frame);
+    }
+}
@@ -0,0 +1,371 @@
+/**
+ * @file Sys_DeferredLog.cpp
+ * @brief 延迟格式化的系统日志管道的实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 记录格式：`RecordHeader` + 参数数据。参数按格式串中出现的顺序紧密排列，
+ * 每个参数按其`va_arg`类型原样保存（`int`/`long`/`long long`/`size_t`/`void*`/`double`），
+ * `*`宽度/精度保存为`int`，字符串保存为1字节长度加内容（不含'\0'）。
+ * 编码与解码共用同一套格式串解析规则，因此两者总是一致的。
+ */
+#include "Sys_DeferredLog.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#if __has_include("esp_memory_utils.h")
+#include "esp_memory_utils.h"     // ESP-IDF 5.x
+#else
+#include "soc/soc_memory_layout.h" // ESP-IDF 4.x
+#endif
+#include <cctype>
+#include <cstring>
+
+// --- 静态成员初始化 ---
+RingbufHandle_t Sys_DeferredLog::_rings[Sys_DeferredLog::CORE_COUNT] = {};
+TaskHandle_t Sys_DeferredLog::_consumer = NULL;
+std::atomic<uint32_t> Sys_DeferredLog::_sequence{0};
+std::atomic<uint32_t> Sys_DeferredLog::_dropped{0};
+void* Sys_DeferredLog::_held_item[Sys_DeferredLog::CORE_COUNT] = {};
+size_t Sys_DeferredLog::_held_size[Sys_DeferredLog::CORE_COUNT] = {};
+
+namespace {
+
+/** @brief 格式串中长度修饰符的种类。*/
+enum class LengthModifier : uint8_t { NONE, HH, H, L, LL, J, Z, T, BIG_L };
+
+/**
+ * @brief 解析长度修饰符，并将读取位置推进到转换符上。
+ */
+LengthModifier parseLength(const char*& p) {
+    switch (*p) {
+        case 'h':
+            if (p[1] == 'h') { p += 2; return LengthModifier::HH; }
+            p += 1; return LengthModifier::H;
+        case 'l':
+            if (p[1] == 'l') { p += 2; return LengthModifier::LL; }
+            p += 1; return LengthModifier::L;
+        case 'j': p += 1; return LengthModifier::J;
+        case 'z': p += 1; return LengthModifier::Z;
+        case 't': p += 1; return LengthModifier::T;
+        case 'L': p += 1; return LengthModifier::BIG_L;
+        default:  return LengthModifier::NONE;
+    }
+}
+
+/**
+ * @brief 只有位于Flash只读数据段中的格式串才能在调用返回后继续使用。
+ */
+bool isStableFormat(const char* fmt) {
+    return fmt != nullptr && esp_ptr_in_drom(fmt);
+}
+
+} // namespace
+
+bool Sys_DeferredLog::begin() {
+    static StaticRingbuffer_t ring_structs[CORE_COUNT];
+
+    for (size_t core = 0; core < CORE_COUNT; ++core) {
+        if (_rings[core] != NULL) continue;
+        // 存储区放在PSRAM中，控制块留在内部SRAM
+        uint8_t* storage = (uint8_t*)heap_caps_malloc(RING_SIZE_PER_CORE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (storage != nullptr) {
+            _rings[core] = xRingbufferCreateStatic(RING_SIZE_PER_CORE, RINGBUF_TYPE_NOSPLIT, storage, &ring_structs[core]);
+        } else {
+            _rings[core] = xRingbufferCreate(RING_SIZE_PER_CORE / 2, RINGBUF_TYPE_NOSPLIT);
+        }
+        if (_rings[core] == NULL) {
+            ESP_LOGE("DeferredLog", "Failed to create log ring for core %u.", core);
+            return false;
+        }
+    }
+    return true;
+}
+
+void Sys_DeferredLog::setConsumer(TaskHandle_t consumer) {
+    _consumer = consumer;
+}
+
+uint32_t Sys_DeferredLog::takeDroppedCount() {
+    return _dropped.exchange(0, std::memory_order_relaxed);
+}
+
+// --- 捕获 (热路径) ---
+
+size_t Sys_DeferredLog::encodeArgs(const char* fmt, va_list args, uint8_t* out) {
+    size_t pos = 0;
+    auto put = [&](const void* data, size_t n) {
+        if (out != nullptr) memcpy(out + pos, data, n);
+        pos += n;
+    };
+
+    for (const char* p = fmt; *p != '\0'; ++p) {
+        if (*p != '%') continue;
+        ++p;
+        if (*p == '%') continue;
+
+        // 标志 / 宽度 / 精度
+        while (*p != '\0' && strchr("-+ #0", *p) != nullptr) ++p;
+        if (*p == '*') {
+            int width = va_arg(args, int);
+            put(&width, sizeof(width));
+            ++p;
+        } else {
+            while (isdigit((unsigned char)*p)) ++p;
+        }
+        if (*p == '.') {
+            ++p;
+            if (*p == '*') {
+                int precision = va_arg(args, int);
+                put(&precision, sizeof(precision));
+                ++p;
+            } else {
+                while (isdigit((unsigned char)*p)) ++p;
+            }
+        }
+
+        const LengthModifier length = parseLength(p);
+        switch (*p) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                if (*p == 'c' && length == LengthModifier::L) return ENCODE_UNSUPPORTED; // wint_t
+                if (length == LengthModifier::LL || length == LengthModifier::J) {
+                    long long value = va_arg(args, long long);
+                    put(&value, sizeof(value));
+                } else if (length == LengthModifier::L) {
+                    long value = va_arg(args, long);
+                    put(&value, sizeof(value));
+                } else if (length == LengthModifier::Z || length == LengthModifier::T) {
+                    size_t value = va_arg(args, size_t);
+                    put(&value, sizeof(value));
+                } else {
+                    int value = va_arg(args, int);
+                    put(&value, sizeof(value));
+                }
+                break;
+            case 'p': {
+                void* value = va_arg(args, void*);
+                put(&value, sizeof(value));
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                if (length == LengthModifier::BIG_L) return ENCODE_UNSUPPORTED;
+                double value = va_arg(args, double);
+                put(&value, sizeof(value));
+                break;
+            }
+            case 's': {
+                if (length == LengthModifier::L) return ENCODE_UNSUPPORTED; // wchar_t*
+                const char* str = va_arg(args, const char*);
+                if (str == nullptr) str = "(null)";
+                const uint8_t n = (uint8_t)strnlen(str, MAX_STRING_ARG);
+                put(&n, sizeof(n));
+                put(str, n);
+                break;
+            }
+            default:
+                return ENCODE_UNSUPPORTED; // %n、未知转换符或格式串意外结束
+        }
+    }
+    return pos;
+}
+
+int Sys_DeferredLog::vprintf(const char* fmt, va_list args) {
+    // 任务可能在取得核心号后被迁移到另一核心；环形缓冲区本身是并发安全的，这只影响分区，不影响正确性
+    RingbufHandle_t ring = _rings[xPortGetCoreID()];
+    if (ring == NULL) {
+        return ::vprintf(fmt, args); // 管道尚未初始化，直接输出
+    }
+
+    RecordHeader header;
+    header.seq = _sequence.fetch_add(1, std::memory_order_relaxed);
+    header.fmt = fmt;
+    header.flags = 0;
+
+    size_t body_len = ENCODE_UNSUPPORTED;
+    if (isStableFormat(fmt)) {
+        va_list measure;
+        va_copy(measure, args);
+        body_len = encodeArgs(fmt, measure, nullptr);
+        va_end(measure);
+    }
+
+    void* item = nullptr;
+    if (body_len != ENCODE_UNSUPPORTED) {
+        // 快速路径：只保存格式串指针和原始参数
+        if (xRingbufferSendAcquire(ring, &item, sizeof(header) + body_len, 0) != pdTRUE || item == nullptr) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        memcpy(item, &header, sizeof(header));
+        va_list encode;
+        va_copy(encode, args);
+        encodeArgs(fmt, encode, (uint8_t*)item + sizeof(header));
+        va_end(encode);
+    } else {
+        // 回退路径：格式串不可长期引用，立即格式化成文本
+        char text[MAX_LINE_LENGTH];
+        int n = vsnprintf(text, sizeof(text), fmt, args);
+        if (n < 0) return 0;
+        const size_t text_len = ((size_t)n < sizeof(text)) ? (size_t)n : sizeof(text) - 1;
+        header.fmt = nullptr;
+        header.flags = RECORD_PREFORMATTED;
+        if (xRingbufferSendAcquire(ring, &item, sizeof(header) + text_len, 0) != pdTRUE || item == nullptr) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        memcpy(item, &header, sizeof(header));
+        memcpy((uint8_t*)item + sizeof(header), text, text_len);
+    }
+    xRingbufferSendComplete(ring, item);
+
+    if (_consumer != NULL) {
+        xTaskNotifyGive(_consumer);
+    }
+    return 0;
+}
+
+// --- 格式化 (消费者任务) ---
+
+size_t Sys_DeferredLog::decodeRecord(const RecordHeader& header, const uint8_t* body, size_t body_len, char* line, size_t cap) {
+    if (header.flags & RECORD_PREFORMATTED) {
+        const size_t n = (body_len < cap) ? body_len : cap - 1;
+        memcpy(line, body, n);
+        line[n] = '\0';
+        return n;
+    }
+
+    size_t in = 0;
+    size_t out = 0;
+    auto take = [&](void* dst, size_t n) -> bool {
+        if (in + n > body_len) return false;
+        memcpy(dst, body + in, n);
+        in += n;
+        return true;
+    };
+
+    for (const char* p = header.fmt; *p != '\0' && out < cap - 1; ++p) {
+        if (*p != '%') {
+            line[out++] = *p;
+            continue;
+        }
+        ++p;
+        if (*p == '%') {
+            line[out++] = '%';
+            continue;
+        }
+
+        // 重建单个转换说明，`*`替换为记录中保存的数值
+        char spec[32];
+        size_t sl = 0;
+        spec[sl++] = '%';
+        while (*p != '\0' && strchr("-+ #0", *p) != nullptr && sl < 8) spec[sl++] = *p++;
+        if (*p == '*') {
+            int width = 0;
+            if (!take(&width, sizeof(width))) break;
+            sl += snprintf(spec + sl, sizeof(spec) - sl, "%d", width);
+            ++p;
+        } else {
+            while (isdigit((unsigned char)*p) && sl < 16) spec[sl++] = *p++;
+        }
+        if (*p == '.') {
+            spec[sl++] = *p++;
+            if (*p == '*') {
+                int precision = 0;
+                if (!take(&precision, sizeof(precision))) break;
+                sl += snprintf(spec + sl, sizeof(spec) - sl, "%d", precision);
+                ++p;
+            } else {
+                while (isdigit((unsigned char)*p) && sl < 24) spec[sl++] = *p++;
+            }
+        }
+        const char* length_start = p;
+        const LengthModifier length = parseLength(p);
+        while (length_start < p && sl < sizeof(spec) - 2) spec[sl++] = *length_start++;
+        spec[sl++] = *p;
+        spec[sl] = '\0';
+
+        char* dst = line + out;
+        const size_t remaining = cap - out;
+        int written = 0;
+        switch (*p) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                if (length == LengthModifier::LL || length == LengthModifier::J) {
+                    long long value;
+                    if (!take(&value, sizeof(value))) break;
+                    written = snprintf(dst, remaining, spec, value);
+                } else if (length == LengthModifier::L) {
+                    long value;
+                    if (!take(&value, sizeof(value))) break;
+                    written = snprintf(dst, remaining, spec, value);
+                } else if (length == LengthModifier::Z || length == LengthModifier::T) {
+                    size_t value;
+                    if (!take(&value, sizeof(value))) break;
+                    written = snprintf(dst, remaining, spec, value);
+                } else {
+                    int value;
+                    if (!take(&value, sizeof(value))) break;
+                    written = snprintf(dst, remaining, spec, value);
+                }
+                break;
+            case 'p': {
+                void* value;
+                if (!take(&value, sizeof(value))) break;
+                written = snprintf(dst, remaining, spec, value);
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                double value;
+                if (!take(&value, sizeof(value))) break;
+                written = snprintf(dst, remaining, spec, value);
+                break;
+            }
+            case 's': {
+                uint8_t n = 0;
+                char str[MAX_STRING_ARG + 1];
+                if (!take(&n, sizeof(n)) || !take(str, n)) break;
+                str[n] = '\0';
+                written = snprintf(dst, remaining, spec, str);
+                break;
+            }
+            default:
+                break;
+        }
+        if (written > 0) {
+            out += ((size_t)written < remaining) ? (size_t)written : remaining - 1;
+        }
+    }
+
+    line[out] = '\0';
+    return out;
+}
+
+bool Sys_DeferredLog::formatNext(char* line, size_t& len) {
+    // 每个核心各取出一条候选记录，输出序号最小的一条，以恢复跨核心的先后顺序
+    int best = -1;
+    uint32_t best_seq = 0;
+    for (size_t core = 0; core < CORE_COUNT; ++core) {
+        if (_held_item[core] == nullptr && _rings[core] != NULL) {
+            _held_item[core] = xRingbufferReceive(_rings[core], &_held_size[core], 0);
+        }
+        if (_held_item[core] == nullptr) continue;
+
+        RecordHeader header;
+        memcpy(&header, _held_item[core], sizeof(header));
+        if (best < 0 || (int32_t)(header.seq - best_seq) < 0) {
+            best = (int)core;
+            best_seq = header.seq;
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+
+    const uint8_t* item = (const uint8_t*)_held_item[best];
+    RecordHeader header;
+    memcpy(&header, item, sizeof(header));
+    len = decodeRecord(header, item + sizeof(header), _held_size[best] - sizeof(header), line, MAX_LINE_LENGTH);
+
+    vRingbufferReturnItem(_rings[best], _held_item[best]);
+    _held_item[best] = nullptr;
+    return true;
+}
@@ -21,6 +21,8 @@
 #include "esp_heap_caps.h"
 #include "esp_partition.h"
 #include "Sys_Filesystem.h" // 需要获取文件系统状态
+#include "Sys_ImageKernels.h" // [新增] 图像内核微基准测试
+#include "esp_timer.h"
 
 // --- 日志标签 ---
 // 所有此模块的输出都会带上 `[Diagnostics]` 前缀
@@ -42,6 +44,7 @@ void Sys_Diagnostics::run() {
     checkMemory();
     checkPartitions();
     checkFileSystems();
+    checkImageKernels();
 
     ESP_LOGI(TAG, "=============================================");
     ESP_LOGI(TAG, "      Diagnostics Complete");
@@ -153,6 +156,91 @@ void Sys_Diagnostics::checkFileSystems() {
     } else {
         ESP_LOGE(TAG, "  FFat (Media)       : [FAIL] Not mounted!");
     }
+
+    // [新增] 闪存日志的运行统计
+    const FlashLoggerStats stats = Sys_FlashLogger::getInstance()->getStats();
+    ESP_LOGI(TAG, "  Flash Logger       : Logged: %u, Dropped: %u, Flushes: %u, Sectors: %u",
+             stats.messages_logged, stats.messages_dropped, stats.flush_count, stats.sectors_written);
+    ESP_LOGI(TAG, "  Flush Latency      : Last: %u us, Max: %u us, Avg: %llu us",
+             stats.last_flush_us, stats.max_flush_us,
+             stats.flush_count ? stats.total_flush_us / stats.flush_count : 0ULL);
+}
+
+/**
+ * @brief 对比图像内核的各个版本（参考 / SWAR / PIE）。
+ * @details 测试图像位于PSRAM（与摄像头帧缓冲相同）并按16字节对齐，使PIE版本走向量路径；
+ *          每个版本重复`ITERATIONS`次取平均，输出与参考版本逐字节比较。
+ */
+void Sys_Diagnostics::checkImageKernels() {
+    ESP_LOGI(TAG, "--- 5. Image Kernel Benchmarks / 图像内核基准测试 ---");
+    static constexpr uint16_t W = 320;
+    static constexpr uint16_t H = 240;
+    static constexpr int ITERATIONS = 10;
+    static constexpr size_t INTEGRAL_BYTES = (W + 1) * (H + 1) * sizeof(uint32_t);
+    static constexpr uint32_t CAPS = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+
+    uint8_t* input = (uint8_t*)heap_caps_aligned_alloc(16, W * H * 2, CAPS);
+    uint8_t* out_fast = (uint8_t*)heap_caps_aligned_alloc(16, W * H, CAPS);
+    uint8_t* out_ref = (uint8_t*)heap_caps_aligned_alloc(16, W * H, CAPS);
+    uint32_t* integral_fast = (uint32_t*)heap_caps_aligned_alloc(16, INTEGRAL_BYTES, CAPS);
+    uint32_t* integral_ref = (uint32_t*)heap_caps_aligned_alloc(16, INTEGRAL_BYTES, CAPS);
+    if (!input || !out_fast || !out_ref || !integral_fast || !integral_ref) {
+        ESP_LOGE(TAG, "  [FAIL] Not enough PSRAM for the benchmark images.");
+        heap_caps_free(input); heap_caps_free(out_fast); heap_caps_free(out_ref);
+        heap_caps_free(integral_fast); heap_caps_free(integral_ref);
+        return;
+    }
+    for (size_t i = 0; i < (size_t)W * H * 2; ++i) {
+        input[i] = (uint8_t)esp_random();
+    }
+    const uint8_t* gray = input; // 灰度内核直接把输入的前W*H字节当作灰度图
+
+    auto timeKernel = [](auto&& kernel) -> int64_t {
+        const int64_t start = esp_timer_get_time();
+        for (int i = 0; i < ITERATIONS; ++i) kernel();
+        return (esp_timer_get_time() - start) / ITERATIONS;
+    };
+    // 运行一个优化版本并打印平均耗时、相对参考版本的加速比和一致性；
+    // 输出先清零，避免沿用上一个版本留下的正确结果
+    auto bench = [&](const char* name, const char* variant, auto&& kernel, int64_t ref_us, void* out, const void* expected, size_t len) {
+        memset(out, 0, len);
+        const int64_t us = timeKernel(kernel);
+        const bool match = memcmp(out, expected, len) == 0;
+        ESP_LOGI(TAG, "  %-18s %-4s : %6lld us (ref %6lld us, x%.2f) %s", name, variant, us, ref_us,
+                 us > 0 ? (float)ref_us / us : 0.0f, match ? "[OK]" : "[FAIL] output mismatch");
+    };
+
+    int64_t ref_us = timeKernel([&] { Sys_ImageKernels::yuyvToGrayReference(input, out_ref, W * H); });
+    bench("yuyvToGray", "swar", [&] { Sys_ImageKernels::yuyvToGraySwar(input, out_fast, W * H); }, ref_us, out_fast, out_ref, W * H);
+#if SYS_IMAGE_KERNELS_PIE
+    bench("yuyvToGray", "pie", [&] { Sys_ImageKernels::yuyvToGrayPie(input, out_fast, W * H); }, ref_us, out_fast, out_ref, W * H);
+#endif
+
+    ref_us = timeKernel([&] { Sys_ImageKernels::rgb565ToGrayReference((const uint16_t*)input, out_ref, W * H); });
+    bench("rgb565ToGray", "swar", [&] { Sys_ImageKernels::rgb565ToGray((const uint16_t*)input, out_fast, W * H); }, ref_us, out_fast, out_ref, W * H);
+
+    ref_us = timeKernel([&] { Sys_ImageKernels::downscale2xReference(gray, W, H, W, out_ref, W / 2); });
+    bench("downscale2x", "swar", [&] { Sys_ImageKernels::downscale2xSwar(gray, W, H, W, out_fast, W / 2); },
+          ref_us, out_fast, out_ref, (W / 2) * (H / 2));
+#if SYS_IMAGE_KERNELS_PIE
+    bench("downscale2x", "pie", [&] { Sys_ImageKernels::downscale2xPie(gray, W, H, W, out_fast, W / 2); },
+          ref_us, out_fast, out_ref, (W / 2) * (H / 2));
+#endif
+
+    ref_us = timeKernel([&] { Sys_ImageKernels::integralImageReference(gray, W, H, W, integral_ref); });
+    bench("integralImage", "swar", [&] { Sys_ImageKernels::integralImage(gray, W, H, W, integral_fast); },
+          ref_us, integral_fast, integral_ref, INTEGRAL_BYTES);
+
+    ref_us = timeKernel([&] { Sys_ImageKernels::adaptiveThresholdReference(gray, W, H, W, integral_ref, 15, 15, out_ref, W); });
+    bench("adaptiveThreshold", "swar", [&] { Sys_ImageKernels::adaptiveThresholdSwar(gray, W, H, W, integral_ref, 15, 15, out_fast, W); },
+          ref_us, out_fast, out_ref, W * H);
+#if SYS_IMAGE_KERNELS_PIE
+    bench("adaptiveThreshold", "pie", [&] { Sys_ImageKernels::adaptiveThresholdPie(gray, W, H, W, integral_ref, 15, 15, out_fast, W); },
+          ref_us, out_fast, out_ref, W * H);
+#endif
+
+    heap_caps_free(input); heap_caps_free(out_fast); heap_caps_free(out_ref);
+    heap_caps_free(integral_fast); heap_caps_free(integral_ref);
 }
 
 /**
@@ -3,22 +3,181 @@
  * @brief Flash友好型日志记录器的实现文件
  * @author [ANEAK]
  * @date [2025/7]
- * 
+ *
  * @details
  * 实现了日志的缓冲、后台任务的创建和文件写入逻辑。
- * 它利用了FreeRTOS的Ringbuf和两种同步原语，实现了高效、线程安全的日志处理：
+ * 它利用了PSRAM双缓冲暂存区和三种同步原语，实现了高效、线程安全的日志处理：
  * 1. **`_flush_semaphore` (二元信号量):** 用于从任何任务触发一次刷写操作。
  * 2. **`_file_mutex` (互斥信号量):** 用于保护对日志文件的实际I/O，防止并发访问导致的文件系统损坏。
+ * 3. **`_stage_mutex` (互斥信号量):** 只在追加一条记录或交换缓冲区指针时持有，从不跨越文件I/O。
+ *
+ * [优化] 暂存缓冲区中保存的已是二进制记录（`FlashLogRecordHeader` + 文本）；
+ * 后台任务把记录打包成（可压缩的）数据块，再以扇区为单位写入当前分段。
+ *
+ * [新增] 每封装一个数据块就把它的汇总信息并入活动分段的稀疏索引；查询时按索引条目从新到旧
+ * 检索，只解压可能命中的数据块。查询与刷写共用`_file_mutex`，以及同一组数据块缓冲区。
  */
 #include "Sys_FlashLogger.h"
 #include "Sys_Debug.h"
 #include "Sys_Filesystem.h" // 需要文件系统来操作文件
+#include "Sys_Lzss.h"       // [新增] 数据块压缩
+#include "esp_heap_caps.h"
+#include "esp_timer.h"      // [新增] 刷写耗时统计
+#include "Sys_RpcRouter.h"  // [新增] 注册`log.query`
+#include "Sys_MemoryManager.h" // [新增] 查询结果文档使用PSRAM分配器
+#include "Sys_Trace.h"       // [新增] 落盘延迟追踪
+#include "types.h"
 #include <cstdarg>
+#include <cstdlib>
+
+namespace {
+
+/** @brief 数据块在分段中的最大占用（块头 + 最坏情况的压缩数据）。*/
+constexpr size_t MAX_CHUNK_SIZE = sizeof(FlashLogChunkHeader) + Sys_Lzss::maxCompressedSize(Sys_FlashLogger::CHUNK_RAW_CAPACITY);
+/** @brief 一个数据块最多包含的记录数（每条记录至少占一个记录头）。*/
+constexpr size_t MAX_RECORDS_PER_CHUNK = Sys_FlashLogger::CHUNK_RAW_CAPACITY / sizeof(FlashLogRecordHeader);
+/** @brief 查询时一次倒序处理的数据块数，索引条目中的块更多时分批处理。*/
+constexpr size_t QUERY_CHUNK_WINDOW = 128;
+
+/** @brief 与`esp_log_level_t`一一对应的级别字母。*/
+const char* const LEVEL_NAMES[] = {"N", "E", "W", "I", "D", "V"};
+
+/**
+ * @struct QueryScratch
+ * @brief 一次查询用到的临时缓冲区，整体分配在PSRAM中。
+ */
+struct QueryScratch {
+    FlashLogIndexEntry entries[Sys_FlashLogger::MAX_INDEX_ENTRIES];
+    uint32_t chunk_offsets[QUERY_CHUNK_WINDOW];
+    uint16_t record_offsets[MAX_RECORDS_PER_CHUNK];
+    char tag_names[Sys_FlashLogger::MAX_TAGS][Sys_FlashLogger::TAG_NAME_LENGTH];
+    /** @brief `tag_names`对应的启动序号，-1表示尚未加载。*/
+    int32_t tag_boot;
+    /** @brief 标签过滤条件在该次启动中的标签ID，-1表示该次启动中没有这个标签。*/
+    int16_t filter_tag_id;
+};
+
+/** @brief 读取并校验`offset`处的块头。*/
+bool readChunkHeader(File& file, uint32_t offset, size_t file_size, FlashLogChunkHeader& header) {
+    if (offset + sizeof(header) > file_size) {
+        return false;
+    }
+    file.seek(offset);
+    return file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+           header.magic == FLASH_LOG_CHUNK_MAGIC &&
+           header.raw_len <= Sys_FlashLogger::CHUNK_RAW_CAPACITY &&
+           sizeof(header) + header.stored_len <= MAX_CHUNK_SIZE &&
+           offset + sizeof(header) + header.stored_len <= file_size;
+}
+
+/**
+ * @brief 读取并解压一个数据块的数据。
+ * @return size_t 解压后的长度，数据损坏时返回0。
+ */
+size_t readChunkBody(File& file, uint32_t offset, const FlashLogChunkHeader& header, uint8_t* stored, uint8_t* raw) {
+    file.seek(offset + sizeof(header));
+    if (!(header.flags & FLASH_LOG_CHUNK_COMPRESSED)) {
+        return (header.stored_len == header.raw_len && file.read(raw, header.raw_len) == header.raw_len) ? header.raw_len : 0;
+    }
+    if (file.read(stored, header.stored_len) != header.stored_len) {
+        return 0;
+    }
+    const size_t raw_len = Sys_Lzss::decompress(stored, header.stored_len, raw, Sys_FlashLogger::CHUNK_RAW_CAPACITY);
+    return raw_len == header.raw_len ? raw_len : 0;
+}
+
+/**
+ * @brief 把已解压数据块中的记录起始位置填入`offsets`。
+ * @return size_t 完整的记录数。
+ */
+size_t splitRecords(const uint8_t* raw, size_t raw_len, uint16_t record_count, uint16_t* offsets) {
+    size_t n = 0;
+    size_t pos = 0;
+    while (n < record_count && n < MAX_RECORDS_PER_CHUNK && pos + sizeof(FlashLogRecordHeader) <= raw_len) {
+        FlashLogRecordHeader header;
+        memcpy(&header, raw + pos, sizeof(header));
+        if (pos + sizeof(header) + header.length > raw_len) break;
+        offsets[n++] = (uint16_t)pos;
+        pos += sizeof(header) + header.length;
+    }
+    return n;
+}
+
+/**
+ * @brief 从分段中收集某次启动的标签定义，并解析标签过滤条件。
+ * @details 只解压带有`FLASH_LOG_INDEX_HAS_TAG_DEFS`标志的索引条目中的数据块。
+ */
+void loadTagTable(File& file, size_t file_size, const FlashLogIndexEntry* entries, size_t count, uint16_t boot_seq,
+                  const char* filter_tag, QueryScratch* scratch, uint8_t* stored, uint8_t* raw) {
+    for (uint8_t id = 0; id < Sys_FlashLogger::MAX_TAGS; ++id) {
+        snprintf(scratch->tag_names[id], Sys_FlashLogger::TAG_NAME_LENGTH, id == 0 ? "-" : "#%u", id);
+    }
+    for (size_t e = 0; e < count; ++e) {
+        const FlashLogIndexEntry& entry = entries[e];
+        if (!(entry.flags & FLASH_LOG_INDEX_HAS_TAG_DEFS)) continue;
+        if (entry.boot_seq != boot_seq && !(entry.flags & FLASH_LOG_INDEX_MIXED_BOOTS)) continue;
+
+        uint32_t offset = entry.offset;
+        FlashLogChunkHeader chunk;
+        while (offset < entry.end_offset && readChunkHeader(file, offset, file_size, chunk)) {
+            const uint32_t next = offset + sizeof(chunk) + chunk.stored_len;
+            const size_t raw_len = (chunk.boot_seq == boot_seq) ? readChunkBody(file, offset, chunk, stored, raw) : 0;
+            size_t pos = 0;
+            for (uint16_t i = 0; i < chunk.record_count && pos + sizeof(FlashLogRecordHeader) <= raw_len; ++i) {
+                FlashLogRecordHeader header;
+                memcpy(&header, raw + pos, sizeof(header));
+                pos += sizeof(header);
+                if (pos + header.length > raw_len) break;
+                if (header.level == FLASH_LOG_LEVEL_TAG_DEFINITION && header.tag_id < Sys_FlashLogger::MAX_TAGS) {
+                    const size_t n = header.length < Sys_FlashLogger::TAG_NAME_LENGTH - 1 ? header.length : Sys_FlashLogger::TAG_NAME_LENGTH - 1;
+                    memcpy(scratch->tag_names[header.tag_id], raw + pos, n);
+                    scratch->tag_names[header.tag_id][n] = '\0';
+                }
+                pos += header.length;
+            }
+            offset = next;
+        }
+    }
+
+    scratch->tag_boot = boot_seq;
+    scratch->filter_tag_id = -1;
+    for (uint8_t id = 0; filter_tag[0] != '\0' && id < Sys_FlashLogger::MAX_TAGS; ++id) {
+        if (strcmp(scratch->tag_names[id], filter_tag) == 0) {
+            scratch->filter_tag_id = id;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief [新增] RPC `log.query`：检索Flash中的历史日志。
+ * @details 参数见`Sys_FlashLogger::parseQuery()`。该方法需要读取并解压Flash数据，注册为耗时操作。
+ */
+void rpcLogQuery(const JsonRpcRequest& request) {
+    FlashLogQuery query;
+    const char* error = Sys_FlashLogger::parseQuery(request.params, query);
+    if (error != nullptr) {
+        Sys_RpcRouter::sendError(request, -32602, error);
+        return;
+    }
+    JsonDocument result_doc(Sys_PsramJsonAllocator::instance());
+    if (!Sys_FlashLogger::getInstance()->query(query, result_doc.to<JsonObject>())) {
+        Sys_RpcRouter::sendError(request, -32000, "Log query failed");
+        return;
+    }
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
+
+} // namespace
 
 // 初始化静态单例指针
 Sys_FlashLogger* Sys_FlashLogger::_instance = nullptr;
 
-Sys_FlashLogger::Sys_FlashLogger() {}
+Sys_FlashLogger::Sys_FlashLogger() {
+    // 标签0保留给空标签和标签表溢出
+    strncpy(_tag_names[0], "-", TAG_NAME_LENGTH);
+    _tag_count = 1;
+}
 
 /**
  * @brief 获取日志记录器的单例实例。
@@ -33,18 +192,19 @@ Sys_FlashLogger* Sys_FlashLogger::getInstance() {
 /**
  * @brief 初始化日志记录器。
  */
-bool Sys_FlashLogger::begin(const char* log_filepath, size_t buffer_size, uint32_t flush_interval_ms) {
-    if (_ring_buffer_handle) {
+bool Sys_FlashLogger::begin(const char* log_basepath, size_t buffer_size, uint32_t flush_interval_ms, bool compress) {
+    if (_front_buffer) {
         ESP_LOGW("FlashLogger", "Flash Logger already initialized.");
         return true;
     }
 
     DEBUG_LOG("Initializing Flash Logger...");
-    _log_filepath = log_filepath;
+    _log_basepath = log_basepath;
     _flush_interval_ms = flush_interval_ms;
+    _compress = compress;
 
     // 在创建缓冲区之前，先确保日志目录存在
-    String log_dir = _log_filepath.substring(0, _log_filepath.lastIndexOf('/'));
+    String log_dir = _log_basepath.substring(0, _log_basepath.lastIndexOf('/'));
     if (FFat.exists(log_dir.c_str())) {
          DEBUG_LOG("Log directory '%s' already exists.", log_dir.c_str());
     } else {
@@ -57,60 +217,165 @@ bool Sys_FlashLogger::begin(const char* log_filepath, size_t buffer_size, uint32
         }
     }
 
-    // 步骤1：创建环形缓冲区。
-    // 类型设为 RINGBUF_TYPE_NOSPLIT 确保日志条目在缓冲区中是连续的，不会被分割。
-    _ring_buffer_handle = xRingbufferCreate(buffer_size, RINGBUF_TYPE_NOSPLIT);
-    if (!_ring_buffer_handle) {
-        ESP_LOGE("FlashLogger", "FATAL: Failed to create ring buffer!");
+    // [新增] 步骤0：在PSRAM中一次性分配两个暂存缓冲区，以及扇区、数据块、压缩输出和哈希表工作区。
+    // 一个暂存缓冲区的内容总能装进一个数据块，后台任务因此每批只需封装一次。
+    _stage_size = buffer_size / 2;
+    if (_stage_size > CHUNK_RAW_CAPACITY) _stage_size = CHUNK_RAW_CAPACITY;
+    if (_stage_size < sizeof(FlashLogRecordHeader) + MAX_MESSAGE_LENGTH) _stage_size = sizeof(FlashLogRecordHeader) + MAX_MESSAGE_LENGTH;
+    const size_t compress_cap = Sys_Lzss::maxCompressedSize(CHUNK_RAW_CAPACITY);
+    const size_t index_size = MAX_INDEX_ENTRIES * sizeof(FlashLogIndexEntry);
+    const size_t workspace_size = index_size + 2 * _stage_size + SECTOR_SIZE + CHUNK_RAW_CAPACITY + compress_cap + 1 + Sys_Lzss::WORKSPACE_ENTRIES * sizeof(uint16_t);
+    uint8_t* workspace = (uint8_t*)heap_caps_malloc(workspace_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!workspace) {
+        ESP_LOGE("FlashLogger", "FATAL: Failed to allocate %u bytes of PSRAM workspace!", workspace_size);
         return false;
     }
+    _active_index = (FlashLogIndexEntry*)workspace; // 放在最前面，保证对齐
+    uint8_t* front_buffer = workspace + index_size;
+    _back_buffer = front_buffer + _stage_size;
+    _sector_buffer = _back_buffer + _stage_size;
+    _chunk_buffer = _sector_buffer + SECTOR_SIZE;
+    _compress_buffer = _chunk_buffer + CHUNK_RAW_CAPACITY;
+    _lz_workspace = (uint16_t*)(_compress_buffer + ((compress_cap + 1) & ~(size_t)1)); // 2字节对齐
 
-    // 步骤2：创建用于手动触发刷写的二进制信号量。
+    // 步骤1：创建用于手动触发刷写的二进制信号量。
     _flush_semaphore = xSemaphoreCreateBinary();
     if (!_flush_semaphore) {
-        vRingbufferDelete(_ring_buffer_handle); // 清理已创建的资源
+        heap_caps_free(workspace); // 清理已创建的资源
         ESP_LOGE("FlashLogger", "FATAL: Failed to create flush semaphore!");
         return false;
     }
 
-    // 步骤3：创建用于保护文件操作的互斥锁
+    // 步骤2：创建用于保护文件操作、标签表和暂存区的互斥锁
     _file_mutex = xSemaphoreCreateMutex();
-    if (!_file_mutex) {
-        vRingbufferDelete(_ring_buffer_handle);
+    _tag_mutex = xSemaphoreCreateMutex();
+    _stage_mutex = xSemaphoreCreateMutex();
+    if (!_file_mutex || !_tag_mutex || !_stage_mutex) {
         vSemaphoreDelete(_flush_semaphore);
-        ESP_LOGE("FlashLogger", "FATAL: Failed to create file mutex!");
+        heap_caps_free(workspace);
+        ESP_LOGE("FlashLogger", "FATAL: Failed to create logger mutexes!");
         return false;
     }
+    // [优化] 锁创建完毕后才发布前台缓冲区：`logv()`以它判断是否已初始化，
+    // 并行启动时其它启动阶段（如WiFi事件）可能在本函数返回前就开始记录日志
+    _front_buffer = front_buffer;
+
+    // [新增] 步骤3：定位最新分段，在其有效数据末尾继续追加
+    {
+        Sys_LockGuard lock(_file_mutex);
+        if (!openNewestSegment()) {
+            ESP_LOGE("FlashLogger", "FATAL: Failed to open a log segment under '%s'!", _log_basepath.c_str());
+            return false;
+        }
+    }
 
     // 步骤4：创建后台刷写任务
     xTaskCreatePinnedToCore(flushTask, "FlashLog_FlushTask", 4096, this, 1, &_flush_task_handle, 1);
 
-    ESP_LOGI("FlashLogger", "Initialized. Logging to '%s', buffer: %u B, flush interval: %u ms", 
-             _log_filepath.c_str(), buffer_size, flush_interval_ms);
+    // [新增] 步骤5：注册日志查询RPC（HTTP接口`/api/log/query`由Sys_WebServer提供）
+    Sys_RpcRouter::registerMethod("log.query", rpcLogQuery, RPC_FLAG_LONG_RUNNING);
+
+    ESP_LOGI("FlashLogger", "Initialized. Logging to '%s' (segment %u, seq %u, boot %u), buffers: 2x%u B, flush interval: %u ms",
+             segmentPath(_segment_slot).c_str(), _segment_slot, _segment_seq, _boot_seq, _stage_size, flush_interval_ms);
     return true;
 }
 
 /**
- * @brief 记录一条格式化的日志。
+ * @brief 以INFO级别记录一条格式化的日志。
+ */
+void Sys_FlashLogger::log(const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    logv(ESP_LOG_INFO, tag, format, args);
+    va_end(args);
+}
+
+/**
+ * @brief 以指定级别记录一条格式化的日志。
  */
-void Sys_FlashLogger::log(const char* format, ...) {
-    if (!_ring_buffer_handle) return; // 安全检查：如果未初始化则不执行任何操作
-    
-    char buffer[256]; // 限制单条日志的最大长度，防止栈溢出
+void Sys_FlashLogger::log(esp_log_level_t level, const char* tag, const char* format, ...) {
     va_list args;
     va_start(args, format);
-    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    logv(level, tag, format, args);
     va_end(args);
+}
 
-    if (len > 0) {
-        // xRingbufferSend 是线程安全的，无需额外加锁。
-        if (xRingbufferSend(_ring_buffer_handle, buffer, len, pdMS_TO_TICKS(10)) != pdTRUE) {
-            // 缓冲区满，日志被丢弃
-            ESP_LOGW("FlashLogger", "Ring buffer full, log message dropped.");
+void Sys_FlashLogger::logv(esp_log_level_t level, const char* tag, const char* format, va_list args) {
+    if (!_front_buffer) return; // 安全检查：如果未初始化则不执行任何操作
+
+    // 记录头 + 文本；多留1字节给vsnprintf的结尾'\0'（不写入缓冲区）
+    uint8_t record[sizeof(FlashLogRecordHeader) + MAX_MESSAGE_LENGTH + 1];
+    int len = vsnprintf((char*)record + sizeof(FlashLogRecordHeader), MAX_MESSAGE_LENGTH + 1, format, args);
+    if (len <= 0) {
+        return;
+    }
+    if ((size_t)len > MAX_MESSAGE_LENGTH) {
+        len = MAX_MESSAGE_LENGTH;
+    }
+
+    FlashLogRecordHeader header;
+    header.timestamp_ms = millis();
+    header.level = (uint8_t)level;
+    header.tag_id = internTag(tag);
+    header.length = (uint16_t)len;
+    memcpy(record, &header, sizeof(header));
+
+    // [优化] 追加到前台缓冲区；前台满时若后台空闲则立即交换，否则丢弃并计数——从不等待刷写
+    const size_t size = sizeof(header) + len;
+    bool wake_flusher = false;
+    {
+        Sys_LockGuard lock(_stage_mutex);
+        if (_front_fill + size > _stage_size) {
+            if (_back_fill != 0) {
+                _stats.messages_dropped++; // 不在此处打印日志，由后台任务汇总报告
+                return;
+            }
+            uint8_t* full = _front_buffer;
+            _front_buffer = _back_buffer;
+            _back_buffer = full;
+            _back_fill = _front_fill;
+            _front_fill = 0;
+            wake_flusher = true;
         }
+        memcpy(_front_buffer + _front_fill, record, size);
+        _front_fill += size;
+        _stats.messages_logged++;
+    }
+    if (wake_flusher) {
+        xSemaphoreGive(_flush_semaphore);
     }
 }
 
+uint8_t Sys_FlashLogger::internTag(const char* tag) {
+    if (tag == nullptr) {
+        return 0;
+    }
+    // 规范化："[WiFi]" -> "WiFi"
+    char name[TAG_NAME_LENGTH];
+    size_t n = 0;
+    if (*tag == '[') tag++;
+    while (tag[n] != '\0' && tag[n] != ']' && n < TAG_NAME_LENGTH - 1) {
+        name[n] = tag[n];
+        n++;
+    }
+    name[n] = '\0';
+    if (n == 0) {
+        return 0;
+    }
+
+    Sys_LockGuard lock(_tag_mutex);
+    for (uint8_t i = 1; i < _tag_count; ++i) {
+        if (strcmp(_tag_names[i], name) == 0) {
+            return i;
+        }
+    }
+    if (_tag_count >= MAX_TAGS) {
+        return 0;
+    }
+    memcpy(_tag_names[_tag_count], name, n + 1);
+    return _tag_count++;
+}
+
 /**
  * @brief 强制刷写缓冲区。
  */
@@ -121,77 +386,703 @@ void Sys_FlashLogger::flush() {
 }
 
 /**
- * @brief 线程安全地清理日志文件。
+ * @brief 线程安全地清理所有日志分段。
  */
 void Sys_FlashLogger::clearLogFile() {
     // [优化] 关键：在接触文件系统前，获取文件互斥锁。
     Sys_LockGuard lock(_file_mutex);
 
-    if (FFat.exists(_log_filepath)) {
-        if (FFat.remove(_log_filepath)) {
-            ESP_LOGI("FlashLogger", "Log file '%s' cleared.", _log_filepath.c_str());
-        } else {
-            ESP_LOGE("FlashLogger", "Failed to clear log file '%s'.", _log_filepath.c_str());
+    if (_segment_file) {
+        _segment_file.close();
+    }
+    for (uint8_t slot = 0; slot < SEGMENT_COUNT; ++slot) {
+        const String path = segmentPath(slot);
+        if (FFat.exists(path) && !FFat.remove(path)) {
+            ESP_LOGE("FlashLogger", "Failed to clear log segment '%s'.", path.c_str());
         }
+        const String index_path = indexPath(slot);
+        if (FFat.exists(index_path)) {
+            FFat.remove(index_path);
+        }
+    }
+    _active_index_count = 0;
+    if (startSegment(0, _segment_seq + 1)) {
+        ESP_LOGI("FlashLogger", "Log segments under '%s' cleared.", _log_basepath.c_str());
     }
 }
 
+FlashLoggerStats Sys_FlashLogger::getStats() {
+    if (!_stage_mutex) {
+        return FlashLoggerStats();
+    }
+    Sys_LockGuard lock(_stage_mutex);
+    return _stats;
+}
+
+String Sys_FlashLogger::segmentPath(uint8_t slot) const {
+    return _log_basepath + "." + String(slot) + ".blog";
+}
+
+String Sys_FlashLogger::indexPath(uint8_t slot) const {
+    return _log_basepath + "." + String(slot) + ".idx";
+}
+
 // --- 私有辅助方法 (Private Methods) ---
 
-/**
- * @brief 将缓冲区数据写入文件的核心逻辑。
- */
-void Sys_FlashLogger::writeBufferToFile() {
-    // 步骤1：检查缓冲区是否有数据。
-    // 在 ESP-IDF v5.0+ 中, vRingbufferGetInfo 的 API 已改变。
-    // 使用第3个参数 uxUsed 来获取缓冲区中已用的字节数。
-    // 同时，变量类型建议使用 size_t。
-    size_t items_waiting = 0; 
-    if (_ring_buffer_handle) {
-        // 新版 API 调用，共6个参数 (handle + 5个指针)
-        // 我们只需要获取 "已使用" 的大小(“可读取的字节数”的参数通常都是第3个)，所以其他指针传入 NULL
-        vRingbufferGetInfo(_ring_buffer_handle, NULL, NULL, NULL, &items_waiting, NULL);
-    }
-
-    if (items_waiting == 0) {
-        // 缓冲区为空，直接返回，避免不必要的文件操作
+bool Sys_FlashLogger::openNewestSegment() {
+    // 步骤1：读取所有分段的文件头，找出序号最大的分段
+    int newest_slot = -1;
+    FlashLogSegmentHeader newest_header = {};
+    for (uint8_t slot = 0; slot < SEGMENT_COUNT; ++slot) {
+        const String path = segmentPath(slot);
+        if (!FFat.exists(path)) continue;
+        File file = FFat.open(path, "r");
+        if (!file) continue;
+        FlashLogSegmentHeader header;
+        const bool valid = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                           header.magic == FLASH_LOG_SEGMENT_MAGIC &&
+                           header.version == FLASH_LOG_FORMAT_VERSION;
+        file.close();
+        if (valid && (newest_slot < 0 || header.segment_seq > newest_header.segment_seq)) {
+            newest_slot = slot;
+            newest_header = header;
+        }
+    }
+    if (newest_slot < 0) {
+        _boot_seq = 0;
+        return startSegment(0, 1);
+    }
+
+    // 步骤2：沿块头链找到有效数据的末尾，同时取得上一次启动的启动序号，并重建活动分段的索引
+    File file = FFat.open(segmentPath(newest_slot), "r+");
+    if (!file) {
+        return false;
+    }
+    uint32_t end = 0;
+    uint16_t last_boot_seq = 0;
+    buildSegmentIndex(file, newest_header, _active_index, _active_index_count, end, last_boot_seq);
+    _boot_seq = last_boot_seq + 1;
+
+    // 步骤3：剩余空间不足一个最坏情况的数据块时，直接轮转到下一个分段
+    if (end + MAX_CHUNK_SIZE > SEGMENT_SIZE) {
+        file.close();
+        writeIndexFile(newest_slot, newest_header.segment_seq, _active_index, _active_index_count);
+        return startSegment((newest_slot + 1) % SEGMENT_COUNT, newest_header.segment_seq + 1);
+    }
+
+    // 步骤4：把尾扇区中已有的有效数据读回扇区缓冲区，之后的写入会整扇区覆盖它
+    _segment_slot = newest_slot;
+    _segment_seq = newest_header.segment_seq;
+    _segment_tag_mask = 0; // 本次启动的标签ID与上一次无关，需要重新定义
+    _sector_offset = end & ~(SECTOR_SIZE - 1);
+    _sector_fill = end - _sector_offset;
+    file.seek(_sector_offset);
+    if (file.read(_sector_buffer, _sector_fill) != _sector_fill) {
+        file.close();
+        writeIndexFile(newest_slot, newest_header.segment_seq, _active_index, _active_index_count);
+        return startSegment((newest_slot + 1) % SEGMENT_COUNT, newest_header.segment_seq + 1);
+    }
+    _segment_file = file;
+    return true;
+}
+
+bool Sys_FlashLogger::startSegment(uint8_t slot, uint32_t segment_seq) {
+    if (_segment_file) {
+        _segment_file.close();
+    }
+    // 该槽位上旧分段的索引已经过期
+    const String index_path = indexPath(slot);
+    if (FFat.exists(index_path)) {
+        FFat.remove(index_path);
+    }
+    File file = FFat.open(segmentPath(slot), "w+"); // 可读写：查询时直接复用这个句柄
+    if (!file) {
+        ESP_LOGE("FlashLogger", "Failed to create log segment '%s'.", segmentPath(slot).c_str());
+        return false;
+    }
+
+    FlashLogSegmentHeader header = {};
+    header.magic = FLASH_LOG_SEGMENT_MAGIC;
+    header.version = FLASH_LOG_FORMAT_VERSION;
+    header.header_size = sizeof(header);
+    header.sector_size = SECTOR_SIZE;
+    header.segment_seq = segment_seq;
+    header.boot_seq = _boot_seq;
+
+    _segment_file = file;
+    _segment_slot = slot;
+    _segment_seq = segment_seq;
+    _segment_tag_mask = 0;
+    _active_index_count = 0;
+    _chunk_summary = ChunkSummary();
+    _sector_offset = 0;
+    memcpy(_sector_buffer, &header, sizeof(header));
+    _sector_fill = sizeof(header);
+    writeTailSector(); // 文件头立即落盘
+
+    DEBUG_LOG("Started log segment %u (seq %u).", slot, segment_seq);
+    return true;
+}
+
+void Sys_FlashLogger::appendRecord(const uint8_t* record, size_t size) {
+    if (size < sizeof(FlashLogRecordHeader)) {
         return;
     }
+    FlashLogRecordHeader header;
+    memcpy(&header, record, sizeof(header));
 
-    // 步骤2：获取文件锁，准备执行I/O操作
-    // [优化] 使用RAII锁来保证即使发生错误也能释放锁
-    Sys_LockGuard lock(_file_mutex);
-    
-    // 打开文件准备写入（以追加模式）
-    File logFile = FFat.open(_log_filepath, "a");
-    if (!logFile) {
-        ESP_LOGE("FlashLogger", "Failed to open log file for appending: %s", _log_filepath.c_str());
+    // 标签定义记录最多占用 记录头 + TAG_NAME_LENGTH 字节
+    const size_t worst_case = size + sizeof(FlashLogRecordHeader) + TAG_NAME_LENGTH;
+    if (_chunk_fill + worst_case > CHUNK_RAW_CAPACITY) {
+        sealChunk();
+    }
+
+    if (_chunk_fill == 0) {
+        // 新数据块：确保它能完整地落在当前分段中，否则先轮转（数据块从不跨分段）
+        if (_sector_offset + _sector_fill + MAX_CHUNK_SIZE > SEGMENT_SIZE) {
+            writeTailSector();
+            writeIndexFile(_segment_slot, _segment_seq, _active_index, _active_index_count);
+            if (!startSegment((_segment_slot + 1) % SEGMENT_COUNT, _segment_seq + 1)) {
+                return;
+            }
+        }
+        _chunk_summary.first_ts = header.timestamp_ms;
+    }
+
+    // 标签在当前分段中首次出现：先写入标签定义记录
+    const uint64_t tag_bit = 1ULL << header.tag_id;
+    if (!(_segment_tag_mask & tag_bit)) {
+        char name[TAG_NAME_LENGTH];
+        {
+            Sys_LockGuard lock(_tag_mutex);
+            memcpy(name, _tag_names[header.tag_id], TAG_NAME_LENGTH);
+        }
+        FlashLogRecordHeader definition;
+        definition.timestamp_ms = header.timestamp_ms;
+        definition.level = FLASH_LOG_LEVEL_TAG_DEFINITION;
+        definition.tag_id = header.tag_id;
+        definition.length = (uint16_t)strnlen(name, TAG_NAME_LENGTH - 1);
+        appendToChunk(&definition, sizeof(definition));
+        appendToChunk(name, definition.length);
+        _chunk_records++;
+        _segment_tag_mask |= tag_bit;
+        _chunk_summary.has_tag_defs = true;
+    }
+
+    appendToChunk(record, size);
+    _chunk_records++;
+
+    // [新增] 更新当前数据块的汇总信息
+    _chunk_summary.last_ts = header.timestamp_ms;
+    _chunk_summary.tag_mask |= tag_bit;
+    if (header.level < 8) _chunk_summary.level_mask |= (uint8_t)(1u << header.level);
+    _chunk_summary.records++;
+}
+
+void Sys_FlashLogger::appendToChunk(const void* data, size_t size) {
+    memcpy(_chunk_buffer + _chunk_fill, data, size);
+    _chunk_fill += size;
+}
+
+void Sys_FlashLogger::sealChunk() {
+    if (_chunk_fill == 0) {
         return;
     }
-    
-    DEBUG_LOG("Flushing log buffer to flash...");
-    size_t total_written = 0;
-    size_t item_size;
-    
-    // 循环处理，直到缓冲区中的所有数据项都被取出并写入
-    while (true) {
-        char* item = (char*)xRingbufferReceive(_ring_buffer_handle, &item_size, 0);
-        if (item == NULL) {
-            // 缓冲区已空，退出循环
-            break;
+
+    FlashLogChunkHeader header = {};
+    header.magic = FLASH_LOG_CHUNK_MAGIC;
+    header.raw_len = (uint16_t)_chunk_fill;
+    header.record_count = _chunk_records;
+    header.boot_seq = _boot_seq;
+    header.first_timestamp_ms = _chunk_summary.first_ts;
+
+    // 只有压缩后确实更小时才保存压缩数据
+    const uint8_t* payload = _chunk_buffer;
+    size_t stored_len = _chunk_fill;
+    if (_compress) {
+        const size_t compressed = Sys_Lzss::compress(_chunk_buffer, _chunk_fill, _compress_buffer,
+                                                     Sys_Lzss::maxCompressedSize(CHUNK_RAW_CAPACITY), _lz_workspace);
+        if (compressed > 0 && compressed < _chunk_fill) {
+            payload = _compress_buffer;
+            stored_len = compressed;
+            header.flags |= FLASH_LOG_CHUNK_COMPRESSED;
+        }
+    }
+    header.stored_len = (uint16_t)stored_len;
+
+    const uint32_t chunk_offset = _sector_offset + _sector_fill;
+    appendToSector((const uint8_t*)&header, sizeof(header));
+    appendToSector(payload, stored_len);
+    addToIndex(_active_index, _active_index_count, chunk_offset, chunk_offset + sizeof(header) + stored_len,
+               _boot_seq, _chunk_summary);
+    _chunk_summary = ChunkSummary();
+    DEBUG_LOG("Sealed log chunk: %u records, %u -> %u bytes.", _chunk_records, _chunk_fill, stored_len);
+
+    _chunk_fill = 0;
+    _chunk_records = 0;
+}
+
+void Sys_FlashLogger::appendToSector(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        const size_t n = (size < SECTOR_SIZE - _sector_fill) ? size : SECTOR_SIZE - _sector_fill;
+        memcpy(_sector_buffer + _sector_fill, data, n);
+        _sector_fill += n;
+        data += n;
+        size -= n;
+        if (_sector_fill == SECTOR_SIZE) {
+            writeTailSector();
+            _sector_offset += SECTOR_SIZE;
+            _sector_fill = 0;
+        }
+    }
+}
+
+void Sys_FlashLogger::writeTailSector() {
+    if (!_segment_file || _sector_fill == 0) {
+        return;
+    }
+    // 未满的部分以0填充（不是合法的块头魔数），下一次刷写会在原位置覆盖整个扇区
+    memset(_sector_buffer + _sector_fill, 0, SECTOR_SIZE - _sector_fill);
+    _segment_file.seek(_sector_offset);
+    if (_segment_file.write(_sector_buffer, SECTOR_SIZE) != SECTOR_SIZE) {
+        ESP_LOGE("FlashLogger", "Short write to log segment %u at offset %u.", _segment_slot, _sector_offset);
+    }
+    _sectors_written++;
+}
+
+// --- [新增] 稀疏索引 (Sparse Index) ---
+
+void Sys_FlashLogger::summarizeChunk(const uint8_t* raw, size_t raw_len, uint16_t record_count, ChunkSummary& summary) {
+    summary = ChunkSummary();
+    size_t pos = 0;
+    for (uint16_t i = 0; i < record_count && pos + sizeof(FlashLogRecordHeader) <= raw_len; ++i) {
+        FlashLogRecordHeader header;
+        memcpy(&header, raw + pos, sizeof(header));
+        pos += sizeof(header) + header.length;
+        if (pos > raw_len) break;
+        if (header.level == FLASH_LOG_LEVEL_TAG_DEFINITION) {
+            summary.has_tag_defs = true;
+            continue;
+        }
+        if (summary.records == 0) summary.first_ts = header.timestamp_ms;
+        summary.last_ts = header.timestamp_ms;
+        if (header.tag_id < MAX_TAGS) summary.tag_mask |= 1ULL << header.tag_id;
+        if (header.level < 8) summary.level_mask |= (uint8_t)(1u << header.level);
+        summary.records++;
+    }
+}
+
+void Sys_FlashLogger::addToIndex(FlashLogIndexEntry* entries, size_t& count, uint32_t offset, uint32_t end_offset,
+                                 uint16_t boot_seq, const ChunkSummary& summary) {
+    if (entries == nullptr) {
+        return;
+    }
+    FlashLogIndexEntry* last = (count > 0) ? &entries[count - 1] : nullptr;
+    const bool extend_last = last != nullptr && last->end_offset == offset &&
+                             last->boot_seq == boot_seq && !(last->flags & FLASH_LOG_INDEX_MIXED_BOOTS) &&
+                             last->record_count < INDEX_INTERVAL_RECORDS;
+
+    if (!extend_last && count < MAX_INDEX_ENTRIES) {
+        // 新条目：启动序号变化，或上一个条目已覆盖足够多的记录
+        FlashLogIndexEntry& entry = entries[count++];
+        entry = FlashLogIndexEntry();
+        entry.offset = offset;
+        entry.end_offset = end_offset;
+        entry.first_timestamp_ms = summary.first_ts;
+        entry.last_timestamp_ms = summary.last_ts;
+        entry.tag_mask = summary.tag_mask;
+        entry.boot_seq = boot_seq;
+        entry.record_count = summary.records;
+        entry.level_mask = summary.level_mask;
+        entry.flags = summary.has_tag_defs ? FLASH_LOG_INDEX_HAS_TAG_DEFS : 0;
+        return;
+    }
+    if (last == nullptr) {
+        return;
+    }
+
+    // 并入最后一个条目（索引表已满时可能跨越多次启动，此时只有级别位图仍可用于过滤）
+    if (last->boot_seq != boot_seq) {
+        last->flags |= FLASH_LOG_INDEX_MIXED_BOOTS;
+    }
+    if (summary.records > 0) {
+        if (last->record_count == 0 || summary.first_ts < last->first_timestamp_ms) last->first_timestamp_ms = summary.first_ts;
+        if (summary.last_ts > last->last_timestamp_ms) last->last_timestamp_ms = summary.last_ts;
+    }
+    last->end_offset = end_offset;
+    last->tag_mask |= summary.tag_mask;
+    last->level_mask |= summary.level_mask;
+    last->record_count = (last->record_count + summary.records > 0xFFFF) ? 0xFFFF : last->record_count + summary.records;
+    if (summary.has_tag_defs) last->flags |= FLASH_LOG_INDEX_HAS_TAG_DEFS;
+}
+
+void Sys_FlashLogger::buildSegmentIndex(File& file, const FlashLogSegmentHeader& segment, FlashLogIndexEntry* entries,
+                                        size_t& count, uint32_t& end, uint16_t& last_boot_seq) {
+    const size_t file_size = file.size();
+    count = 0;
+    end = segment.header_size;
+    last_boot_seq = segment.boot_seq;
+
+    FlashLogChunkHeader chunk;
+    while (readChunkHeader(file, end, file_size, chunk)) {
+        const uint32_t next = end + sizeof(chunk) + chunk.stored_len;
+        const size_t raw_len = readChunkBody(file, end, chunk, _compress_buffer, _chunk_buffer);
+        if (raw_len > 0) {
+            ChunkSummary summary;
+            summarizeChunk(_chunk_buffer, raw_len, chunk.record_count, summary);
+            addToIndex(entries, count, end, next, chunk.boot_seq, summary);
+        }
+        last_boot_seq = chunk.boot_seq;
+        end = next;
+    }
+}
+
+void Sys_FlashLogger::writeIndexFile(uint8_t slot, uint32_t segment_seq, const FlashLogIndexEntry* entries, size_t count) {
+    if (entries == nullptr) {
+        return;
+    }
+    File file = FFat.open(indexPath(slot), "w");
+    if (!file) {
+        ESP_LOGE("FlashLogger", "Failed to write log index '%s'.", indexPath(slot).c_str());
+        return;
+    }
+    FlashLogIndexHeader header = {};
+    header.magic = FLASH_LOG_INDEX_MAGIC;
+    header.segment_seq = segment_seq;
+    header.entry_count = count;
+    file.write((const uint8_t*)&header, sizeof(header));
+    file.write((const uint8_t*)entries, count * sizeof(FlashLogIndexEntry));
+    file.close();
+    DEBUG_LOG("Wrote log index for segment %u (seq %u, %u entries).", slot, segment_seq, count);
+}
+
+void Sys_FlashLogger::loadSegmentIndex(File& file, uint8_t slot, const FlashLogSegmentHeader& segment,
+                                       FlashLogIndexEntry* entries, size_t& count) {
+    const String path = indexPath(slot);
+    if (FFat.exists(path)) {
+        File index = FFat.open(path, "r");
+        FlashLogIndexHeader header;
+        if (index && index.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == FLASH_LOG_INDEX_MAGIC && header.segment_seq == segment.segment_seq &&
+            header.entry_count <= MAX_INDEX_ENTRIES) {
+            const size_t bytes = header.entry_count * sizeof(FlashLogIndexEntry);
+            if (index.read((uint8_t*)entries, bytes) == bytes) {
+                count = header.entry_count;
+                return;
+            }
+        }
+    }
+
+    // 索引缺失或已过期：扫描分段重建，写回后下次即可直接使用
+    ESP_LOGW("FlashLogger", "Rebuilding log index for segment %u.", slot);
+    uint32_t end = 0;
+    uint16_t last_boot_seq = 0;
+    buildSegmentIndex(file, segment, entries, count, end, last_boot_seq);
+    writeIndexFile(slot, segment.segment_seq, entries, count);
+}
+
+// --- [新增] 日志查询 (Log Query) ---
+
+const char* Sys_FlashLogger::parseQuery(JsonVariantConst params, FlashLogQuery& query) {
+    query = FlashLogQuery();
+    if (params.isNull()) {
+        return nullptr;
+    }
+    if (!params["boot"].isNull()) query.boot_seq = params["boot"].as<int32_t>();
+    if (!params["from"].isNull()) query.from_ms = params["from"].as<uint32_t>();
+    if (!params["to"].isNull()) query.to_ms = params["to"].as<uint32_t>();
+    if (query.from_ms > query.to_ms) {
+        return "Invalid params: 'from' is later than 'to'";
+    }
+
+    // 级别：字母（"E"/"W"/"I"/"D"/"V"）或对应的数字
+    JsonVariantConst level = params["level"];
+    if (!level.isNull()) {
+        int value = -1;
+        const char* name = level.as<const char*>();
+        if (name != nullptr && name[0] != '\0' && name[1] == '\0') {
+            const char* letters = "NEWIDV";
+            const char* hit = strchr(letters, toupper((unsigned char)name[0]));
+            if (hit != nullptr) value = hit - letters;
+            else if (name[0] >= '0' && name[0] <= '9') value = name[0] - '0';
+        } else if (name == nullptr && level.is<int>()) {
+            value = level.as<int>();
+        }
+        if (value < ESP_LOG_ERROR || value > ESP_LOG_VERBOSE) {
+            return "Invalid params: level must be one of E/W/I/D/V";
         }
+        query.max_level = (uint8_t)value;
+    }
 
-        logFile.write((uint8_t*)item, item_size);
-        logFile.write('\n'); // 每条日志后添加换行符
-        total_written += item_size;
+    // 标签：与记录时一样去除方括号
+    const char* tag = params["tag"];
+    if (tag != nullptr) {
+        if (*tag == '[') tag++;
+        size_t n = 0;
+        while (tag[n] != '\0' && tag[n] != ']' && n < sizeof(query.tag) - 1) {
+            query.tag[n] = tag[n];
+            n++;
+        }
+        query.tag[n] = '\0';
+    }
 
-        // 必须返还item的内存给ringbuffer，以便它可以被重用
-        vRingbufferReturnItem(_ring_buffer_handle, (void*)item);
+    if (!params["limit"].isNull()) {
+        const int limit = params["limit"].as<int>();
+        if (limit <= 0) {
+            return "Invalid params: limit must be positive";
+        }
+        query.limit = (limit > MAX_QUERY_LIMIT) ? MAX_QUERY_LIMIT : (uint16_t)limit;
     }
 
-    logFile.close();
-    
-    DEBUG_LOG("Flush complete. %u bytes written to '%s'.", total_written, _log_filepath.c_str());
+    // 游标："<分段序号>.<数据块偏移>.<记录序号>"，即上一页`next_cursor`的原样回传
+    const char* cursor = params["cursor"];
+    if (cursor != nullptr && cursor[0] != '\0') {
+        char* p = nullptr;
+        const unsigned long seq = strtoul(cursor, &p, 10);
+        if (*p != '.') return "Invalid params: malformed cursor";
+        const unsigned long offset = strtoul(p + 1, &p, 10);
+        if (*p != '.') return "Invalid params: malformed cursor";
+        const unsigned long record = strtoul(p + 1, &p, 10);
+        if (*p != '\0' || record > 0xFFFF) return "Invalid params: malformed cursor";
+        query.has_cursor = true;
+        query.cursor_segment_seq = seq;
+        query.cursor_offset = offset;
+        query.cursor_record = (uint16_t)record;
+    }
+    return nullptr;
+}
+
+bool Sys_FlashLogger::query(const FlashLogQuery& query, JsonObject result) {
+    if (!_front_buffer) {
+        return false;
+    }
+    QueryScratch* scratch = (QueryScratch*)heap_caps_malloc(sizeof(QueryScratch), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!scratch) {
+        ESP_LOGE("FlashLogger", "Failed to allocate %u bytes for a log query.", sizeof(QueryScratch));
+        return false;
+    }
+    JsonArray records = result["records"].to<JsonArray>();
+    result["next_cursor"] = nullptr;
+
+    // 步骤1：先把暂存区中的日志落盘，查询结果因此包含调用前刚记录的日志
+    writeBufferToFile();
+    Sys_LockGuard lock(_file_mutex);
+
+    // 步骤2：读取各分段的文件头，按序号从新到旧排列
+    uint8_t slots[SEGMENT_COUNT];
+    FlashLogSegmentHeader headers[SEGMENT_COUNT];
+    size_t segment_count = 0;
+    for (uint8_t slot = 0; slot < SEGMENT_COUNT; ++slot) {
+        const String path = segmentPath(slot);
+        if (!FFat.exists(path)) continue;
+        File file = (slot == _segment_slot && _segment_file) ? _segment_file : FFat.open(path, "r");
+        FlashLogSegmentHeader header;
+        if (!file) continue;
+        file.seek(0);
+        if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+            header.magic != FLASH_LOG_SEGMENT_MAGIC || header.version != FLASH_LOG_FORMAT_VERSION) {
+            continue;
+        }
+        size_t i = segment_count++;
+        for (; i > 0 && headers[i - 1].segment_seq < header.segment_seq; --i) {
+            slots[i] = slots[i - 1];
+            headers[i] = headers[i - 1];
+        }
+        slots[i] = slot;
+        headers[i] = header;
+    }
+
+    const uint8_t level_filter = (uint8_t)((1u << (query.max_level + 1)) - 1) & ~1u; // 级别1..max_level
+    const bool filter_by_tag = query.tag[0] != '\0';
+    size_t chunks_scanned = 0;
+    char message[MAX_MESSAGE_LENGTH + 1];
+
+    // 步骤3：逐个分段检索
+    for (size_t s = 0; s < segment_count; ++s) {
+        const uint32_t seq = headers[s].segment_seq;
+        if (query.has_cursor && seq > query.cursor_segment_seq) continue;
+        const bool cursor_segment = query.has_cursor && seq == query.cursor_segment_seq;
+
+        const bool active = (slots[s] == _segment_slot && _segment_file);
+        File file = active ? _segment_file : FFat.open(segmentPath(slots[s]), "r");
+        if (!file) continue;
+        const size_t file_size = active ? (_sector_offset + _sector_fill) : file.size();
+        const FlashLogIndexEntry* entries = _active_index;
+        size_t entry_count = _active_index_count;
+        if (!active) {
+            loadSegmentIndex(file, slots[s], headers[s], scratch->entries, entry_count);
+            entries = scratch->entries;
+        }
+        scratch->tag_boot = -1;
+
+        // 步骤4：按索引条目从新到旧检索，跳过不可能命中的条目
+        for (size_t e = entry_count; e-- > 0;) {
+            const FlashLogIndexEntry& entry = entries[e];
+            if (cursor_segment && entry.offset > query.cursor_offset) continue;
+            if (!(entry.level_mask & level_filter)) continue;
+            if (!(entry.flags & FLASH_LOG_INDEX_MIXED_BOOTS)) {
+                if (query.boot_seq >= 0 && entry.boot_seq != query.boot_seq) continue;
+                if (entry.last_timestamp_ms < query.from_ms || entry.first_timestamp_ms > query.to_ms) continue;
+                if (filter_by_tag) {
+                    if (scratch->tag_boot != entry.boot_seq) {
+                        loadTagTable(file, file_size, entries, entry_count, entry.boot_seq, query.tag, scratch, _compress_buffer, _chunk_buffer);
+                    }
+                    if (scratch->filter_tag_id < 0 || !(entry.tag_mask & (1ULL << scratch->filter_tag_id))) continue;
+                }
+            }
+
+            // 步骤5：收集条目中的数据块偏移（只读块头），再倒序解压处理；块太多时分批
+            uint32_t range_end = entry.end_offset;
+            if (cursor_segment && query.cursor_offset < range_end) range_end = query.cursor_offset + 1;
+            while (range_end > entry.offset) {
+                size_t total = 0;
+                uint32_t offset = entry.offset;
+                FlashLogChunkHeader chunk;
+                while (offset < range_end && readChunkHeader(file, offset, file_size, chunk)) {
+                    scratch->chunk_offsets[total % QUERY_CHUNK_WINDOW] = offset;
+                    total++;
+                    offset += sizeof(chunk) + chunk.stored_len;
+                }
+                const size_t window = (total < QUERY_CHUNK_WINDOW) ? total : QUERY_CHUNK_WINDOW;
+
+                for (size_t w = 0; w < window; ++w) {
+                    const uint32_t chunk_offset = scratch->chunk_offsets[(total - 1 - w) % QUERY_CHUNK_WINDOW];
+                    if (!readChunkHeader(file, chunk_offset, file_size, chunk)) continue;
+                    if (query.boot_seq >= 0 && chunk.boot_seq != query.boot_seq) continue;
+                    if (chunk.first_timestamp_ms > query.to_ms) continue;
+
+                    if (chunks_scanned >= MAX_QUERY_CHUNKS) {
+                        // 本次查询的预算用完：从这个（尚未处理的）数据块继续
+                        char cursor[32];
+                        snprintf(cursor, sizeof(cursor), "%u.%u.%u", seq, chunk_offset, 0xFFFFu);
+                        result["next_cursor"] = (char*)cursor;
+                        heap_caps_free(scratch);
+                        return true;
+                    }
+                    if (scratch->tag_boot != chunk.boot_seq) {
+                        loadTagTable(file, file_size, entries, entry_count, chunk.boot_seq, query.tag, scratch, _compress_buffer, _chunk_buffer);
+                    }
+                    if (filter_by_tag && scratch->filter_tag_id < 0) continue;
+
+                    const size_t raw_len = readChunkBody(file, chunk_offset, chunk, _compress_buffer, _chunk_buffer);
+                    chunks_scanned++;
+                    const size_t record_count = splitRecords(_chunk_buffer, raw_len, chunk.record_count, scratch->record_offsets);
+                    const bool cursor_chunk = cursor_segment && chunk_offset == query.cursor_offset;
+
+                    for (size_t r = record_count; r-- > 0;) {
+                        if (cursor_chunk && r >= query.cursor_record) continue;
+                        FlashLogRecordHeader header;
+                        memcpy(&header, _chunk_buffer + scratch->record_offsets[r], sizeof(header));
+                        if (header.level == FLASH_LOG_LEVEL_TAG_DEFINITION || header.level > query.max_level) continue;
+                        if (header.timestamp_ms < query.from_ms || header.timestamp_ms > query.to_ms) continue;
+                        if (filter_by_tag && header.tag_id != scratch->filter_tag_id) continue;
+
+                        const size_t len = (header.length < MAX_MESSAGE_LENGTH) ? header.length : MAX_MESSAGE_LENGTH;
+                        memcpy(message, _chunk_buffer + scratch->record_offsets[r] + sizeof(header), len);
+                        message[len] = '\0';
+
+                        JsonObject item = records.add<JsonObject>();
+                        item["boot"] = chunk.boot_seq;
+                        item["ts"] = header.timestamp_ms;
+                        item["level"] = LEVEL_NAMES[header.level < ESP_LOG_VERBOSE ? header.level : ESP_LOG_VERBOSE];
+                        item["tag"] = scratch->tag_names[header.tag_id < MAX_TAGS ? header.tag_id : 0];
+                        item["msg"] = message;
+
+                        if (records.size() >= query.limit) {
+                            char cursor[32];
+                            snprintf(cursor, sizeof(cursor), "%u.%u.%u", seq, chunk_offset, (unsigned)r);
+                            result["next_cursor"] = (char*)cursor;
+                            heap_caps_free(scratch);
+                            return true;
+                        }
+                    }
+                }
+                if (total <= QUERY_CHUNK_WINDOW) break;
+                range_end = scratch->chunk_offsets[(total - window) % QUERY_CHUNK_WINDOW];
+            }
+        }
+    }
+
+    heap_caps_free(scratch);
+    return true;
+}
+
+/**
+ * @brief 将暂存数据写入文件的核心逻辑。
+ */
+void Sys_FlashLogger::writeBufferToFile() {
+    // [优化] 文件锁覆盖整个循环：刷写任务与查询调用者可能同时进入，后台缓冲区只能由其中一方处理。
+    // `log()`调用者只获取`_stage_mutex`，不受影响。
+    Sys_LockGuard file_lock(_file_mutex);
+    for (;;) {
+        // 步骤1：取得待写入的后台缓冲区。后台空闲时，把前台缓冲区交换过来。
+        const uint8_t* batch = nullptr;
+        size_t batch_len = 0;
+        uint32_t dropped = 0;
+        {
+            Sys_LockGuard lock(_stage_mutex);
+            if (_back_fill == 0 && _front_fill > 0) {
+                uint8_t* full = _front_buffer;
+                _front_buffer = _back_buffer;
+                _back_buffer = full;
+                _back_fill = _front_fill;
+                _front_fill = 0;
+            }
+            batch = _back_buffer;
+            batch_len = _back_fill;
+            dropped = _stats.messages_dropped - _reported_drops;
+            _reported_drops = _stats.messages_dropped;
+        }
+        if (dropped > 0) {
+            ESP_LOGW("FlashLogger", "%u log messages dropped, staging buffers were full.", dropped);
+        }
+        if (batch_len == 0) {
+            // 两个缓冲区都为空，直接返回，避免不必要的文件操作
+            return;
+        }
+
+        // 步骤2：执行I/O操作。此期间`log()`调用者只会写入前台缓冲区。
+        const int64_t start_us = esp_timer_get_time();
+        size_t total_records = 0;
+        {
+            SYS_TRACE_SCOPE(TracePoint::FLASHLOG_FLUSH);
+            if (_segment_file) {
+                DEBUG_LOG("Flushing log buffer to flash...");
+
+                // 步骤3：把整批记录打包进数据块；写满的扇区在此过程中直接写入文件
+                size_t pos = 0;
+                while (pos + sizeof(FlashLogRecordHeader) <= batch_len) {
+                    FlashLogRecordHeader header;
+                    memcpy(&header, batch + pos, sizeof(header));
+                    const size_t size = sizeof(header) + header.length;
+                    if (pos + size > batch_len) break;
+                    appendRecord(batch + pos, size);
+                    pos += size;
+                    total_records++;
+                }
+
+                // 步骤4：封装最后一个数据块，写入尾扇区并提交FAT
+                sealChunk();
+                writeTailSector();
+                _segment_file.flush();
+            } else {
+                ESP_LOGE("FlashLogger", "No open log segment, %u bytes of logs discarded.", batch_len);
+            }
+        }
+        const uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+        // 步骤5：释放后台缓冲区并更新统计
+        {
+            Sys_LockGuard lock(_stage_mutex);
+            _back_fill = 0;
+            _stats.flush_count++;
+            _stats.last_flush_us = elapsed_us;
+            if (elapsed_us > _stats.max_flush_us) _stats.max_flush_us = elapsed_us;
+            _stats.total_flush_us += elapsed_us;
+            _stats.sectors_written = _sectors_written;
+        }
+        DEBUG_LOG("Flush complete. %u records written to segment %u in %u us.", total_records, _segment_slot, elapsed_us);
+    }
 }
 
 /**
@@ -203,7 +1094,7 @@ void Sys_FlashLogger::flushTask(void* parameter) {
     for (;;) {
         // 阻塞等待，直到被手动flush()或超时唤醒
         xSemaphoreTake(self->_flush_semaphore, pdMS_TO_TICKS(self->_flush_interval_ms));
-        
+
         // 无论是哪种方式唤醒，都执行一次刷写操作。
         self->writeBufferToFile();
     }
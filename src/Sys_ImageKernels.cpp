@@ -0,0 +1,474 @@
+/**
+ * @file Sys_ImageKernels.cpp
+ * @brief 条码预处理图像内核库的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * SWAR技巧：一个32位字在小端序下依次装着4个像素（字节0为最左侧像素）。
+ * 把偶数/奇数像素分别掩码到16位通道（`& 0x00FF00FF`）后，两个通道可以在同一次加法中累加而互不进位，
+ * 因此2x2平均值可以两个一组地计算，且结果与逐像素的`(a + b + c + d + 2) >> 2`完全相同。
+ *
+ * [新增] PIE版本沿用同样的通道划分，只是寄存器变为128位（Q0～Q7），一次处理4个32位字：
+ * - `EE.VLD.128.IP`/`EE.VST.128.IP`要求16字节对齐（地址低4位被忽略），因此只在对齐的主体部分使用；
+ *   自适应二值化的四个角指针相差奇数个元素，无法同时对齐，改用`EE.LD.128.USAR.IP` + `EE.SRC.Q`做非对齐加载。
+ * - Q寄存器不受编译器管理，每个内联汇编块在自身内部完成加载、计算和存储，不跨块保留Q寄存器或SAR的值。
+ */
+#include "Sys_ImageKernels.h"
+
+/** @brief 判断指针是否满足32位对齐。*/
+static inline bool isWordAligned(const void* p) {
+    return (reinterpret_cast<uintptr_t>(p) & 3) == 0;
+}
+
+#if SYS_IMAGE_KERNELS_PIE
+/** @brief 判断指针是否满足128位（16字节）对齐。*/
+static inline bool isQuadAligned(const void* p) {
+    return (reinterpret_cast<uintptr_t>(p) & 15) == 0;
+}
+
+/** @brief `EE.VLDBC.32`广播用的常量：偶数像素掩码与2x2平均的舍入偏置（每个16位通道各一份）。*/
+static const uint32_t PIE_LANE_MASK = 0x00FF00FFu;
+static const uint32_t PIE_ROUND_BIAS = 0x00020002u;
+#endif
+
+/**
+ * @struct Rgb565GrayTables
+ * @brief RGB565灰度转换查找表。
+ * @details 扩展到8位后，R只来自高字节、B只来自低字节；G的高3位（含其扩展用的最高2位）在高字节、低3位在低字节，
+ *          因此`77*R8 + 150*G8 + 29*B8 + 128`可以精确地拆为`hi[高字节] + lo[低字节]`，最大值65408不溢出16位。
+ */
+struct Rgb565GrayTables {
+    uint16_t hi[256];
+    uint16_t lo[256];
+
+    Rgb565GrayTables() {
+        for (uint32_t v = 0; v < 256; ++v) {
+            const uint32_t r5 = v >> 3;
+            const uint32_t g_hi = v & 0x07;
+            hi[v] = static_cast<uint16_t>(77 * ((r5 << 3) | (r5 >> 2)) + 150 * (g_hi * 32 + (g_hi >> 1)) + 128);
+
+            const uint32_t g_lo = v >> 5;
+            const uint32_t b5 = v & 0x1F;
+            lo[v] = static_cast<uint16_t>(150 * (g_lo * 4) + 29 * ((b5 << 3) | (b5 >> 2)));
+        }
+    }
+};
+
+/** @brief 首次使用时构建查找表（C++11保证局部静态对象的初始化是线程安全的）。*/
+static const Rgb565GrayTables& rgb565GrayTables() {
+    static const Rgb565GrayTables tables;
+    return tables;
+}
+
+/** @brief 一个RGB565像素的灰度值（参考实现）。*/
+static inline uint8_t rgb565Gray(uint16_t px) {
+    const uint32_t r5 = px >> 11;
+    const uint32_t g6 = (px >> 5) & 0x3F;
+    const uint32_t b5 = px & 0x1F;
+    const uint32_t r8 = (r5 << 3) | (r5 >> 2);
+    const uint32_t g8 = (g6 << 2) | (g6 >> 4);
+    const uint32_t b8 = (b5 << 3) | (b5 >> 2);
+    return static_cast<uint8_t>((77 * r8 + 150 * g8 + 29 * b8 + 128) >> 8);
+}
+
+/**
+ * @brief 对同一列上下两个字（各4个像素）计算2个2x2平均值，结果位于返回值的低16位。
+ */
+static inline uint32_t averageQuad(uint32_t top, uint32_t bottom) {
+    const uint32_t sum = (top & 0x00FF00FFu) + ((top >> 8) & 0x00FF00FFu) +
+                         (bottom & 0x00FF00FFu) + ((bottom >> 8) & 0x00FF00FFu) + 0x00020002u;
+    const uint32_t avg = (sum >> 2) & 0x00FF00FFu;
+    return (avg & 0xFFu) | ((avg >> 8) & 0xFF00u);
+}
+
+// =================================================================================================
+// 灰度转换
+// =================================================================================================
+
+void Sys_ImageKernels::yuyvToGray(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+#if SYS_IMAGE_KERNELS_PIE
+    yuyvToGrayPie(src, dst, pixel_count);
+#else
+    yuyvToGraySwar(src, dst, pixel_count);
+#endif
+}
+
+void Sys_ImageKernels::yuyvToGraySwar(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    // 逐像素处理到输出对齐为止；此后输入若也对齐，则每次读2个字、写1个字（4个像素）
+    for (; i < pixel_count && !isWordAligned(dst + i); ++i) {
+        dst[i] = src[2 * i];
+    }
+    if (isWordAligned(src + 2 * i)) {
+        const uint32_t* in = reinterpret_cast<const uint32_t*>(src + 2 * i);
+        uint32_t* out = reinterpret_cast<uint32_t*>(dst + i);
+        for (; i + 4 <= pixel_count; i += 4) {
+            const uint32_t w0 = *in++; // Y0 U Y1 V
+            const uint32_t w1 = *in++; // Y2 U Y3 V
+            *out++ = (w0 & 0xFFu) | ((w0 >> 8) & 0xFF00u) | ((w1 & 0xFFu) << 16) | ((w1 << 8) & 0xFF000000u);
+        }
+    }
+    for (; i < pixel_count; ++i) {
+        dst[i] = src[2 * i];
+    }
+}
+
+void Sys_ImageKernels::yuyvToGrayReference(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        dst[i] = src[2 * i];
+    }
+}
+
+#if SYS_IMAGE_KERNELS_PIE
+void Sys_ImageKernels::yuyvToGrayPie(const uint8_t* src, uint8_t* dst, size_t pixel_count) {
+    size_t i = 0;
+    for (; i < pixel_count && !isQuadAligned(dst + i); ++i) {
+        dst[i] = src[2 * i];
+    }
+    // 每次读取32字节（16个像素），解交织后偶数字节即为16个亮度值
+    size_t blocks = (pixel_count - i) / 16;
+    if (blocks > 0 && isQuadAligned(src + 2 * i)) {
+        const uint8_t* in = src + 2 * i;
+        uint8_t* out = dst + i;
+        i += blocks * 16;
+        asm volatile(
+            "1:                                 \n"
+            "ee.vld.128.ip      q0, %[in], 16   \n"
+            "ee.vld.128.ip      q1, %[in], 16   \n"
+            "ee.vunzip.8        q0, q1          \n" // q0 = Y0..Y15, q1 = U/V
+            "ee.vst.128.ip      q0, %[out], 16  \n"
+            "addi               %[n], %[n], -1  \n"
+            "bnez               %[n], 1b        \n"
+            : [in] "+r"(in), [out] "+r"(out), [n] "+r"(blocks)
+            :
+            : "memory");
+    }
+    yuyvToGraySwar(src + 2 * i, dst + i, pixel_count - i);
+}
+#endif
+
+void Sys_ImageKernels::rgb565ToGray(const uint16_t* src, uint8_t* dst, size_t pixel_count) {
+    const Rgb565GrayTables& t = rgb565GrayTables();
+    size_t i = 0;
+    for (; i < pixel_count && !isWordAligned(dst + i); ++i) {
+        dst[i] = static_cast<uint8_t>((t.hi[src[i] >> 8] + t.lo[src[i] & 0xFF]) >> 8);
+    }
+    if (isWordAligned(src + i)) {
+        const uint32_t* in = reinterpret_cast<const uint32_t*>(src + i);
+        uint32_t* out = reinterpret_cast<uint32_t*>(dst + i);
+        for (; i + 4 <= pixel_count; i += 4) {
+            const uint32_t p01 = *in++;
+            const uint32_t p23 = *in++;
+            const uint32_t g0 = (t.hi[(p01 >> 8) & 0xFF] + t.lo[p01 & 0xFF]) >> 8;
+            const uint32_t g1 = (t.hi[p01 >> 24] + t.lo[(p01 >> 16) & 0xFF]) >> 8;
+            const uint32_t g2 = (t.hi[(p23 >> 8) & 0xFF] + t.lo[p23 & 0xFF]) >> 8;
+            const uint32_t g3 = (t.hi[p23 >> 24] + t.lo[(p23 >> 16) & 0xFF]) >> 8;
+            *out++ = g0 | (g1 << 8) | (g2 << 16) | (g3 << 24);
+        }
+    }
+    for (; i < pixel_count; ++i) {
+        dst[i] = static_cast<uint8_t>((t.hi[src[i] >> 8] + t.lo[src[i] & 0xFF]) >> 8);
+    }
+}
+
+void Sys_ImageKernels::rgb565ToGrayReference(const uint16_t* src, uint8_t* dst, size_t pixel_count) {
+    for (size_t i = 0; i < pixel_count; ++i) {
+        dst[i] = rgb565Gray(src[i]);
+    }
+}
+
+// =================================================================================================
+// 降采样
+// =================================================================================================
+
+/**
+ * @brief 降采样一行：先以SWAR处理对齐的部分，其余逐像素处理。
+ * @param x 起始输出列（之前的列已由PIE版本处理）。
+ */
+static void downscaleRowSwar(const uint8_t* top, const uint8_t* bottom, uint8_t* out, size_t x, size_t out_width) {
+    if (isWordAligned(top + 2 * x) && isWordAligned(bottom + 2 * x) && isWordAligned(out + x)) {
+        // 每次读取上下各8个像素，输出4个像素
+        const uint32_t* t = reinterpret_cast<const uint32_t*>(top + 2 * x);
+        const uint32_t* b = reinterpret_cast<const uint32_t*>(bottom + 2 * x);
+        uint32_t* o = reinterpret_cast<uint32_t*>(out + x);
+        for (; x + 4 <= out_width; x += 4) {
+            *o++ = averageQuad(t[0], b[0]) | (averageQuad(t[1], b[1]) << 16);
+            t += 2;
+            b += 2;
+        }
+    }
+    for (; x < out_width; ++x) {
+        out[x] = static_cast<uint8_t>((top[2 * x] + top[2 * x + 1] + bottom[2 * x] + bottom[2 * x + 1] + 2) >> 2);
+    }
+}
+
+void Sys_ImageKernels::downscale2x(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+#if SYS_IMAGE_KERNELS_PIE
+    downscale2xPie(src, width, height, src_stride, dst, dst_stride);
+#else
+    downscale2xSwar(src, width, height, src_stride, dst, dst_stride);
+#endif
+}
+
+void Sys_ImageKernels::downscale2xSwar(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+    const size_t out_width = width / 2;
+    const size_t out_height = height / 2;
+    for (size_t y = 0; y < out_height; ++y) {
+        const uint8_t* top = src + 2 * y * src_stride;
+        downscaleRowSwar(top, top + src_stride, dst + y * dst_stride, 0, out_width);
+    }
+}
+
+void Sys_ImageKernels::downscale2xReference(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+    for (size_t y = 0; y < height / 2u; ++y) {
+        for (size_t x = 0; x < width / 2u; ++x) {
+            const uint8_t* p = src + 2 * y * src_stride + 2 * x;
+            dst[y * dst_stride + x] = static_cast<uint8_t>((p[0] + p[1] + p[src_stride] + p[src_stride + 1] + 2) >> 2);
+        }
+    }
+}
+
+#if SYS_IMAGE_KERNELS_PIE
+/**
+ * @brief 以PIE指令降采样一行的`blocks * 16`个输出像素，三个指针都必须16字节对齐。
+ * @details 与`averageQuad()`相同：偶数像素`& 0x00FF00FF`、奇数像素`>> 8 & 0x00FF00FF`落在16位通道中，
+ *          上下两行四项相加再加2后右移2位；最后`EE.VUNZIP.8`取出每个16位通道的低字节。
+ *          通道值不超过1022，`EE.VADDS.S16`的饱和不会发生。
+ */
+static void downscaleRowPie(const uint8_t* top, const uint8_t* bottom, uint8_t* out, size_t blocks) {
+    uint32_t shift;
+    asm volatile(
+        "ee.vldbc.32        q6, %[mask]         \n" // q6 = 0x00FF00FF x4
+        "ee.vldbc.32        q7, %[bias]         \n" // q7 = 0x00020002 x4
+        "1:                                     \n"
+        "ee.vld.128.ip      q0, %[top], 16      \n" // 上一行的32个像素
+        "ee.vld.128.ip      q1, %[top], 16      \n"
+        "ee.vld.128.ip      q2, %[bottom], 16   \n" // 下一行的32个像素
+        "ee.vld.128.ip      q3, %[bottom], 16   \n"
+        "movi               %[shift], 8         \n"
+        "wsr.sar            %[shift]            \n"
+        // 输出像素0～7：各行的水平像素对之和，再上下相加
+        "ee.vsr.32          q4, q0              \n"
+        "ee.vsr.32          q5, q2              \n"
+        "ee.andq            q0, q0, q6          \n"
+        "ee.andq            q4, q4, q6          \n"
+        "ee.andq            q2, q2, q6          \n"
+        "ee.andq            q5, q5, q6          \n"
+        "ee.vadds.s16       q0, q0, q4          \n"
+        "ee.vadds.s16       q2, q2, q5          \n"
+        "ee.vadds.s16       q0, q0, q2          \n"
+        // 输出像素8～15
+        "ee.vsr.32          q4, q1              \n"
+        "ee.vsr.32          q5, q3              \n"
+        "ee.andq            q1, q1, q6          \n"
+        "ee.andq            q4, q4, q6          \n"
+        "ee.andq            q3, q3, q6          \n"
+        "ee.andq            q5, q5, q6          \n"
+        "ee.vadds.s16       q1, q1, q4          \n"
+        "ee.vadds.s16       q3, q3, q5          \n"
+        "ee.vadds.s16       q1, q1, q3          \n"
+        // (sum + 2) >> 2，清除从相邻通道移入的位
+        "ee.vadds.s16       q0, q0, q7          \n"
+        "ee.vadds.s16       q1, q1, q7          \n"
+        "movi               %[shift], 2         \n"
+        "wsr.sar            %[shift]            \n"
+        "ee.vsr.32          q0, q0              \n"
+        "ee.vsr.32          q1, q1              \n"
+        "ee.andq            q0, q0, q6          \n"
+        "ee.andq            q1, q1, q6          \n"
+        "ee.vunzip.8        q0, q1              \n" // q0 = 16个16位通道的低字节
+        "ee.vst.128.ip      q0, %[out], 16      \n"
+        "addi               %[n], %[n], -1      \n"
+        "bnez               %[n], 1b            \n"
+        : [top] "+r"(top), [bottom] "+r"(bottom), [out] "+r"(out), [n] "+r"(blocks), [shift] "=&r"(shift)
+        : [mask] "r"(&PIE_LANE_MASK), [bias] "r"(&PIE_ROUND_BIAS)
+        : "memory");
+}
+
+void Sys_ImageKernels::downscale2xPie(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint8_t* dst, size_t dst_stride) {
+    const size_t out_width = width / 2;
+    const size_t out_height = height / 2;
+    const size_t blocks = out_width / 16;
+    for (size_t y = 0; y < out_height; ++y) {
+        const uint8_t* top = src + 2 * y * src_stride;
+        const uint8_t* bottom = top + src_stride;
+        uint8_t* out = dst + y * dst_stride;
+        size_t x = 0;
+        if (blocks > 0 && isQuadAligned(top) && isQuadAligned(bottom) && isQuadAligned(out)) {
+            downscaleRowPie(top, bottom, out, blocks);
+            x = blocks * 16;
+        }
+        downscaleRowSwar(top, bottom, out, x, out_width);
+    }
+}
+#endif
+
+// =================================================================================================
+// 积分图
+// =================================================================================================
+
+void Sys_ImageKernels::integralImage(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint32_t* dst) {
+    // 行内前缀和 + 上一行：每个元素只需一次加法和一次读取
+    const size_t stride = width + 1;
+    memset(dst, 0, stride * sizeof(uint32_t));
+    for (size_t y = 0; y < height; ++y) {
+        const uint8_t* in = src + y * src_stride;
+        const uint32_t* above = dst + y * stride;
+        uint32_t* row = dst + (y + 1) * stride;
+        uint32_t running = 0;
+        row[0] = 0;
+        for (size_t x = 0; x < width; ++x) {
+            running += in[x];
+            row[x + 1] = above[x + 1] + running;
+        }
+    }
+}
+
+void Sys_ImageKernels::integralImageReference(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, uint32_t* dst) {
+    const size_t stride = width + 1;
+    for (size_t y = 0; y <= height; ++y) {
+        for (size_t x = 0; x <= width; ++x) {
+            if (x == 0 || y == 0) {
+                dst[y * stride + x] = 0;
+            } else {
+                dst[y * stride + x] = src[(y - 1) * src_stride + (x - 1)] + dst[(y - 1) * stride + x] +
+                                      dst[y * stride + (x - 1)] - dst[(y - 1) * stride + (x - 1)];
+            }
+        }
+    }
+}
+
+// =================================================================================================
+// 自适应二值化
+// =================================================================================================
+
+#if SYS_IMAGE_KERNELS_PIE
+/**
+ * @brief 以PIE指令计算4个连续内部像素的窗口和，写入16字节对齐的`sums`，四个角指针各前进4个元素。
+ * @details 每路数据先用`EE.LD.128.USAR.IP`加载所在的对齐块（同时按地址低4位设置SAR_BYTE），
+ *          再加载下一个对齐块，由`EE.SRC.Q`拼出从该地址开始的16字节。积分图的值小于2^31，
+ *          `(br - tr) - (bl - tl)`的每一步都非负，`EE.VSUBS.S32`的饱和不会发生。
+ */
+static inline void windowSums4Pie(const uint32_t*& tl, const uint32_t*& tr, const uint32_t*& bl, const uint32_t*& br, uint32_t* sums) {
+    asm volatile(
+        "ee.ld.128.usar.ip  q0, %[br], 16       \n"
+        "ee.vld.128.ip      q1, %[br], 0        \n"
+        "ee.src.q           q0, q0, q1          \n" // q0 = br[0..3]
+        "ee.ld.128.usar.ip  q2, %[tr], 16       \n"
+        "ee.vld.128.ip      q3, %[tr], 0        \n"
+        "ee.src.q           q2, q2, q3          \n" // q2 = tr[0..3]
+        "ee.ld.128.usar.ip  q4, %[bl], 16       \n"
+        "ee.vld.128.ip      q5, %[bl], 0        \n"
+        "ee.src.q           q4, q4, q5          \n" // q4 = bl[0..3]
+        "ee.ld.128.usar.ip  q6, %[tl], 16       \n"
+        "ee.vld.128.ip      q7, %[tl], 0        \n"
+        "ee.src.q           q6, q6, q7          \n" // q6 = tl[0..3]
+        "ee.vsubs.s32       q0, q0, q2          \n"
+        "ee.vsubs.s32       q4, q4, q6          \n"
+        "ee.vsubs.s32       q0, q0, q4          \n"
+        "ee.vst.128.ip      q0, %[sums], 0      \n"
+        : [tl] "+r"(tl), [tr] "+r"(tr), [bl] "+r"(bl), [br] "+r"(br)
+        : [sums] "r"(sums)
+        : "memory");
+}
+#endif
+
+/**
+ * @brief 自适应二值化的可移植实现；`use_pie`为`true`时内部像素的窗口和以4个为一组由PIE指令计算。
+ */
+static void adaptiveThresholdRows(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                  uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride, bool use_pie) {
+    radius = constrain(radius, (uint8_t)1, Sys_ImageKernels::MAX_THRESHOLD_RADIUS);
+    const uint32_t factor = 100 - (bias_percent > 100 ? 100 : bias_percent);
+    const size_t stride = width + 1;
+    const size_t r = radius;
+#if SYS_IMAGE_KERNELS_PIE
+    alignas(16) uint32_t sums[4];
+#else
+    (void)use_pie;
+#endif
+    // 窗口不会越过左右边缘的x范围 [interior_begin, interior_end)
+    const size_t interior_begin = (r < width) ? r : width;
+    const size_t interior_end = (width >= 2 * r + 1) ? width - r : interior_begin;
+
+    for (size_t y = 0; y < height; ++y) {
+        const size_t y0 = (y > r) ? y - r : 0;
+        const size_t y1 = (y + r + 1 < height) ? y + r + 1 : height;
+        const uint32_t* top = integral + y0 * stride;
+        const uint32_t* bottom = integral + y1 * stride;
+        const uint8_t* in = src + y * src_stride;
+        uint8_t* out = dst + y * dst_stride;
+        const uint32_t rows = y1 - y0;
+
+        // 边缘像素：逐个裁剪窗口
+        auto edgePixel = [&](size_t x) {
+            const size_t x0 = (x > r) ? x - r : 0;
+            const size_t x1 = (x + r + 1 < width) ? x + r + 1 : width;
+            const uint32_t sum = bottom[x1] - top[x1] - bottom[x0] + top[x0];
+            out[x] = (in[x] * rows * (x1 - x0) * 100 < sum * factor) ? 0 : 255;
+        };
+        for (size_t x = 0; x < interior_begin; ++x) {
+            edgePixel(x);
+        }
+        // 内部像素：窗口面积不变，四个角的指针同步前进
+        const uint32_t area100 = rows * (2 * r + 1) * 100;
+        const uint32_t* tl = top + (interior_begin - r);
+        const uint32_t* bl = bottom + (interior_begin - r);
+        const uint32_t* tr = top + (interior_begin + r + 1);
+        const uint32_t* br = bottom + (interior_begin + r + 1);
+        size_t x = interior_begin;
+#if SYS_IMAGE_KERNELS_PIE
+        // 第二次对齐加载最多读到当前位置之后7个元素，留出余量，保证末行也不越过积分图的末尾
+        for (; use_pie && x + 8 <= interior_end; x += 4) {
+            windowSums4Pie(tl, tr, bl, br, sums);
+            for (size_t k = 0; k < 4; ++k) {
+                out[x + k] = (in[x + k] * area100 < sums[k] * factor) ? 0 : 255;
+            }
+        }
+#endif
+        for (; x < interior_end; ++x) {
+            const uint32_t sum = *br++ - *tr++ - *bl++ + *tl++;
+            out[x] = (in[x] * area100 < sum * factor) ? 0 : 255;
+        }
+        for (size_t x = interior_end; x < width; ++x) {
+            edgePixel(x);
+        }
+    }
+}
+
+void Sys_ImageKernels::adaptiveThreshold(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                         uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride) {
+    adaptiveThresholdRows(src, width, height, src_stride, integral, radius, bias_percent, dst, dst_stride, SYS_IMAGE_KERNELS_PIE);
+}
+
+void Sys_ImageKernels::adaptiveThresholdSwar(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                             uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride) {
+    adaptiveThresholdRows(src, width, height, src_stride, integral, radius, bias_percent, dst, dst_stride, false);
+}
+
+#if SYS_IMAGE_KERNELS_PIE
+void Sys_ImageKernels::adaptiveThresholdPie(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                            uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride) {
+    adaptiveThresholdRows(src, width, height, src_stride, integral, radius, bias_percent, dst, dst_stride, true);
+}
+#endif
+
+void Sys_ImageKernels::adaptiveThresholdReference(const uint8_t* src, uint16_t width, uint16_t height, size_t src_stride, const uint32_t* integral,
+                                                  uint8_t radius, uint8_t bias_percent, uint8_t* dst, size_t dst_stride) {
+    radius = constrain(radius, (uint8_t)1, MAX_THRESHOLD_RADIUS);
+    const uint32_t factor = 100 - (bias_percent > 100 ? 100 : bias_percent);
+    const size_t stride = width + 1;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            const size_t x0 = (x > radius) ? x - radius : 0;
+            const size_t y0 = (y > radius) ? y - radius : 0;
+            const size_t x1 = (x + radius + 1 < width) ? x + radius + 1 : width;
+            const size_t y1 = (y + radius + 1 < height) ? y + radius + 1 : height;
+            const uint32_t sum = integral[y1 * stride + x1] - integral[y0 * stride + x1] -
+                                 integral[y1 * stride + x0] + integral[y0 * stride + x0];
+            const uint32_t count = (x1 - x0) * (y1 - y0);
+            dst[y * dst_stride + x] = (src[y * src_stride + x] * count * 100 < sum * factor) ? 0 : 255;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @file Sys_Lzss.cpp
+ * @brief 轻量级LZSS块压缩工具的实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 压缩端使用单槽哈希表（3字节前缀 -> 最近出现位置）寻找匹配，速度优先于压缩率；
+ * 对日志文本这类重复度高的数据，通常可达到2~4倍的压缩比。
+ */
+#include "Sys_Lzss.h"
+#include <cstring>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 3;
+constexpr size_t MAX_MATCH = 18; // 4位长度字段 + MIN_MATCH
+
+/** @brief 3字节前缀的哈希，结果落在工作区范围内。*/
+inline uint16_t hashPrefix(const uint8_t* p) {
+    const uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+    return (uint16_t)((v * 2654435761u) >> 20) & (Sys_Lzss::WORKSPACE_ENTRIES - 1);
+}
+
+} // namespace
+
+size_t Sys_Lzss::compress(const uint8_t* input, size_t input_len, uint8_t* output, size_t output_cap, uint16_t* workspace) {
+    if (input_len > 0xFFFF) {
+        return 0; // 工作区以uint16_t保存位置
+    }
+    // 工作区中保存“位置+1”，0表示空槽
+    memset(workspace, 0, WORKSPACE_ENTRIES * sizeof(uint16_t));
+
+    size_t in = 0;
+    size_t out = 0;
+    while (in < input_len) {
+        // 为接下来的（最多）8个条目预留控制字节
+        if (out >= output_cap) return 0;
+        const size_t flag_pos = out++;
+        uint8_t flags = 0;
+
+        for (uint8_t bit = 0; bit < 8 && in < input_len; ++bit) {
+            size_t match_len = 0;
+            size_t match_off = 0;
+            if (input_len - in >= MIN_MATCH) {
+                const uint16_t h = hashPrefix(input + in);
+                const size_t candidate = workspace[h];
+                workspace[h] = (uint16_t)(in + 1);
+                if (candidate != 0) {
+                    const size_t pos = candidate - 1;
+                    const size_t offset = in - pos;
+                    if (offset <= WINDOW_SIZE) {
+                        const size_t limit = (input_len - in < MAX_MATCH) ? input_len - in : MAX_MATCH;
+                        while (match_len < limit && input[pos + match_len] == input[in + match_len]) {
+                            match_len++;
+                        }
+                        match_off = offset;
+                    }
+                }
+            }
+
+            if (match_len >= MIN_MATCH) {
+                if (out + 2 > output_cap) return 0;
+                const uint16_t off = (uint16_t)(match_off - 1);
+                output[out++] = (uint8_t)(off >> 4);
+                output[out++] = (uint8_t)(((off & 0x0F) << 4) | (match_len - MIN_MATCH));
+                flags |= (uint8_t)(1u << bit);
+                // 把匹配区间内的前缀也登记进哈希表，提高后续命中率
+                for (size_t k = 1; k < match_len && in + k + MIN_MATCH <= input_len; ++k) {
+                    workspace[hashPrefix(input + in + k)] = (uint16_t)(in + k + 1);
+                }
+                in += match_len;
+            } else {
+                if (out >= output_cap) return 0;
+                output[out++] = input[in++];
+            }
+        }
+        output[flag_pos] = flags;
+    }
+    return out;
+}
+
+size_t Sys_Lzss::decompress(const uint8_t* input, size_t input_len, uint8_t* output, size_t output_cap) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < input_len) {
+        const uint8_t flags = input[in++];
+        for (uint8_t bit = 0; bit < 8 && in < input_len; ++bit) {
+            if (flags & (1u << bit)) {
+                if (in + 2 > input_len) return 0;
+                const size_t offset = (((size_t)input[in] << 4) | (input[in + 1] >> 4)) + 1;
+                const size_t length = (input[in + 1] & 0x0F) + MIN_MATCH;
+                in += 2;
+                if (offset > out || out + length > output_cap) return 0;
+                // 逐字节复制：匹配区间允许与输出重叠（如连续重复字符）
+                for (size_t k = 0; k < length; ++k, ++out) {
+                    output[out] = output[out - offset];
+                }
+            } else {
+                if (out >= output_cap) return 0;
+                output[out++] = input[in++];
+            }
+        }
+    }
+    return out;
+}
@@ -1,27 +1,41 @@
 /**
  * @file Sys_MemoryManager.cpp
- * @brief PSRAM固定块内存池管理器的实现
+ * @brief PSRAM多级固定块内存池管理器的实现
  * @author [ANEAK]
  * @date [2025/7]
  *
  * @details
- *  实现了应用层的、手动的、固定块内存池管理。
+ *  实现了应用层的、按尺寸分级的固定块内存池管理。
+ *  所有级别从同一块PSRAM区域中连续切分，释放时通过地址区间定位所属级别，
+ *  再通过移位计算块索引，整个分配/释放路径不含任何循环扫描。
+ *  [优化] 位图与每核弹匣均为原子变量，分配/释放全程无锁。
  */
 #include "Sys_MemoryManager.h"
 #include "Sys_Debug.h"
 #include "esp_heap_caps.h"
 #include "Sys_FlashLogger.h" // [新增] 引入闪存日志模块
-#include <numeric> // For std::iota
 
 // --- 内存池配置 ---
-static const size_t FRAMEBUFFER_HEAP_SIZE = 4 * 1024 * 1024; // 预留4MB PSRAM
+/**
+ * @brief 各尺寸级别的几何配置，顺序必须与`MemPoolClass`一致。
+ * @details 总计 32KB + 192KB + 768KB + 1MB + 4MB = 6112KB。1MB级别保持原先的4块，
+ *          小级别在其之外追加预留，不挤占帧缓冲。
+ */
+static constexpr struct {
+    size_t block_size;
+    uint16_t block_count;
+} POOL_LAYOUT[] = {
+    {        512, 64 }, // POOL_512B
+    {   4 * 1024, 48 }, // POOL_4KB
+    {  32 * 1024, 24 }, // POOL_32KB
+    { 256 * 1024,  4 }, // POOL_256KB
+    {1024 * 1024,  4 }, // POOL_1MB
+};
+static_assert(sizeof(POOL_LAYOUT) / sizeof(POOL_LAYOUT[0]) == static_cast<size_t>(MemPoolClass::COUNT),
+              "POOL_LAYOUT must define every MemPoolClass");
 
 // --- 静态成员初始化 ---
 Sys_MemoryManager* Sys_MemoryManager::_instance = nullptr;
-void* Sys_MemoryManager::_framebuffer_heap_start = nullptr;
-std::vector<bool> Sys_MemoryManager::_block_is_used;
-size_t Sys_MemoryManager::_block_size = 0;
-size_t Sys_MemoryManager::_block_count = 0;
 
 /**
  * @brief 获取内存管理器的单例实例。
@@ -47,102 +61,351 @@ Sys_MemoryManager::Sys_MemoryManager() {
  * @brief 初始化内存池。
  */
 bool Sys_MemoryManager::initializePools() {
-    DEBUG_LOG("Initializing Framebuffer Memory Pool...");
+    DEBUG_LOG("Initializing multi-class PSRAM Memory Pool...");
+
+    // 1. 计算所有级别所需的总大小
+    size_t total_size = 0;
+    for (const auto& layout : POOL_LAYOUT) {
+        total_size += layout.block_size * layout.block_count;
+    }
 
-    // 1. 从PSRAM中为我们的内存池预分配一大块内存
-    _framebuffer_heap_start = heap_caps_malloc(FRAMEBUFFER_HEAP_SIZE, MALLOC_CAP_SPIRAM);
+    // 2. 从PSRAM中为我们的内存池预分配一大块内存
+    _pool_heap_start = static_cast<uint8_t*>(heap_caps_malloc(total_size, MALLOC_CAP_SPIRAM));
 
-    if (_framebuffer_heap_start == nullptr) {
-        ESP_LOGE("MemManager", "Fatal: Failed to allocate %d bytes for Framebuffer Pool from PSRAM!", FRAMEBUFFER_HEAP_SIZE);
+    if (_pool_heap_start == nullptr) {
+        ESP_LOGE("MemManager", "Fatal: Failed to allocate %d bytes for Memory Pool from PSRAM!", total_size);
         // [日志] 记录内存分配失败的致命错误
-        Sys_FlashLogger::getInstance()->log("[MemManager]", "FATAL: Failed to allocate %d bytes for Framebuffer Pool!", FRAMEBUFFER_HEAP_SIZE);
+        Sys_FlashLogger::getInstance()->log(ESP_LOG_ERROR, "[MemManager]", "FATAL: Failed to allocate %d bytes for Memory Pool!", total_size);
         return false;
     }
-    
-    // 2. 定义池的几何形状并初始化状态向量
-    _block_size = 1024 * 1024; // 每块1MB
-    _block_count = FRAMEBUFFER_HEAP_SIZE / _block_size;
-    _block_is_used.assign(_block_count, false); // 初始化所有块为"未使用"
 
-    ESP_LOGI("MemManager", "Framebuffer Pool initialized: %d blocks, %d KB/block.", _block_count, _block_size / 1024);
+    // 3. 依次切分各级别，把位图中有效块对应的位全部置1（空闲），并清空所有弹匣
+    // 此函数在setup()的单线程环境中调用，无需加锁。
+    uint8_t* cursor = _pool_heap_start;
+    for (size_t i = 0; i < POOL_CLASS_COUNT; ++i) {
+        PoolClass& pool = _pools[i];
+        pool.base = cursor;
+        pool.block_size = POOL_LAYOUT[i].block_size;
+        pool.block_shift = static_cast<uint8_t>(__builtin_ctz(pool.block_size));
+        pool.block_count = POOL_LAYOUT[i].block_count;
+        for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+            size_t first_bit = w * 32;
+            uint32_t bits = 0;
+            if (pool.block_count >= first_bit + 32) {
+                bits = 0xFFFFFFFFu;
+            } else if (pool.block_count > first_bit) {
+                bits = (1u << (pool.block_count - first_bit)) - 1u;
+            }
+            pool.free_bitmap[w].store(bits, std::memory_order_relaxed);
+        }
+        for (size_t core = 0; core < CORE_COUNT; ++core) {
+            for (size_t slot = 0; slot < MAGAZINE_SLOTS; ++slot) {
+                pool.magazine[core][slot].store(MAGAZINE_EMPTY, std::memory_order_relaxed);
+            }
+        }
+        for (size_t block = 0; block < MAX_BLOCKS_PER_CLASS; ++block) {
+            pool.allocated[block].store(0, std::memory_order_relaxed);
+        }
+        cursor += pool.block_size * pool.block_count;
+
+        ESP_LOGI("MemManager", "Pool class %u initialized: %u blocks x %u B.", i, pool.block_count, pool.block_size);
+    }
+
+    // 最后才公开区域大小：owns()以此判断内存池是否可用
+    std::atomic_thread_fence(std::memory_order_release);
+    _pool_heap_size = total_size;
+
+    ESP_LOGI("MemManager", "Memory Pool initialized: %u KB across %u size classes.", total_size / 1024, POOL_CLASS_COUNT);
     printMemoryInfo();
     return true;
 }
 
 /**
- * @brief 从帧缓冲池获取一个空闲块。
+ * @brief 按尺寸分配一个块，级别耗尽时向更大的级别溢出。
+ * @note  热路径中不使用`DEBUG_LOG`：它会查询设置管理器并因此获取互斥锁。
  */
-void* Sys_MemoryManager::getFrameBuffer() {
-    Sys_LockGuard lock(_mutex);
-    for (size_t i = 0; i < _block_count; ++i) {
-        if (!_block_is_used[i]) {
-            _block_is_used[i] = true;
-            void* block_ptr = static_cast<char*>(_framebuffer_heap_start) + (i * _block_size);
-            DEBUG_LOG("Allocated framebuffer block %d at address %p", i, block_ptr);
+void* Sys_MemoryManager::allocate(size_t size) {
+    if (_pool_heap_size == 0 || size == 0) return nullptr;
+
+    for (size_t i = 0; i < POOL_CLASS_COUNT; ++i) {
+        PoolClass& pool = _pools[i];
+        if (pool.block_size < size) continue;
+
+        void* block_ptr = takeBlock(pool);
+        if (block_ptr != nullptr) {
             return block_ptr;
         }
+        // 该级别已满，记录一次失败并尝试下一个更大的级别
+        pool.fail_count.fetch_add(1, std::memory_order_relaxed);
     }
-    ESP_LOGE("MemManager", "No free frame buffers available!");
+
+    ESP_LOGW("MemManager", "No pooled block available for %u bytes.", size);
     return nullptr;
 }
 
 /**
- * @brief 释放一个帧缓冲块。
+ * @brief 从指定级别分配一个块。
  */
-void Sys_MemoryManager::releaseFrameBuffer(void* buffer) {
+void* Sys_MemoryManager::allocateFromClass(MemPoolClass pool_class) {
+    size_t index = static_cast<size_t>(pool_class);
+    if (_pool_heap_size == 0 || index >= POOL_CLASS_COUNT) return nullptr;
+
+    PoolClass& pool = _pools[index];
+    void* block_ptr = takeBlock(pool);
+    if (block_ptr == nullptr) {
+        pool.fail_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return block_ptr;
+}
+
+/**
+ * @brief 释放一个块回到所属级别。
+ * @details 优先放入本核弹匣的空槽位；弹匣已满时，通过原子或运算归还到共享位图。
+ */
+void Sys_MemoryManager::release(void* buffer) {
     if (buffer == nullptr) return;
-    
+
     // 安全检查：确保指针在我们的内存池范围内
-    if (buffer < _framebuffer_heap_start || buffer >= static_cast<char*>(_framebuffer_heap_start) + FRAMEBUFFER_HEAP_SIZE) {
+    PoolClass* pool = findOwnerClass(buffer);
+    if (pool == nullptr) {
         ESP_LOGW("MemManager", "Attempted to release a buffer not managed by this pool.");
         return;
     }
 
-    Sys_LockGuard lock(_mutex);
-    // 通过指针运算计算出块的索引
-    size_t offset = static_cast<char*>(buffer) - static_cast<char*>(_framebuffer_heap_start);
-    size_t index = offset / _block_size;
-
-    if (index < _block_count) {
-        if (_block_is_used[index]) {
-            _block_is_used[index] = false;
-            DEBUG_LOG("Released framebuffer block %d", index);
-        } else {
-            ESP_LOGW("MemManager", "Attempted to release a block that was already free.");
+    // 通过指针运算计算出块的索引，并校验指针是否指向块的起始位置
+    size_t offset = static_cast<uint8_t*>(buffer) - pool->base;
+    int32_t index = static_cast<int32_t>(offset >> pool->block_shift);
+    if ((offset & (pool->block_size - 1)) != 0) {
+        ESP_LOGE("MemManager", "Released pointer %p is not aligned to a block boundary.", buffer);
+        return;
+    }
+
+    uint32_t mask = 1u << (index & 31);
+    std::atomic<uint32_t>& word = pool->free_bitmap[index >> 5];
+
+#if CORE_DEBUG_MODE
+    // [调试] 重复释放检测：块已在位图或任一弹匣中即视为重复释放。
+    // 该检查需要扫描所有弹匣，因此只在调试构建中启用；下面的在用标记在所有构建中兜底。
+    bool already_free = (word.load(std::memory_order_relaxed) & mask) != 0;
+    for (size_t core = 0; core < CORE_COUNT && !already_free; ++core) {
+        for (size_t slot = 0; slot < MAGAZINE_SLOTS; ++slot) {
+            if (pool->magazine[core][slot].load(std::memory_order_relaxed) == index) {
+                already_free = true;
+                break;
+            }
+        }
+    }
+    if (already_free) {
+        ESP_LOGW("MemManager", "Attempted to release a block that was already free.");
+        return;
+    }
+#endif
+
+    // 重复释放防护（所有构建）：只有把在用标记从1改为0的一方可以归还该块，
+    // 否则同一块会两次进入弹匣/位图，随后被分配给两个持有者
+    if (pool->allocated[index].exchange(0, std::memory_order_acq_rel) == 0) {
+        ESP_LOGE("MemManager", "Attempted to release block %d (%u B) that was already free, ignored.", index, pool->block_size);
+        return;
+    }
+
+    pool->in_use.fetch_sub(1, std::memory_order_relaxed);
+
+    // 快速路径：放入本核弹匣的空槽位
+    size_t core = xPortGetCoreID();
+    for (size_t slot = 0; slot < MAGAZINE_SLOTS; ++slot) {
+        int32_t expected = MAGAZINE_EMPTY;
+        if (pool->magazine[core][slot].compare_exchange_strong(expected, index, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
         }
-    } else {
-        ESP_LOGE("MemManager", "Calculated invalid block index on release.");
     }
+
+    // 弹匣已满：归还到共享位图
+    word.fetch_or(mask, std::memory_order_release);
+}
+
+/**
+ * @brief 判断指针是否属于内存池。
+ */
+bool Sys_MemoryManager::owns(const void* buffer) const {
+    const uint8_t* p = static_cast<const uint8_t*>(buffer);
+    return _pool_heap_size != 0 && p >= _pool_heap_start && p < _pool_heap_start + _pool_heap_size;
+}
+
+/**
+ * @brief 从帧缓冲级别获取一个空闲块。
+ */
+void* Sys_MemoryManager::getFrameBuffer() {
+    void* block_ptr = allocateFromClass(MemPoolClass::POOL_1MB);
+    if (block_ptr == nullptr) {
+        ESP_LOGE("MemManager", "No free frame buffers available!");
+    }
+    return block_ptr;
+}
+
+/**
+ * @brief 释放一个帧缓冲块。
+ */
+void Sys_MemoryManager::releaseFrameBuffer(void* buffer) {
+    release(buffer);
+}
+
+/**
+ * @brief 获取某个级别的统计快照。
+ * @details 计数器本身是原子的；互斥锁只用于让并发的统计读取者彼此串行。
+ */
+bool Sys_MemoryManager::getPoolStats(MemPoolClass pool_class, MemPoolStats& out_stats) {
+    size_t index = static_cast<size_t>(pool_class);
+    if (_pool_heap_size == 0 || index >= POOL_CLASS_COUNT) return false;
+
+    Sys_LockGuard lock(_mutex);
+    const PoolClass& pool = _pools[index];
+    out_stats.block_size = pool.block_size;
+    out_stats.block_count = pool.block_count;
+    out_stats.in_use = static_cast<uint16_t>(pool.in_use.load(std::memory_order_relaxed));
+    out_stats.high_water = static_cast<uint16_t>(pool.high_water.load(std::memory_order_relaxed));
+    out_stats.alloc_count = pool.alloc_count.load(std::memory_order_relaxed);
+    out_stats.fail_count = pool.fail_count.load(std::memory_order_relaxed);
+    return true;
 }
 
 /**
  * @brief 打印内存池和系统堆的当前状态。
  */
 void Sys_MemoryManager::printMemoryInfo() {
-    Sys_LockGuard lock(_mutex);
     ESP_LOGI("MemManager", "--- Memory Pool Info ---");
 
-    // 计算已用块
-    int used_blocks = 0;
-    for(size_t i = 0; i < _block_count; ++i) {
-        if (_block_is_used[i]) {
-            used_blocks++;
-        }
+    for (size_t i = 0; i < POOL_CLASS_COUNT; ++i) {
+        MemPoolStats stats;
+        if (!getPoolStats(static_cast<MemPoolClass>(i), stats)) continue;
+        ESP_LOGI("MemManager", "Pool %7u B: Used %2u / %2u, HWM %2u, Allocs %u, Fails %u",
+                 stats.block_size, stats.in_use, stats.block_count, stats.high_water, stats.alloc_count, stats.fail_count);
     }
-    ESP_LOGI("MemManager", "Framebuffer Pool: Used %d / %d blocks", used_blocks, _block_count);
-    
+
     ESP_LOGI("MemManager", "--- System Heap Info ---");
     multi_heap_info_t info;
-    
+
     // 打印默认内部SRAM堆信息
     heap_caps_get_info(&info, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    ESP_LOGI("MemManager", "SRAM Heap: Free=%d, MinFree=%d, LargestFree=%d", 
+    ESP_LOGI("MemManager", "SRAM Heap: Free=%d, MinFree=%d, LargestFree=%d",
              info.total_free_bytes, info.minimum_free_bytes, info.largest_free_block);
 
     // 打印默认外部PSRAM堆信息
     heap_caps_get_info(&info, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    ESP_LOGI("MemManager", "PSRAM Heap (General): Free=%d, MinFree=%d, LargestFree=%d", 
+    ESP_LOGI("MemManager", "PSRAM Heap (General): Free=%d, MinFree=%d, LargestFree=%d",
              info.total_free_bytes, info.minimum_free_bytes, info.largest_free_block);
-    
+
     ESP_LOGI("MemManager", "------------------------");
 }
+
+// --- 私有辅助方法 (Private Methods) ---
+
+/**
+ * @brief 无锁地取出一个空闲块：本核弹匣 -> 共享位图 -> 其它核心的弹匣。
+ */
+void* Sys_MemoryManager::takeBlock(PoolClass& pool) {
+    size_t core = xPortGetCoreID();
+
+    int32_t index = popMagazine(pool, core);
+    if (index == MAGAZINE_EMPTY) {
+        index = claimFromBitmap(pool);
+    }
+    if (index == MAGAZINE_EMPTY) {
+        // 共享位图也已耗尽：从其它核心的弹匣中窃取，避免空闲块被单个核心囤积
+        for (size_t other = 0; other < CORE_COUNT && index == MAGAZINE_EMPTY; ++other) {
+            if (other != core) {
+                index = popMagazine(pool, other);
+            }
+        }
+    }
+    if (index == MAGAZINE_EMPTY) {
+        return nullptr;
+    }
+
+    pool.allocated[index].store(1, std::memory_order_relaxed);
+    recordAllocation(pool);
+    return pool.base + (static_cast<size_t>(index) << pool.block_shift);
+}
+
+/**
+ * @brief 通过CAS认领共享位图中最低位的空闲块。
+ */
+int32_t Sys_MemoryManager::claimFromBitmap(PoolClass& pool) {
+    for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+        uint32_t word = pool.free_bitmap[w].load(std::memory_order_relaxed);
+        while (word != 0) {
+            // __builtin_ctz 直接给出最低位的空闲块编号；CAS失败时word会被更新为最新值并重试
+            uint32_t bit = __builtin_ctz(word);
+            if (pool.free_bitmap[w].compare_exchange_weak(word, word & (word - 1), std::memory_order_acquire, std::memory_order_relaxed)) {
+                return static_cast<int32_t>(w * 32 + bit);
+            }
+        }
+    }
+    return MAGAZINE_EMPTY;
+}
+
+/**
+ * @brief 通过原子交换从弹匣中取出一个块。
+ */
+int32_t Sys_MemoryManager::popMagazine(PoolClass& pool, size_t core) {
+    for (size_t slot = 0; slot < MAGAZINE_SLOTS; ++slot) {
+        std::atomic<int32_t>& entry = pool.magazine[core][slot];
+        if (entry.load(std::memory_order_relaxed) == MAGAZINE_EMPTY) continue;
+
+        int32_t index = entry.exchange(MAGAZINE_EMPTY, std::memory_order_acquire);
+        if (index != MAGAZINE_EMPTY) {
+            return index;
+        }
+    }
+    return MAGAZINE_EMPTY;
+}
+
+/**
+ * @brief 更新在用计数和高水位（CAS取最大值）。
+ */
+void Sys_MemoryManager::recordAllocation(PoolClass& pool) {
+    pool.alloc_count.fetch_add(1, std::memory_order_relaxed);
+    uint32_t now_in_use = pool.in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t high_water = pool.high_water.load(std::memory_order_relaxed);
+    while (now_in_use > high_water &&
+           !pool.high_water.compare_exchange_weak(high_water, now_in_use, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief 根据地址区间定位所属级别。
+ */
+Sys_MemoryManager::PoolClass* Sys_MemoryManager::findOwnerClass(const void* buffer) {
+    if (!owns(buffer)) return nullptr;
+
+    const uint8_t* p = static_cast<const uint8_t*>(buffer);
+    for (size_t i = 0; i < POOL_CLASS_COUNT; ++i) {
+        PoolClass& pool = _pools[i];
+        if (p >= pool.base && p < pool.base + pool.block_size * pool.block_count) {
+            return &pool;
+        }
+    }
+    return nullptr;
+}
+
+// =================================================================================================
+// Sys_PsramJsonAllocator 实现
+// =================================================================================================
+
+Sys_PsramJsonAllocator* Sys_PsramJsonAllocator::instance() {
+    static Sys_PsramJsonAllocator allocator;
+    return &allocator;
+}
+
+void* Sys_PsramJsonAllocator::allocate(size_t size) {
+    void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return ptr ? ptr : heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+}
+
+void Sys_PsramJsonAllocator::deallocate(void* ptr) {
+    heap_caps_free(ptr);
+}
+
+void* Sys_PsramJsonAllocator::reallocate(void* ptr, size_t new_size) {
+    void* new_ptr = heap_caps_realloc(ptr, new_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return new_ptr ? new_ptr : heap_caps_realloc(ptr, new_size, MALLOC_CAP_DEFAULT);
+}
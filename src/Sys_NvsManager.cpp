@@ -6,6 +6,7 @@
  *
  * @details
  * 本文件实现了 Sys_NvsManager.h 中定义的静态接口。
+ * [优化] 所有操作都通过`getHandle()`复用缓存的句柄，写操作通过`commitUnlessBatched()`提交。
  * 严格遵循了设计蓝图中的代码规范，特别是：
  *  - 错误处理：所有与NVS交互的ESP-IDF函数都检查了返回值。
  *  - 代码注释：为所有公共函数提供了详细的中文注释。
@@ -13,6 +14,17 @@
 
 #include "Sys_NvsManager.h"
 #include "Sys_Debug.h" // 用于调试日志
+#include "Sys_LockGuard.h"
+#include "Sys_Trace.h"   // [新增] 提交延迟追踪
+
+// --- 静态成员初始化 ---
+Sys_NvsManager::CachedHandle Sys_NvsManager::_handles[MAX_CACHED_HANDLES];
+size_t Sys_NvsManager::_handle_count = 0;
+SemaphoreHandle_t Sys_NvsManager::_cache_mutex = NULL;
+SemaphoreHandle_t Sys_NvsManager::_batch_mutex = NULL;
+nvs_handle_t Sys_NvsManager::_batch_handle = 0;
+TaskHandle_t Sys_NvsManager::_batch_owner = NULL;
+bool Sys_NvsManager::_batch_failed = false;
 
 /**
  * @brief 初始化NVS分区。
@@ -33,6 +45,14 @@ esp_err_t Sys_NvsManager::initialize() {
     }
     // 检查最终的初始化结果
     ESP_ERROR_CHECK(ret);
+
+    // [新增] 创建句柄缓存与批量事务的互斥锁
+    if (_cache_mutex == NULL) _cache_mutex = xSemaphoreCreateMutex();
+    if (_batch_mutex == NULL) _batch_mutex = xSemaphoreCreateMutex();
+    if (_cache_mutex == NULL || _batch_mutex == NULL) {
+        ESP_LOGE("NVS", "FATAL: Failed to create NVS mutexes!");
+        return ESP_ERR_NO_MEM;
+    }
     DEBUG_LOG("NVS Manager initialized successfully.");
     return ret;
 }
@@ -47,15 +67,13 @@ esp_err_t Sys_NvsManager::initialize() {
  */
 bool Sys_NvsManager::readString(const char* ns_name, const char* key, char* out_buffer, size_t buffer_size) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE("NVS", "Failed to open NVS namespace '%s'. Error: %s", ns_name, esp_err_to_name(err));
+    if (!getHandle(ns_name, nvs_handle)) {
         return false;
     }
 
     size_t required_size = 0;
     // 第一次调用获取所需大小
-    err = nvs_get_str(nvs_handle, key, NULL, &required_size);
+    esp_err_t err = nvs_get_str(nvs_handle, key, NULL, &required_size);
     if (err == ESP_OK && required_size <= buffer_size) {
         // 第二次调用实际读取数据
         err = nvs_get_str(nvs_handle, key, out_buffer, &required_size);
@@ -64,7 +82,6 @@ bool Sys_NvsManager::readString(const char* ns_name, const char* key, char* out_
         err = ESP_ERR_NVS_INVALID_LENGTH; // 明确错误类型
     }
 
-    nvs_close(nvs_handle);
     return err == ESP_OK;
 }
 
@@ -77,16 +94,14 @@ bool Sys_NvsManager::readString(const char* ns_name, const char* key, char* out_
  */
 bool Sys_NvsManager::writeString(const char* ns_name, const char* key, const char* value) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE("NVS", "Failed to open NVS namespace '%s' for writing. Error: %s", ns_name, esp_err_to_name(err));
+    if (!getHandle(ns_name, nvs_handle)) {
         return false;
     }
 
-    err = nvs_set_str(nvs_handle, key, value);
+    esp_err_t err = nvs_set_str(nvs_handle, key, value);
     if (err == ESP_OK) {
-        // 只有在set成功后才提交
-        err = nvs_commit(nvs_handle);
+        // 只有在set成功后才提交（批量事务中推迟到commitBatch()）
+        err = commitUnlessBatched(nvs_handle);
         if (err != ESP_OK) {
             ESP_LOGE("NVS", "Failed to commit NVS changes for key '%s'. Error: %s", key, esp_err_to_name(err));
         }
@@ -94,7 +109,6 @@ bool Sys_NvsManager::writeString(const char* ns_name, const char* key, const cha
         ESP_LOGE("NVS", "Failed to set string for key '%s'. Error: %s", key, esp_err_to_name(err));
     }
 
-    nvs_close(nvs_handle);
     return err == ESP_OK;
 }
 
@@ -108,16 +122,11 @@ bool Sys_NvsManager::writeString(const char* ns_name, const char* key, const cha
  */
 bool Sys_NvsManager::readBlob(const char* ns_name, const char* key, void* out_blob, size_t* length) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE("NVS", "Failed to open NVS namespace '%s'. Error: %s", ns_name, esp_err_to_name(err));
+    if (!getHandle(ns_name, nvs_handle)) {
         return false;
     }
 
-    err = nvs_get_blob(nvs_handle, key, out_blob, length);
-
-    nvs_close(nvs_handle);
-    return err == ESP_OK;
+    return nvs_get_blob(nvs_handle, key, out_blob, length) == ESP_OK;
 }
 
 /**
@@ -130,15 +139,13 @@ bool Sys_NvsManager::readBlob(const char* ns_name, const char* key, void* out_bl
  */
 bool Sys_NvsManager::writeBlob(const char* ns_name, const char* key, const void* blob, size_t length) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE("NVS", "Failed to open NVS namespace '%s' for writing. Error: %s", ns_name, esp_err_to_name(err));
+    if (!getHandle(ns_name, nvs_handle)) {
         return false;
     }
 
-    err = nvs_set_blob(nvs_handle, key, blob, length);
+    esp_err_t err = nvs_set_blob(nvs_handle, key, blob, length);
     if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle);
+        err = commitUnlessBatched(nvs_handle);
         if (err != ESP_OK) {
             ESP_LOGE("NVS", "Failed to commit NVS blob for key '%s'. Error: %s", key, esp_err_to_name(err));
         }
@@ -146,7 +153,31 @@ bool Sys_NvsManager::writeBlob(const char* ns_name, const char* key, const void*
         ESP_LOGE("NVS", "Failed to set blob for key '%s'. Error: %s", key, esp_err_to_name(err));
     }
 
-    nvs_close(nvs_handle);
+    return err == ESP_OK;
+}
+
+/**
+ * @brief 擦除指定命名空间下的单个键。
+ * @param ns_name NVS命名空间。
+ * @param key 要擦除的键名。
+ * @return bool `true` 表示成功或键本来就不存在, `false` 表示失败。
+ */
+bool Sys_NvsManager::eraseKey(const char* ns_name, const char* key) {
+    nvs_handle_t nvs_handle;
+    if (!getHandle(ns_name, nvs_handle)) {
+        return false;
+    }
+    esp_err_t err;
+
+    err = nvs_erase_key(nvs_handle, key);
+    if (err == ESP_OK) {
+        err = commitUnlessBatched(nvs_handle);
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = ESP_OK; // 键本来就不存在，视为成功
+    } else {
+        ESP_LOGE("NVS", "Failed to erase key '%s'. Error: %s", key, esp_err_to_name(err));
+    }
+
     return err == ESP_OK;
 }
 
@@ -158,14 +189,14 @@ bool Sys_NvsManager::writeBlob(const char* ns_name, const char* key, const void*
  */
 bool Sys_NvsManager::eraseNamespace(const char* ns_name) {
     nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(ns_name, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE("NVS", "Failed to open NVS namespace '%s' for erasing. Error: %s", ns_name, esp_err_to_name(err));
+    if (!getHandle(ns_name, nvs_handle)) {
         return false;
     }
+    esp_err_t err;
 
     err = nvs_erase_all(nvs_handle);
     if (err == ESP_OK) {
+        SYS_TRACE_SCOPE(TracePoint::NVS_COMMIT);
         err = nvs_commit(nvs_handle);
         if (err != ESP_OK) {
             ESP_LOGE("NVS", "Failed to commit erase for namespace '%s'. Error: %s", ns_name, esp_err_to_name(err));
@@ -174,6 +205,128 @@ bool Sys_NvsManager::eraseNamespace(const char* ns_name) {
         ESP_LOGE("NVS", "Failed to erase namespace '%s'. Error: %s", ns_name, esp_err_to_name(err));
     }
 
-    nvs_close(nvs_handle);
     return err == ESP_OK;
 }
+
+// --- [新增] 批量事务 (Batch Transactions) ---
+
+/**
+ * @brief 开始一个批量事务。
+ */
+bool Sys_NvsManager::beginBatch(const char* ns_name) {
+    if (_batch_mutex == NULL) {
+        ESP_LOGE("NVS", "beginBatch() called before initialize().");
+        return false;
+    }
+    nvs_handle_t nvs_handle;
+    if (!getHandle(ns_name, nvs_handle)) {
+        return false;
+    }
+    xSemaphoreTake(_batch_mutex, portMAX_DELAY); // 一直持有到commitBatch()
+    _batch_handle = nvs_handle;
+    _batch_owner = xTaskGetCurrentTaskHandle();
+    _batch_failed = false;
+    return true;
+}
+
+/**
+ * @brief 在当前批量事务中写入一个字符串。
+ */
+bool Sys_NvsManager::setString(const char* key, const char* value) {
+    if (_batch_owner != xTaskGetCurrentTaskHandle()) {
+        ESP_LOGE("NVS", "setString('%s') called outside of a batch.", key);
+        return false;
+    }
+    const esp_err_t err = nvs_set_str(_batch_handle, key, value);
+    if (err != ESP_OK) {
+        ESP_LOGE("NVS", "Failed to set string for key '%s'. Error: %s", key, esp_err_to_name(err));
+        _batch_failed = true;
+    }
+    return err == ESP_OK;
+}
+
+/**
+ * @brief 在当前批量事务中写入一个BLOB。
+ */
+bool Sys_NvsManager::setBlob(const char* key, const void* blob, size_t length) {
+    if (_batch_owner != xTaskGetCurrentTaskHandle()) {
+        ESP_LOGE("NVS", "setBlob('%s') called outside of a batch.", key);
+        return false;
+    }
+    const esp_err_t err = nvs_set_blob(_batch_handle, key, blob, length);
+    if (err != ESP_OK) {
+        ESP_LOGE("NVS", "Failed to set blob for key '%s'. Error: %s", key, esp_err_to_name(err));
+        _batch_failed = true;
+    }
+    return err == ESP_OK;
+}
+
+/**
+ * @brief 提交并结束当前批量事务。
+ */
+bool Sys_NvsManager::commitBatch() {
+    if (_batch_owner != xTaskGetCurrentTaskHandle()) {
+        ESP_LOGE("NVS", "commitBatch() called without a matching beginBatch().");
+        return false;
+    }
+    esp_err_t err;
+    {
+        SYS_TRACE_SCOPE(TracePoint::NVS_COMMIT);
+        err = nvs_commit(_batch_handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE("NVS", "Failed to commit NVS batch. Error: %s", esp_err_to_name(err));
+    }
+    const bool ok = (err == ESP_OK) && !_batch_failed;
+    _batch_owner = NULL;
+    xSemaphoreGive(_batch_mutex);
+    return ok;
+}
+
+// --- 私有辅助方法 (Private Methods) ---
+
+/**
+ * @brief 获取（必要时打开并缓存）命名空间的句柄。
+ * @details 句柄以读写模式打开，既用于读也用于写；打开后一直保持，直到系统重启。
+ */
+bool Sys_NvsManager::getHandle(const char* ns_name, nvs_handle_t& out_handle) {
+    if (_cache_mutex == NULL) {
+        ESP_LOGE("NVS", "NVS accessed before initialize().");
+        return false;
+    }
+    Sys_LockGuard lock(_cache_mutex);
+    for (size_t i = 0; i < _handle_count; ++i) {
+        if (strncmp(_handles[i].ns_name, ns_name, sizeof(_handles[i].ns_name)) == 0) {
+            out_handle = _handles[i].handle;
+            return true;
+        }
+    }
+    if (_handle_count >= MAX_CACHED_HANDLES) {
+        ESP_LOGE("NVS", "NVS handle cache full, cannot open namespace '%s'.", ns_name);
+        return false;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns_name, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE("NVS", "Failed to open NVS namespace '%s'. Error: %s", ns_name, esp_err_to_name(err));
+        return false;
+    }
+    CachedHandle& entry = _handles[_handle_count++];
+    strncpy(entry.ns_name, ns_name, sizeof(entry.ns_name) - 1);
+    entry.ns_name[sizeof(entry.ns_name) - 1] = '\0';
+    entry.handle = nvs_handle;
+    out_handle = nvs_handle;
+    return true;
+}
+
+/**
+ * @brief 提交写操作，批量事务中的写入推迟到`commitBatch()`。
+ */
+esp_err_t Sys_NvsManager::commitUnlessBatched(nvs_handle_t handle) {
+    if (_batch_owner != NULL && _batch_owner == xTaskGetCurrentTaskHandle() && handle == _batch_handle) {
+        return ESP_OK;
+    }
+    SYS_TRACE_SCOPE(TracePoint::NVS_COMMIT);
+    return nvs_commit(handle);
+}
@@ -0,0 +1,222 @@
+/**
+ * @file Sys_RpcRouter.cpp
+ * @brief 表驱动的JSON RPC方法路由器的实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 路由表在注册时通过插入排序保持按哈希升序，分发时二分查找。
+ * 方法数量有限（几十个），插入排序的O(n)只发生在启动阶段。
+ */
+#include "Sys_RpcRouter.h"
+#include "types.h"
+#include "Sys_Debug.h"
+#include "Sys_MemoryManager.h" // 请求对象与响应的序列化缓冲从内存池分配
+#include "esp_heap_caps.h"
+#include <new>                 // placement new
+
+// --- 静态成员初始化 ---
+Sys_RpcRouter::MethodEntry Sys_RpcRouter::_methods[Sys_RpcRouter::MAX_METHODS];
+size_t Sys_RpcRouter::_method_count = 0;
+
+// --- RPC请求对象的分配与释放 ---
+
+JsonRpcRequest::JsonRpcRequest() : doc(Sys_PsramJsonAllocator::instance()) {}
+
+/**
+ * @brief 从内存池分配并构造一个请求对象。
+ */
+JsonRpcRequest* JsonRpcRequest::create() {
+    static_assert(sizeof(JsonRpcRequest) <= 512, "JsonRpcRequest must fit in the 512B pool class");
+    void* storage = Sys_MemoryManager::getInstance()->allocate(sizeof(JsonRpcRequest));
+    if (storage == nullptr) {
+        // 内存池耗尽，回退到通用堆
+        storage = heap_caps_malloc(sizeof(JsonRpcRequest), MALLOC_CAP_DEFAULT);
+        if (storage == nullptr) return nullptr;
+    }
+    return new (storage) JsonRpcRequest();
+}
+
+/**
+ * @brief 析构请求对象并归还其内存。
+ */
+void JsonRpcRequest::release(JsonRpcRequest* request) {
+    if (request == nullptr) return;
+    request->~JsonRpcRequest();
+
+    Sys_MemoryManager* memory = Sys_MemoryManager::getInstance();
+    if (memory->owns(request)) {
+        memory->release(request);
+    } else {
+        heap_caps_free(request);
+    }
+}
+
+/**
+ * @brief 注册一个RPC方法，并保持路由表按哈希有序。
+ */
+bool Sys_RpcRouter::registerMethod(const char* name, Handler handler, uint8_t flags) {
+    if (name == nullptr || handler == nullptr) {
+        return false;
+    }
+
+#if !CORE_DEBUG_MODE
+    // release构建中不注册调试专用方法，也不占用路由表空间
+    if (flags & RPC_FLAG_DEBUG_ONLY) {
+        return true;
+    }
+#endif
+
+    if (_method_count >= MAX_METHODS) {
+        ESP_LOGE("RpcRouter", "Method table full, cannot register '%s'.", name);
+        return false;
+    }
+
+    const uint32_t hash = rpcMethodHash(name);
+
+    // 找到插入位置（第一个哈希值不小于新哈希的位置）
+    size_t pos = 0;
+    while (pos < _method_count && _methods[pos].hash < hash) {
+        ++pos;
+    }
+    if (pos < _method_count && _methods[pos].hash == hash) {
+        if (strcmp(_methods[pos].name, name) == 0) {
+            ESP_LOGE("RpcRouter", "Method '%s' is already registered.", name);
+        } else {
+            ESP_LOGE("RpcRouter", "Hash collision between '%s' and '%s'.", name, _methods[pos].name);
+        }
+        return false;
+    }
+
+    // 后移元素，腾出插入位置
+    for (size_t i = _method_count; i > pos; --i) {
+        _methods[i] = _methods[i - 1];
+    }
+    _methods[pos] = { hash, name, handler, flags };
+    _method_count++;
+
+    DEBUG_LOG("RPC method registered: %s (hash 0x%08x, flags 0x%02x)", name, hash, flags);
+    return true;
+}
+
+/**
+ * @brief 通过哈希二分查找方法。
+ */
+const Sys_RpcRouter::MethodEntry* Sys_RpcRouter::find(const char* name) {
+    if (name == nullptr) return nullptr;
+
+    const uint32_t hash = rpcMethodHash(name);
+    size_t low = 0;
+    size_t high = _method_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (_methods[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low >= _method_count || _methods[low].hash != hash || strcmp(_methods[low].name, name) != 0) {
+        return nullptr;
+    }
+
+    const MethodEntry* entry = &_methods[low];
+    if ((entry->flags & RPC_FLAG_DEBUG_ONLY) && !Sys_SettingsManager::getInstance()->isDebugModeEnabled()) {
+        // 运行时调试开关关闭，调试专用方法对外不可见
+        return nullptr;
+    }
+    return entry;
+}
+
+/**
+ * @brief 分发请求。
+ */
+void Sys_RpcRouter::dispatch(const JsonRpcRequest& request) {
+    const MethodEntry* entry = find(request.method);
+    if (entry == nullptr) {
+        sendError(request, -32601, "Method not found");
+        return;
+    }
+    entry->handler(request);
+}
+
+/**
+ * @brief 解析一帧并校验JSON RPC 2.0格式。
+ */
+int Sys_RpcRouter::parseFrame(JsonRpcRequest& request, const char* data, size_t len, bool msgpack) {
+    JsonDocument& doc = request.doc;
+    DeserializationError error = msgpack ? deserializeMsgPack(doc, data, len) : deserializeJson(doc, data, len);
+    if (error) {
+        return -32700;
+    }
+
+    const char* version = doc["jsonrpc"];
+    if (version == nullptr || strcmp(version, "2.0") != 0 || !doc["method"].is<const char*>()) {
+        return -32600;
+    }
+
+    // method/params直接引用已解析的文档
+    request.id = doc["id"] | 0; // 如果id不存在，默认为0
+    request.method = doc["method"];
+    request.params = doc["params"];
+    request.encoding = msgpack ? WsEncoding::MSGPACK : WsEncoding::JSON;
+    return 0;
+}
+
+/**
+ * @brief 按请求的编码格式序列化响应文档并交给响应回调。
+ * @details [优化] 按`measureJson`/`measureMsgPack`的结果从内存池申请恰好够用的块，
+ *          避免为每个响应构造`String`。内存池耗尽时JSON响应才退回到`String`。
+ */
+static void emitResponse(const JsonRpcRequest& request, JsonDocument& response_doc) {
+    const bool msgpack = (request.encoding == WsEncoding::MSGPACK);
+    const size_t len = msgpack ? measureMsgPack(response_doc) : measureJson(response_doc);
+    char* buffer = (char*)Sys_MemoryManager::getInstance()->allocate(len + 1);
+    if (buffer != nullptr) {
+        if (msgpack) {
+            serializeMsgPack(response_doc, buffer, len);
+        } else {
+            serializeJson(response_doc, buffer, len + 1);
+        }
+        request.response_cb(buffer, len);
+        Sys_MemoryManager::getInstance()->release(buffer);
+        return;
+    }
+
+    if (msgpack) {
+        ESP_LOGW("RpcRouter", "Out of memory, MessagePack response for id %u dropped.", request.id);
+        return;
+    }
+    String response_str;
+    serializeJson(response_doc, response_str);
+    request.response_cb(response_str.c_str(), response_str.length());
+}
+
+/**
+ * @brief 响应一个JSON RPC请求。
+ */
+void Sys_RpcRouter::sendResult(const JsonRpcRequest& request, JsonDocument& result) {
+    if (request.response_cb) {
+        JsonDocument response_doc;
+        response_doc["jsonrpc"] = "2.0";
+        response_doc["result"] = result.as<JsonVariant>();
+        response_doc["id"] = request.id;
+        emitResponse(request, response_doc);
+    }
+}
+
+/**
+ * @brief 响应一个JSON RPC错误。
+ */
+void Sys_RpcRouter::sendError(const JsonRpcRequest& request, int code, const char* message) {
+    if (request.response_cb) {
+        JsonDocument response_doc;
+        response_doc["jsonrpc"] = "2.0";
+        JsonObject error_obj = response_doc["error"].to<JsonObject>();
+        error_obj["code"] = code;
+        error_obj["message"] = message;
+        response_doc["id"] = request.id;
+        emitResponse(request, response_doc);
+    }
+}
@@ -0,0 +1,373 @@
+/**
+ * @file Sys_Scheduler.cpp
+ * @brief 事件驱动的定时器轮调度器的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 轮刻度由64位的`esp_timer_get_time()`换算得到，按32位回绕比较，约497天回绕一次。
+ * 每次醒来时只访问从上次处理到当前刻度之间的槽（最多一整圈），
+ * 槽中尚未到期的定时器（到期时间超过一圈）保持原位。
+ */
+#include "Sys_Scheduler.h"
+#include "Sys_Debug.h"
+#include "Sys_LockGuard.h"
+#include "esp_timer.h"
+#include "esp_idf_version.h"
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static_assert((Sys_Scheduler::WHEEL_SLOTS & (Sys_Scheduler::WHEEL_SLOTS - 1)) == 0, "WHEEL_SLOTS must be a power of two");
+
+/** @brief 事件名称，下标为`SysEvent`。*/
+static const char* const EVENT_NAMES[] = {"clients_changed", "settings_changed"};
+static_assert(sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]) == static_cast<size_t>(SysEvent::COUNT), "EVENT_NAMES out of sync with SysEvent");
+
+// --- 静态成员初始化 ---
+SemaphoreHandle_t Sys_Scheduler::_mutex = NULL;
+std::atomic<TaskHandle_t> Sys_Scheduler::_task{nullptr};
+std::atomic<uint32_t> Sys_Scheduler::_pending_events{0};
+Sys_Scheduler::Timer Sys_Scheduler::_timers[Sys_Scheduler::MAX_TIMERS];
+size_t Sys_Scheduler::_timer_count = 0;
+TimerId Sys_Scheduler::_wheel[Sys_Scheduler::WHEEL_SLOTS];
+uint32_t Sys_Scheduler::_processed_tick = 0;
+Sys_Scheduler::EventHandler Sys_Scheduler::_handlers[static_cast<size_t>(SysEvent::COUNT)][Sys_Scheduler::MAX_HANDLERS_PER_EVENT] = {};
+uint32_t Sys_Scheduler::_wakeups = 0;
+uint32_t Sys_Scheduler::_timers_fired = 0;
+uint32_t Sys_Scheduler::_events_dispatched = 0;
+
+/**
+ * @brief 创建内部锁并清空定时器轮。
+ */
+void Sys_Scheduler::begin() {
+    _mutex = xSemaphoreCreateMutex();
+    if (_mutex == NULL) {
+        ESP_LOGE("Scheduler", "FATAL: Failed to create mutex!");
+        return;
+    }
+    for (size_t i = 0; i < WHEEL_SLOTS; ++i) {
+        _wheel[i] = INVALID_TIMER;
+    }
+    _processed_tick = nowTick();
+}
+
+/**
+ * @brief 调度循环。
+ */
+void Sys_Scheduler::run() {
+    _task.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    ESP_LOGI("Scheduler", "Scheduler running with %u timers.", _timer_count);
+
+    for (;;) {
+        // 先处理积压：包括本任务启动前投递的事件
+        const uint32_t events = _pending_events.exchange(0, std::memory_order_acq_rel);
+        if (events != 0) {
+            dispatchEvents(events);
+        }
+        runExpiredTimers();
+
+        // 阻塞直到最近一个定时器到期，或被post()/其它任务修改定时器唤醒
+        ulTaskNotifyTake(pdTRUE, nextTimeout());
+        _wakeups++;
+    }
+}
+
+// --- 定时器 ---
+
+/**
+ * @brief 创建一个定时器。
+ */
+TimerId Sys_Scheduler::createTimer(const char* name, TimerCallback callback, void* arg) {
+    if (_mutex == NULL || callback == nullptr) {
+        return INVALID_TIMER;
+    }
+    Sys_LockGuard lock(_mutex);
+    if (_timer_count >= MAX_TIMERS) {
+        ESP_LOGE("Scheduler", "Timer table full, cannot create '%s'.", name);
+        return INVALID_TIMER;
+    }
+    const TimerId id = static_cast<TimerId>(_timer_count++);
+    Timer& timer = _timers[id];
+    timer.name = name;
+    timer.callback = callback;
+    timer.arg = arg;
+    DEBUG_LOG("Timer created: %s (id %d)", name, id);
+    return id;
+}
+
+/**
+ * @brief 启动或重新启动一个定时器。
+ */
+void Sys_Scheduler::startTimer(TimerId id, uint32_t delay_ms, uint32_t period_ms) {
+    if (id < 0 || static_cast<size_t>(id) >= _timer_count) {
+        return;
+    }
+    {
+        Sys_LockGuard lock(_mutex);
+        Timer& timer = _timers[id];
+        if (timer.active) {
+            unlink(id);
+        }
+        timer.expiry = nowTick() + (delay_ms + TICK_MS - 1) / TICK_MS; // 向上取整，不会提前到期
+        timer.period = (period_ms + TICK_MS - 1) / TICK_MS;
+        timer.active = true;
+        timer.due = false;
+        link(id);
+    }
+
+    // 在其它任务中修改定时器时，唤醒调度任务重新计算阻塞时间
+    TaskHandle_t task = _task.load(std::memory_order_acquire);
+    if (task != NULL && task != xTaskGetCurrentTaskHandle()) {
+        xTaskNotifyGive(task);
+    }
+}
+
+/**
+ * @brief 停止一个定时器。
+ */
+void Sys_Scheduler::stopTimer(TimerId id) {
+    if (id < 0 || static_cast<size_t>(id) >= _timer_count) {
+        return;
+    }
+    Sys_LockGuard lock(_mutex);
+    Timer& timer = _timers[id];
+    if (timer.active) {
+        unlink(id);
+        timer.active = false;
+    }
+    timer.due = false;
+    // 不必唤醒调度任务：多醒一次只会发现没有到期的定时器
+}
+
+/**
+ * @brief 定时器是否在运行。
+ */
+bool Sys_Scheduler::isTimerActive(TimerId id) {
+    if (id < 0 || static_cast<size_t>(id) >= _timer_count) {
+        return false;
+    }
+    Sys_LockGuard lock(_mutex);
+    return _timers[id].active;
+}
+
+// --- 事件 ---
+
+/**
+ * @brief 订阅一个事件。
+ */
+bool Sys_Scheduler::subscribe(SysEvent event, EventHandler handler) {
+    if (_mutex == NULL || event >= SysEvent::COUNT || handler == nullptr) {
+        return false;
+    }
+    Sys_LockGuard lock(_mutex);
+    EventHandler* handlers = _handlers[static_cast<size_t>(event)];
+    for (size_t i = 0; i < MAX_HANDLERS_PER_EVENT; ++i) {
+        if (handlers[i] == nullptr) {
+            handlers[i] = handler;
+            return true;
+        }
+    }
+    ESP_LOGE("Scheduler", "Too many handlers for event '%s'.", EVENT_NAMES[static_cast<size_t>(event)]);
+    return false;
+}
+
+/**
+ * @brief 投递一个事件。
+ */
+void Sys_Scheduler::post(SysEvent event) {
+    if (event >= SysEvent::COUNT) {
+        return;
+    }
+    _pending_events.fetch_or(1u << static_cast<uint8_t>(event), std::memory_order_acq_rel);
+    TaskHandle_t task = _task.load(std::memory_order_acquire);
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+// --- 统计与电源管理 ---
+
+/**
+ * @brief 写入调度器的统计。
+ */
+void Sys_Scheduler::writeStats(JsonObject out) {
+    if (_mutex == NULL) {
+        return;
+    }
+    Sys_LockGuard lock(_mutex);
+    out["wakeups"] = _wakeups;
+    out["timers_fired"] = _timers_fired;
+    out["events"] = _events_dispatched;
+
+    const uint32_t now = nowTick();
+    JsonArray timers = out["timers"].to<JsonArray>();
+    for (size_t i = 0; i < _timer_count; ++i) {
+        const Timer& timer = _timers[i];
+        if (!timer.active) continue;
+        JsonObject entry = timers.add<JsonObject>();
+        entry["name"] = timer.name;
+        const int32_t remaining = static_cast<int32_t>(timer.expiry - now);
+        entry["due_ms"] = remaining > 0 ? remaining * TICK_MS : 0;
+        entry["period_ms"] = timer.period * TICK_MS;
+    }
+}
+
+/**
+ * @brief 配置动态调频和自动Light-sleep。
+ */
+bool Sys_Scheduler::configurePowerManagement(uint32_t max_mhz, uint32_t min_mhz, bool light_sleep) {
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    esp_pm_config_t config = {};
+#else
+    esp_pm_config_esp32s3_t config = {};
+#endif
+    config.max_freq_mhz = max_mhz;
+    config.min_freq_mhz = min_mhz;
+    config.light_sleep_enable = light_sleep;
+    const esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK) {
+        // 未开启CONFIG_FREERTOS_USE_TICKLESS_IDLE时，请求Light-sleep会返回ESP_ERR_NOT_SUPPORTED
+        ESP_LOGE("Scheduler", "esp_pm_configure failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    ESP_LOGI("Scheduler", "Power management enabled: %u-%u MHz, light sleep %s.", min_mhz, max_mhz, light_sleep ? "on" : "off");
+    return true;
+#else
+    (void)max_mhz;
+    (void)min_mhz;
+    (void)light_sleep;
+    ESP_LOGW("Scheduler", "CONFIG_PM_ENABLE is off, power management not configured.");
+    return false;
+#endif
+}
+
+// --- 私有辅助函数 ---
+
+/**
+ * @brief 当前时刻（轮刻度）。
+ */
+uint32_t Sys_Scheduler::nowTick() {
+    return static_cast<uint32_t>(esp_timer_get_time() / (TICK_MS * 1000));
+}
+
+/**
+ * @brief 把定时器挂到槽的链表头部。
+ */
+void Sys_Scheduler::link(TimerId id) {
+    Timer& timer = _timers[id];
+    TimerId& head = _wheel[timer.expiry & (WHEEL_SLOTS - 1)];
+    timer.next = head;
+    head = id;
+}
+
+/**
+ * @brief 把定时器从槽的链表中摘下。
+ */
+void Sys_Scheduler::unlink(TimerId id) {
+    TimerId* cursor = &_wheel[_timers[id].expiry & (WHEEL_SLOTS - 1)];
+    while (*cursor != INVALID_TIMER) {
+        if (*cursor == id) {
+            *cursor = _timers[id].next;
+            _timers[id].next = INVALID_TIMER;
+            return;
+        }
+        cursor = &_timers[*cursor].next;
+    }
+}
+
+/**
+ * @brief 执行所有已到期的定时器。
+ * @details 先在锁内摘下到期的定时器（周期定时器立即挂回下一个到期时刻），再在锁外逐个执行回调。
+ */
+void Sys_Scheduler::runExpiredTimers() {
+    TimerId expired[MAX_TIMERS];
+    size_t expired_count = 0;
+    {
+        Sys_LockGuard lock(_mutex);
+        const uint32_t now = nowTick();
+        // 包含上次处理到的刻度：延迟为0的定时器就挂在当前刻度上
+        uint32_t slots_to_visit = now - _processed_tick + 1;
+        if (slots_to_visit > WHEEL_SLOTS) {
+            slots_to_visit = WHEEL_SLOTS;
+        }
+        for (uint32_t i = 0; i < slots_to_visit; ++i) {
+            TimerId* cursor = &_wheel[(_processed_tick + i) & (WHEEL_SLOTS - 1)];
+            while (*cursor != INVALID_TIMER) {
+                const TimerId id = *cursor;
+                Timer& timer = _timers[id];
+                if (static_cast<int32_t>(timer.expiry - now) > 0) {
+                    cursor = &timer.next; // 到期时间在之后的某一圈
+                    continue;
+                }
+                *cursor = timer.next;
+                timer.next = INVALID_TIMER;
+                timer.due = true;
+                expired[expired_count++] = id;
+                if (timer.period > 0) {
+                    timer.expiry += timer.period;
+                    if (static_cast<int32_t>(timer.expiry - now) <= 0) {
+                        timer.expiry = now + timer.period; // 落后超过一个周期时不补偿错过的执行
+                    }
+                    link(id);
+                } else {
+                    timer.active = false;
+                }
+            }
+        }
+        _processed_tick = now;
+    }
+
+    for (size_t i = 0; i < expired_count; ++i) {
+        TimerCallback callback;
+        void* arg;
+        {
+            Sys_LockGuard lock(_mutex);
+            Timer& timer = _timers[expired[i]];
+            if (!timer.due) continue; // 已被之前执行的回调停止或重新启动
+            timer.due = false;
+            callback = timer.callback;
+            arg = timer.arg;
+        }
+        _timers_fired++;
+        callback(arg);
+    }
+}
+
+/**
+ * @brief 计算到最近一个活动定时器的阻塞时间。
+ */
+TickType_t Sys_Scheduler::nextTimeout() {
+    Sys_LockGuard lock(_mutex);
+    const uint32_t now = nowTick();
+    bool any_active = false;
+    int32_t nearest = INT32_MAX;
+    for (size_t i = 0; i < _timer_count; ++i) {
+        if (!_timers[i].active) continue;
+        any_active = true;
+        const int32_t remaining = static_cast<int32_t>(_timers[i].expiry - now);
+        if (remaining < nearest) {
+            nearest = remaining;
+        }
+    }
+    if (!any_active) {
+        return portMAX_DELAY;
+    }
+    return nearest > 0 ? pdMS_TO_TICKS(nearest * TICK_MS) : 0;
+}
+
+/**
+ * @brief 依次调用每个事件的处理函数。
+ */
+void Sys_Scheduler::dispatchEvents(uint32_t event_bits) {
+    for (size_t e = 0; e < static_cast<size_t>(SysEvent::COUNT); ++e) {
+        if ((event_bits & (1u << e)) == 0) continue;
+        _events_dispatched++;
+        DEBUG_LOG("Event dispatched: %s", EVENT_NAMES[e]);
+        for (size_t i = 0; i < MAX_HANDLERS_PER_EVENT && _handlers[e][i] != nullptr; ++i) {
+            _handlers[e][i](static_cast<SysEvent>(e));
+        }
+    }
+}
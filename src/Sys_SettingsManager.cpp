@@ -5,17 +5,113 @@
  * @date [2025/7]
  * 
  * @details
- * 实现了从NVS加载、保存配置，以及版本控制和默认值恢复等核心逻辑。
- * 它完全依赖`Sys_NvsManager`作为其底层存储引擎，并使用互斥锁确保
- * 所有对配置缓存的读写操作都是线程安全的。
+ * 实现了从NVS加载、保存配置，以及版本迁移和默认值恢复等核心逻辑。
+ * [优化] 每个配置项对应字段表中的一项（NVS键名、类型、在结构体中的偏移），
+ * 加载、保存和迁移都通过遍历字段表完成。
+ * 它完全依赖`Sys_NvsManager`作为其底层存储引擎。
+ * [优化] 读取通过快照槽位的读者计数实现无锁；修改在互斥锁内复制出新快照并原子地发布。
  */
 #include "Sys_SettingsManager.h"
 #include "Sys_NvsManager.h" // 依赖底层NVS工具类
 #include "Sys_Debug.h"
 #include "Sys_FlashLogger.h" // [新增] 引入闪存日志模块
+#include <cstddef>           // offsetof
 
-/** @brief 当前固件期望的设置版本号。当`SystemSettings`结构体发生不兼容的改变时，必须增加此版本号。*/
-static constexpr const uint32_t CURRENT_SETTINGS_VERSION = 1;
+/**
+ * @brief 当前固件期望的设置模式版本号。
+ * @details 新增字段无需修改版本号（缺失的键读取时保持默认值）；只有当已有字段的键名、类型或含义
+ *          发生改变时才需要增加版本号，并在`migrate()`中追加对应的迁移步骤。
+ *          - v1: 整个`SystemSettings`结构体保存为一个BLOB（`settings_v1`）。
+ *          - v2: 每个字段保存为独立的键。
+ */
+static constexpr const uint32_t CURRENT_SETTINGS_VERSION = 2;
+
+namespace {
+
+/** @brief 字段在NVS中的存储类型。*/
+enum class FieldType : uint8_t { STRING, BOOL, ENUM };
+
+/**
+ * @struct FieldDescriptor
+ * @brief 描述一个配置项与NVS键的对应关系。
+ */
+struct FieldDescriptor {
+    /** @brief NVS键名（最长15个字符）。*/
+    const char* key;
+    FieldType type;
+    /** @brief 字段在`SystemSettings`中的偏移。*/
+    size_t offset;
+    /** @brief 字段大小（字符串为缓冲区大小）。*/
+    size_t size;
+};
+
+#define SETTINGS_FIELD(key, type, member) { key, type, offsetof(SystemSettings, member), sizeof(SystemSettings::member) }
+
+/** @brief 字段表，顺序必须与`Sys_SettingsManager::Field`一致。*/
+const FieldDescriptor FIELDS[] = {
+    SETTINGS_FIELD("wifi_ssid",   FieldType::STRING, wifi_ssid),
+    SETTINGS_FIELD("wifi_pass",   FieldType::STRING, wifi_password),
+    SETTINGS_FIELD("wifi_mode",   FieldType::ENUM,   wifi_mode),
+    SETTINGS_FIELD("wifi_sip_en", FieldType::BOOL,   wifi_static_ip_enabled),
+    SETTINGS_FIELD("wifi_sip",    FieldType::STRING, wifi_static_ip),
+    SETTINGS_FIELD("wifi_subnet", FieldType::STRING, wifi_subnet),
+    SETTINGS_FIELD("wifi_gw",     FieldType::STRING, wifi_gateway),
+    SETTINGS_FIELD("bt_enabled",  FieldType::BOOL,   bluetooth_enabled),
+    SETTINGS_FIELD("bt_name",     FieldType::STRING, bluetooth_name),
+    SETTINGS_FIELD("debug_mode",  FieldType::BOOL,   debug_mode_enabled),
+};
+
+#undef SETTINGS_FIELD
+
+static_assert(sizeof(FIELDS) / sizeof(FIELDS[0]) == Sys_SettingsManager::FIELD_COUNT, "Field table does not match Sys_SettingsManager::Field");
+static_assert(sizeof(SystemSettings::WiFiMode) == sizeof(int), "ENUM fields are stored through an int");
+
+/**
+ * @struct SystemSettingsV1
+ * @brief v1固件写入NVS的BLOB布局（冻结，仅用于迁移；不要随`SystemSettings`修改）。
+ */
+struct SystemSettingsV1 {
+    uint32_t settings_version;
+    char wifi_ssid[33];
+    char wifi_password[65];
+    int wifi_mode;
+    bool wifi_static_ip_enabled;
+    char wifi_static_ip[16];
+    char wifi_subnet[16];
+    char wifi_gateway[16];
+    bool bluetooth_enabled;
+    char bluetooth_name[33];
+    bool debug_mode_enabled;
+};
+
+static_assert(sizeof(SystemSettingsV1) == 192, "SystemSettingsV1 must match the blob written by v1 firmware");
+
+/**
+ * @brief 比较两份配置，返回取值不同的字段位图。
+ * @details 字符串字段只比较'\0'之前的内容。
+ */
+uint32_t diffFields(const SystemSettings& a, const SystemSettings& b) {
+    const uint8_t* base_a = reinterpret_cast<const uint8_t*>(&a);
+    const uint8_t* base_b = reinterpret_cast<const uint8_t*>(&b);
+    uint32_t changed = 0;
+    for (size_t i = 0; i < Sys_SettingsManager::FIELD_COUNT; ++i) {
+        const FieldDescriptor& field = FIELDS[i];
+        const bool differs = (field.type == FieldType::STRING)
+            ? strncmp(reinterpret_cast<const char*>(base_a + field.offset), reinterpret_cast<const char*>(base_b + field.offset), field.size) != 0
+            : memcmp(base_a + field.offset, base_b + field.offset, field.size) != 0;
+        if (differs) changed |= (1u << i);
+    }
+    return changed;
+}
+
+/** @brief 安全地拷贝字符串（始终以'\0'结尾）。*/
+template<size_t N, size_t M>
+void copyString(char (&dest)[N], const char (&src)[M]) {
+    strncpy(dest, src, N - 1);
+    dest[N - 1] = '\0';
+}
+
+} // namespace
 
 // 初始化静态单例指针
 Sys_SettingsManager* Sys_SettingsManager::_instance = nullptr;
@@ -25,7 +121,8 @@ Sys_SettingsManager* Sys_SettingsManager::_instance = nullptr;
  */
 Sys_SettingsManager::Sys_SettingsManager() {
     _mutex = xSemaphoreCreateMutex();
-    if (_mutex == NULL) {
+    _write_mutex = xSemaphoreCreateMutex();
+    if (_mutex == NULL || _write_mutex == NULL) {
         ESP_LOGE("Settings", "FATAL: Failed to create mutex!"); // 严重错误: 创建互斥锁失败！
     }
 }
@@ -50,114 +147,387 @@ void Sys_SettingsManager::begin() {
     // 调试日志: 正在初始化设置管理器...
     
     // 在begin()中，系统处于单线程模式，无需加锁即可安全调用load()
-    load();
+    SystemSettings loaded;
+    load(loaded);
+
+    // 发布加载结果作为第一份快照
+    Sys_LockGuard lock(_mutex);
+    Slot* draft = beginUpdate();
+    draft->data = loaded;
+    _current.store(draft);
 }
 
 /**
- * @brief 从NVS加载配置到内存缓存。
- * @note 这是一个私有方法，假定它总是在一个已获取锁或单线程的上下文中被调用。
+ * @brief 从NVS加载配置到`settings`。
+ * @note 这是一个私有方法，只在单线程的`begin()`中被调用。
  */
-void Sys_SettingsManager::load() {
-    SystemSettings temp_settings;
-    size_t blob_size = sizeof(SystemSettings);
-
-    if (Sys_NvsManager::readBlob(NVS_NAMESPACE, NVS_KEY_BLOB, &temp_settings, &blob_size) && blob_size == sizeof(SystemSettings)) {
-        // 读取成功，检查版本
-        if (temp_settings.settings_version == CURRENT_SETTINGS_VERSION) {
-            ESP_LOGI("Settings", "Settings v%u loaded from NVS.", temp_settings.settings_version);
+void Sys_SettingsManager::load(SystemSettings& settings) {
+    uint32_t schema = 0;
+    if (Sys_NvsManager::readValue(NVS_NAMESPACE, NVS_KEY_SCHEMA, schema)) {
+        if (schema == CURRENT_SETTINGS_VERSION) {
+            loadFields(settings);
+            ESP_LOGI("Settings", "Settings v%u loaded from NVS.", schema);
             // 日志: 从NVS加载了v%u版本的设置。
-            _settings = temp_settings;
-            _is_dirty = false;
             return;
-        } else {
-            // 版本不匹配
-            ESP_LOGW("Settings", "NVS version mismatch (found v%u, expected v%u). Restoring defaults.", temp_settings.settings_version, CURRENT_SETTINGS_VERSION);
-            // 警告: NVS版本不匹配(发现v%u, 期望v%u)。正在恢复默认值。
-            loadDefaults();
-            save(); // 保存新的默认值
         }
-    } else {
-        // 读取失败 (通常是首次启动)
-        ESP_LOGW("Settings", "Could not read settings. Loading and saving defaults.");
-        // 警告: 无法读取设置。正在加载并保存默认值。
-        loadDefaults();
-        save();
+        if (schema > CURRENT_SETTINGS_VERSION) {
+            // 较新固件写入的配置（如固件回退）：已知的键仍然兼容，直接读取，不回写版本号
+            ESP_LOGW("Settings", "NVS schema v%u is newer than v%u. Loading known fields only.", schema, CURRENT_SETTINGS_VERSION);
+            loadFields(settings);
+            return;
+        }
+        migrate(settings, schema);
+        return;
+    }
+
+    // 没有版本号：v1固件留下的BLOB，或者首次启动
+    size_t blob_size = 0;
+    if (Sys_NvsManager::readBlob(NVS_NAMESPACE, NVS_KEY_LEGACY_BLOB, nullptr, &blob_size)) {
+        migrate(settings, 1);
+        return;
+    }
+
+    ESP_LOGW("Settings", "Could not read settings. Loading and saving defaults.");
+    // 警告: 无法读取设置。正在加载并保存默认值。
+    loadDefaults(settings);
+    if (writeFields(settings, ALL_FIELDS) == 0 &&
+        Sys_NvsManager::writeValue(NVS_NAMESPACE, NVS_KEY_SCHEMA, CURRENT_SETTINGS_VERSION)) {
+        _dirty_mask = 0;
     }
 }
 
 /**
- * @brief 将内存缓存中的配置保存到NVS。
- * @note 这是一个私有方法，假定它总是在一个已获取锁的上下文中被调用。
- * @return bool 是否保存成功。
+ * @brief 逐个读取分字段保存的配置项。
+ * @note 这是一个私有方法，只在单线程的`begin()`中被调用。
  */
-bool Sys_SettingsManager::save() {
-    DEBUG_LOG("Saving settings to NVS...");
+void Sys_SettingsManager::loadFields(SystemSettings& settings) {
+    settings = SystemSettings();
+    uint8_t* base = reinterpret_cast<uint8_t*>(&settings);
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        const FieldDescriptor& field = FIELDS[i];
+        bool ok = false;
+        switch (field.type) {
+            case FieldType::STRING: {
+                char buffer[65];
+                ok = field.size <= sizeof(buffer) &&
+                     Sys_NvsManager::readString(NVS_NAMESPACE, field.key, buffer, field.size);
+                if (ok) memcpy(base + field.offset, buffer, field.size);
+                break;
+            }
+            case FieldType::BOOL: {
+                bool value = false;
+                ok = Sys_NvsManager::readValue(NVS_NAMESPACE, field.key, value);
+                if (ok) memcpy(base + field.offset, &value, sizeof(value));
+                break;
+            }
+            case FieldType::ENUM: {
+                uint8_t stored = 0;
+                ok = Sys_NvsManager::readValue(NVS_NAMESPACE, field.key, stored);
+                if (ok) {
+                    const int value = stored;
+                    memcpy(base + field.offset, &value, sizeof(value));
+                }
+                break;
+            }
+        }
+        if (!ok) {
+            DEBUG_LOG("Settings key '%s' not found, keeping default.", field.key);
+        }
+    }
+    settings.settings_version = CURRENT_SETTINGS_VERSION;
+    _dirty_mask = 0;
+}
+
+/**
+ * @brief 把NVS中的配置从旧版本逐级迁移到当前版本。
+ * @details 每个`case`把配置从版本n升级到n+1，并贯穿(fallthrough)到下一步；
+ *          迁移完成后以当前格式写回全部字段，最后才更新版本号，中途断电时下次启动会重新迁移。
+ * @note 这是一个私有方法，只在单线程的`begin()`中被调用。
+ */
+bool Sys_SettingsManager::migrate(SystemSettings& settings, uint32_t from_version) {
+    ESP_LOGW("Settings", "Migrating settings from v%u to v%u.", from_version, CURRENT_SETTINGS_VERSION);
+    // 警告: 正在把设置从v%u迁移到v%u。
+    settings = SystemSettings();
+
+    switch (from_version) {
+        case 1: {
+            // v1 -> v2: 从整体BLOB中取出各字段
+            SystemSettingsV1 legacy;
+            size_t blob_size = sizeof(legacy);
+            if (Sys_NvsManager::readBlob(NVS_NAMESPACE, NVS_KEY_LEGACY_BLOB, &legacy, &blob_size) &&
+                blob_size == sizeof(legacy) && legacy.settings_version == 1) {
+                copyString(settings.wifi_ssid, legacy.wifi_ssid);
+                copyString(settings.wifi_password, legacy.wifi_password);
+                settings.wifi_mode = (SystemSettings::WiFiMode)legacy.wifi_mode;
+                settings.wifi_static_ip_enabled = legacy.wifi_static_ip_enabled;
+                copyString(settings.wifi_static_ip, legacy.wifi_static_ip);
+                copyString(settings.wifi_subnet, legacy.wifi_subnet);
+                copyString(settings.wifi_gateway, legacy.wifi_gateway);
+                settings.bluetooth_enabled = legacy.bluetooth_enabled;
+                copyString(settings.bluetooth_name, legacy.bluetooth_name);
+                settings.debug_mode_enabled = legacy.debug_mode_enabled;
+            } else {
+                ESP_LOGW("Settings", "Legacy settings blob is unreadable (%u bytes). Using defaults.", blob_size);
+            }
+        }
+        // fall through
+        // [扩展点] 新版本的迁移步骤（case 2: v2 -> v3 ...）依次追加在这里
+        default:
+            break;
+    }
+    settings.settings_version = CURRENT_SETTINGS_VERSION;
+
+    if (writeFields(settings, ALL_FIELDS) != 0 ||
+        !Sys_NvsManager::writeValue(NVS_NAMESPACE, NVS_KEY_SCHEMA, CURRENT_SETTINGS_VERSION)) {
+        ESP_LOGE("Settings", "Failed to persist migrated settings!");
+        // 错误: 迁移后的设置写入失败！之后由commit()重试
+        markAsDirty(ALL_FIELDS);
+        return false;
+    }
+    if (from_version == 1) {
+        Sys_NvsManager::eraseKey(NVS_NAMESPACE, NVS_KEY_LEGACY_BLOB);
+    }
+    _dirty_mask = 0;
+    Sys_FlashLogger::getInstance()->log("[Settings]", "Settings migrated from v%u to v%u.", from_version, CURRENT_SETTINGS_VERSION);
+    return true;
+}
+
+/**
+ * @brief 把快照中被选中的字段写入NVS。
+ * @details [优化] 所有字段在一个NVS批量事务中写入，只提交一次。
+ * @note 只读取传入的快照，可以在锁外调用。
+ * @return uint32_t 写入失败的字段位图，0表示全部成功。
+ */
+uint32_t Sys_SettingsManager::writeFields(const SystemSettings& snapshot, uint32_t field_mask) {
+    if (!Sys_NvsManager::beginBatch(NVS_NAMESPACE)) {
+        return field_mask;
+    }
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&snapshot);
+    uint32_t failed = 0;
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        if (!(field_mask & (1u << i))) continue;
+        const FieldDescriptor& field = FIELDS[i];
+        bool ok = false;
+        switch (field.type) {
+            case FieldType::STRING:
+                ok = Sys_NvsManager::setString(field.key, reinterpret_cast<const char*>(base + field.offset));
+                break;
+            case FieldType::BOOL: {
+                bool value;
+                memcpy(&value, base + field.offset, sizeof(value));
+                ok = Sys_NvsManager::setValue(field.key, value);
+                break;
+            }
+            case FieldType::ENUM: {
+                int value;
+                memcpy(&value, base + field.offset, sizeof(value));
+                ok = Sys_NvsManager::setValue(field.key, (uint8_t)value);
+                break;
+            }
+        }
+        if (!ok) {
+            ESP_LOGE("Settings", "Failed to write settings key '%s'.", field.key);
+            failed |= (1u << i);
+        }
+    }
+    if (!Sys_NvsManager::commitBatch()) {
+        return field_mask; // 提交失败：整批视为未写入
+    }
+    return failed;
+}
+
+/**
+ * @brief 把脏字段（以及`extra_mask`选中的字段）写入NVS。
+ * @details 在锁内取得快照并清除脏标记，在锁外执行NVS写入；写入失败的字段重新标记为脏。
+ * @return bool 是否全部写入成功。
+ */
+bool Sys_SettingsManager::flushDirtyFields(uint32_t extra_mask) {
+    Sys_LockGuard write_lock(_write_mutex);
+
+    uint32_t field_mask;
+    Slot* slot;
+    {
+        Sys_LockGuard lock(_mutex);
+        field_mask = _dirty_mask | extra_mask;
+        if (field_mask == 0) {
+            return true;
+        }
+        // [优化] 在锁内取得快照，保证它与脏标记一致；快照不可变，无需拷贝
+        slot = acquireCurrent();
+        _dirty_mask = 0;
+    }
+    const Snapshot snapshot(slot);
+
+    DEBUG_LOG("Saving settings to NVS (field mask 0x%03X)...", field_mask);
     // 调试日志: 正在保存设置到NVS...
-    _settings.settings_version = CURRENT_SETTINGS_VERSION;
-
-    if (Sys_NvsManager::writeBlob(NVS_NAMESPACE, NVS_KEY_BLOB, &_settings, sizeof(SystemSettings))) {
-        ESP_LOGI("Settings", "Settings successfully committed to NVS.");
-        // [日志] 记录设置已成功提交到NVS。
-        Sys_FlashLogger::getInstance()->log("[Settings]", "Settings committed to NVS.");
-        _is_dirty = false;
-        return true;
-    } else {
+    const uint32_t failed = writeFields(*snapshot, field_mask);
+    if (failed != 0) {
+        Sys_LockGuard lock(_mutex);
+        _dirty_mask |= failed; // 保留原有的时间戳，下一次commit()立即重试
         ESP_LOGE("Settings", "Failed to commit settings to NVS!");
         // 错误: 提交设置到NVS失败！
         return false;
     }
+
+    ESP_LOGI("Settings", "Settings successfully committed to NVS.");
+    // [日志] 记录设置已成功提交到NVS。
+    Sys_FlashLogger::getInstance()->log("[Settings]", "Settings committed to NVS (field mask 0x%03X).", field_mask);
+    return true;
 }
 
 /**
  * @brief 提交内存中的修改到NVS（如果需要）。
  */
 bool Sys_SettingsManager::commit() {
-    Sys_LockGuard lock(_mutex);
-    if (_is_dirty) {
-        return save();
+    {
+        Sys_LockGuard lock(_mutex);
+        if (_dirty_mask == 0) {
+            return true; // 没有修改，视为提交成功
+        }
+        // [优化] 仍在合并窗口内：等待修改“安静”下来，再把它们合并为一次写入
+        const uint32_t now = millis();
+        if (now - _last_change_ms < _commit_window_ms && now - _first_dirty_ms < MAX_COMMIT_DELAY_MS) {
+            return true;
+        }
     }
-    return true; // 没有修改，视为提交成功
+    return flushDirtyFields(0);
 }
 
 /**
  * @brief 强制将内存配置写入NVS。
  */
 void Sys_SettingsManager::forceSave() {
+    flushDirtyFields(ALL_FIELDS);
+}
+
+/**
+ * @brief 设置写入合并窗口。
+ */
+void Sys_SettingsManager::setCommitWindow(uint32_t window_ms) {
     Sys_LockGuard lock(_mutex);
-    save();
+    _commit_window_ms = window_ms;
 }
 
 /**
- * @brief 将出厂默认配置加载到内存缓存。
- * @note 这是一个私有方法，假定它总是在一个已获取锁的上下文中被调用。
+ * @brief 将出厂默认配置加载到`settings`。
+ * @note 这是一个私有方法，假定它总是在一个已获取锁（或单线程）的上下文中被调用。
  */
-void Sys_SettingsManager::loadDefaults() {
+void Sys_SettingsManager::loadDefaults(SystemSettings& settings) {
     ESP_LOGI("Settings", "Loading default settings into memory.");
     // 日志: 正在加载默认设置到内存。
-    _settings = SystemSettings(); // 使用默认构造函数重置
-    markAsDirty();
+    settings = SystemSettings(); // 使用默认构造函数重置
+    markAsDirty(ALL_FIELDS);
 }
 
 /**
  * @brief 恢复出厂设置。
  */
 void Sys_SettingsManager::factoryReset() {
-    Sys_LockGuard lock(_mutex);
     ESP_LOGW("Settings", "Performing factory reset!");
     // 警告: 正在执行恢复出厂设置！
     // [日志] 记录恢复出厂设置事件。
     Sys_FlashLogger::getInstance()->log("[Settings]", "Factory reset performed.");
-    Sys_NvsManager::eraseNamespace(NVS_NAMESPACE);
-    loadDefaults();
-    save();
+    uint32_t changed;
+    {
+        Sys_LockGuard write_lock(_write_mutex);
+        Sys_NvsManager::eraseNamespace(NVS_NAMESPACE);
+        Sys_NvsManager::writeValue(NVS_NAMESPACE, NVS_KEY_SCHEMA, CURRENT_SETTINGS_VERSION);
+        Sys_LockGuard lock(_mutex);
+        Slot* draft = beginUpdate();
+        loadDefaults(draft->data);
+        changed = diffFields(draft->data, _current.load()->data);
+        // NVS已被清空：即使取值未变，所有字段也都需要重新写入（已由loadDefaults()标记）
+        _current.store(draft);
+    }
+    flushDirtyFields(0);
+    notifyListeners(changed);
+}
+
+/**
+ * @brief 获取当前配置的只读快照。
+ */
+Sys_SettingsManager::Snapshot Sys_SettingsManager::getSettings() const {
+    return Snapshot(acquireCurrent());
+}
+
+/**
+ * @brief 取得当前快照，并增加其读者计数。
+ * @details 先读取当前指针再增加计数，之间写者可能已经发布了新快照、甚至开始复用这个槽位，
+ *          因此增加计数后需要再确认它仍是当前快照，否则撤销计数重试。
+ *          写者只复用读者计数为0且不是当前快照的槽位；计数与指针都使用顺序一致的原子操作，
+ *          保证二者之中至少有一方能观察到对方。
+ */
+Sys_SettingsManager::Slot* Sys_SettingsManager::acquireCurrent() const {
+    for (;;) {
+        Slot* slot = _current.load();
+        slot->readers.fetch_add(1);
+        if (_current.load() == slot) {
+            return slot;
+        }
+        slot->readers.fetch_sub(1);
+    }
+}
+
+/**
+ * @brief 找到一个空闲槽位并复制当前配置到其中。
+ * @note 这是一个私有方法，假定它总是在一个已获取锁的上下文中被调用。
+ */
+Sys_SettingsManager::Slot* Sys_SettingsManager::beginUpdate() {
+    Slot* current = _current.load();
+    for (;;) {
+        for (Slot& slot : _slots) {
+            if (&slot != current && slot.readers.load() == 0) {
+                slot.data = current->data;
+                return &slot;
+            }
+        }
+        // 所有旧快照都仍被读者持有（极少见）：等待它们释放
+        vTaskDelay(1);
+    }
+}
+
+/**
+ * @brief 发布新快照。
+ * @note 这是一个私有方法，假定它总是在一个已获取锁的上下文中被调用。
+ */
+void Sys_SettingsManager::publish(Slot* draft, uint32_t changed_fields) {
+    if (changed_fields == 0) {
+        return; // 没有变化：草稿槽位无人引用，直接丢弃
+    }
+    _current.store(draft);
+    markAsDirty(changed_fields);
 }
 
 /**
- * @brief 获取对配置缓存的安全拷贝。
+ * @brief 注册配置变更监听器。
  */
-SystemSettings Sys_SettingsManager::getSettings() {
+bool Sys_SettingsManager::addChangeListener(uint32_t field_mask, ChangeListener listener) {
     Sys_LockGuard lock(_mutex);
-    return _settings;
+    const size_t count = _listener_count.load();
+    if (listener == nullptr || count >= MAX_CHANGE_LISTENERS) {
+        ESP_LOGE("Settings", "Cannot register settings change listener (%u registered).", count);
+        return false;
+    }
+    _listeners[count] = { field_mask, listener };
+    _listener_count.store(count + 1); // 表项写完后再发布计数
+    return true;
+}
+
+/**
+ * @brief 通知订阅了变化字段的监听器。
+ * @note 必须在锁外调用：监听器通常会读取配置并执行耗时的硬件操作。
+ */
+void Sys_SettingsManager::notifyListeners(uint32_t changed_fields) {
+    if (changed_fields == 0) {
+        return;
+    }
+    const size_t count = _listener_count.load();
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t relevant = changed_fields & _listeners[i].field_mask;
+        if (relevant != 0) {
+            _listeners[i].listener(relevant);
+        }
+    }
 }
 
 /**
@@ -165,78 +535,123 @@ SystemSettings Sys_SettingsManager::getSettings() {
  */
 bool Sys_SettingsManager::isDirty() {
     Sys_LockGuard lock(_mutex);
-    return _is_dirty;
+    return _dirty_mask != 0;
+}
+
+/**
+ * @brief 计算距离下一次可以提交的时间。
+ */
+uint32_t Sys_SettingsManager::getCommitDelay() {
+    Sys_LockGuard lock(_mutex);
+    if (_dirty_mask == 0) {
+        return NO_PENDING_COMMIT;
+    }
+    const uint32_t now = millis();
+    const uint32_t since_change = now - _last_change_ms;
+    const uint32_t since_first = now - _first_dirty_ms;
+    if (since_change >= _commit_window_ms || since_first >= MAX_COMMIT_DELAY_MS) {
+        return 0;
+    }
+    const uint32_t window_left = _commit_window_ms - since_change;
+    const uint32_t max_left = MAX_COMMIT_DELAY_MS - since_first;
+    return window_left < max_left ? window_left : max_left;
 }
 
 /**
- * @brief 标记配置为“脏”。
+ * @brief 标记指定字段为“脏”。
  * @note 这是一个私有方法，假定它总是在一个已获取锁的上下文中被调用。
  */
-void Sys_SettingsManager::markAsDirty() {
-    if (!_is_dirty) {
-        DEBUG_LOG("Settings marked as dirty.");
-        _is_dirty = true;
+void Sys_SettingsManager::markAsDirty(uint32_t field_mask) {
+    const uint32_t now = millis();
+    if (_dirty_mask == 0) {
+        _first_dirty_ms = now;
+    }
+    _dirty_mask |= field_mask;
+    _last_change_ms = now;
+}
+
+/**
+ * @brief 修改一个字符串字段。
+ * @return uint32_t 值实际发生变化时返回该字段的位，否则返回0。
+ */
+uint32_t Sys_SettingsManager::updateString(Field field, char* dest, size_t dest_size, const char* value) {
+    if (strncmp(dest, value, dest_size - 1) == 0) {
+        return 0;
     }
+    strncpy(dest, value, dest_size - 1);
+    dest[dest_size - 1] = '\0'; // 确保null结尾
+    return 1u << field;
 }
 
 // --- 线程安全的 Getter 实现 ---
+// [优化] 无锁：读取当前快照。
 
-bool Sys_SettingsManager::isDebugModeEnabled() {
-    Sys_LockGuard lock(_mutex);
-    return _settings.debug_mode_enabled;
+bool Sys_SettingsManager::isDebugModeEnabled() const {
+    return getSettings()->debug_mode_enabled;
 }
 
-SystemSettings::WiFiMode Sys_SettingsManager::getWiFiMode() {
-    Sys_LockGuard lock(_mutex);
-    return _settings.wifi_mode;
+SystemSettings::WiFiMode Sys_SettingsManager::getWiFiMode() const {
+    return getSettings()->wifi_mode;
 }
 
-String Sys_SettingsManager::getBluetoothName() {
-    Sys_LockGuard lock(_mutex);
-    return String(_settings.bluetooth_name);
+String Sys_SettingsManager::getBluetoothName() const {
+    return String(getSettings()->bluetooth_name);
 }
 
 // --- 线程安全的 Setter 实现 ---
+// [优化] 每个setter在草稿快照上修改，只为实际发生变化的字段设置脏标记并发布新快照，
+// 随后在锁外把变化的字段通知给监听器。
 
 void Sys_SettingsManager::setWiFiConfig(const char* ssid, const char* password, SystemSettings::WiFiMode mode) {
-    Sys_LockGuard lock(_mutex);
-    // 只有当配置实际发生变化时，才进行修改并标记为脏
-    if (strcmp(_settings.wifi_ssid, ssid) != 0 || 
-        strcmp(_settings.wifi_password, password) != 0 || 
-        _settings.wifi_mode != mode) {
-        
-        strncpy(_settings.wifi_ssid, ssid, sizeof(_settings.wifi_ssid) - 1);
-        _settings.wifi_ssid[sizeof(_settings.wifi_ssid) - 1] = '\0'; // 确保null结尾
-        
-        strncpy(_settings.wifi_password, password, sizeof(_settings.wifi_password) - 1);
-        _settings.wifi_password[sizeof(_settings.wifi_password) - 1] = '\0';
-
-        _settings.wifi_mode = mode;
-        
-        markAsDirty();
+    uint32_t changed = 0;
+    {
+        Sys_LockGuard lock(_mutex);
+        Slot* draft = beginUpdate();
+        SystemSettings& settings = draft->data;
+        changed |= updateString(FIELD_WIFI_SSID, settings.wifi_ssid, sizeof(settings.wifi_ssid), ssid);
+        changed |= updateString(FIELD_WIFI_PASSWORD, settings.wifi_password, sizeof(settings.wifi_password), password);
+        if (settings.wifi_mode != mode) {
+            settings.wifi_mode = mode;
+            changed |= 1u << FIELD_WIFI_MODE;
+        }
+        publish(draft, changed);
     }
+    notifyListeners(changed);
 }
 
 /**
  * @brief 设置蓝牙配置。
  */
 void Sys_SettingsManager::setBluetoothConfig(bool enabled, const char* name) {
-    Sys_LockGuard lock(_mutex);
-    if (_settings.bluetooth_enabled != enabled || strcmp(_settings.bluetooth_name, name) != 0) {
-        _settings.bluetooth_enabled = enabled;
-        strncpy(_settings.bluetooth_name, name, sizeof(_settings.bluetooth_name) - 1);
-        _settings.bluetooth_name[sizeof(_settings.bluetooth_name) - 1] = '\0';
-        markAsDirty();
+    uint32_t changed = 0;
+    {
+        Sys_LockGuard lock(_mutex);
+        Slot* draft = beginUpdate();
+        SystemSettings& settings = draft->data;
+        if (settings.bluetooth_enabled != enabled) {
+            settings.bluetooth_enabled = enabled;
+            changed |= 1u << FIELD_BLUETOOTH_ENABLED;
+        }
+        changed |= updateString(FIELD_BLUETOOTH_NAME, settings.bluetooth_name, sizeof(settings.bluetooth_name), name);
+        publish(draft, changed);
     }
+    notifyListeners(changed);
 }
 
 /**
  * @brief 设置运行时调试模式。
  */
 void Sys_SettingsManager::setDebugMode(bool enabled) {
-    Sys_LockGuard lock(_mutex);
-    if (_settings.debug_mode_enabled != enabled) {
-        _settings.debug_mode_enabled = enabled;
-        markAsDirty();
+    uint32_t changed = 0;
+    {
+        Sys_LockGuard lock(_mutex);
+        if (getSettings()->debug_mode_enabled == enabled) {
+            return; // 未变化：无需复制快照
+        }
+        Slot* draft = beginUpdate();
+        draft->data.debug_mode_enabled = enabled;
+        changed = 1u << FIELD_DEBUG_MODE;
+        publish(draft, changed);
     }
+    notifyListeners(changed);
 }
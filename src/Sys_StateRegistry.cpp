@@ -0,0 +1,172 @@
+/**
+ * @file Sys_StateRegistry.cpp
+ * @brief 系统状态注册表的实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#include "Sys_StateRegistry.h"
+#include "Sys_Debug.h"
+#include "Sys_Tasks.h" // 需要 xDataEventGroup 唤醒推送任务
+
+// --- 静态成员初始化 ---
+Sys_StateRegistry* Sys_StateRegistry::_instance = nullptr;
+
+/**
+ * @brief 获取单例实例。
+ */
+Sys_StateRegistry* Sys_StateRegistry::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new Sys_StateRegistry();
+    }
+    return _instance;
+}
+
+Sys_StateRegistry::Sys_StateRegistry() {
+    _mutex = xSemaphoreCreateMutex();
+    if (_mutex == NULL) {
+        ESP_LOGE("StateReg", "FATAL: Failed to create mutex!");
+    }
+}
+
+StateFieldId Sys_StateRegistry::registerField(const char* name, StateFieldType type, uint32_t min_interval_ms) {
+    if (name == nullptr) {
+        return INVALID_STATE_FIELD;
+    }
+    Sys_LockGuard lock(_mutex);
+
+    for (size_t i = 0; i < _field_count; ++i) {
+        if (strcmp(_fields[i].name, name) == 0) {
+            return static_cast<StateFieldId>(i);
+        }
+    }
+    if (_field_count >= MAX_FIELDS) {
+        ESP_LOGE("StateReg", "Field table full, cannot register '%s'.", name);
+        return INVALID_STATE_FIELD;
+    }
+
+    StateField& field = _fields[_field_count];
+    field.name = name;
+    field.type = type;
+    field.min_interval_ms = min_interval_ms;
+    DEBUG_LOG("State field registered: %s (id %u, interval %ums)", name, _field_count, min_interval_ms);
+    return static_cast<StateFieldId>(_field_count++);
+}
+
+StateFieldId Sys_StateRegistry::findField(const char* name) {
+    if (name == nullptr) {
+        return INVALID_STATE_FIELD;
+    }
+    Sys_LockGuard lock(_mutex);
+    for (size_t i = 0; i < _field_count; ++i) {
+        if (strcmp(_fields[i].name, name) == 0) {
+            return static_cast<StateFieldId>(i);
+        }
+    }
+    return INVALID_STATE_FIELD;
+}
+
+// --- 发布 ---
+
+void Sys_StateRegistry::publishInt(StateFieldId id, int32_t value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    publishBits(id, bits);
+}
+
+void Sys_StateRegistry::publishUInt(StateFieldId id, uint32_t value) {
+    publishBits(id, value);
+}
+
+void Sys_StateRegistry::publishFloat(StateFieldId id, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    publishBits(id, bits);
+}
+
+void Sys_StateRegistry::publishBool(StateFieldId id, bool value) {
+    publishBits(id, value ? 1u : 0u);
+}
+
+void Sys_StateRegistry::publishBits(StateFieldId id, uint32_t bits) {
+    bool committed = false;
+    {
+        Sys_LockGuard lock(_mutex);
+        if (id < 0 || static_cast<size_t>(id) >= _field_count) {
+            return;
+        }
+        StateField& field = _fields[id];
+        if (field.changed_seq != 0 && field.bits == bits) {
+            return; // 值未变化，不产生新的变更
+        }
+        field.bits = bits;
+
+        const uint32_t now = millis();
+        if (field.changed_seq == 0 || now - field.last_change_ms >= field.min_interval_ms) {
+            commitChange(field, now);
+            committed = true;
+        } else {
+            field.deferred = true; // 限速期内，等待tick()生效
+        }
+    }
+
+    if (committed && xDataEventGroup != NULL) {
+        xEventGroupSetBits(xDataEventGroup, BIT_STATE_REGISTRY_DIRTY);
+    }
+}
+
+void Sys_StateRegistry::commitChange(StateField& field, uint32_t now_ms) {
+    field.changed_seq = ++_sequence;
+    field.last_change_ms = now_ms;
+    field.deferred = false;
+}
+
+void Sys_StateRegistry::tick() {
+    Sys_LockGuard lock(_mutex);
+    const uint32_t now = millis();
+    for (size_t i = 0; i < _field_count; ++i) {
+        StateField& field = _fields[i];
+        if (field.deferred && now - field.last_change_ms >= field.min_interval_ms) {
+            commitChange(field, now);
+        }
+    }
+}
+
+uint32_t Sys_StateRegistry::getSequence() {
+    Sys_LockGuard lock(_mutex);
+    return _sequence;
+}
+
+// --- 增量输出 ---
+
+size_t Sys_StateRegistry::writeDelta(JsonObject params, uint32_t since_seq, uint32_t field_mask) {
+    Sys_LockGuard lock(_mutex);
+    size_t written = 0;
+    for (size_t i = 0; i < _field_count; ++i) {
+        const StateField& field = _fields[i];
+        if (!(field_mask & (1u << i)) || field.changed_seq <= since_seq) {
+            continue;
+        }
+        switch (field.type) {
+            case StateFieldType::INT: {
+                int32_t value;
+                memcpy(&value, &field.bits, sizeof(value));
+                params[field.name] = value;
+                break;
+            }
+            case StateFieldType::UINT:
+                params[field.name] = field.bits;
+                break;
+            case StateFieldType::FLOAT: {
+                float value;
+                memcpy(&value, &field.bits, sizeof(value));
+                params[field.name] = value;
+                break;
+            }
+            case StateFieldType::BOOL:
+                params[field.name] = (field.bits != 0);
+                break;
+        }
+        written++;
+    }
+    return written;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file Sys_TaskStats.cpp
+ * @brief 任务运行时统计模块的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 运行时计数器是32位的微秒计数（`esp_timer`），约71分钟回绕一次；相邻两次采样的差值按无符号减法计算，
+ * 因此只要采样间隔小于回绕周期，结果就是正确的。
+ */
+#include "Sys_TaskStats.h"
+#include "Sys_Debug.h"
+#include "Sys_Tasks.h"       // 需要访问各通信句柄，并通过通知环形缓冲区推送
+#include "Sys_RpcRouter.h"
+#include "Sys_LockGuard.h"
+#include "Sys_MemoryManager.h" // 结果文档使用PSRAM分配器
+#include "types.h"
+#include "esp_heap_caps.h"
+
+SemaphoreHandle_t Sys_TaskStats::_mutex = NULL;
+TaskStatus_t* Sys_TaskStats::_status = nullptr;
+Sys_TaskStats::RunTimeSample Sys_TaskStats::_previous[MAX_TASKS];
+size_t Sys_TaskStats::_previous_count = 0;
+uint32_t Sys_TaskStats::_previous_total = 0;
+uint32_t Sys_TaskStats::_previous_ms = 0;
+uint32_t Sys_TaskStats::_stream_interval_ms = 0;
+TimerId Sys_TaskStats::_stream_timer = INVALID_TIMER;
+
+/** @brief 任务状态的文本表示，下标为`eTaskState`。*/
+static const char* const TASK_STATE_NAMES[] = {"running", "ready", "blocked", "suspended", "deleted", "invalid"};
+
+/**
+ * @brief 分配采样缓冲区、创建推送定时器并注册RPC方法。
+ */
+void Sys_TaskStats::begin() {
+    _mutex = xSemaphoreCreateMutex();
+#if configUSE_TRACE_FACILITY
+    _status = (TaskStatus_t*)heap_caps_malloc(MAX_TASKS * sizeof(TaskStatus_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (_status == nullptr) {
+        ESP_LOGE("TaskStats", "Failed to allocate the task status buffer.");
+    }
+#else
+    ESP_LOGW("TaskStats", "FreeRTOS trace facility disabled, task statistics are limited to queue depths.");
+#endif
+    _previous_ms = millis();
+    _stream_timer = Sys_Scheduler::createTimer("taskStats", onStreamTimer);
+    Sys_RpcRouter::registerMethod("system.taskStats", rpcTaskStats);
+}
+
+/**
+ * @brief 采集一份统计。
+ */
+bool Sys_TaskStats::collect(JsonObject out) {
+    if (_mutex == NULL) {
+        return false;
+    }
+    Sys_LockGuard lock(_mutex);
+
+    const uint32_t now = millis();
+    out["uptime_ms"] = now;
+    out["window_ms"] = now - _previous_ms;
+    out["stream_interval_ms"] = _stream_interval_ms;
+    collectQueues(out["queues"].to<JsonObject>());
+    Sys_Scheduler::writeStats(out["scheduler"].to<JsonObject>());
+
+#if configUSE_TRACE_FACILITY
+    if (_status == nullptr) {
+        return false;
+    }
+    uint32_t total = 0;
+    const UBaseType_t count = uxTaskGetSystemState(_status, MAX_TASKS, &total);
+    if (count == 0) {
+        ESP_LOGW("TaskStats", "More than %u tasks, statistics skipped.", MAX_TASKS);
+        return false;
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    // 每个核心在这段时间内都经过了`elapsed`，任务的占用率是相对于单个核心的百分比
+    const uint32_t elapsed = total - _previous_total;
+    out["runtime_stats"] = true;
+#else
+    const uint32_t elapsed = 0;
+    out["runtime_stats"] = false;
+#endif
+
+    JsonArray tasks = out["tasks"].to<JsonArray>();
+    float idle_pct[portNUM_PROCESSORS] = {};
+    for (UBaseType_t i = 0; i < count; ++i) {
+        const TaskStatus_t& status = _status[i];
+        JsonObject task = tasks.add<JsonObject>();
+        task["name"] = status.pcTaskName;
+        const BaseType_t affinity = xTaskGetAffinity(status.xHandle);
+        if (affinity == tskNO_AFFINITY) {
+            task["core"] = nullptr;
+        } else {
+            task["core"] = affinity;
+        }
+        task["prio"] = status.uxCurrentPriority;
+        task["state"] = TASK_STATE_NAMES[status.eCurrentState < eInvalid ? status.eCurrentState : eInvalid];
+        task["stack_free"] = status.usStackHighWaterMark; // ESP-IDF中以字节为单位
+        if (elapsed > 0) {
+            const float pct = (status.ulRunTimeCounter - previousRunTime(status.xHandle)) * 100.0f / elapsed;
+            task["cpu_pct"] = roundf(pct * 10) / 10;
+            for (BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+                if (status.xHandle == xTaskGetIdleTaskHandleForCPU(core)) {
+                    idle_pct[core] = pct;
+                }
+            }
+        }
+    }
+    if (elapsed > 0) {
+        JsonArray cores = out["cores"].to<JsonArray>();
+        for (BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+            JsonObject entry = cores.add<JsonObject>();
+            entry["core"] = core;
+            entry["idle_pct"] = roundf(idle_pct[core] * 10) / 10;
+        }
+    }
+
+    // 保存本次采样，作为下一次的基准
+    _previous_count = count;
+    for (UBaseType_t i = 0; i < count; ++i) {
+        _previous[i].handle = _status[i].xHandle;
+        _previous[i].run_time = _status[i].ulRunTimeCounter;
+    }
+    _previous_total = total;
+#else
+    out["runtime_stats"] = false;
+#endif
+    _previous_ms = now;
+    return true;
+}
+
+/**
+ * @brief 推送定时器到期时广播一份统计。
+ */
+void Sys_TaskStats::onStreamTimer(void*) {
+    JsonDocument doc(Sys_PsramJsonAllocator::instance());
+    doc["jsonrpc"] = "2.0";
+    doc["method"] = "system.taskStats";
+    if (collect(doc["params"].to<JsonObject>())) {
+        Sys_Tasks::postNotification(doc);
+    }
+}
+
+/**
+ * @brief `system.taskStats`：返回一份统计，并可调整周期推送间隔。
+ */
+void Sys_TaskStats::rpcTaskStats(const JsonRpcRequest& request) {
+    JsonVariantConst interval = request.params["interval_ms"];
+    if (!interval.isNull()) {
+        uint32_t value = interval.as<uint32_t>();
+        if (value != 0 && value < MIN_STREAM_INTERVAL_MS) {
+            value = MIN_STREAM_INTERVAL_MS;
+        }
+        _stream_interval_ms = value;
+        if (value == 0) {
+            Sys_Scheduler::stopTimer(_stream_timer);
+        } else {
+            Sys_Scheduler::startTimer(_stream_timer, value, value);
+        }
+    }
+
+    JsonDocument result_doc(Sys_PsramJsonAllocator::instance());
+    if (!collect(result_doc.to<JsonObject>())) {
+        Sys_RpcRouter::sendError(request, -32000, "Task statistics unavailable");
+        return;
+    }
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
+
+/**
+ * @brief 在上一次采样中查找任务。
+ */
+uint32_t Sys_TaskStats::previousRunTime(TaskHandle_t handle) {
+    for (size_t i = 0; i < _previous_count; ++i) {
+        if (_previous[i].handle == handle) {
+            return _previous[i].run_time;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 写入主要通信队列的深度。
+ */
+void Sys_TaskStats::collectQueues(JsonObject out) {
+    const struct {
+        const char* name;
+        QueueHandle_t queue;
+    } queues[] = {
+        {"command", xCommandQueue},
+        {"slow_command", xSlowCommandQueue},
+        {"log", xLogQueue},
+    };
+    for (const auto& q : queues) {
+        if (q.queue == NULL) continue;
+        JsonObject entry = out[q.name].to<JsonObject>();
+        const UBaseType_t waiting = uxQueueMessagesWaiting(q.queue);
+        entry["waiting"] = waiting;
+        entry["capacity"] = waiting + uxQueueSpacesAvailable(q.queue);
+    }
+    if (xStateRingbuf != NULL) {
+        // 通知环形缓冲区是变长的：报告待读条目数和剩余字节数
+        UBaseType_t items_waiting = 0;
+        vRingbufferGetInfo(xStateRingbuf, NULL, NULL, NULL, NULL, &items_waiting);
+        JsonObject entry = out["state"].to<JsonObject>();
+        entry["waiting"] = items_waiting;
+        entry["free_bytes"] = xRingbufferGetCurFreeSize(xStateRingbuf);
+    }
+}
@@ -23,6 +23,13 @@
 #include "Sys_BlueToothManager.h"
 #include "Sys_Diagnostics.h"
 #include "Sys_FlashLogger.h"      // [新增] 引入闪存日志模块
+#include "Sys_RpcRouter.h"        // [新增] 表驱动的RPC分发
+#include "Sys_WsBroadcaster.h"    // [新增] 按客户端背压投递推送消息
+#include "Sys_StateRegistry.h"    // [新增] 增量状态推送
+#include "Sys_TaskStats.h"        // [新增] 任务运行时统计
+#include "Sys_Trace.h"            // [新增] 热路径延迟追踪
+#include "Sys_DeferredLog.h"      // [新增] 延迟格式化的日志管道
+#include "Sys_Scheduler.h"        // [新增] 事件驱动的定时器轮
 
 // --- 第三方库依赖 ---
 #include "ArduinoJson.h"
@@ -30,59 +37,83 @@
 // --- ESP-IDF 核心依赖 ---
 #include "esp_task_wdt.h" // [优化] 引入任务看门狗头文件
 #include "esp_log.h"      // [新增] 引入日志重定向所需的头文件
-#include <cstdarg>        // [新增] 引入 va_list
+#include "esp_heap_caps.h"
 
 // --- 全局通信句柄的定义 ---
 QueueHandle_t xCommandQueue = NULL;
-QueueHandle_t xStateQueue = NULL;
+QueueHandle_t xSlowCommandQueue = NULL; // [新增] 慢速通道命令队列
+RingbufHandle_t xStateRingbuf = NULL; // [优化] PSRAM中的变长通知环形缓冲区
 QueueHandle_t xLogQueue = NULL; // [新增] 日志队列
 EventGroupHandle_t xDataEventGroup = NULL;
 
-// --- 日志重定向实现 ---
+// --- Task_SystemMonitor的状态字段与定时器 ---
+
+// [新增] Task_SystemMonitor发布的状态字段句柄（在begin()中注册）
+static StateFieldId s_field_uptime = INVALID_STATE_FIELD;
+static StateFieldId s_field_free_heap = INVALID_STATE_FIELD;
+static StateFieldId s_field_free_psram = INVALID_STATE_FIELD;
+static StateFieldId s_field_wifi_state = INVALID_STATE_FIELD;
+
+// [新增] Task_SystemMonitor上运行的定时器（在begin()中创建）
+static TimerId s_status_timer = INVALID_TIMER;
+static TimerId s_commit_timer = INVALID_TIMER;
+/** @brief 状态字段的发布周期（毫秒），只在有WebSocket客户端时运行。*/
+static constexpr uint32_t STATUS_PUBLISH_INTERVAL_MS = 1000;
+/** @brief 配置提交失败后的重试间隔（毫秒）。*/
+static constexpr uint32_t COMMIT_RETRY_INTERVAL_MS = 1000;
 
 /**
- * @brief 自定义vprintf实现，用于重定向ESP-IDF日志。
- * @details
- *  - [优化] 职责单一化：仅将格式化后的原始日志字符串放入队列。
- *  - [优化] 性能：不在此处进行任何JSON操作或复杂的字符串解析。
- * @param fmt 格式化字符串。
- * @param args 可变参数列表。
- * @return int 写入串口的字节数。
+ * @brief [优化] 状态定时器回调：将系统状态发布到状态注册表，由推送任务按客户端生成增量。
  */
-static int custom_log_vprintf(const char *fmt, va_list args) {
-    // 步骤1: 格式化日志到临时缓冲区并发送到物理串口，保证本地调试不受影响
-    char buffer[256];
-    int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
-    if (len > 0) {
-        Serial.write((uint8_t*)buffer, len);
-    }
+static void onStatusTimer(void*) {
+    Sys_StateRegistry* registry = Sys_StateRegistry::getInstance();
+    registry->publishUInt(s_field_uptime, millis());
+    registry->publishUInt(s_field_free_heap, ESP.getFreeHeap());
+    registry->publishUInt(s_field_free_psram, ESP.getFreePsram());
+    registry->publishInt(s_field_wifi_state, (int)Sys_WiFiManager::getInstance()->getCurrentState());
+}
 
-    // 步骤2: 创建一个轻量级的日志条目
-    LogEntry_t log_entry;
-    // 移除末尾的换行符，因为它们通常由日志宏自动添加
-    if (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r')) {
-        buffer[len - 1] = '\0';
-        if (len > 1 && (buffer[len - 2] == '\r' || buffer[len - 2] == '\n')) {
-            buffer[len - 2] = '\0';
+/**
+ * @brief [新增] 客户端数量变化：有客户端时立即发布一次并开始周期发布，没有客户端时停止。
+ */
+static void onClientsChanged(SysEvent) {
+    if (Sys_WsBroadcaster::getInstance()->hasClients()) {
+        if (!Sys_Scheduler::isTimerActive(s_status_timer)) {
+            Sys_Scheduler::startTimer(s_status_timer, 0, STATUS_PUBLISH_INTERVAL_MS);
         }
+    } else {
+        Sys_Scheduler::stopTimer(s_status_timer);
     }
-    strncpy(log_entry.message, buffer, sizeof(log_entry.message) - 1);
-    log_entry.message[sizeof(log_entry.message) - 1] = '\0'; // 确保null结尾
-
-    // 步骤3: [关键] 快速将原始数据入队，不阻塞
-    if (xLogQueue != NULL) {
-        if (xQueueSend(xLogQueue, &log_entry, 0) == pdPASS) {
-            // 仅当队列未满时才设置事件位，避免在队列满时无谓地频繁唤醒Pusher任务
-            if (xDataEventGroup != NULL) {
-                xEventGroupSetBits(xDataEventGroup, BIT_LOG_QUEUE_READY);
-            }
-        }
-        // 如果队列已满，日志将被静默丢弃，不进行任何操作
+}
+
+/**
+ * @brief [新增] 按设置管理器给出的剩余时间安排下一次提交；没有待提交的修改时停止提交定时器。
+ */
+static void scheduleCommit() {
+    const uint32_t delay_ms = Sys_SettingsManager::getInstance()->getCommitDelay();
+    if (delay_ms == Sys_SettingsManager::NO_PENDING_COMMIT) {
+        Sys_Scheduler::stopTimer(s_commit_timer);
+    } else {
+        Sys_Scheduler::startTimer(s_commit_timer, delay_ms);
     }
+}
 
-    return len;
+/**
+ * @brief [新增] 提交定时器回调：提交“脏”的设置。写入失败时配置仍为脏，稍后重试。
+ */
+static void onCommitTimer(void*) {
+    Sys_SettingsManager::getInstance()->commit();
+    if (Sys_SettingsManager::getInstance()->getCommitDelay() == 0) {
+        Sys_Scheduler::startTimer(s_commit_timer, COMMIT_RETRY_INTERVAL_MS);
+    } else {
+        scheduleCommit();
+    }
 }
 
+/** @brief [新增] 配置变更回调（在修改配置的任务中调用），只投递事件，由调度任务重新安排提交。*/
+static void onSettingsChanged(uint32_t) {
+    Sys_Scheduler::post(SysEvent::SETTINGS_CHANGED);
+}
 
 // [优化] 定义看门狗超时时间（秒）
 static constexpr const uint32_t TASK_WDT_TIMEOUT_S = 15;
@@ -94,21 +125,62 @@ void Sys_Tasks::begin(AsyncWebSocket* webSocket) {
     DEBUG_LOG("Initializing system tasks and communication handles...");
 
     // 步骤 1: 创建通信句柄
-    xCommandQueue = xQueueCreate(10, sizeof(JsonRpcRequest));
-    xStateQueue = xQueueCreate(20, sizeof(char[1024]));
+    xCommandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(JsonRpcRequest*)); // [优化] 队列只传递请求对象的指针
+    xSlowCommandQueue = xQueueCreate(SLOW_COMMAND_QUEUE_LENGTH, sizeof(JsonRpcRequest*));
+    // [优化] 通知环形缓冲区的存储区放在PSRAM中，控制块留在内部SRAM
+    static StaticRingbuffer_t state_ringbuf_struct;
+    uint8_t* state_ringbuf_storage = (uint8_t*)heap_caps_malloc(STATE_RINGBUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (state_ringbuf_storage) {
+        xStateRingbuf = xRingbufferCreateStatic(STATE_RINGBUF_SIZE, RINGBUF_TYPE_NOSPLIT, state_ringbuf_storage, &state_ringbuf_struct);
+    } else {
+        ESP_LOGW("Tasks", "PSRAM unavailable, state ring buffer falls back to %u bytes of internal SRAM.", STATE_RINGBUF_FALLBACK_SIZE);
+        xStateRingbuf = xRingbufferCreate(STATE_RINGBUF_FALLBACK_SIZE, RINGBUF_TYPE_NOSPLIT);
+    }
     xLogQueue = xQueueCreate(30, sizeof(LogEntry_t)); // [优化] 队列现在存放轻量级结构体
     xDataEventGroup = xEventGroupCreate();
 
-    if (!xCommandQueue || !xStateQueue || !xDataEventGroup || !xLogQueue) {
+    if (!xCommandQueue || !xSlowCommandQueue || !xStateRingbuf || !xDataEventGroup || !xLogQueue) {
         ESP_LOGE("Tasks", "FATAL: Failed to create communication handles!");
         return;
     }
 
-    // 步骤 2: [新增] 重定向日志输出
-    ESP_LOGI("Tasks", "Redirecting system logs to WebSocket...");
-    esp_log_set_vprintf(&custom_log_vprintf);
+    // 步骤 2: [新增] 注册RPC方法（必须在任务启动前完成，此后路由表只读）
+    registerRpcMethods();
+    Sys_TaskStats::begin(); // [新增] system.taskStats（需要上面创建的队列句柄）
+#if SYS_TRACE_ENABLED
+    Sys_Trace::begin();     // [新增] system.traceStats
+#endif
+
+    // [新增] 注册系统监视器发布的状态字段；内存类字段变化频繁，限速为每2秒最多推送一次
+    Sys_StateRegistry* registry = Sys_StateRegistry::getInstance();
+    s_field_uptime = registry->registerField("uptime", StateFieldType::UINT);
+    s_field_free_heap = registry->registerField("free_heap", StateFieldType::UINT, 2000);
+    s_field_free_psram = registry->registerField("free_psram", StateFieldType::UINT, 2000);
+    s_field_wifi_state = registry->registerField("wifi_state", StateFieldType::INT);
+
+    // [新增] Task_SystemMonitor的定时器与事件：状态只在有客户端时发布，配置在提交窗口结束时提交
+    s_status_timer = Sys_Scheduler::createTimer("status", onStatusTimer);
+    s_commit_timer = Sys_Scheduler::createTimer("settingsCommit", onCommitTimer);
+    Sys_Scheduler::subscribe(SysEvent::CLIENTS_CHANGED, onClientsChanged);
+    Sys_Scheduler::subscribe(SysEvent::SETTINGS_CHANGED, [](SysEvent) { scheduleCommit(); });
+    Sys_SettingsManager::getInstance()->addChangeListener(Sys_SettingsManager::ALL_FIELDS, onSettingsChanged);
+    Sys_Scheduler::post(SysEvent::SETTINGS_CHANGED); // 启动期间（如迁移或恢复默认值）产生的修改
+#if SYS_POWER_SAVE
+    Sys_Scheduler::configurePowerManagement(240, 80, true); // [新增] 电池供电设备：空闲时自动Light-sleep
+#endif
+
+    // 步骤 3: [优化] 重定向日志输出：调用者只记录二进制日志，由Task_LogFormatter在后台格式化
+    ESP_LOGI("Tasks", "Redirecting system logs to the deferred log pipeline...");
+    if (Sys_DeferredLog::begin()) {
+        TaskHandle_t formatter_handle = NULL;
+        xTaskCreatePinnedToCore(taskLogFormatterLoop, TASK_LOG_FORMATTER_NAME, TASK_LOG_FORMATTER_STACK_SIZE, NULL, TASK_LOG_FORMATTER_PRIORITY, &formatter_handle, TASK_LOG_FORMATTER_CORE);
+        Sys_DeferredLog::setConsumer(formatter_handle);
+        esp_log_set_vprintf(&Sys_DeferredLog::vprintf);
+    } else {
+        ESP_LOGE("Tasks", "Deferred log pipeline unavailable, logs stay on the serial port only.");
+    }
 
-    // 步骤 3: [优化] 初始化任务看门狗
+    // 步骤 4: [优化] 初始化任务看门狗
     ESP_LOGI("Tasks", "Initializing Task Watchdog Timer with %d seconds timeout.", TASK_WDT_TIMEOUT_S);
     ESP_ERROR_CHECK(esp_task_wdt_init(TASK_WDT_TIMEOUT_S, true)); // true 表示 panic on timeout
     
@@ -116,14 +188,17 @@ void Sys_Tasks::begin(AsyncWebSocket* webSocket) {
     ESP_ERROR_CHECK(esp_task_wdt_add(NULL)); 
     esp_task_wdt_reset();
 
-    // 步骤 4: 创建并启动所有后台任务
+    // 步骤 5: 创建并启动所有后台任务
     TaskHandle_t worker_handle;
-    xTaskCreatePinnedToCore(taskWorkerLoop, TASK_WORKER_NAME, TASK_WORKER_STACK_SIZE, NULL, TASK_WORKER_PRIORITY, &worker_handle, TASK_WORKER_CORE);
+    TaskHandle_t slow_worker_handle;
+    xTaskCreatePinnedToCore(taskWorkerLoop, TASK_WORKER_NAME, TASK_WORKER_STACK_SIZE, (void*)xCommandQueue, TASK_WORKER_PRIORITY, &worker_handle, TASK_WORKER_CORE);
+    xTaskCreatePinnedToCore(taskWorkerLoop, TASK_SLOW_WORKER_NAME, TASK_SLOW_WORKER_STACK_SIZE, (void*)xSlowCommandQueue, TASK_SLOW_WORKER_PRIORITY, &slow_worker_handle, TASK_SLOW_WORKER_CORE);
     xTaskCreatePinnedToCore(taskSystemMonitorLoop, TASK_MONITOR_NAME, TASK_MONITOR_STACK_SIZE, NULL, TASK_MONITOR_PRIORITY, NULL, TASK_MONITOR_CORE);
     xTaskCreatePinnedToCore(taskWebSocketPusherLoop, TASK_PUSHER_NAME, TASK_PUSHER_STACK_SIZE, (void*)webSocket, TASK_PUSHER_PRIORITY, NULL, TASK_PUSHER_CORE);
     
-    // [优化] 将关键的Task_Worker注册到看门狗
+    // [优化] 将关键的工作任务注册到看门狗
     ESP_ERROR_CHECK(esp_task_wdt_add(worker_handle));
+    ESP_ERROR_CHECK(esp_task_wdt_add(slow_worker_handle));
 
     ESP_LOGI("Tasks", "All system tasks created successfully.");
 
@@ -136,25 +211,66 @@ void Sys_Tasks::begin(AsyncWebSocket* webSocket) {
 // =================================================================================================
 
 /**
- * @brief Task_Worker 的核心循环函数。
+ * @brief 将RPC请求投递到对应的执行通道。
+ */
+bool Sys_Tasks::submitRpcRequest(JsonRpcRequest* request) {
+    const Sys_RpcRouter::MethodEntry* entry = Sys_RpcRouter::find(request->method);
+    const bool long_running = (entry != nullptr) && (entry->flags & RPC_FLAG_LONG_RUNNING);
+    QueueHandle_t lane = long_running ? xSlowCommandQueue : xCommandQueue;
+    return xQueueSend(lane, &request, pdMS_TO_TICKS(10)) == pdPASS;
+}
+
+/**
+ * @brief 将通知文档零拷贝地序列化进状态通知环形缓冲区。
+ */
+bool Sys_Tasks::postNotification(JsonDocument& doc) {
+    if (xStateRingbuf == NULL) {
+        return false;
+    }
+
+    const size_t len = measureJson(doc);
+    void* item = nullptr;
+    if (xRingbufferSendAcquire(xStateRingbuf, &item, len, 0) != pdTRUE || item == nullptr) {
+        ESP_LOGW("Tasks", "State ring buffer full, %u-byte notification dropped.", len);
+        return false;
+    }
+    serializeJson(doc, (char*)item, len); // 恰好写满预留空间，不需要结尾的'\0'
+    xRingbufferSendComplete(xStateRingbuf, item);
+    xEventGroupSetBits(xDataEventGroup, BIT_STATE_QUEUE_READY);
+    return true;
+}
+
+/**
+ * @brief Task_Worker / Task_SlowWorker 的核心循环函数。
  * @details
- *  - 这是一个被看门狗监控的关键任务。
- *  - 它永远阻塞等待新命令，收到后分发给具体的处理函数。
+ *  - 这是一个被看门狗监控的关键任务，每个执行通道运行一个实例。
+ *  - 它永远阻塞等待本通道的新命令，收到后分发给具体的处理函数。
+ *  - 队列中传递的是请求对象的指针，处理完毕后由本任务负责释放。
  */
 void Sys_Tasks::taskWorkerLoop(void* parameter) {
-    ESP_LOGI(TASK_WORKER_NAME, "Task starting... Now monitored by TWDT.");
-    JsonRpcRequest request;
+    QueueHandle_t queue = (QueueHandle_t)parameter;
+    const char* task_name = pcTaskGetTaskName(NULL);
+    ESP_LOGI(task_name, "Task starting... Now monitored by TWDT.");
+    JsonRpcRequest* request = nullptr;
     const TickType_t xBlockTime = pdMS_TO_TICKS(10000); // 等待10秒，小于15秒的看门狗超时
 
     for (;;) {
         // 1. 尝试从队列接收命令，但最多只阻塞10秒
-        if (xQueueReceive(xCommandQueue, &request, xBlockTime) == pdPASS) {
-            // 如果接收到命令，则处理它
-            DEBUG_LOG("Worker received RPC method: %s from client #%u", request.method, request.client_id);
-            processJsonRpcRequest(request);
+        if (xQueueReceive(queue, &request, xBlockTime) == pdPASS) {
+            // 如果接收到命令，则处理它，并归还请求对象
+            DEBUG_LOG("%s received RPC method: %s from client #%u", task_name, request->method, request->client_id);
+            {
+                SYS_TRACE_SCOPE(TracePoint::RPC_DISPATCH);
+                Sys_RpcRouter::dispatch(*request);
+            }
+            // [新增] 处理函数返回时响应已经通过response_cb发出，到此为止即为端到端延迟
+            SYS_TRACE_SINCE(queue == xSlowCommandQueue ? TracePoint::RPC_SLOW_END_TO_END : TracePoint::RPC_END_TO_END,
+                            request->received_us);
+            JsonRpcRequest::release(request);
+            request = nullptr;
         } else {
             // 如果10秒内没有命令，队列接收超时返回，打印一条调试信息
-            DEBUG_LOG("Worker queue timed out, no command received.");
+            DEBUG_LOG("%s queue timed out, no command received.", task_name);
         }
 
         // 2. 无论是否收到命令，循环到这里都会喂狗，确保任务存活
@@ -165,51 +281,79 @@ void Sys_Tasks::taskWorkerLoop(void* parameter) {
 
 /**
  * @brief Task_SystemMonitor 的核心循环函数。
+ * @details
+ *  [重构] 不再每秒醒来轮询各模块，而是运行`Sys_Scheduler`：WiFi重连、配置提交、状态发布和
+ *  任务统计推送都是各模块创建的定时器，只在定时器到期或有事件投递时才唤醒本任务。
  */
 void Sys_Tasks::taskSystemMonitorLoop(void* parameter) {
     ESP_LOGI(TASK_MONITOR_NAME, "Task starting...");
-    const TickType_t xFrequency = pdMS_TO_TICKS(1000);
-    TickType_t xLastWakeTime = xTaskGetTickCount();
+    Sys_Scheduler::run(); // 永不返回
+}
+
+/**
+ * @brief Task_LogFormatter 的核心循环函数。
+ * @details
+ *  [新增] 取代原先在每个`ESP_LOGx`调用者上下文中执行的`custom_log_vprintf`。
+ *  - 被`Sys_DeferredLog::vprintf()`的任务通知唤醒，按全局序号取出两个核心记录的日志并格式化。
+ *  - 每行都写入物理串口，保证本地调试不受影响。
+ *  - 只有存在WebSocket客户端时才拷贝进`xLogQueue`，没有客户端时完全跳过这一步。
+ *  - 丢弃计数直接写串口报告，不经过`ESP_LOGx`，避免自我反馈。
+ *  - 没有日志时无限期阻塞，不做周期性唤醒。丢弃只发生在环形缓冲区已满时，此时必有未取出的记录
+ *    和尚未消费的通知，因此丢弃计数总在下一次唤醒时报告。
+ */
+void Sys_Tasks::taskLogFormatterLoop(void* parameter) {
+    char line[Sys_DeferredLog::MAX_LINE_LENGTH];
+    size_t len = 0;
+    LogEntry_t log_entry;
 
     for (;;) {
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
-        DEBUG_LOG("System Monitor tick...");
-
-        // 1. 更新WiFi状态机
-        Sys_WiFiManager::getInstance()->update();
-        
-        // 2. 更新蓝牙状态机
-        Sys_BlueToothManager::getInstance()->update();
-
-        // 3. 提交“脏”的设置
-        Sys_SettingsManager::getInstance()->commit();
-
-        // 4. 采集系统状态并打包JSON
-        // 4. 采集系统状态并打包为JSON RPC 2.0通知
-        JsonDocument doc;
-        doc["jsonrpc"] = "2.0";
-        doc["method"] = "system.stateUpdate";
-        JsonObject params = doc["params"].to<JsonObject>();
-        params["uptime"] = millis();
-        params["free_heap"] = ESP.getFreeHeap();
-        params["free_psram"] = ESP.getFreePsram();
-        params["wifi_state"] = (int)Sys_WiFiManager::getInstance()->getCurrentState();
-
-        char jsonBuffer[512];
-        serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
-
-        // [优化] 检查队列发送结果
-        if (xQueueSend(xStateQueue, &jsonBuffer, pdMS_TO_TICKS(10)) != pdPASS) {
-            ESP_LOGW(TASK_MONITOR_NAME, "State queue is full. Status update dropped.");
-        } else {
-            xEventGroupSetBits(xDataEventGroup, BIT_STATE_QUEUE_READY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const uint32_t dropped = Sys_DeferredLog::takeDroppedCount();
+        if (dropped > 0) {
+            int n = snprintf(line, sizeof(line), "W (%u) Log: %u messages dropped, log ring full\n", esp_log_timestamp(), dropped);
+            if (n > 0) {
+                Serial.write((uint8_t*)line, ((size_t)n < sizeof(line)) ? (size_t)n : sizeof(line) - 1);
+            }
+        }
+
+        const bool forward_to_ws = Sys_WsBroadcaster::getInstance()->hasClients();
+        bool queued = false;
+        while (Sys_DeferredLog::formatNext(line, len)) {
+            if (len > 0) {
+                Serial.write((uint8_t*)line, len);
+            }
+            if (!forward_to_ws || xLogQueue == NULL) {
+                continue;
+            }
+
+            // 移除末尾的换行符，因为它们通常由日志宏自动添加
+            while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+                len--;
+            }
+            const size_t copy_len = (len < sizeof(log_entry.message)) ? len : sizeof(log_entry.message) - 1;
+            memcpy(log_entry.message, line, copy_len);
+            log_entry.message[copy_len] = '\0';
+
+            // 如果队列已满，日志将被静默丢弃，不进行任何操作
+            if (xQueueSend(xLogQueue, &log_entry, 0) == pdPASS) {
+                queued = true;
+            }
+        }
+
+        // 一批日志只唤醒一次推送任务
+        if (queued && xDataEventGroup != NULL) {
+            xEventGroupSetBits(xDataEventGroup, BIT_LOG_QUEUE_READY);
         }
     }
 }
 
 /**
  * @brief Task_WebSocketPusher 的核心循环函数。
- * @details [优化] 实现了日志的批处理和超时发送机制。
+ * @details
+ *  [优化] 实现了日志的批处理和超时发送机制。
+ *  [优化] 所有推送经由`Sys_WsBroadcaster`按客户端投递：状态以增量形式从`Sys_StateRegistry`生成，
+ *         日志批次和其它通知受每客户端积压上限约束，慢速客户端不会拖累其他客户端。
  */
 void Sys_Tasks::taskWebSocketPusherLoop(void* parameter) {
     ESP_LOGI(TASK_PUSHER_NAME, "Task starting... Now handles batched notifications.");
@@ -219,8 +363,10 @@ void Sys_Tasks::taskWebSocketPusherLoop(void* parameter) {
         ESP_LOGE(TASK_PUSHER_NAME, "FATAL: WebSocket instance is NULL!");
         vTaskDelete(NULL);
     }
+    Sys_WsBroadcaster* broadcaster = Sys_WsBroadcaster::getInstance();
     
-    char stateMessageBuffer[1024];
+    char* state_item = nullptr;
+    size_t state_item_size = 0;
     LogEntry_t log_entry;
     const TickType_t max_block_time = pdMS_TO_TICKS(500); // 设置一个500ms的超时
 
@@ -228,27 +374,35 @@ void Sys_Tasks::taskWebSocketPusherLoop(void* parameter) {
         // 等待事件，但最多只等 max_block_time
         const EventBits_t bits = xEventGroupWaitBits(
             xDataEventGroup,
-            BIT_STATE_QUEUE_READY | BIT_LOG_QUEUE_READY,
+            BIT_STATE_QUEUE_READY | BIT_LOG_QUEUE_READY | BIT_STATE_REGISTRY_DIRTY,
             pdTRUE, // 在退出时清除事件位
             pdFALSE, // 等待任何一个事件位
             max_block_time);
 
         // 检查是否有客户端连接
-        if (webSocket->count() == 0) {
+        if (!broadcaster->hasClients()) {
             // 清空所有队列，防止消息堆积
-            while (xQueueReceive(xStateQueue, &stateMessageBuffer, 0) == pdPASS) {}
+            while ((state_item = (char*)xRingbufferReceive(xStateRingbuf, &state_item_size, 0)) != NULL) {
+                vRingbufferReturnItem(xStateRingbuf, state_item);
+            }
             while (xQueueReceive(xLogQueue, &log_entry, 0) == pdPASS) {}
             continue; // 跳过本次推送
         }
+        SYS_TRACE_SCOPE(TracePoint::PUSHER_BATCH); // [新增] 统计到本次循环结束
 
-        // --- 处理状态队列 (保持原样，单个发送) ---
+        // --- 处理状态通知环形缓冲区 ---
         if (bits & BIT_STATE_QUEUE_READY) {
             DEBUG_LOG("Pusher woken by state queue event.");
-            while (xQueueReceive(xStateQueue, &stateMessageBuffer, 0) == pdPASS) {
-                webSocket->textAll(stateMessageBuffer);
+            // [优化] 就地读取环形缓冲区中的条目，发送后归还，不经过中间缓冲
+            while ((state_item = (char*)xRingbufferReceive(xStateRingbuf, &state_item_size, 0)) != NULL) {
+                broadcaster->broadcast(state_item, state_item_size); // 一次性通知，如扫描结果
+                vRingbufferReturnItem(xStateRingbuf, state_item);
             }
         }
 
+        // --- [优化] 推送状态增量（超时唤醒时同样执行，为已恢复可写的客户端补发） ---
+        broadcaster->flushStateDeltas();
+
         // --- [优化] 处理日志队列 (批处理) ---
         if (uxQueueMessagesWaiting(xLogQueue) > 0) {
             DEBUG_LOG("Pusher processing log queue...");
@@ -267,9 +421,7 @@ void Sys_Tasks::taskWebSocketPusherLoop(void* parameter) {
             }
 
             if (logs_in_batch > 0) {
-                String batch_string;
-                serializeJson(batch_doc, batch_string);
-                webSocket->textAll(batch_string);
+                broadcaster->broadcast(batch_doc); // [优化] 只序列化一次，共享给所有客户端
                 DEBUG_LOG("Sent a batch of %d logs.", logs_in_batch);
             }
         }
@@ -278,153 +430,124 @@ void Sys_Tasks::taskWebSocketPusherLoop(void* parameter) {
 
 
 // =================================================================================================
-// 命令处理函数实现 (Command Handler Implementations)
+// RPC方法处理函数实现 (RPC Method Handler Implementations)
 // =================================================================================================
+// [重构] 每个RPC方法是一个独立的处理函数，在`registerRpcMethods()`中注册到`Sys_RpcRouter`。
+// 新模块可以在自己的`begin()`中注册方法，无需修改本文件。
 
-/**
- * @brief 响应一个JSON RPC请求的辅助函数。
- * @param request 原始请求，用于获取id和client_id。
- * @param result 要包含在响应中的`result`字段的JSON文档。
- */
-static void sendRpcResult(const JsonRpcRequest& request, JsonDocument& result) {
-    if (request.response_cb) {
-        JsonDocument response_doc;
-        response_doc["jsonrpc"] = "2.0";
-        response_doc["result"] = result.as<JsonVariant>();
-        response_doc["id"] = request.id;
-        
-        String response_str;
-        serializeJson(response_doc, response_str);
-        request.response_cb(response_str.c_str());
-    }
-}
+/** @brief RPC处理函数的日志标签。*/
+static const char* RPC_TAG = "RpcHandler";
 
-/**
- * @brief 响应一个JSON RPC错误的辅助函数。
- */
-static void sendRpcError(const JsonRpcRequest& request, int code, const char* message) {
-    if (request.response_cb) {
-        JsonDocument response_doc;
-        response_doc["jsonrpc"] = "2.0";
-        JsonObject error_obj = response_doc["error"].to<JsonObject>();
-        error_obj["code"] = code;
-        error_obj["message"] = message;
-        response_doc["id"] = request.id;
-
-        String response_str;
-        serializeJson(response_doc, response_str);
-        request.response_cb(response_str.c_str());
-    }
+// --- 系统命令 ---
+
+static void rpcSystemReboot(const JsonRpcRequest& request) {
+    Sys_FlashLogger::getInstance()->log("[Worker]", "Received reboot command. Restarting...");
+    JsonDocument result_doc;
+    result_doc["status"] = "rebooting";
+    Sys_RpcRouter::sendResult(request, result_doc);
+
+    // [重要] 重启前强制刷写日志
+    Sys_FlashLogger::getInstance()->flush();
+    vTaskDelay(pdMS_TO_TICKS(200)); // 给予后台任务一点时间来完成写入
+
+    ESP.restart();
 }
 
+static void rpcSystemFactoryReset(const JsonRpcRequest& request) {
+    JsonDocument result_doc;
+    result_doc["status"] = "resetting";
+    Sys_RpcRouter::sendResult(request, result_doc);
+    Sys_FlashLogger::getInstance()->log("[Worker]", "Received factory reset command. Resetting...");
+    Sys_SettingsManager::getInstance()->factoryReset();
 
-void Sys_Tasks::processJsonRpcRequest(const JsonRpcRequest& request) {
-    JsonDocument params_doc;
-    deserializeJson(params_doc, request.params);
+    // [重要] 重启前强制刷写日志
+    Sys_FlashLogger::getInstance()->flush();
+    vTaskDelay(pdMS_TO_TICKS(200)); // 给予后台任务一点时间来完成写入
 
-    // --- 系统命令 ---
-    if (strcmp(request.method, "system.reboot") == 0) {
-        Sys_FlashLogger::getInstance()->log("[Worker]", "Received reboot command. Restarting...");
-        JsonDocument result_doc;
-        result_doc["status"] = "rebooting";
-        sendRpcResult(request, result_doc);
-        
-        // [重要] 重启前强制刷写日志
-        Sys_FlashLogger::getInstance()->flush();
-        vTaskDelay(pdMS_TO_TICKS(200)); // 给予后台任务一点时间来完成写入
-        
-        ESP.restart();
-    }
-    else if (strcmp(request.method, "system.factoryReset") == 0) {
-        JsonDocument result_doc;
-        result_doc["status"] = "resetting";
-        sendRpcResult(request, result_doc);
-        Sys_FlashLogger::getInstance()->log("[Worker]", "Received factory reset command. Resetting...");
-        Sys_SettingsManager::getInstance()->factoryReset();
+    ESP.restart();
+}
 
-        // [重要] 重启前强制刷写日志
-        Sys_FlashLogger::getInstance()->flush();
-        vTaskDelay(pdMS_TO_TICKS(200)); // 给予后台任务一点时间来完成写入
+// --- 设置管理 ---
+
+static void rpcSettingsGet(const JsonRpcRequest& request) {
+    const auto snapshot = Sys_SettingsManager::getInstance()->getSettings();
+    const SystemSettings& settings = *snapshot;
+    JsonDocument result_doc;
+    JsonObject wifi_obj = result_doc["wifi"].to<JsonObject>();
+    wifi_obj["ssid"] = settings.wifi_ssid;
+    wifi_obj["mode"] = (int)settings.wifi_mode;
+    JsonObject bt_obj = result_doc["bluetooth"].to<JsonObject>();
+    bt_obj["deviceName"] = settings.bluetooth_name;
+    bt_obj["enabled"] = settings.bluetooth_enabled;
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
 
-        ESP.restart();
-    }
-    // --- 设置管理 ---
-    else if (strcmp(request.method, "settings.get") == 0) {
-        const auto& settings = Sys_SettingsManager::getInstance()->getSettings();
+static void rpcSettingsSaveWiFi(const JsonRpcRequest& request) {
+    JsonVariantConst params = request.params;
+    const char* ssid = params["ssid"];
+    const char* password = params["password"];
+    if (ssid) {
+        // [优化] WiFi管理器订阅了配置变更，只重新应用实际变化的部分
+        Sys_SettingsManager::getInstance()->setWiFiConfig(ssid, password ? password : "", (SystemSettings::WiFiMode)params["mode"].as<int>());
         JsonDocument result_doc;
-        JsonObject wifi_obj = result_doc["wifi"].to<JsonObject>();
-        wifi_obj["ssid"] = settings.wifi_ssid;
-        wifi_obj["mode"] = (int)settings.wifi_mode;
-        JsonObject bt_obj = result_doc["bluetooth"].to<JsonObject>();
-        bt_obj["deviceName"] = settings.bluetooth_name;
-        bt_obj["enabled"] = settings.bluetooth_enabled;
-        sendRpcResult(request, result_doc);
+        result_doc["status"] = "success";
+        Sys_RpcRouter::sendResult(request, result_doc);
+    } else {
+        Sys_RpcRouter::sendError(request, -32602, "Invalid params: missing ssid");
     }
-    else if (strcmp(request.method, "settings.saveWiFi") == 0) {
-        const char* ssid = params_doc["ssid"];
-        const char* password = params_doc["password"];
-        if (ssid) {
-            Sys_SettingsManager::getInstance()->setWiFiConfig(ssid, password ? password : "", (SystemSettings::WiFiMode)params_doc["mode"].as<int>());
-            Sys_WiFiManager::getInstance()->applySettings();
-            JsonDocument result_doc;
-            result_doc["status"] = "success";
-            sendRpcResult(request, result_doc);
-        } else {
-            sendRpcError(request, -32602, "Invalid params: missing ssid");
-        }
-    }
-    else if (strcmp(request.method, "settings.saveBluetooth") == 0) {
-        const char* name = params_doc["deviceName"];
-        if (name) {
-            Sys_SettingsManager::getInstance()->setBluetoothConfig(params_doc["enabled"], name);
-            Sys_BlueToothManager::getInstance()->applySettings();
-            JsonDocument result_doc;
-            result_doc["status"] = "success";
-            sendRpcResult(request, result_doc);
-        } else {
-            sendRpcError(request, -32602, "Invalid params: missing deviceName");
-        }
-    }
-    // --- WiFi管理 ---
-    else if (strcmp(request.method, "wifi.scan") == 0) {
-        JsonDocument result_doc;
-        result_doc["status"] = "scanning";
-        sendRpcResult(request, result_doc); // 立即响应，告知客户端扫描已开始
-
-        int n = WiFi.scanNetworks(false, true);
-        ESP_LOGI(TASK_WORKER_NAME, "Scan finished. Found %d networks.", n);
-
-        JsonDocument scan_result_doc;
-        scan_result_doc["jsonrpc"] = "2.0";
-        scan_result_doc["method"] = "wifi.scanResult";
-        JsonArray networks = scan_result_doc["params"].to<JsonArray>();
-        for (int i = 0; i < n; ++i) {
-            JsonObject net = networks.add<JsonObject>();
-            net["ssid"] = WiFi.SSID(i);
-            net["rssi"] = WiFi.RSSI(i);
-            net["auth"] = WiFi.encryptionType(i);
-        }
-        
-        char jsonBuffer[1024];
-        serializeJson(scan_result_doc, jsonBuffer, sizeof(jsonBuffer));
-        if (xQueueSend(xStateQueue, &jsonBuffer, 0) == pdPASS) {
-            xEventGroupSetBits(xDataEventGroup, BIT_STATE_QUEUE_READY);
-        } else {
-            ESP_LOGW(TASK_WORKER_NAME, "State queue full. WiFi scan result dropped.");
-        }
-        WiFi.scanDelete();
-    }
-    // --- 调试命令 ---
-    #if CORE_DEBUG_MODE
-    else if (strcmp(request.method, "debug.runDiagnostics") == 0) {
-        ESP_LOGI(TASK_WORKER_NAME, "Processing RUN_DIAGNOSTICS command...");
-        Sys_Diagnostics::run();
+}
+
+static void rpcSettingsSaveBluetooth(const JsonRpcRequest& request) {
+    JsonVariantConst params = request.params;
+    const char* name = params["deviceName"];
+    if (name) {
+        // [优化] 蓝牙管理器订阅了配置变更，只重新应用实际变化的部分
+        Sys_SettingsManager::getInstance()->setBluetoothConfig(params["enabled"].as<bool>(), name);
         JsonDocument result_doc;
-        result_doc["status"] = "completed";
-        sendRpcResult(request, result_doc);
+        result_doc["status"] = "success";
+        Sys_RpcRouter::sendResult(request, result_doc);
+    } else {
+        Sys_RpcRouter::sendError(request, -32602, "Invalid params: missing deviceName");
     }
-    #endif
-    else {
-        sendRpcError(request, -32601, "Method not found");
+}
+
+// --- WiFi管理 ---
+
+static void rpcWiFiScan(const JsonRpcRequest& request) {
+    // [优化] 异步扫描：立即返回，结果由扫描完成事件通过`wifi.scanResult`通知推送
+    if (!Sys_WiFiManager::getInstance()->startScan()) {
+        Sys_RpcRouter::sendError(request, -32000, "Failed to start WiFi scan");
+        return;
     }
-}
\ No newline at end of file
+    JsonDocument result_doc;
+    result_doc["status"] = "scanning";
+    Sys_RpcRouter::sendResult(request, result_doc); // 立即响应，告知客户端扫描已开始
+}
+
+// --- 调试命令 ---
+// Sys_Diagnostics只存在于调试构建中，因此处理函数本身仍需编译期开关；
+// 分发时的可见性则由RPC_FLAG_DEBUG_ONLY标志统一控制。
+#if CORE_DEBUG_MODE
+static void rpcDebugRunDiagnostics(const JsonRpcRequest& request) {
+    ESP_LOGI(RPC_TAG, "Processing RUN_DIAGNOSTICS command...");
+    Sys_Diagnostics::run();
+    JsonDocument result_doc;
+    result_doc["status"] = "completed";
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
+#endif
+
+/**
+ * @brief 将本模块负责的所有RPC方法注册到路由器。
+ */
+void Sys_Tasks::registerRpcMethods() {
+    Sys_RpcRouter::registerMethod("system.reboot", rpcSystemReboot);
+    Sys_RpcRouter::registerMethod("system.factoryReset", rpcSystemFactoryReset, RPC_FLAG_LONG_RUNNING);
+    Sys_RpcRouter::registerMethod("settings.get", rpcSettingsGet);
+    Sys_RpcRouter::registerMethod("settings.saveWiFi", rpcSettingsSaveWiFi);
+    Sys_RpcRouter::registerMethod("settings.saveBluetooth", rpcSettingsSaveBluetooth);
+    Sys_RpcRouter::registerMethod("wifi.scan", rpcWiFiScan); // 异步扫描，无需占用慢速通道
+#if CORE_DEBUG_MODE
+    Sys_RpcRouter::registerMethod("debug.runDiagnostics", rpcDebugRunDiagnostics, RPC_FLAG_LONG_RUNNING | RPC_FLAG_DEBUG_ONLY);
+#endif
+}
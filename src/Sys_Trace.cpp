@@ -0,0 +1,171 @@
+/**
+ * @file Sys_Trace.cpp
+ * @brief 热路径延迟追踪模块的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 桶的划分：`2^MIN_OCTAVE`个周期以下为第0个桶；此后每个`[2^k, 2^(k+1))`区间按高位之后的
+ * `SUB_BUCKET_BITS`位等分为4个子桶。240MHz下第0个桶对应约0.27µs，最后一个桶的上界约17.9s。
+ * 记录路径只有一次`__builtin_clz`和一次原子加；分位数在导出时对合并后的桶做线性插值。
+ */
+#include "Sys_Trace.h"
+
+#if SYS_TRACE_ENABLED
+
+#include "Sys_RpcRouter.h"
+#include "Sys_MemoryManager.h" // 结果文档使用PSRAM分配器
+#include "types.h"
+
+Sys_Trace::Histogram Sys_Trace::_histograms[CORE_COUNT][(size_t)TracePoint::COUNT];
+uint32_t Sys_Trace::_cycles_per_us = 240;
+
+/** @brief 追踪点的导出名称，下标为`TracePoint`。*/
+static const char* const TRACE_POINT_NAMES[(size_t)TracePoint::COUNT] = {
+    "rpc.e2e", "rpc.e2e_slow", "rpc.dispatch", "pusher.batch", "flashlog.flush", "nvs.commit"
+};
+
+/**
+ * @brief 读取CPU主频并注册RPC方法。
+ */
+void Sys_Trace::begin() {
+    _cycles_per_us = getCpuFrequencyMhz();
+    if (_cycles_per_us == 0) _cycles_per_us = 240;
+    Sys_RpcRouter::registerMethod("system.traceStats", rpcTraceStats);
+    ESP_LOGI("Trace", "Latency tracing enabled, %u tracepoints at %u MHz.", (unsigned)TracePoint::COUNT, _cycles_per_us);
+}
+
+/**
+ * @brief 记录一个周期样本。
+ */
+void Sys_Trace::recordCycles(TracePoint point, uint32_t cycles) {
+    Histogram& histogram = _histograms[xPortGetCoreID()][(size_t)point];
+    histogram.buckets[bucketIndex(cycles)].fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t current = histogram.max_cycles.load(std::memory_order_relaxed);
+    while (cycles > current && !histogram.max_cycles.compare_exchange_weak(current, cycles, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief 记录一个微秒样本，换算为周期后计入同一组直方图。
+ */
+void Sys_Trace::recordMicros(TracePoint point, int64_t micros) {
+    if (micros < 0) micros = 0;
+    const uint64_t cycles = (uint64_t)micros * _cycles_per_us;
+    recordCycles(point, cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles);
+}
+
+/**
+ * @brief 记录一个被丢弃的样本。
+ */
+void Sys_Trace::recordMigrated(TracePoint point) {
+    _histograms[xPortGetCoreID()][(size_t)point].migrated.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 合并所有核心的直方图并导出统计。
+ * @details 导出期间其它任务仍可能在记录，合并结果是一个近似的快照；
+ *          清零同样不是原子的，与清零并发的个别样本可能丢失。
+ */
+void Sys_Trace::collect(JsonObject out, bool reset) {
+    out["cpu_mhz"] = _cycles_per_us;
+    JsonArray points = out["points"].to<JsonArray>();
+    const float cycles_per_us = (float)_cycles_per_us;
+
+    uint32_t merged[BUCKET_COUNT];
+    for (size_t p = 0; p < (size_t)TracePoint::COUNT; ++p) {
+        uint32_t count = 0;
+        uint32_t max_cycles = 0;
+        uint32_t migrated = 0;
+        memset(merged, 0, sizeof(merged));
+        for (size_t core = 0; core < CORE_COUNT; ++core) {
+            Histogram& histogram = _histograms[core][p];
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                const uint32_t n = reset ? histogram.buckets[i].exchange(0, std::memory_order_relaxed)
+                                         : histogram.buckets[i].load(std::memory_order_relaxed);
+                merged[i] += n;
+                count += n;
+            }
+            const uint32_t core_max = reset ? histogram.max_cycles.exchange(0, std::memory_order_relaxed)
+                                            : histogram.max_cycles.load(std::memory_order_relaxed);
+            if (core_max > max_cycles) max_cycles = core_max;
+            migrated += reset ? histogram.migrated.exchange(0, std::memory_order_relaxed)
+                              : histogram.migrated.load(std::memory_order_relaxed);
+        }
+
+        JsonObject entry = points.add<JsonObject>();
+        entry["name"] = TRACE_POINT_NAMES[p];
+        entry["count"] = count;
+        entry["migrated"] = migrated;
+        if (count == 0) {
+            continue;
+        }
+        entry["p50_us"] = roundf(percentile(merged, count, max_cycles, 500) * 10.0f / cycles_per_us) / 10.0f;
+        entry["p90_us"] = roundf(percentile(merged, count, max_cycles, 900) * 10.0f / cycles_per_us) / 10.0f;
+        entry["p99_us"] = roundf(percentile(merged, count, max_cycles, 990) * 10.0f / cycles_per_us) / 10.0f;
+        entry["max_us"] = roundf(max_cycles * 10.0f / cycles_per_us) / 10.0f;
+    }
+}
+
+/**
+ * @brief `system.traceStats`的RPC处理函数。
+ */
+void Sys_Trace::rpcTraceStats(const JsonRpcRequest& request) {
+    const bool reset = request.params["reset"] | false;
+    JsonDocument result_doc(Sys_PsramJsonAllocator::instance());
+    collect(result_doc.to<JsonObject>(), reset);
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
+
+/**
+ * @brief 样本所在的桶。
+ */
+size_t Sys_Trace::bucketIndex(uint32_t cycles) {
+    if (cycles < (1u << MIN_OCTAVE)) {
+        return 0;
+    }
+    const uint32_t octave = 31 - __builtin_clz(cycles);
+    const uint32_t sub = (cycles >> (octave - SUB_BUCKET_BITS)) & ((1u << SUB_BUCKET_BITS) - 1);
+    return ((octave - MIN_OCTAVE) << SUB_BUCKET_BITS) + sub;
+}
+
+/**
+ * @brief 桶的下界；第0个桶同时容纳`2^MIN_OCTAVE`以下的全部样本，下界为0。
+ */
+uint64_t Sys_Trace::bucketLowerBound(size_t index) {
+    if (index == 0) {
+        return 0;
+    }
+    if (index >= BUCKET_COUNT) {
+        return (uint64_t)1 << 32;
+    }
+    const uint32_t octave = MIN_OCTAVE + (index >> SUB_BUCKET_BITS);
+    const uint64_t sub = index & ((1u << SUB_BUCKET_BITS) - 1);
+    return ((1ull << SUB_BUCKET_BITS) + sub) << (octave - SUB_BUCKET_BITS);
+}
+
+/**
+ * @brief 估算第`permille`‰分位数。
+ * @details 找到累计计数首次达到目标名次的桶，在桶的上下界之间按名次线性插值；
+ *          结果不超过实际记录到的最大值。
+ */
+uint32_t Sys_Trace::percentile(const uint32_t* buckets, uint32_t count, uint32_t max_cycles, uint32_t permille) {
+    uint32_t rank = (uint32_t)(((uint64_t)count * permille + 999) / 1000);
+    if (rank == 0) rank = 1;
+
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        if (buckets[i] == 0) continue;
+        if (cumulative + buckets[i] >= rank) {
+            const uint64_t lower = bucketLowerBound(i);
+            const uint64_t upper = bucketLowerBound(i + 1);
+            const uint64_t value = lower + (upper - lower) * (rank - cumulative) / buckets[i];
+            return value < max_cycles ? (uint32_t)value : max_cycles;
+        }
+        cumulative += buckets[i];
+    }
+    return max_cycles;
+}
+
+#endif // SYS_TRACE_ENABLED
@@ -0,0 +1,476 @@
+/**
+ * @file Sys_UploadManager.cpp
+ * @brief 流式文件上传管线的实现文件
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 一个上传在两侧之间的流转：
+ * 1. async_tcp任务收到第一个数据块时占用一个上下文，投递`OPEN`作业；
+ * 2. 数据块拷贝进当前的汇集缓冲区，写满后作为`WRITE`作业交给写入任务，并换用下一个空闲缓冲区；
+ * 3. 最后一个数据块到达后，剩余数据随`FINISH`作业一起交出；出错或客户端断开时投递`ABORT`；
+ * 4. 写入任务按顺序处理作业，写完一个缓冲区就归还它；`FINISH`时校验并重命名文件，推送结果。
+ * 每个请求只接受一个文件。
+ */
+#include "Sys_UploadManager.h"
+#include "Sys_Debug.h"
+#include "Sys_Tasks.h"       // 进度与结果通过通知环形缓冲区推送
+#include "Sys_FlashLogger.h"
+#include "FFat.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+
+// 初始化静态单例指针
+Sys_UploadManager* Sys_UploadManager::_instance = nullptr;
+
+/**
+ * @brief 获取上传管理器的单例实例。
+ */
+Sys_UploadManager* Sys_UploadManager::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new Sys_UploadManager();
+    }
+    return _instance;
+}
+
+/**
+ * @brief 分配缓冲区、创建作业队列并启动写入任务。
+ */
+bool Sys_UploadManager::begin() {
+    for (UploadContext& context : _contexts) {
+        for (size_t i = 0; i < BUFFERS_PER_UPLOAD; ++i) {
+            context.buffers[i] = (uint8_t*)heap_caps_malloc(UPLOAD_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (context.buffers[i] == nullptr) {
+                ESP_LOGE("Upload", "Failed to allocate %u-byte upload buffer in PSRAM!", UPLOAD_BUFFER_SIZE);
+                return false;
+            }
+        }
+        context.free_buffers = xSemaphoreCreateCounting(BUFFERS_PER_UPLOAD, BUFFERS_PER_UPLOAD);
+        if (context.free_buffers == NULL) {
+            ESP_LOGE("Upload", "Failed to create upload buffer semaphore!");
+            return false;
+        }
+    }
+
+    _jobs = xQueueCreate(JOB_QUEUE_LENGTH, sizeof(UploadJob));
+    if (_jobs == NULL ||
+        xTaskCreatePinnedToCore(writerTask, WRITER_TASK_NAME, WRITER_TASK_STACK_SIZE, this, WRITER_TASK_PRIORITY, NULL, WRITER_TASK_CORE) != pdPASS) {
+        ESP_LOGE("Upload", "Failed to start the upload writer task!");
+        return false;
+    }
+
+    // 上传目录不存在时FFat.open()会失败
+    if (!FFat.exists("/media")) {
+        FFat.mkdir("/media");
+    }
+
+    _ready = true;
+    ESP_LOGI("Upload", "Upload pipeline ready: %u concurrent uploads, %u x %u KB PSRAM buffers each.",
+             MAX_CONCURRENT_UPLOADS, BUFFERS_PER_UPLOAD, UPLOAD_BUFFER_SIZE / 1024);
+    return true;
+}
+
+// =================================================================================================
+// async_tcp任务一侧
+// =================================================================================================
+
+/**
+ * @brief 上传数据块回调。
+ */
+void Sys_UploadManager::handleChunk(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) {
+    UploadContext* context = findContext(request);
+    if (index == 0) {
+        if (context != nullptr) {
+            // 同一请求中的第二个文件
+            failUpload(context, "Only one file per upload request is supported");
+            return;
+        }
+        context = acquireContext(request);
+        if (context == nullptr || !startUpload(context, request, filename)) {
+            return;
+        }
+    }
+    if (context == nullptr || context->failed || context->finished) {
+        return;
+    }
+    if (context->write_failed.load()) {
+        failUpload(context, "Failed to write the file to FFat");
+        return;
+    }
+
+    // 汇集进当前缓冲区，写满即交给写入任务
+    while (len > 0) {
+        const size_t space = UPLOAD_BUFFER_SIZE - context->fill_len;
+        const size_t n = (len < space) ? len : space;
+        memcpy(context->buffers[context->fill_buffer] + context->fill_len, data, n);
+        context->fill_len += n;
+        context->received += n;
+        data += n;
+        len -= n;
+        if (context->fill_len == UPLOAD_BUFFER_SIZE && !submitFillBuffer(context, JobType::WRITE)) {
+            return;
+        }
+    }
+
+    if (final) {
+        submitFillBuffer(context, JobType::FINISH);
+        DEBUG_LOG("Upload #%u received: %s, %u bytes.", context->id, context->path, context->received);
+    }
+}
+
+/**
+ * @brief 上传请求的数据接收完毕后的响应回调。
+ */
+void Sys_UploadManager::handleRequestComplete(AsyncWebServerRequest* request) {
+    UploadContext* context = findContext(request);
+    if (context == nullptr) {
+        request->send(_ready ? 400 : 503, "application/json",
+                      _ready ? "{\"error\":\"No file in request, or too many concurrent uploads\"}"
+                             : "{\"error\":\"Upload pipeline unavailable\"}");
+        return;
+    }
+
+    if (context->failed || !context->finished) {
+        String body = "{\"error\":\"";
+        body += context->error ? context->error : "Upload incomplete";
+        body += "\"}";
+        request->send(500, "application/json", body);
+    } else {
+        // 文件可能仍在写入：最终结果以file.uploadResult通知为准
+        char body[128];
+        snprintf(body, sizeof(body), "{\"id\":%u,\"path\":\"%s\",\"size\":%u,\"status\":\"writing\"}",
+                 context->id, context->path, context->received);
+        request->send(202, "application/json", body);
+    }
+    context->request = nullptr;
+    releaseContext(context);
+}
+
+/**
+ * @brief 占用一个空闲的上传上下文。
+ * @note 上下文只在async_tcp任务中被占用，因此无需比较交换。
+ */
+Sys_UploadManager::UploadContext* Sys_UploadManager::acquireContext(AsyncWebServerRequest* request) {
+    if (!_ready) {
+        return nullptr;
+    }
+    for (UploadContext& context : _contexts) {
+        // acquire与releaseContext()中的release配对：看到0时，重置后的字段必然可见
+        if (context.refs.load(std::memory_order_acquire) == 0) {
+            context.refs.store(2); // 请求一侧 + 写入任务
+            context.request = request;
+            context.id = _next_id++;
+            return &context;
+        }
+    }
+    ESP_LOGW("Upload", "Too many concurrent uploads, rejecting request.");
+    return nullptr;
+}
+
+/**
+ * @brief 查找请求对应的上传上下文。
+ */
+Sys_UploadManager::UploadContext* Sys_UploadManager::findContext(AsyncWebServerRequest* request) {
+    for (UploadContext& context : _contexts) {
+        if (context.refs.load() != 0 && context.request == request) {
+            return &context;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 初始化上下文并投递`OPEN`作业。
+ */
+bool Sys_UploadManager::startUpload(UploadContext* context, AsyncWebServerRequest* request, const String& filename) {
+    request->onDisconnect([this, request]() { onRequestDisconnected(request); });
+
+    // 防止路径遍历：文件名中不允许出现目录分隔符和".."
+    if (filename.length() == 0 || filename.indexOf('/') >= 0 || filename.indexOf('\\') >= 0 || filename.indexOf("..") >= 0 ||
+        strlen(UPLOAD_DIR) + filename.length() >= sizeof(context->path)) {
+        failUpload(context, "Invalid file name");
+        return false;
+    }
+    snprintf(context->path, sizeof(context->path), "%s%s", UPLOAD_DIR, filename.c_str());
+    snprintf(context->temp_path, sizeof(context->temp_path), "%s.part", context->path);
+    context->request_length = request->contentLength();
+
+    if (request->hasHeader("X-Upload-CRC32")) {
+        context->expected_crc = strtoul(request->header("X-Upload-CRC32").c_str(), nullptr, 16);
+        context->has_expected_crc = true;
+    }
+
+    // 第一个缓冲区必然空闲（上下文刚被占用）
+    xSemaphoreTake(context->free_buffers, 0);
+    context->fill_buffer = 0;
+    context->fill_len = 0;
+
+    const UploadJob job = { context, JobType::OPEN, 0, 0 };
+    xQueueSend(_jobs, &job, portMAX_DELAY); // 队列容量足够容纳所有上下文的全部作业，不会真正阻塞
+    DEBUG_LOG("Upload #%u started: %s (%u bytes in request).", context->id, context->path, context->request_length);
+    return true;
+}
+
+/**
+ * @brief 把当前缓冲区交给写入任务；`WRITE`之后换用下一个空闲缓冲区。
+ * @return bool `false` 表示上传已失败。
+ */
+bool Sys_UploadManager::submitFillBuffer(UploadContext* context, JobType type) {
+    const UploadJob job = { context, type, context->fill_buffer, (uint32_t)context->fill_len };
+    xQueueSend(_jobs, &job, portMAX_DELAY);
+    if (type == JobType::FINISH) {
+        context->finished = true;
+        return true;
+    }
+
+    // [背压] 所有缓冲区都在等待写入：闪存跟不上网络，短暂阻塞async_tcp任务
+    if (xSemaphoreTake(context->free_buffers, pdMS_TO_TICKS(BUFFER_WAIT_MS)) != pdTRUE) {
+        ESP_LOGE("Upload", "Upload #%u: flash writes stalled for %u ms.", context->id, BUFFER_WAIT_MS);
+        failUpload(context, "Flash write timeout");
+        return false;
+    }
+    context->fill_buffer = (context->fill_buffer + 1) % BUFFERS_PER_UPLOAD;
+    context->fill_len = 0;
+    return true;
+}
+
+/**
+ * @brief 上传在请求一侧失败：通知写入任务放弃，之后的数据块被丢弃。
+ */
+void Sys_UploadManager::failUpload(UploadContext* context, const char* error) {
+    if (context->failed) {
+        return;
+    }
+    ESP_LOGW("Upload", "Upload #%u failed: %s", context->id, error);
+    context->failed = true;
+    context->error = error;
+    if (!context->finished) {
+        const UploadJob job = { context, JobType::ABORT, 0, 0 };
+        xQueueSend(_jobs, &job, portMAX_DELAY);
+        context->finished = true;
+    }
+}
+
+/**
+ * @brief 客户端断开回调。请求正常完成后断开时，上下文已与请求分离，不会被找到。
+ */
+void Sys_UploadManager::onRequestDisconnected(AsyncWebServerRequest* request) {
+    UploadContext* context = findContext(request);
+    if (context == nullptr) {
+        return;
+    }
+    if (!context->finished) {
+        failUpload(context, "Client disconnected");
+    }
+    context->request = nullptr;
+    releaseContext(context);
+}
+
+/**
+ * @brief 释放一个引用；最后一个引用释放时重置上下文，使槽位可复用。
+ * @details 最后一个引用不直接减到0：`acquireContext()`看到0就会占用槽位，
+ *          因此先在仍持有引用时重置所有字段，最后才以release语义把`refs`置0发布为空闲。
+ */
+void Sys_UploadManager::releaseContext(UploadContext* context) {
+    uint8_t refs = context->refs.load(std::memory_order_acquire);
+    while (refs > 1) {
+        if (context->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return;
+        }
+    }
+    if (refs == 0) {
+        ESP_LOGE("Upload", "Upload #%u context released more times than it was acquired!", context->id);
+        return;
+    }
+    // 此时只剩调用者持有该上下文：把缓冲区信号量恢复为全部空闲
+    while (xSemaphoreTake(context->free_buffers, 0) == pdTRUE) {}
+    for (size_t i = 0; i < BUFFERS_PER_UPLOAD; ++i) {
+        xSemaphoreGive(context->free_buffers);
+    }
+    context->request = nullptr;
+    context->path[0] = '\0';
+    context->temp_path[0] = '\0';
+    context->file = File();
+    context->received = 0;
+    context->written = 0;
+    context->last_progress = 0;
+    context->request_length = 0;
+    context->crc = 0;
+    context->expected_crc = 0;
+    context->has_expected_crc = false;
+    context->fill_buffer = 0;
+    context->fill_len = 0;
+    context->failed = false;
+    context->finished = false;
+    context->error = nullptr;
+    context->write_error = nullptr;
+    context->write_failed.store(false);
+    context->refs.store(0, std::memory_order_release);
+}
+
+// =================================================================================================
+// 写入任务一侧
+// =================================================================================================
+
+/**
+ * @brief Task_UploadWriter 的核心循环：按顺序处理所有上传的作业。
+ */
+void Sys_UploadManager::writerTask(void* parameter) {
+    Sys_UploadManager* self = static_cast<Sys_UploadManager*>(parameter);
+    UploadJob job;
+    for (;;) {
+        if (xQueueReceive(self->_jobs, &job, portMAX_DELAY) == pdTRUE) {
+            self->processJob(job);
+        }
+    }
+}
+
+/**
+ * @brief 处理一个作业。
+ */
+void Sys_UploadManager::processJob(const UploadJob& job) {
+    UploadContext* context = job.context;
+    switch (job.type) {
+        case JobType::OPEN:
+            if (FFat.exists(context->temp_path)) {
+                FFat.remove(context->temp_path);
+            }
+            context->file = FFat.open(context->temp_path, "w");
+            if (!context->file) {
+                ESP_LOGE("Upload", "Failed to open %s for writing.", context->temp_path);
+                context->write_error = "Failed to create the file on FFat";
+                context->write_failed.store(true);
+            }
+            break;
+
+        case JobType::WRITE:
+        case JobType::FINISH:
+            if (job.len > 0 && !context->write_failed.load()) {
+                const uint8_t* data = context->buffers[job.buffer];
+                if (context->file.write(data, job.len) != job.len) {
+                    ESP_LOGE("Upload", "Write to %s failed after %u bytes.", context->temp_path, context->written);
+                    context->write_error = "FFat write failed (filesystem full?)";
+                    context->write_failed.store(true);
+                } else {
+                    context->crc = esp_rom_crc32_le(context->crc, data, job.len);
+                    context->written += job.len;
+                    if (context->written - context->last_progress >= PROGRESS_INTERVAL_BYTES) {
+                        context->last_progress = context->written;
+                        postProgress(context);
+                    }
+                }
+            }
+            xSemaphoreGive(context->free_buffers);
+            if (job.type == JobType::FINISH) {
+                finishUpload(context);
+            }
+            break;
+
+        case JobType::ABORT:
+            discardUpload(context);
+            postResult(context, false, context->error);
+            releaseContext(context);
+            break;
+    }
+}
+
+/**
+ * @brief 所有数据已写入：回读校验后把临时文件重命名为目标文件。
+ */
+void Sys_UploadManager::finishUpload(UploadContext* context) {
+    if (context->write_failed.load()) {
+        discardUpload(context);
+        postResult(context, false, context->write_error);
+        releaseContext(context);
+        return;
+    }
+    context->file.close();
+
+    // 回读整个文件，确认闪存中的内容与收到的数据一致（此时所有缓冲区都已空闲，用作读缓冲）
+    uint32_t stored_crc = 0;
+    size_t stored_len = 0;
+    File check = FFat.open(context->temp_path, "r");
+    if (check) {
+        uint8_t* scratch = context->buffers[0];
+        size_t n;
+        while ((n = check.read(scratch, UPLOAD_BUFFER_SIZE)) > 0) {
+            stored_crc = esp_rom_crc32_le(stored_crc, scratch, n);
+            stored_len += n;
+        }
+        check.close();
+    }
+
+    const char* error = nullptr;
+    if (stored_len != context->written || stored_crc != context->crc) {
+        error = "Read-back verification failed";
+    } else if (context->has_expected_crc && context->expected_crc != context->crc) {
+        error = "CRC32 does not match X-Upload-CRC32";
+    } else {
+        if (FFat.exists(context->path)) {
+            FFat.remove(context->path);
+        }
+        if (!FFat.rename(context->temp_path, context->path)) {
+            error = "Failed to rename the uploaded file";
+        }
+    }
+
+    if (error != nullptr) {
+        ESP_LOGE("Upload", "Upload #%u (%s): %s.", context->id, context->path, error);
+        FFat.remove(context->temp_path);
+        postResult(context, false, error);
+    } else {
+        ESP_LOGI("Upload", "Upload #%u stored: %s, %u bytes, CRC32 %08X.", context->id, context->path, context->written, context->crc);
+        Sys_FlashLogger::getInstance()->log("[Upload]", "Stored %s (%u bytes).", context->path, context->written);
+        postResult(context, true, nullptr);
+    }
+    releaseContext(context);
+}
+
+/**
+ * @brief 放弃上传：关闭并删除临时文件。
+ */
+void Sys_UploadManager::discardUpload(UploadContext* context) {
+    if (context->file) {
+        context->file.close();
+    }
+    if (FFat.exists(context->temp_path)) {
+        FFat.remove(context->temp_path);
+    }
+}
+
+/**
+ * @brief 推送`file.uploadProgress`通知。
+ */
+void Sys_UploadManager::postProgress(UploadContext* context) {
+    JsonDocument doc;
+    doc["jsonrpc"] = "2.0";
+    doc["method"] = "file.uploadProgress";
+    JsonObject params = doc["params"].to<JsonObject>();
+    params["id"] = context->id;
+    params["path"] = context->path;
+    params["written"] = context->written;
+    params["total"] = context->request_length; // 请求体长度（含multipart边界），仅用于估算
+    Sys_Tasks::postNotification(doc);
+}
+
+/**
+ * @brief 推送`file.uploadResult`通知。
+ */
+void Sys_UploadManager::postResult(UploadContext* context, bool ok, const char* error) {
+    JsonDocument doc;
+    doc["jsonrpc"] = "2.0";
+    doc["method"] = "file.uploadResult";
+    JsonObject params = doc["params"].to<JsonObject>();
+    params["id"] = context->id;
+    params["path"] = context->path;
+    params["ok"] = ok;
+    params["size"] = context->written;
+    if (ok) {
+        char crc_hex[9];
+        snprintf(crc_hex, sizeof(crc_hex), "%08x", context->crc);
+        params["crc32"] = crc_hex;
+    } else {
+        params["error"] = error ? error : "Upload failed";
+    }
+    Sys_Tasks::postNotification(doc);
+}
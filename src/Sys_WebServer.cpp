@@ -11,12 +11,24 @@
 #include "Sys_WebServer.h"
 #include "types.h"
 #include "Sys_Debug.h"
-#include "Sys_Tasks.h"        // 需要访问 xCommandQueue 和 JsonRpcRequest 结构体
+#include "Sys_Tasks.h"        // 需要投递RPC请求到工作任务
+#include "Sys_WsBroadcaster.h" // [新增] 维护推送会话表
+#include "Sys_RpcRouter.h"     // [新增] 注册本模块的RPC方法
+#include "Sys_StateRegistry.h" // [新增] 状态订阅按字段名解析
 #include "Sys_Filesystem.h"   // 需要访问 LittleFS 和 FFat
 #include "Sys_SettingsManager.h"
+#include "Sys_FlashLogger.h"    // [新增] 日志查询接口
+#include "Sys_MemoryManager.h"  // [新增] 查询结果文档使用PSRAM分配器
+#include "Sys_AssetCache.h"     // [新增] 静态资源内存缓存
+#include "Sys_UploadManager.h"  // [新增] 流式文件上传管线
+#include "Sys_CameraPipeline.h" // [新增] MJPEG实时流的帧来源
+#include "Sys_Trace.h"          // [新增] RPC端到端延迟追踪
+#include "Sys_Scheduler.h"      // [新增] 客户端连接/断开事件
+#include <memory>
 
 // 初始化静态单例指针
 Sys_WebServer* Sys_WebServer::_instance = nullptr;
+uint8_t Sys_WebServer::_stream_clients = 0;
 
 /**
  * @brief 获取WebServer的单例实例。
@@ -28,6 +40,62 @@ Sys_WebServer* Sys_WebServer::getInstance() {
     return _instance;
 }
 
+/**
+ * @brief [新增] RPC `server.setEncoding`：切换调用方客户端的推送编码。
+ * @details 参数 `{"encoding": "json" | "msgpack"}`。本次响应仍使用请求帧的编码，
+ *          此后的推送通知按新编码发送。
+ */
+static void rpcServerSetEncoding(const JsonRpcRequest& request) {
+    const char* encoding_name = request.params["encoding"];
+    WsEncoding encoding;
+    if (encoding_name != nullptr && strcmp(encoding_name, "json") == 0) {
+        encoding = WsEncoding::JSON;
+    } else if (encoding_name != nullptr && strcmp(encoding_name, "msgpack") == 0) {
+        encoding = WsEncoding::MSGPACK;
+    } else {
+        Sys_RpcRouter::sendError(request, -32602, "Invalid params: encoding must be 'json' or 'msgpack'");
+        return;
+    }
+
+    if (!Sys_WsBroadcaster::getInstance()->setClientEncoding(request.client_id, encoding)) {
+        Sys_RpcRouter::sendError(request, -32000, "Client session not found");
+        return;
+    }
+    JsonDocument result_doc;
+    result_doc["encoding"] = encoding_name;
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
+
+/**
+ * @brief [新增] RPC `state.subscribe`：选择调用方客户端接收的状态字段。
+ * @details 参数 `{"fields": ["free_heap", "wifi_state"]}`；省略`fields`或传入空数组表示订阅全部字段。
+ *          订阅生效后，客户端会立即收到所订阅字段的完整快照，之后只接收这些字段的增量。
+ */
+static void rpcStateSubscribe(const JsonRpcRequest& request) {
+    JsonArrayConst fields = request.params["fields"];
+    uint32_t field_mask = Sys_StateRegistry::ALL_FIELDS;
+
+    if (!fields.isNull() && fields.size() > 0) {
+        field_mask = 0;
+        for (JsonVariantConst name : fields) {
+            StateFieldId id = Sys_StateRegistry::getInstance()->findField(name.as<const char*>());
+            if (id == INVALID_STATE_FIELD) {
+                Sys_RpcRouter::sendError(request, -32602, "Invalid params: unknown state field");
+                return;
+            }
+            field_mask |= (1u << id);
+        }
+    }
+
+    if (!Sys_WsBroadcaster::getInstance()->setClientSubscription(request.client_id, field_mask)) {
+        Sys_RpcRouter::sendError(request, -32000, "Client session not found");
+        return;
+    }
+    JsonDocument result_doc;
+    result_doc["status"] = "subscribed";
+    Sys_RpcRouter::sendResult(request, result_doc);
+}
+
 /**
  * @brief 构造函数，初始化服务器监听80端口，WebSocket服务路径为/ws。
  */
@@ -45,6 +113,15 @@ void Sys_WebServer::begin() {
         this->onWebSocketEvent(server, client, type, arg, data, len);
     });
     _server.addHandler(&_ws); // 将WebSocket处理器添加到Web服务器
+    // [新增] 在服务器启动前创建并绑定广播器，确保首个连接事件到来时会话表已就绪
+    Sys_WsBroadcaster::getInstance()->begin(&_ws);
+    Sys_RpcRouter::registerMethod("server.setEncoding", rpcServerSetEncoding);
+    Sys_RpcRouter::registerMethod("state.subscribe", rpcStateSubscribe);
+
+    // [新增] 按照编译期资源清单把Web UI资源载入PSRAM缓存，静态路由因此不必在请求中访问文件系统
+    Sys_AssetCache::getInstance()->begin();
+    // [新增] 分配上传汇集缓冲区并启动写入任务
+    Sys_UploadManager::getInstance()->begin();
 
     // 步骤2：设置所有HTTP路由
     setupHttpRoutes();
@@ -61,34 +138,33 @@ void Sys_WebServer::setupHttpRoutes() {
     // --- 文件上传处理 ---
     // 所有POST到/upload的请求都会被这个处理器处理
     _server.on("/upload", HTTP_POST,
-        // 上传成功后的响应回调
+        // 请求体接收完毕后的响应回调：202 + 上传ID，写入结果通过`file.uploadResult`通知
         [](AsyncWebServerRequest *request) {
-            request->send(200, "text/plain", "Upload OK");
+            Sys_UploadManager::getInstance()->handleRequestComplete(request);
         },
         // 文件块数据处理回调
         handleFileUpload
     );
 
+    // --- [新增] 日志查询 ---
+    // 必须在"/*"静态文件路由之前注册，否则会被其拦截
+    _server.on("/api/log/query", HTTP_GET, handleLogQuery);
+
+    // --- [新增] MJPEG 实时流 ---
+    // 同样必须在"/*"之前注册
+    _server.on("/stream", HTTP_GET, handleStream);
+
     // --- 静态文件服务 (Gzip内容协商优化) ---
-    // 对所有静态资源请求进行拦截，优先提供.gz版本
+    // [优化] 资源由编译期清单描述：优先从PSRAM缓存响应（带ETag/304/Cache-Control），
+    // 请求处理中不再访问文件系统探测文件是否存在；清单中没有的路径直接返回404
     _server.on("/*", HTTP_GET, [](AsyncWebServerRequest *request){
-        String path = request->url();
-        if (path.endsWith("/")) path += "index.html";
-        
-        String contentType = "text/plain";
-        if (path.endsWith(".html")) contentType = "text/html";
-        else if (path.endsWith(".css")) contentType = "text/css";
-        else if (path.endsWith(".js")) contentType = "application/javascript";
-        
-        if (LittleFS.exists(path + ".gz")) {
-            AsyncWebServerResponse *response = request->beginResponse(LittleFS, path + ".gz", contentType);
-            response->addHeader("Content-Encoding", "gzip");
-            request->send(response);
-        } else if (LittleFS.exists(path)) {
-            request->send(LittleFS, path, contentType);
-        } else {
+        bool versioned = false;
+        const CachedAsset* asset = Sys_AssetCache::getInstance()->find(request->url(), versioned);
+        if (asset == nullptr) {
             handleNotFound(request);
+            return;
         }
+        serveAsset(request, asset, versioned);
     });
 
     // --- 媒体文件服务 ---
@@ -110,28 +186,194 @@ void Sys_WebServer::cleanupClients() {
 // --- HTTP Route Handlers (静态方法实现) ---
 
 void Sys_WebServer::handleFileUpload(AsyncWebServerRequest *request, const String& filename, size_t index, uint8_t *data, size_t len, bool final) {
-    static File uploadFile;
-    // 安全地拼接路径，防止路径遍历攻击
-    String path = "/media/" + filename;
-
-    if (!index) { // 文件开始上传 (index=0)
-        DEBUG_LOG("Upload Start: %s", path.c_str());
-        if (FFat.exists(path)) { FFat.remove(path); }
-        uploadFile = FFat.open(path, "w");
-        if (!uploadFile) {
-            ESP_LOGE("WebServer", "Failed to open file for writing: %s", path.c_str());
-            return;
+    // [优化] 每个请求拥有独立的上传上下文；数据块汇集到PSRAM缓冲区后由写入任务落盘，
+    // async_tcp任务不再直接进行闪存写入
+    Sys_UploadManager::getInstance()->handleChunk(request, filename, index, data, len, final);
+}
+
+/**
+ * @struct Sys_WebServer::MjpegStreamState
+ * @brief 一个观看者的推流状态。
+ * @details 由分块响应的回调持有，请求结束（包括客户端断开）时随响应对象析构，释放仍持有的帧引用。
+ */
+struct Sys_WebServer::MjpegStreamState {
+    /** @brief 正在发送的帧（持有一个引用），`nullptr`表示正在等待下一帧。*/
+    CameraFrame* frame = nullptr;
+    /** @brief 最近发送的帧序号。*/
+    uint32_t last_seq = 0;
+    /** @brief 帧间隔（毫秒），由帧率上限决定。*/
+    uint32_t frame_interval_ms = 0;
+    /** @brief 最早可以开始发送下一帧的时间。*/
+    uint32_t next_frame_ms = 0;
+    /** @brief 当前part（头部 + JPEG + CRLF）中已发送的字节数。*/
+    size_t offset = 0;
+    /** @brief 当前part的头部。*/
+    char header[112];
+    size_t header_len = 0;
+
+    ~MjpegStreamState() {
+        Sys_CameraPipeline::getInstance()->releaseFrame(frame);
+        _stream_clients--;
+    }
+};
+
+void Sys_WebServer::handleStream(AsyncWebServerRequest *request) {
+    CameraPipelineStats stats;
+    Sys_CameraPipeline::getInstance()->getStats(stats);
+    if (stats.frame_slots == 0) {
+        request->send(503, "text/plain", "Camera pipeline unavailable");
+        return;
+    }
+    if (_stream_clients >= STREAM_MAX_CLIENTS) {
+        request->send(503, "text/plain", "Too many stream viewers");
+        return;
+    }
+
+    uint32_t fps = STREAM_DEFAULT_FPS;
+    if (request->hasParam("fps")) {
+        fps = constrain(request->getParam("fps")->value().toInt(), 1L, (long)STREAM_MAX_FPS);
+    }
+    std::shared_ptr<MjpegStreamState> state = std::make_shared<MjpegStreamState>();
+    state->frame_interval_ms = 1000 / fps;
+    _stream_clients++;
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        String("multipart/x-mixed-replace; boundary=") + STREAM_BOUNDARY,
+        [state](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+            return fillStreamChunk(*state, buffer, max_len);
+        });
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+    DEBUG_LOG("MJPEG viewer connected (%u active, %u fps cap).", _stream_clients, fps);
+}
+
+size_t Sys_WebServer::fillStreamChunk(MjpegStreamState& state, uint8_t* buffer, size_t max_len) {
+    if (state.frame == nullptr) {
+        const uint32_t now = millis();
+        if ((int32_t)(now - state.next_frame_ms) < 0) {
+            return RESPONSE_TRY_AGAIN; // 帧率上限
+        }
+        // 总是取最新的帧：慢速观看者跳过中间帧，而不是积压
+        CameraFrame* frame = Sys_CameraPipeline::getInstance()->acquireLatestFrame(state.last_seq);
+        if (frame == nullptr) {
+            return RESPONSE_TRY_AGAIN;
+        }
+        state.frame = frame;
+        state.last_seq = frame->seq;
+        state.offset = 0;
+        state.header_len = snprintf(state.header, sizeof(state.header),
+                                    "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %u\r\n\r\n",
+                                    STREAM_BOUNDARY, frame->jpeg_len, frame->timestamp_ms);
+        state.next_frame_ms = now + state.frame_interval_ms;
+    }
+
+    // 直接从帧缓冲拷贝到TCP发送缓冲区，不经过String
+    static const char PART_END[] = "\r\n";
+    const CameraFrame* frame = state.frame;
+    const size_t jpeg_end = state.header_len + frame->jpeg_len;
+    const size_t part_len = jpeg_end + sizeof(PART_END) - 1;
+    const size_t limit = (max_len < STREAM_CHUNK_LIMIT) ? max_len : STREAM_CHUNK_LIMIT;
+    size_t written = 0;
+    while (written < limit && state.offset < part_len) {
+        const uint8_t* src;
+        size_t available;
+        if (state.offset < state.header_len) {
+            src = (const uint8_t*)state.header + state.offset;
+            available = state.header_len - state.offset;
+        } else if (state.offset < jpeg_end) {
+            src = frame->jpeg + (state.offset - state.header_len);
+            available = jpeg_end - state.offset;
+        } else {
+            src = (const uint8_t*)PART_END + (state.offset - jpeg_end);
+            available = part_len - state.offset;
+        }
+        const size_t n = (available < limit - written) ? available : limit - written;
+        memcpy(buffer + written, src, n);
+        written += n;
+        state.offset += n;
+    }
+
+    if (state.offset == part_len) {
+        Sys_CameraPipeline::getInstance()->releaseFrame(state.frame);
+        state.frame = nullptr;
+    }
+    return written;
+}
+
+void Sys_WebServer::handleLogQuery(AsyncWebServerRequest *request) {
+    // 把查询字符串转换为与RPC `log.query`相同的参数对象
+    JsonDocument params_doc;
+    static const char* const NUMERIC_PARAMS[] = {"from", "to", "limit"};
+    static const char* const TEXT_PARAMS[] = {"level", "tag", "cursor"};
+    if (request->hasParam("boot")) {
+        params_doc["boot"] = request->getParam("boot")->value().toInt();
+    }
+    for (const char* name : NUMERIC_PARAMS) {
+        if (request->hasParam(name)) {
+            params_doc[name] = strtoul(request->getParam(name)->value().c_str(), nullptr, 10);
+        }
+    }
+    for (const char* name : TEXT_PARAMS) {
+        if (request->hasParam(name)) {
+            params_doc[name] = request->getParam(name)->value();
         }
     }
 
-    if (len > 0 && uploadFile) {
-        uploadFile.write(data, len); // 将接收到的数据块写入文件
+    FlashLogQuery query;
+    const char* error = Sys_FlashLogger::parseQuery(params_doc, query);
+    if (error != nullptr) {
+        JsonDocument error_doc;
+        error_doc["error"] = error;
+        String body;
+        serializeJson(error_doc, body);
+        request->send(400, "application/json", body);
+        return;
     }
 
-    if (final) { // 文件上传结束
-        DEBUG_LOG("Upload End: %s, Total Size: %u", path.c_str(), index + len);
-        if (uploadFile) { uploadFile.close(); }
+    JsonDocument result_doc(Sys_PsramJsonAllocator::instance());
+    if (!Sys_FlashLogger::getInstance()->query(query, result_doc.to<JsonObject>())) {
+        request->send(503, "application/json", "{\"error\":\"Log query failed\"}");
+        return;
     }
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(result_doc, *response);
+    request->send(response);
+}
+
+void Sys_WebServer::serveAsset(AsyncWebServerRequest *request, const CachedAsset* asset, bool versioned) {
+    const AssetManifestEntry* entry = asset->entry;
+    if (!asset->matches_manifest) {
+        // 文件系统镜像与固件不匹配：照常提供文件，但不承诺ETag
+        AsyncWebServerResponse *response = request->beginResponse(LittleFS, String(entry->path) + ".gz", entry->content_type);
+        response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+        return;
+    }
+
+    const char* cache_control = versioned ? Sys_AssetCache::CACHE_CONTROL_VERSIONED : Sys_AssetCache::CACHE_CONTROL_REVALIDATE;
+
+    // 浏览器已持有相同内容：只返回304，不发送正文
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match").indexOf(entry->etag) >= 0) {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", entry->etag);
+        response->addHeader("Cache-Control", cache_control);
+        request->send(response);
+        return;
+    }
+
+    AsyncWebServerResponse *response;
+    if (asset->data != nullptr) {
+        // 直接引用PSRAM中的缓存内容，不发生拷贝
+        response = request->beginResponse_P(200, entry->content_type, asset->data, entry->gzip_size);
+    } else {
+        // 超出缓存预算的资源：从LittleFS读取（路径来自清单，无需探测）
+        response = request->beginResponse(LittleFS, String(entry->path) + ".gz", entry->content_type);
+    }
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", entry->etag);
+    response->addHeader("Cache-Control", cache_control);
+    request->send(response);
 }
 
 void Sys_WebServer::handleNotFound(AsyncWebServerRequest *request) {
@@ -151,56 +393,62 @@ void Sys_WebServer::onWebSocketEvent(AsyncWebSocket *server, AsyncWebSocketClien
         case WS_EVT_CONNECT:
             ESP_LOGI("WebSocket", "Client #%u connected from %s", client->id(), client->remoteIP().toString().c_str());
             client->text("{\"jsonrpc\":\"2.0\",\"method\":\"server.welcome\",\"params\":{\"message\":\"Connection established!\"}}");
+            Sys_WsBroadcaster::getInstance()->onClientConnected(client->id()); // [新增] 登记推送会话
+            Sys_Scheduler::post(SysEvent::CLIENTS_CHANGED); // [新增] 有客户端时才周期发布状态
             break;
 
         case WS_EVT_DISCONNECT:
             ESP_LOGI("WebSocket", "Client #%u disconnected", client->id());
+            Sys_WsBroadcaster::getInstance()->onClientDisconnected(client->id());
+            Sys_Scheduler::post(SysEvent::CLIENTS_CHANGED);
             break;
 
         case WS_EVT_DATA: {
             AwsFrameInfo *info = (AwsFrameInfo*)arg;
-            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-                
-                JsonDocument doc;
-                DeserializationError error = deserializeJson(doc, (const char*)data, len);
+            const bool is_binary = (info->opcode == WS_BINARY);
+            if (info->final && info->index == 0 && info->len == len && (info->opcode == WS_TEXT || is_binary)) {
 
-                if (error) {
-                    client->text("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32700,\"message\":\"Parse error\"},\"id\":null}");
+                // [优化] 请求对象从内存池分配，帧只在此处解析一次，解析结果随指针一起交给Task_Worker
+                JsonRpcRequest* rpcRequest = JsonRpcRequest::create();
+                if (rpcRequest == nullptr) {
+                    ESP_LOGE("WebServer", "Out of memory, dropping RPC request.");
+                    client->text("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32000,\"message\":\"Server busy, out of memory\"},\"id\":null}");
                     return;
                 }
+                SYS_TRACE_STAMP(rpcRequest->received_us); // [新增] 端到端延迟的起点
 
-                // 验证JSON RPC 2.0格式
-                if (strcmp(doc["jsonrpc"], "2.0") != 0 || doc["method"].isNull()) {
-                    client->text("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32600,\"message\":\"Invalid Request\"},\"id\":null}");
+                // [新增] 二进制帧按MessagePack解析，文本帧按JSON解析；响应使用与请求相同的编码
+                const int parse_error = Sys_RpcRouter::parseFrame(*rpcRequest, (const char*)data, len, is_binary);
+                if (parse_error == -32700) {
+                    JsonRpcRequest::release(rpcRequest);
+                    client->text("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32700,\"message\":\"Parse error\"},\"id\":null}");
                     return;
                 }
-
-                // 封装为内部命令结构体
-                JsonRpcRequest rpcRequest;
-                rpcRequest.id = doc["id"] | 0; // 如果id不存在，默认为0
-                rpcRequest.client_id = client->id();
-                
-                strncpy(rpcRequest.method, doc["method"], sizeof(rpcRequest.method) - 1);
-                
-                if (!doc["params"].isNull()) {
-                    serializeJson(doc["params"], rpcRequest.params, sizeof(rpcRequest.params));
+                if (parse_error != 0) {
+                    JsonRpcRequest::release(rpcRequest);
+                    client->text("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32600,\"message\":\"Invalid Request\"},\"id\":null}");
+                    return;
                 }
+                rpcRequest->client_id = client->id();
 
                 // [新增] 创建响应闭包
-                rpcRequest.response_cb = [this, client_id = client->id()](const char* json_response) {
+                rpcRequest->response_cb = [this, client_id = client->id(), is_binary](const char* response, size_t response_len) {
                     // 检查WebSocket服务器和客户端是否仍然有效
                     if (this->_ws.count() > 0 && this->_ws.hasClient(client_id)) {
-                        this->_ws.text(client_id, json_response);
+                        if (is_binary) {
+                            this->_ws.binary(client_id, response, response_len);
+                        } else {
+                            this->_ws.text(client_id, response, response_len);
+                        }
                     }
                 };
 
-                // 发送到命令队列
-                if (xQueueSend(xCommandQueue, &rpcRequest, pdMS_TO_TICKS(10)) != pdPASS) {
+                // 按方法声明的通道投递（只传递指针，所有权随之转移给工作任务）
+                if (!Sys_Tasks::submitRpcRequest(rpcRequest)) {
                     ESP_LOGE("WebServer", "Command queue full, dropping RPC request.");
-                    // 如果队列已满，也通过回调函数返回错误
-                    if (rpcRequest.response_cb) {
-                        rpcRequest.response_cb("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32000,\"message\":\"Server busy, command queue full\"},\"id\":null}");
-                    }
+                    // 如果队列已满，直接以文本帧返回错误（客户端对两种帧都能解码）
+                    client->text("{\"jsonrpc\":\"2.0\",\"error\":{\"code\":-32000,\"message\":\"Server busy, command queue full\"},\"id\":null}");
+                    JsonRpcRequest::release(rpcRequest);
                 }
             }
             break;
@@ -7,9 +7,14 @@
 #include "Sys_WiFiManager.h"
 #include "Sys_Debug.h"
 #include "Sys_FlashLogger.h" // [新增] 引入闪存日志模块
+#include "Sys_Tasks.h"       // [新增] 扫描结果通过通知环形缓冲区推送
+#include "Sys_NvsManager.h"  // [新增] 快速连接缓存
+#include "ArduinoJson.h"
 
 // [优化] 定义重连相关的常量
-static constexpr const uint32_t RECONNECT_INTERVAL_MS = 10000; // 10秒重连间隔
+static constexpr const uint32_t RECONNECT_BASE_MS = 1000;      // [优化] 第一次重连间隔，此后每次翻倍
+static constexpr const uint32_t RECONNECT_MAX_MS = 60000;      // [新增] 重连间隔上限
+static constexpr const uint8_t RECONNECT_JITTER_PCT = 25;      // [新增] 随机抖动±25%，避免多台设备同时重连
 static constexpr const uint8_t MAX_STA_RETRIES = 3;            // 对于永久性错误，最多重试3次
 
 Sys_WiFiManager* Sys_WiFiManager::_instance = nullptr;
@@ -32,26 +37,64 @@ Sys_WiFiManager::Sys_WiFiManager() {
 void Sys_WiFiManager::begin() {
     // 关键：让静态回调能找到实例。这必须在注册回调之前完成。
     _instance = this; 
+    // [优化] 断开后的重连由单次定时器触发，间隔按指数退避：从RECONNECT_BASE_MS（1秒）起每次翻倍，
+    //        最长RECONNECT_MAX_MS（60秒），并叠加±RECONNECT_JITTER_PCT（25%）的随机抖动
+    _reconnect_timer = Sys_Scheduler::createTimer("wifiReconnect", onReconnectTimer, this);
+    _cache_save_timer = Sys_Scheduler::createTimer("wifiCacheSave", onCacheSaveTimer, this);
+
+    // [新增] 加载快速连接缓存，首次applySettings()即可跳过扫描
+    size_t length = sizeof(_saved);
+    if (Sys_NvsManager::readBlob(NVS_NAMESPACE, NVS_KEY_CONNECTION, &_saved, &length) &&
+        length == sizeof(_saved) && _saved.version == CONNECTION_CACHE_VERSION) {
+        _cache = _saved;
+        _cache_valid = true;
+        ESP_LOGI("WiFiMan", "Cached AP for '%s' on channel %u loaded.", _cache.ssid, _cache.channel);
+    } else {
+        _saved = {};
+    }
     WiFi.onEvent(WiFiEvent); // 注册统一的事件回调
+    // [新增] 订阅WiFi相关配置的变更，保存配置后自动重新应用
+    Sys_SettingsManager::getInstance()->addChangeListener(Sys_SettingsManager::WIFI_FIELDS, onSettingsChanged);
     
     // 首次启动时，应用一次当前配置
     applySettings();
 }
 
-void Sys_WiFiManager::applySettings() {
+void Sys_WiFiManager::onSettingsChanged(uint32_t changed_fields) {
+    getInstance()->applySettings(changed_fields);
+}
+
+void Sys_WiFiManager::applySettings(uint32_t changed_fields) {
+    // [优化] 除模式以外的WiFi字段都只影响STA
+    constexpr uint32_t MODE_FIELD = 1u << Sys_SettingsManager::FIELD_WIFI_MODE;
+    constexpr uint32_t STA_FIELDS = Sys_SettingsManager::WIFI_FIELDS & ~MODE_FIELD;
+    const bool mode_changed = (changed_fields & MODE_FIELD) != 0;
+    const bool sta_changed  = (changed_fields & STA_FIELDS) != 0;
+    if (!mode_changed && !sta_changed) {
+        return;
+    }
+
     Sys_LockGuard lock(_mutex); // [优化] 保护整个应用过程，确保原子性
 
-    DEBUG_LOG("Applying new WiFi settings...");
-    const auto& settings = Sys_SettingsManager::getInstance()->getSettings();
+    DEBUG_LOG("Applying new WiFi settings (changed fields 0x%03X)...", changed_fields);
+    const auto snapshot = Sys_SettingsManager::getInstance()->getSettings();
+    const SystemSettings& settings = *snapshot;
     
     // 重置永久失败状态和重试计数器，因为我们有了新的配置
     if (_currentState == WiFiState::FAILED_PERMANENTLY) {
         _currentState = WiFiState::WIFI_STATE_DISABLED;
     }
     _sta_retry_count = 0;
+    _backoff_count = 0; // [新增] 新配置从最短的重连间隔开始
+    Sys_Scheduler::stopTimer(_reconnect_timer);
+    if (sta_changed) {
+        _cache_valid = (_cache.version == CONNECTION_CACHE_VERSION); // 之前快速连接失败时重新允许尝试
+    }
 
     // 设置WiFi模式。这是启动STA/AP的前提。
-    WiFi.mode((wifi_mode_t)settings.wifi_mode);
+    if (mode_changed) {
+        WiFi.mode((wifi_mode_t)settings.wifi_mode);
+    }
 
     // 根据新的模式，决定启动或停止STA/AP
     bool should_have_sta = (settings.wifi_mode == SystemSettings::WIFI_MODE_STA || settings.wifi_mode == SystemSettings::WIFI_MODE_AP_STA);
@@ -64,10 +107,13 @@ void Sys_WiFiManager::applySettings() {
         stopSTA();
     }
 
-    if (should_have_ap) {
-        startAP(settings);
-    } else {
-        stopAP();
+    // [优化] 只有模式变化时才动AP，修改STA参数不会断开已连接到AP的客户端
+    if (mode_changed) {
+        if (should_have_ap) {
+            startAP(settings);
+        } else {
+            stopAP();
+        }
     }
     
     if (!should_have_sta && !should_have_ap) {
@@ -77,17 +123,49 @@ void Sys_WiFiManager::applySettings() {
     }
 }
 
-void Sys_WiFiManager::update() {
-    // update()只负责一件事情：处理非永久性断开后的超时重连
-    if (getCurrentState() == WiFiState::DISCONNECTED) {
-        if (millis() - _last_reconnect_attempt_ms > RECONNECT_INTERVAL_MS) {
-            Sys_LockGuard lock(_mutex); // [优化] 保护重连动作
-            ESP_LOGI("WiFiMan", "Reconnect timeout. Attempting to connect again...");
-            const auto& settings = Sys_SettingsManager::getInstance()->getSettings();
-            WiFi.begin(settings.wifi_ssid, settings.wifi_password);
-            // 不在此处改变状态，等待WIFI_STA_START事件
-        }
+void Sys_WiFiManager::onReconnectTimer(void* arg) {
+    // 定时器只负责一件事情：处理非永久性断开后的超时重连
+    Sys_WiFiManager* self = (Sys_WiFiManager*)arg;
+    Sys_LockGuard lock(self->_mutex); // [优化] 保护重连动作
+    if (self->_currentState != WiFiState::DISCONNECTED) {
+        return; // 定时器到期前已经重新连接，或配置已改变
+    }
+    if (self->_backoff_count < UINT8_MAX) {
+        self->_backoff_count++;
     }
+    ESP_LOGI("WiFiMan", "Reconnect timeout. Attempting to connect again (attempt %u)...", self->_backoff_count);
+    const auto settings = Sys_SettingsManager::getInstance()->getSettings();
+    self->connectSTA(*settings);
+    // 不在此处改变状态，等待WIFI_STA_START事件；若没有任何事件到来，则按退避间隔再试
+    Sys_Scheduler::startTimer(self->_reconnect_timer, self->reconnectDelay());
+}
+
+void Sys_WiFiManager::onCacheSaveTimer(void* arg) {
+    Sys_WiFiManager* self = (Sys_WiFiManager*)arg;
+    ConnectionCache cache;
+    {
+        Sys_LockGuard lock(self->_mutex);
+        cache = self->_cache;
+    }
+    // 同一AP重复连接时内容不变，不写闪存
+    if (memcmp(&cache, &self->_saved, sizeof(cache)) == 0) {
+        return;
+    }
+    if (Sys_NvsManager::writeBlob(NVS_NAMESPACE, NVS_KEY_CONNECTION, &cache, sizeof(cache))) {
+        self->_saved = cache;
+        DEBUG_LOG("Connection cache saved (channel %u).", cache.channel);
+    } else {
+        ESP_LOGW("WiFiMan", "Failed to save the connection cache.");
+    }
+}
+
+uint32_t Sys_WiFiManager::reconnectDelay() const {
+    uint32_t delay_ms = RECONNECT_MAX_MS;
+    if (_backoff_count < 16 && (RECONNECT_BASE_MS << _backoff_count) < RECONNECT_MAX_MS) {
+        delay_ms = RECONNECT_BASE_MS << _backoff_count;
+    }
+    const uint32_t jitter_range = delay_ms * RECONNECT_JITTER_PCT / 100;
+    return delay_ms - jitter_range + esp_random() % (2 * jitter_range + 1);
 }
 
 WiFiState Sys_WiFiManager::getCurrentState() {
@@ -107,6 +185,24 @@ String Sys_WiFiManager::getIPAddress() {
     return "0.0.0.0";
 }
 
+bool Sys_WiFiManager::startScan() {
+    Sys_LockGuard lock(_mutex);
+    if (_scan_in_progress) {
+        DEBUG_LOG("WiFi scan already in progress, joining it.");
+        return true;
+    }
+
+    // async=true: 立即返回，完成时触发 ARDUINO_EVENT_WIFI_SCAN_DONE
+    int16_t ret = WiFi.scanNetworks(true, true);
+    if (ret == WIFI_SCAN_FAILED) {
+        ESP_LOGE("WiFiMan", "Failed to start async WiFi scan.");
+        return false;
+    }
+    _scan_in_progress = true;
+    ESP_LOGI("WiFiMan", "Async WiFi scan started.");
+    return true;
+}
+
 // --- Private Helper Methods (仅由 applySettings 调用，已在锁的保护下) ---
 
 void Sys_WiFiManager::startSTA(const SystemSettings& settings) {
@@ -121,13 +217,37 @@ void Sys_WiFiManager::startSTA(const SystemSettings& settings) {
                 ESP_LOGW("WiFiMan", "Invalid static IP configuration, falling back to DHCP.");
             }
         }
-        WiFi.begin(settings.wifi_ssid, settings.wifi_password);
+        connectSTA(settings);
     } else {
         ESP_LOGW("WiFiMan", "STA mode enabled, but no SSID configured.");
         stopSTA();
     }
 }
 
+void Sys_WiFiManager::connectSTA(const SystemSettings& settings) {
+    const bool fast = _cache_valid && _cache.channel != 0 && strcmp(_cache.ssid, settings.wifi_ssid) == 0;
+#if SYS_WIFI_REUSE_IP
+    if (!settings.wifi_static_ip_enabled) {
+        if (fast && _cache.ip != 0) {
+            WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+            _static_ip_from_cache = true;
+        } else if (_static_ip_from_cache) {
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // 恢复DHCP
+            _static_ip_from_cache = false;
+        }
+    }
+#endif
+    _fast_connect_pending = fast;
+    if (fast) {
+        // [优化] 指定BSSID和信道，驱动只在该信道上探测，省去全信道扫描
+        ESP_LOGI("WiFiMan", "Fast connect to %02X:%02X:%02X:%02X:%02X:%02X on channel %u.",
+                 _cache.bssid[0], _cache.bssid[1], _cache.bssid[2], _cache.bssid[3], _cache.bssid[4], _cache.bssid[5], _cache.channel);
+        WiFi.begin(settings.wifi_ssid, settings.wifi_password, _cache.channel, _cache.bssid);
+    } else {
+        WiFi.begin(settings.wifi_ssid, settings.wifi_password);
+    }
+}
+
 void Sys_WiFiManager::startAP(const SystemSettings& settings) {
     const char* ap_ssid = "ESP32S3-Device"; // Can be read from settings in the future
     ESP_LOGI("WiFiMan", "Triggering AP mode with SSID: %s", ap_ssid);
@@ -144,6 +264,47 @@ void Sys_WiFiManager::stopAP() {
     WiFi.softAPdisconnect(true);
 }
 
+void Sys_WiFiManager::updateConnectionCache(const arduino_event_info_t& info) {
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid == nullptr) {
+        return;
+    }
+    ConnectionCache cache = {};
+    cache.ip = info.got_ip.ip_info.ip.addr;
+    cache.gateway = info.got_ip.ip_info.gw.addr;
+    cache.subnet = info.got_ip.ip_info.netmask.addr;
+    cache.dns = (uint32_t)WiFi.dnsIP();
+    cache.version = CONNECTION_CACHE_VERSION;
+    cache.channel = (uint8_t)WiFi.channel();
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    strlcpy(cache.ssid, WiFi.SSID().c_str(), sizeof(cache.ssid));
+    _cache = cache;
+    _cache_valid = true;
+    Sys_Scheduler::startTimer(_cache_save_timer, 0); // NVS写入交给Task_SystemMonitor
+}
+
+void Sys_WiFiManager::publishScanResults() {
+    int16_t n = WiFi.scanComplete();
+    ESP_LOGI("WiFiMan", "Scan finished. Found %d networks.", n);
+
+    JsonDocument scan_result_doc;
+    scan_result_doc["jsonrpc"] = "2.0";
+    scan_result_doc["method"] = "wifi.scanResult";
+    JsonArray networks = scan_result_doc["params"].to<JsonArray>();
+    for (int16_t i = 0; i < n; ++i) {
+        JsonObject net = networks.add<JsonObject>();
+        net["ssid"] = WiFi.SSID(i);
+        net["rssi"] = WiFi.RSSI(i);
+        net["auth"] = WiFi.encryptionType(i);
+    }
+    WiFi.scanDelete();
+
+    // [优化] 直接序列化进PSRAM中的通知环形缓冲区，大型扫描结果不再被截断
+    if (!Sys_Tasks::postNotification(scan_result_doc)) {
+        ESP_LOGW("WiFiMan", "WiFi scan result dropped.");
+    }
+}
+
 // --- Static Event Handler ---
 // 这是整个模块的核心驱动力，所有状态转换都在这里发生
 void Sys_WiFiManager::WiFiEvent(WiFiEvent_t event, arduino_event_info_t info) {
@@ -173,7 +334,6 @@ void Sys_WiFiManager::WiFiEvent(WiFiEvent_t event, arduino_event_info_t info) {
         case ARDUINO_EVENT_WIFI_STA_START:
             ESP_LOGI("WiFiMan", "STA Mode Started. Connecting...");
             _instance->_currentState = WiFiState::CONNECTING;
-            _instance->_last_reconnect_attempt_ms = millis();
             break;
             
         case ARDUINO_EVENT_WIFI_STA_CONNECTED:
@@ -187,6 +347,10 @@ void Sys_WiFiManager::WiFiEvent(WiFiEvent_t event, arduino_event_info_t info) {
             // [日志] 记录STA连接成功事件
             Sys_FlashLogger::getInstance()->log("[WiFi]", "STA Connected. IP: %s", ip.c_str());
             _instance->_sta_retry_count = 0; // 连接成功，重置重试计数器
+            _instance->_backoff_count = 0;
+            _instance->_fast_connect_pending = false;
+            Sys_Scheduler::stopTimer(_instance->_reconnect_timer);
+            _instance->updateConnectionCache(info);
             _instance->_currentState = WiFi.softAPgetStationNum() > 0 ? WiFiState::HOSTING_AP_STA : WiFiState::CONNECTED_STA;
             break;
         }
@@ -198,6 +362,16 @@ void Sys_WiFiManager::WiFiEvent(WiFiEvent_t event, arduino_event_info_t info) {
             // [日志] 记录STA断开连接事件
             Sys_FlashLogger::getInstance()->log("[WiFi]", "STA Disconnected. Reason: %s (%d)", reason_name, reason);
 
+            // [新增] 快速连接失败（AP换了信道或已不存在）：不计入重试次数，立即回退到扫描连接
+            if (_instance->_fast_connect_pending) {
+                ESP_LOGW("WiFiMan", "Fast connect failed, falling back to a full scan.");
+                _instance->_fast_connect_pending = false;
+                _instance->_cache_valid = false;
+                _instance->_currentState = WiFiState::DISCONNECTED;
+                Sys_Scheduler::startTimer(_instance->_reconnect_timer, 0);
+                break;
+            }
+
             // [优化] 智能重连逻辑
             // 检查是否是“永久性”错误
             if (reason == WIFI_REASON_NO_AP_FOUND || reason == WIFI_REASON_AUTH_EXPIRE || reason == WIFI_REASON_AUTH_FAIL) {
@@ -206,7 +380,7 @@ void Sys_WiFiManager::WiFiEvent(WiFiEvent_t event, arduino_event_info_t info) {
                 if (_instance->_sta_retry_count >= MAX_STA_RETRIES) {
                     ESP_LOGE("WiFiMan", "Max retries reached. Entering permanent failure state.");
                     // [日志] 记录连接永久失败错误
-                    Sys_FlashLogger::getInstance()->log("[WiFi]", "ERROR: Max retries reached. Entering permanent failure state.");
+                    Sys_FlashLogger::getInstance()->log(ESP_LOG_ERROR, "[WiFi]", "Max retries reached. Entering permanent failure state.");
                     _instance->_currentState = WiFiState::FAILED_PERMANENTLY;
                     // 在这里停止，不再尝试重连
                     break;
@@ -214,10 +388,16 @@ void Sys_WiFiManager::WiFiEvent(WiFiEvent_t event, arduino_event_info_t info) {
             }
             // 对于其他临时性断开或未达到重试上限的永久性错误，进入常规重连流程
             _instance->_currentState = WiFiState::DISCONNECTED;
-            _instance->_last_reconnect_attempt_ms = millis(); 
+            Sys_Scheduler::startTimer(_instance->_reconnect_timer, _instance->reconnectDelay());
             break;
         }
         
+        case ARDUINO_EVENT_WIFI_SCAN_DONE:
+            // [新增] 异步扫描完成，推送 wifi.scanResult 通知
+            _instance->_scan_in_progress = false;
+            _instance->publishScanResults();
+            break;
+
         default:
             break;
     }
@@ -0,0 +1,313 @@
+/**
+ * @file Sys_WsBroadcaster.cpp
+ * @brief 感知客户端背压的WebSocket广播器的实现
+ * @author [ANEAK]
+ * @date [2025/7]
+ */
+#include "Sys_WsBroadcaster.h"
+#include "Sys_Debug.h"
+#include "Sys_MemoryManager.h" // 部分客户端拥塞时，序列化暂存区从PSRAM内存池分配
+#include "Sys_StateRegistry.h"  // 状态增量的来源
+
+// --- 静态成员初始化 ---
+Sys_WsBroadcaster* Sys_WsBroadcaster::_instance = nullptr;
+
+/**
+ * @brief 获取单例实例。
+ */
+Sys_WsBroadcaster* Sys_WsBroadcaster::getInstance() {
+    if (_instance == nullptr) {
+        _instance = new Sys_WsBroadcaster();
+    }
+    return _instance;
+}
+
+void Sys_WsBroadcaster::begin(AsyncWebSocket* webSocket) {
+    _ws = webSocket;
+}
+
+// --- 会话表维护 (AsyncTCP任务) ---
+
+void Sys_WsBroadcaster::onClientConnected(uint32_t client_id) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        uint32_t expected = FREE_SLOT;
+        if (_sessions[i].client_id.compare_exchange_strong(expected, client_id, std::memory_order_acq_rel)) {
+            _sessions[i].encoding.store(static_cast<uint8_t>(WsEncoding::JSON), std::memory_order_release); // 新连接默认使用JSON
+            _sessions[i].subscription_mask.store(Sys_StateRegistry::ALL_FIELDS, std::memory_order_release); // 默认订阅全部字段
+            return;
+        }
+    }
+    ESP_LOGW("WsBroadcast", "Session table full, client #%u will not receive notifications.", client_id);
+}
+
+void Sys_WsBroadcaster::onClientDisconnected(uint32_t client_id) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        uint32_t expected = client_id;
+        if (_sessions[i].client_id.compare_exchange_strong(expected, FREE_SLOT, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+}
+
+bool Sys_WsBroadcaster::hasClients() const {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (_sessions[i].client_id.load(std::memory_order_acquire) != FREE_SLOT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- 投递逻辑 (Task_WebSocketPusher) ---
+
+AsyncWebSocketClient* Sys_WsBroadcaster::resolveClient(ClientSession& session) {
+    const uint32_t id = session.client_id.load(std::memory_order_acquire);
+
+    if (id != session.owner_id) {
+        // 槽位易主：为离开的客户端输出一次统计，然后为新客户端重置状态
+        if (session.owner_id != FREE_SLOT && (session.states_coalesced > 0 || session.messages_dropped > 0)) {
+            ESP_LOGI("WsBroadcast", "Client #%u left: %u state updates coalesced, %u messages dropped.",
+                     session.owner_id, session.states_coalesced, session.messages_dropped);
+        }
+        session.owner_id = id;
+        session.delivered_state_seq = 0; // 新客户端尚未收到任何状态，下一次刷新时得到完整快照
+        session.deferred_state_seq = 0;
+        session.states_coalesced = 0;
+        session.messages_dropped = 0;
+    }
+
+    if (id == FREE_SLOT || _ws == nullptr) {
+        return nullptr;
+    }
+    AsyncWebSocketClient* client = _ws->client(id);
+    if (client == nullptr || client->status() != WS_CONNECTED) {
+        return nullptr;
+    }
+    return client;
+}
+
+bool Sys_WsBroadcaster::isWritable(AsyncWebSocketClient* client) {
+    return client->canSend() && client->queueLen() < MAX_CLIENT_BACKLOG;
+}
+
+bool Sys_WsBroadcaster::setClientEncoding(uint32_t client_id, WsEncoding encoding) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (_sessions[i].client_id.load(std::memory_order_acquire) == client_id) {
+            _sessions[i].encoding.store(static_cast<uint8_t>(encoding), std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+WsEncoding Sys_WsBroadcaster::getClientEncoding(uint32_t client_id) const {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (_sessions[i].client_id.load(std::memory_order_acquire) == client_id) {
+            return static_cast<WsEncoding>(_sessions[i].encoding.load(std::memory_order_acquire));
+        }
+    }
+    return WsEncoding::JSON;
+}
+
+bool Sys_WsBroadcaster::setClientSubscription(uint32_t client_id, uint32_t field_mask) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (_sessions[i].client_id.load(std::memory_order_acquire) == client_id) {
+            _sessions[i].subscription_mask.store(field_mask, std::memory_order_release);
+            _sessions[i].snapshot_requested.store(true, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+Sys_WsBroadcaster::DeliveryPlan Sys_WsBroadcaster::collectWritableClients() {
+    DeliveryPlan plan;
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        ClientSession& session = _sessions[i];
+        AsyncWebSocketClient* client = resolveClient(session);
+        if (client == nullptr) {
+            continue;
+        }
+        plan.connected_mask |= (1u << i);
+        if (isWritable(client)) {
+            plan.target_mask[session.encoding.load(std::memory_order_acquire)] |= (1u << i);
+        } else {
+            session.messages_dropped++;
+        }
+    }
+    return plan;
+}
+
+void Sys_WsBroadcaster::sendEach(const char* message, size_t len, uint32_t target_mask, WsEncoding encoding) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (!(target_mask & (1u << i))) {
+            continue;
+        }
+        AsyncWebSocketClient* client = _ws->client(_sessions[i].owner_id);
+        if (client == nullptr) {
+            continue;
+        }
+        if (encoding == WsEncoding::MSGPACK) {
+            client->binary((const uint8_t*)message, len);
+        } else {
+            client->text(message, len);
+        }
+    }
+}
+
+void Sys_WsBroadcaster::deliver(const char* message, size_t len, uint32_t target_mask, WsEncoding encoding, const DeliveryPlan& plan) {
+    if (target_mask == 0) {
+        return;
+    }
+
+    if (target_mask == plan.connected_mask) {
+        // 所有客户端都是目标（且编码相同）：负载只拷贝一次，由库对共享缓冲区进行引用计数
+        AsyncWebSocketMessageBuffer* buffer = _ws->makeBuffer(len);
+        if (buffer != nullptr) {
+            memcpy(buffer->get(), message, len);
+            if (encoding == WsEncoding::MSGPACK) {
+                _ws->binaryAll(buffer);
+            } else {
+                _ws->textAll(buffer);
+            }
+            return;
+        }
+    }
+
+    sendEach(message, len, target_mask, encoding);
+}
+
+bool Sys_WsBroadcaster::deliverDocument(JsonDocument& doc, uint32_t target_mask, WsEncoding encoding, const DeliveryPlan& plan) {
+    if (target_mask == 0) {
+        return true;
+    }
+    if (doc.overflowed()) {
+        ESP_LOGW("WsBroadcast", "Broadcast document incomplete (out of memory), dropped.");
+        return false;
+    }
+
+    const bool msgpack = (encoding == WsEncoding::MSGPACK);
+    const size_t len = msgpack ? measureMsgPack(doc) : measureJson(doc);
+    if (target_mask == plan.connected_mask) {
+        // 直接序列化进共享缓冲区，没有任何中间字符串
+        AsyncWebSocketMessageBuffer* buffer = _ws->makeBuffer(len);
+        if (buffer != nullptr) {
+            if (msgpack) {
+                serializeMsgPack(doc, (char*)buffer->get(), len);
+                _ws->binaryAll(buffer);
+            } else {
+                serializeJson(doc, (char*)buffer->get(), len);
+                _ws->textAll(buffer);
+            }
+            return true;
+        }
+    }
+
+    // 部分客户端拥塞或编码不一：序列化一次到PSRAM暂存区，再逐个发送
+    char* staging = (char*)Sys_MemoryManager::getInstance()->allocate(len + 1);
+    if (staging == nullptr) {
+        ESP_LOGW("WsBroadcast", "No staging buffer for %u-byte broadcast, dropped.", len);
+        return false;
+    }
+    if (msgpack) {
+        serializeMsgPack(doc, staging, len);
+    } else {
+        serializeJson(doc, staging, len + 1);
+    }
+    sendEach(staging, len, target_mask, encoding);
+    Sys_MemoryManager::getInstance()->release(staging);
+    return true;
+}
+
+void Sys_WsBroadcaster::flushStateDeltas() {
+    Sys_StateRegistry* registry = Sys_StateRegistry::getInstance();
+    registry->tick();
+    const uint32_t current_seq = registry->getSequence();
+    if (current_seq == 0) {
+        return; // 尚无任何状态字段发布过值
+    }
+
+    // 1. 找出需要增量且可写的客户端
+    DeliveryPlan plan;
+    uint32_t pending_mask = 0;
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        ClientSession& session = _sessions[i];
+        AsyncWebSocketClient* client = resolveClient(session);
+        if (client == nullptr) {
+            continue;
+        }
+        plan.connected_mask |= (1u << i);
+        if (session.snapshot_requested.exchange(false, std::memory_order_acq_rel)) {
+            session.delivered_state_seq = 0; // 订阅变更，补发一次完整快照
+        }
+        if (session.delivered_state_seq == current_seq) {
+            continue;
+        }
+        if (!isWritable(client)) {
+            // 保持未送达；期间的变更会合并进客户端恢复后的下一条增量
+            if (session.deferred_state_seq != current_seq) {
+                session.deferred_state_seq = current_seq;
+                session.states_coalesced++;
+            }
+            continue;
+        }
+        pending_mask |= (1u << i);
+    }
+
+    // 2. 按(已送达序号, 订阅位图, 编码)分组，每组只生成并序列化一份增量
+    while (pending_mask != 0) {
+        const size_t leader = __builtin_ctz(pending_mask);
+        const uint32_t since_seq = _sessions[leader].delivered_state_seq;
+        const uint32_t field_mask = _sessions[leader].subscription_mask.load(std::memory_order_acquire);
+        const uint8_t encoding = _sessions[leader].encoding.load(std::memory_order_acquire);
+
+        uint32_t group_mask = 0;
+        for (size_t i = leader; i < MAX_CLIENTS; ++i) {
+            if ((pending_mask & (1u << i)) &&
+                _sessions[i].delivered_state_seq == since_seq &&
+                _sessions[i].subscription_mask.load(std::memory_order_acquire) == field_mask &&
+                _sessions[i].encoding.load(std::memory_order_acquire) == encoding) {
+                group_mask |= (1u << i);
+            }
+        }
+        pending_mask &= ~group_mask;
+
+        JsonDocument doc(Sys_PsramJsonAllocator::instance());
+        doc["jsonrpc"] = "2.0";
+        doc["method"] = "system.stateUpdate";
+        JsonObject params = doc["params"].to<JsonObject>();
+        if (registry->writeDelta(params, since_seq, field_mask) > 0 &&
+            !deliverDocument(doc, group_mask, static_cast<WsEncoding>(encoding), plan)) {
+            // 投递失败：保持已送达序号不变，下一次刷新（最迟在推送任务超时唤醒时）重新生成并发送这份增量
+            continue;
+        }
+
+        for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+            if (group_mask & (1u << i)) {
+                _sessions[i].delivered_state_seq = current_seq;
+            }
+        }
+    }
+}
+
+void Sys_WsBroadcaster::broadcast(const char* message, size_t len) {
+    const DeliveryPlan plan = collectWritableClients();
+    deliver(message, len, plan.target_mask[static_cast<size_t>(WsEncoding::JSON)], WsEncoding::JSON, plan);
+
+    const uint32_t msgpack_mask = plan.target_mask[static_cast<size_t>(WsEncoding::MSGPACK)];
+    if (msgpack_mask != 0) {
+        // 文本消息只为二进制客户端解析一次
+        JsonDocument doc(Sys_PsramJsonAllocator::instance());
+        if (deserializeJson(doc, message, len)) {
+            ESP_LOGW("WsBroadcast", "Broadcast message is not valid JSON, skipped for MessagePack clients.");
+            return;
+        }
+        deliverDocument(doc, msgpack_mask, WsEncoding::MSGPACK, plan);
+    }
+}
+
+void Sys_WsBroadcaster::broadcast(JsonDocument& doc) {
+    const DeliveryPlan plan = collectWritableClients();
+    deliverDocument(doc, plan.target_mask[static_cast<size_t>(WsEncoding::JSON)], WsEncoding::JSON, plan);
+    deliverDocument(doc, plan.target_mask[static_cast<size_t>(WsEncoding::MSGPACK)], WsEncoding::MSGPACK, plan);
+}
@@ -6,13 +6,16 @@
  *
  * @details
  * 本文件是整个嵌入式系统的启动程序。它的核心职责是：
- * 1. 在单线程的 `setup()` 环境中，按照严格的依赖顺序初始化所有核心服务模块。
+ * 1. 在 `setup()` 中按照声明的依赖关系初始化所有核心服务模块。
  * 2. 启动FreeRTOS任务调度器，将系统从单线程模式切换到多任务并发模式。
  * 3. `loop()` 函数在多任务启动后将不再被主要使用，系统的心跳和业务逻辑
  *    完全由后台的FreeRTOS任务驱动。
  *
- * 初始化顺序至关重要，遵循以下逻辑：
- *   硬件层 -> NVS -> 设置 -> 内存 -> 文件系统 -> 日志 -> 网络 -> 任务调度
+ * [优化] 初始化不再严格串行，而是一张由`Sys_Boot`执行的阶段图，互不依赖的阶段在两个核心上同时进行：
+ *   NVS -> 设置 -> WiFi / 蓝牙
+ *   内存 -> 文件系统 -> 日志 ；内存 -> 摄像头管线
+ *   文件系统 + 日志 + WiFi -> Web服务器
+ * 所有阶段完成后再创建后台任务；调试构建中的诊断报告推迟到一个低优先级的后台任务中执行。
  */
 
 #include <Arduino.h>
@@ -24,83 +27,130 @@
 #include "Sys_MemoryManager.h"
 #include "Sys_Filesystem.h"
 #include "Sys_FlashLogger.h"
+#include "Sys_Scheduler.h"
+#include "Sys_Boot.h"         // [新增] 分阶段并行启动
 #include "Sys_WiFiManager.h"
 #include "Sys_BlueToothManager.h"
 #include "Sys_WebServer.h"
+#include "Sys_CameraPipeline.h"
 #include "Sys_Tasks.h"
+#include "Sys_StateRegistry.h"
+#include "Sys_WsBroadcaster.h"
 
 // --- 调试与诊断工具 ---
 #include "Sys_Debug.h"
 #include "Sys_Diagnostics.h"
+#include "Sys_Benchmark.h" // [新增] 基准测试固件 (SYS_BENCH_MODE)
 
 // 定义固件版本号
 #define FIRMWARE_VERSION "5.5.1"
 
+// [新增] 启动时等待串口监视器连接的时间（毫秒），默认不等待
+#ifndef SYS_BOOT_SERIAL_WAIT_MS
+#define SYS_BOOT_SERIAL_WAIT_MS 0
+#endif
+
+// --- [新增] 启动阶段图 ---
+// 每个阶段声明它依赖的阶段（只能依赖表中排在前面的阶段），`Sys_Boot`让互不依赖的阶段并行执行。
+
+/** @brief 启动阶段在`BOOT_STAGES`中的下标。*/
+enum BootStageIndex : uint8_t {
+    STAGE_NVS,        // NVS是所有配置管理的基础
+    STAGE_MEMORY,     // 为文件系统和其他模块准备内存池和PSRAM堆
+    STAGE_SETTINGS,   // 依赖NVS来加载配置，并执行健壮的迁移逻辑
+    STAGE_FILESYSTEM, // 挂载LittleFS和FFat，为Web服务器和日志系统做准备
+    STAGE_WIFI,       // 读取WiFi配置并尝试自动连接（同时初始化TCP/IP协议栈）
+    STAGE_LOGGER,     // 依赖文件系统来存储日志
+    STAGE_BLUETOOTH,  // 依赖设置中的蓝牙配置
+    STAGE_CAMERA,     // 依赖内存管理器提供的帧缓冲，三个处理任务固定在Core 0上运行
+    STAGE_WEBSERVER,  // 依赖文件系统、日志查询接口和网络协议栈
+    STAGE_COUNT
+};
+
+static const Sys_Boot::Stage BOOT_STAGES[] = {
+    {"nvs", [] { return Sys_NvsManager::initialize() == ESP_OK; }, 0},
+    {"memory", [] { return Sys_MemoryManager::getInstance()->initializePools(); }, 0},
+    {"settings", [] { Sys_SettingsManager::getInstance()->begin(); return true; },
+        Sys_Boot::after(STAGE_NVS)},
+    {"filesystem", [] { return Sys_Filesystem::getInstance()->begin(); },
+        Sys_Boot::after(STAGE_MEMORY)},
+    {"wifi", [] { Sys_WiFiManager::getInstance()->begin(); return true; },
+        Sys_Boot::after(STAGE_SETTINGS)},
+    {"logger", [] { return Sys_FlashLogger::getInstance()->begin("/sys/system"); }, // 分段文件: /sys/system.<n>.blog
+        Sys_Boot::after(STAGE_FILESYSTEM)},
+    {"bluetooth", [] { Sys_BlueToothManager::getInstance()->begin(); return true; },
+        Sys_Boot::after(STAGE_SETTINGS)},
+    {"camera", [] { return Sys_CameraPipeline::getInstance()->begin(); },
+        Sys_Boot::after(STAGE_MEMORY)},
+    {"webserver", [] { Sys_WebServer::getInstance()->begin(); return true; },
+        Sys_Boot::after(STAGE_FILESYSTEM) | Sys_Boot::after(STAGE_LOGGER) | Sys_Boot::after(STAGE_WIFI)},
+};
+static_assert(sizeof(BOOT_STAGES) / sizeof(BOOT_STAGES[0]) == STAGE_COUNT, "BOOT_STAGES out of sync with BootStageIndex");
+
+#if CORE_DEBUG_MODE
+/**
+ * @brief [优化] 诊断报告任务：在启动完成后以低优先级运行一次，然后自行删除。
+ */
+static void taskDeferredDiagnostics(void* parameter) {
+    DEBUG_LOG("Running post-boot diagnostics report...");
+    Sys_Diagnostics::run();
+    vTaskDelete(NULL);
+}
+#endif
+
 /**
  * @brief 系统启动函数 (setup)
  *
- * 在这里，系统以单线程模式运行，是进行所有模块初始化和资源分配的
- * 安全时机。所有单例模式的 `getInstance()` 首次调用都在此完成。
+ * 单例的首次`getInstance()`调用仍在此处的单线程环境中完成，之后才并行执行各启动阶段。
  */
 void setup() {
     // 步骤 1: 初始化物理串口，用于早期调试日志输出
     Serial.begin(115200);
-    delay(1000); // 给予串口监视器足够的时间来连接
+    if (SYS_BOOT_SERIAL_WAIT_MS > 0) {
+        delay(SYS_BOOT_SERIAL_WAIT_MS); // 给予串口监视器足够的时间来连接
+    }
     ESP_LOGI("Boot", "\n\n--- ESP32-S3 Modular Management System Booting ---");
 
-    // 步骤 2: 初始化NVS（非易失性存储）
-    // 这是所有配置管理的基础，必须最先执行。
-    ESP_LOGI("Boot", "[1/9] Initializing NVS Manager...");
-    Sys_NvsManager::initialize();
-
-    // 步骤 3: 初始化设置管理器
-    // 它依赖NVS来加载配置，并执行健壮的迁移逻辑。
-    ESP_LOGI("Boot", "[2/9] Initializing Settings Manager...");
-    Sys_SettingsManager::getInstance()->begin();
-
-    // 步骤 4: 初始化内存管理器
-    // 为文件系统和其他模块准备内存池和PSRAM堆。
-    ESP_LOGI("Boot", "[3/9] Initializing Memory Manager...");
-    Sys_MemoryManager::getInstance()->initializePools();
-
-    // 步骤 5: 初始化文件系统
-    // 挂载LittleFS和FFat，为Web服务器和日志系统做准备。
-    ESP_LOGI("Boot", "[4/9] Initializing Filesystem...");
-    Sys_Filesystem::getInstance()->begin();
-
-    // 步骤 6: 初始化闪存日志系统
-    // 它依赖文件系统来存储日志。
-    ESP_LOGI("Boot", "[5/9] Initializing Flash Logger...");
-    Sys_FlashLogger::getInstance()->begin("/sys/system.log");
-
-    // 步骤 7: 初始化WiFi管理器
-    // 它会读取NVS中的WiFi配置并尝试自动连接。
-    ESP_LOGI("Boot", "[6/9] Initializing WiFi Manager...");
-    Sys_WiFiManager::getInstance()->begin();
-    
-    // 步骤 8: 初始化Web服务器
-    // 它依赖文件系统和网络服务。
-    ESP_LOGI("Boot", "[7/9] Initializing Web Server...");
-    Sys_WebServer::getInstance()->begin();
-
-    // 步骤 9: 初始化蓝牙管理器 (如果启用)
-    ESP_LOGI("Boot", "[8/9] Initializing BlueTooth Manager...");
-    Sys_BlueToothManager::getInstance()->begin();
-
-    // 步骤 10: 创建所有后台服务任务
+    // 步骤 2: [新增] 在并行阶段开始前构造所有单例（简单单例模式要求首次调用是单线程的），
+    // 并初始化调度器（WiFi等模块在各自的begin()中创建定时器）
+    Sys_SettingsManager::getInstance();
+    Sys_MemoryManager::getInstance();
+    Sys_Filesystem::getInstance();
+    Sys_FlashLogger::getInstance();
+    Sys_WiFiManager::getInstance();
+    Sys_BlueToothManager::getInstance();
+    Sys_WebServer::getInstance();
+    Sys_CameraPipeline::getInstance();
+    Sys_StateRegistry::getInstance();
+    Sys_WsBroadcaster::getInstance();
+    Sys_Scheduler::begin();
+
+    #if SYS_BENCH_MODE
+        // [新增] 基准测试固件：只执行到文件系统为止的阶段（内存池和文件系统就绪），不再启动网络和后台任务
+        Sys_Boot::run(BOOT_STAGES, STAGE_FILESYSTEM + 1);
+        Sys_Benchmark::run(FIRMWARE_VERSION);
+        return;
+    #endif
+
+    // 步骤 3: [优化] 按依赖关系并行执行所有启动阶段
+    Sys_Boot::run(BOOT_STAGES, STAGE_COUNT);
+
+    // 步骤 4: 创建所有后台服务任务
     // 这是最后一步，在所有基础服务都初始化完毕后，启动系统的“大脑”。
-    ESP_LOGI("Boot", "[9/9] Creating all background tasks...");
+    ESP_LOGI("Boot", "Creating all background tasks...");
     Sys_Tasks::begin(Sys_WebServer::getInstance()->getWebSocket());
 
+    // [新增] 启动耗时作为状态字段发布，出现在客户端收到的第一条状态更新中
+    Sys_Boot::publishTiming();
+
     ESP_LOGI("Boot", "--- System Initialization Complete. Handing over to FreeRTOS... ---");
 
     // [日志] 记录系统启动成功事件
     Sys_FlashLogger::getInstance()->log("[Main]", "System booted successfully. Version: %s", FIRMWARE_VERSION);
 
-    // [按需调试] 如果需要，可以在这里运行一次诊断报告
+    // [按需调试] 诊断报告推迟到低优先级的后台任务中，不再阻塞启动
     #if CORE_DEBUG_MODE
-        DEBUG_LOG("Running post-boot diagnostics report...");
-        Sys_Diagnostics::run();
+        xTaskCreatePinnedToCore(taskDeferredDiagnostics, "Task_Diagnostics", 8192, NULL, tskIDLE_PRIORITY + 1, NULL, 1);
     #endif
 }
 
@@ -0,0 +1,271 @@
+/**
+ * @file main_native.cpp
+ * @brief [新增] 主机端（`native`环境）驱动程序：核心模块的基准测试与模糊测试入口
+ * @author [ANEAK]
+ * @date [2025/7]
+ *
+ * @details
+ * 只在`pio run -e native`构建中编译（`SYS_NATIVE_BUILD`），依赖`lib/native_shims`提供的
+ * FreeRTOS/NVS/FS替代实现，链接的核心模块与固件中的完全相同：
+ * `Sys_RpcRouter`、`Sys_SettingsManager`、`Sys_NvsManager`、`Sys_FlashLogger`、`Sys_Lzss`、
+ * `Sys_MemoryManager`和`Sys_Filesystem`。
+ *
+ * 用法：
+ * - `program`                      运行主机端基准测试，结果以与固件相同的`BENCH {json}`行输出到stdout
+ *                                   （日志输出到stderr），可直接交给`bench_compare.py`。
+ * - `program replay <file>...`     把每个文件作为一帧原始WebSocket数据，走一遍`parseFrame()`和`dispatch()`；
+ *                                   用于回放AFL语料库，或在`native_asan`环境中复现崩溃。
+ * - 定义`SYS_NATIVE_LIBFUZZER`时，改为提供libFuzzer入口`LLVMFuzzerTestOneInput`（不编译`main`）。
+ *
+ * 帧的编码按首个非空白字节判断：`{`或`[`按JSON解析，其余按MessagePack解析。
+ * 主机文件系统的根目录由环境变量`SYS_NATIVE_FS_ROOT`指定（默认`.native_fs`）。
+ */
+#if SYS_NATIVE_BUILD
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "esp_timer.h"
+#include "ArduinoJson.h"
+#include "types.h"
+#include "Sys_RpcRouter.h"
+#include "Sys_NvsManager.h"
+#include "Sys_SettingsManager.h"
+#include "Sys_MemoryManager.h"
+#include "Sys_Filesystem.h"
+#include "Sys_FlashLogger.h"
+
+static const char* TAG = "Native";
+
+/** @brief 驱动程序自己注册的RPC方法，原样返回`params`，用于测量路由与响应序列化的开销。*/
+static void rpcNativeEcho(const JsonRpcRequest& request) {
+    JsonDocument result;
+    result.set(request.params);
+    Sys_RpcRouter::sendResult(request, result);
+}
+
+/**
+ * @brief 按固件中`setup()`的顺序初始化主机端可用的核心模块。
+ */
+static void initCoreModules() {
+    Sys_NvsManager::initialize();
+    Sys_SettingsManager::getInstance()->begin();
+    Sys_MemoryManager::getInstance()->initializePools();
+    Sys_Filesystem::getInstance()->begin();
+    Sys_FlashLogger::getInstance()->begin("/sys/system");
+    Sys_RpcRouter::registerMethod("native.echo", rpcNativeEcho);
+}
+
+/**
+ * @brief 解析并分发一帧数据，响应写入计数后丢弃。
+ * @return size_t 响应的字节数（解析失败时为错误响应的字节数）。
+ */
+static size_t handleFrame(const uint8_t* data, size_t len) {
+    JsonRpcRequest* request = JsonRpcRequest::create();
+    if (request == nullptr) return 0;
+
+    size_t response_bytes = 0;
+    request->response_cb = [&response_bytes](const char* response, size_t response_len) {
+        (void)response;
+        response_bytes += response_len;
+    };
+
+    size_t first = 0;
+    while (first < len && isspace(data[first])) ++first;
+    const bool msgpack = first < len && data[first] != '{' && data[first] != '[';
+
+    const int error = Sys_RpcRouter::parseFrame(*request, (const char*)data, len, msgpack);
+    if (error != 0) {
+        request->encoding = msgpack ? WsEncoding::MSGPACK : WsEncoding::JSON;
+        Sys_RpcRouter::sendError(*request, error, error == -32700 ? "Parse error" : "Invalid Request");
+    } else {
+        Sys_RpcRouter::dispatch(*request);
+    }
+
+    JsonRpcRequest::release(request);
+    return response_bytes;
+}
+
+#if SYS_NATIVE_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool initialized = [] {
+        initCoreModules();
+        return true;
+    }();
+    (void)initialized;
+    handleFrame(data, size);
+    return 0;
+}
+
+#else
+
+// --- 基准测试 ---
+
+/**
+ * @brief 输出一行结果，格式与`Sys_Benchmark::report()`一致（suite固定为"native"）。
+ */
+static void report(const char* name, double value, const char* unit) {
+    JsonDocument doc;
+    doc["suite"] = "native";
+    doc["name"] = name;
+    doc["value"] = serialized(String(value, 3));
+    doc["unit"] = unit;
+    char line[256];
+    serializeJson(doc, line, sizeof(line));
+    printf("BENCH %s\n", line);
+}
+
+/**
+ * @brief 把`op`重复执行`iterations`次，报告每秒操作数。
+ */
+template <typename Op>
+static void benchOps(const char* name, uint32_t iterations, Op op) {
+    const int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        op(i);
+    }
+    const int64_t elapsed_us = esp_timer_get_time() - start;
+    report(name, elapsed_us > 0 ? iterations * 1e6 / elapsed_us : 0.0, "ops/s");
+}
+
+static void benchRpc() {
+    static const char JSON_FRAME[] =
+        "{\"jsonrpc\":\"2.0\",\"id\":42,\"method\":\"native.echo\","
+        "\"params\":{\"ssid\":\"MyNetwork\",\"password\":\"secret123\",\"mode\":3,\"tags\":[1,2,3,4,5,6,7,8]}}";
+
+    JsonDocument frame;
+    deserializeJson(frame, JSON_FRAME);
+    std::vector<uint8_t> msgpack_frame(measureMsgPack(frame));
+    serializeMsgPack(frame, msgpack_frame.data(), msgpack_frame.size());
+
+    benchOps("rpc.parse.json", 200000, [&](uint32_t) {
+        JsonRpcRequest* request = JsonRpcRequest::create();
+        Sys_RpcRouter::parseFrame(*request, JSON_FRAME, sizeof(JSON_FRAME) - 1, false);
+        JsonRpcRequest::release(request);
+    });
+    benchOps("rpc.parse.msgpack", 200000, [&](uint32_t) {
+        JsonRpcRequest* request = JsonRpcRequest::create();
+        Sys_RpcRouter::parseFrame(*request, (const char*)msgpack_frame.data(), msgpack_frame.size(), true);
+        JsonRpcRequest::release(request);
+    });
+    benchOps("rpc.roundtrip.json", 100000, [&](uint32_t) {
+        handleFrame((const uint8_t*)JSON_FRAME, sizeof(JSON_FRAME) - 1);
+    });
+    benchOps("rpc.roundtrip.msgpack", 100000, [&](uint32_t) {
+        handleFrame(msgpack_frame.data(), msgpack_frame.size());
+    });
+    benchOps("rpc.not_found", 200000, [&](uint32_t) {
+        static const char FRAME[] = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"no.such.method\"}";
+        handleFrame((const uint8_t*)FRAME, sizeof(FRAME) - 1);
+    });
+}
+
+static void benchSettings() {
+    Sys_SettingsManager* settings = Sys_SettingsManager::getInstance();
+    settings->setCommitWindow(0);
+
+    benchOps("settings.set_commit", 20000, [&](uint32_t i) {
+        char ssid[32];
+        snprintf(ssid, sizeof(ssid), "Network-%u", (unsigned)(i & 7));
+        settings->setWiFiConfig(ssid, "secret123", SystemSettings::WIFI_MODE_AP_STA);
+        settings->commit();
+    });
+    benchOps("settings.force_save", 20000, [&](uint32_t) {
+        settings->forceSave();
+    });
+    benchOps("settings.snapshot", 1000000, [&](uint32_t) {
+        volatile bool debug = settings->isDebugModeEnabled();
+        (void)debug;
+    });
+
+    settings->setCommitWindow(Sys_SettingsManager::DEFAULT_COMMIT_WINDOW_MS);
+}
+
+static void benchFlashLogger() {
+    Sys_FlashLogger* logger = Sys_FlashLogger::getInstance();
+
+    benchOps("flashlog.log", 200000, [&](uint32_t i) {
+        logger->log(ESP_LOG_INFO, "[Native]", "Sample record %u, free heap %u bytes, state=%s", i, 123456u, "connected");
+    });
+    benchOps("flashlog.log_long", 100000, [&](uint32_t i) {
+        logger->log(ESP_LOG_WARN, "[Native]", "Long record %u: %s", i,
+                    "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+                    "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+    });
+    // 落盘由后台任务异步完成（`flush()`只负责唤醒），其耗时不计入上面的结果
+}
+
+static void benchMemoryPool() {
+    Sys_MemoryManager* memory = Sys_MemoryManager::getInstance();
+
+    static const size_t SIZES[] = {256, 2048, 16384};
+    for (size_t size : SIZES) {
+        char name[48];
+        snprintf(name, sizeof(name), "mempool.alloc_free.%u", (unsigned)size);
+        benchOps(name, 1000000, [&](uint32_t) {
+            void* block = memory->allocate(size);
+            memory->release(block);
+        });
+    }
+}
+
+static int runBenchmarks() {
+    ESP_LOGI(TAG, "Running native benchmark suite, results are printed as 'BENCH {json}' lines.");
+    printf("BENCH {\"suite\":\"meta\",\"firmware\":\"native\",\"idf\":\"%s\"}\n", esp_get_idf_version());
+
+    benchRpc();
+    benchSettings();
+    benchFlashLogger();
+    benchMemoryPool();
+
+    printf("BENCH {\"suite\":\"done\"}\n");
+    return 0;
+}
+
+// --- 回放 ---
+
+static int replayFiles(int argc, char** argv) {
+    for (int i = 0; i < argc; ++i) {
+        FILE* f = fopen(argv[i], "rb");
+        if (!f) {
+            ESP_LOGE(TAG, "Cannot open '%s'.", argv[i]);
+            return 1;
+        }
+        std::vector<uint8_t> frame;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            frame.insert(frame.end(), buffer, buffer + n);
+        }
+        fclose(f);
+
+        const size_t response_bytes = handleFrame(frame.data(), frame.size());
+        ESP_LOGI(TAG, "%s: %u bytes in, %u bytes out", argv[i], (unsigned)frame.size(), (unsigned)response_bytes);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    initCoreModules();
+
+    int result;
+    if (argc >= 2 && strcmp(argv[1], "replay") == 0) {
+        result = replayFiles(argc - 2, argv + 2);
+    } else {
+        result = runBenchmarks();
+    }
+
+    Sys_FlashLogger::getInstance()->flush();
+    vTaskDelay(pdMS_TO_TICKS(200)); // 给后台刷写任务留出落盘时间
+    fflush(stdout);
+    fflush(stderr);
+    // 后台刷写线程仍在运行，跳过静态析构，避免与其竞争
+    _Exit(result);
+}
+
+#endif // SYS_NATIVE_LIBFUZZER
+
+#endif // SYS_NATIVE_BUILD